@@ -671,10 +671,18 @@ namespace
 			deviceFeatures.samplerAnisotropy = VK_TRUE;
 		/* gotta have the geom shader! */
 		deviceFeatures.geometryShader = VK_TRUE; // (used for the mesh density visualisation)
+		/* the virtual shadow map analysis pass marks pages from the fragment shader */
+		deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+
+		/* multiview renders every shadow cascade in a single pass */
+		VkPhysicalDeviceVulkan11Features deviceMultiviewFeatures{};
+		deviceMultiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+		deviceMultiviewFeatures.multiview = VK_TRUE;
 
 		VkPhysicalDeviceVulkan12Features deviceExtraFeatures{};
 		deviceExtraFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 		deviceExtraFeatures.hostQueryReset = VK_TRUE;
+		deviceExtraFeatures.pNext = &deviceMultiviewFeatures;
 
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
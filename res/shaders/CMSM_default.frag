@@ -0,0 +1,166 @@
+#version 450
+
+float eps = 0.0001;
+float pi = 3.141592;
+
+float depth_bias = 0.001;
+float normal_bias = 0.08;
+float min_variance = 0.00002;
+float light_bleed = 0.2;
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projCam;
+	vec4 position;
+} cameraData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+struct DirectionalLight
+{
+	vec4 direction;
+	vec4 colour;
+};
+
+struct AmbientLight
+{
+	vec4 colour;
+};
+
+layout(set = 2, binding = 0) uniform LightData
+{
+	DirectionalLight sunLight;
+	AmbientLight ambientLight;
+} lightingData;
+
+layout(set = 3, binding = 0) uniform sampler2DArray shadowMomentMap; /* rg: opaque moments, ba: nearest translucent moments */
+layout(set = 3, binding = 1) uniform sampler2DArray shadowTransmittanceMap;
+layout(set = 3, binding = 2) uniform DirectionalShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo; /* x: cascade count, y: CSSM colour format, z: rendered resolution */
+} shadowData;
+
+/* Helper functions */
+
+float pos(float x)
+{
+	return max(0.0, x);
+}
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+float ChebyshevUpperBound(vec2 moments, float depth)
+{
+	/* the fraction of the filter region that is at least as far as the fragment */
+	if (depth <= moments.x)
+		return 1.0;
+
+	float variance = max(moments.y - moments.x * moments.x, min_variance);
+	float d = depth - moments.x;
+	float pMax = variance / (variance + d * d);
+
+	/* cut off the tail of the bound, which otherwise leaks light where occluders overlap */
+	return clamp((pMax - light_bleed) / (1.0 - light_bleed), 0.0, 1.0);
+}
+
+uint SelectCascade(vec3 position)
+{
+	/* the first cascade whose far split lies beyond the fragment's view depth */
+	float viewDepth = abs((cameraData.view * vec4(position, 1.0)).z);
+	uint cascade = 0;
+	for (uint i = 0; i + 1 < shadowData.cascadeInfo.x; i++)
+		cascade += uint(viewDepth > shadowData.cascadeSplits[i]);
+	return cascade;
+}
+
+vec2 ShadowRegion(vec2 uv, vec2 mapSize)
+{
+	/* the map may be rendered below its allocated size, into the top left cascadeInfo.z texels,
+		clamp to that region so stale texels from a larger resolution are never read */
+	float region = float(shadowData.cascadeInfo.z);
+	return clamp(uv * region, vec2(0.5), vec2(region - 0.5)) / mapSize;
+}
+
+/* Lighting and Shading Calculations */
+
+vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
+{
+	/* direct lighting strength componenets */ 
+	vec3 to_cam = normalize(cameraPosition.rgb - position);
+	vec3 to_light = normalize(-lightingData.sunLight.direction.rgb);
+	vec3 half_vector = normalize(to_cam + to_light);
+
+	/* shadow coverage calculation */
+	vec3 normalBiasVector = normal * normal_bias;
+	uint cascade = SelectCascade(position);
+	vec4 shadowViewPosition = shadowData.cascadeProjView[cascade] * vec4(position, 1.0);
+	vec4 shadowCoords = vec4(shadowViewPosition / shadowViewPosition.w);
+	shadowCoords.x = shadowCoords.x * 0.5 + 0.5;
+	shadowCoords.y = shadowCoords.y * 0.5 + 0.5;
+	shadowCoords.z -= depth_bias;
+	shadowCoords.w = 1.0;
+
+	/* the maps are prefiltered, so one trilinear fetch covers the whole filter whatever its width.
+		the gradients come from the fragment's world position through this cascade's projection, so they
+		don't jump where neighbouring fragments pick different cascades */
+	vec2 mapSize = vec2(textureSize(shadowMomentMap, 0).xy);
+	vec2 scale = 0.5 * float(shadowData.cascadeInfo.z) / mapSize;
+	vec2 gradX = (mat3(shadowData.cascadeProjView[cascade]) * dFdx(position)).xy * scale;
+	vec2 gradY = (mat3(shadowData.cascadeProjView[cascade]) * dFdy(position)).xy * scale;
+	vec3 sampleCoords = vec3(ShadowRegion(shadowCoords.xy, mapSize), float(cascade));
+
+	vec4 moments = textureGrad(shadowMomentMap, sampleCoords, gradX, gradY);
+	vec3 transmittance = textureGrad(shadowTransmittanceMap, sampleCoords, gradX, gradY).rgb;
+
+	/* opaque casters block the light, translucent casters in front of the fragment tint it */
+	float shadowStrength = ChebyshevUpperBound(moments.rg, shadowCoords.z);
+	float inFront = ChebyshevUpperBound(moments.ba, shadowCoords.z);
+	vec3 shadowColour = mix(transmittance, vec3(1.0), inFront);
+
+	vec3 direct = (lightingData.sunLight.colour.rgb * shadowColour * shadowStrength * diffuse);
+	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
+
+	return ambient + (posDot(normal, to_light)) * direct;
+}
+
+/* main() */
+
+void main()
+{
+	vec3 diffuse = texture(uColourTex, iUV).rgb;
+	float metallic = uMaterialData.metallic;// * texture(UMetallicRoughnessTex, iUV).r;
+	float roughness = uMaterialData.roughness;// * texture(UMetallicRoughnessTex, iUV).g;
+	vec3 lit = uMaterialData.emissive + LightingCalculation(iPosition, normalize(iNormal), diffuse, 0.0, 0.0, cameraData.position.rgb);
+	oColour = vec4(lit, texture(uColourTex, iUV).a);
+}
\ No newline at end of file
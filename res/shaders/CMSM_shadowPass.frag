@@ -0,0 +1,43 @@
+#version 450
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+
+layout(location = 0) out vec4 oMoments;
+layout(location = 1) out vec4 oTransmittance;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+void main()
+{
+	/* fragment depth */
+	float depth = gl_FragCoord.z / gl_FragCoord.w;
+
+	/* the second moment is biased by the depth's slope over the texel, so a plane doesn't shadow itself once filtered */
+	float dx = dFdx(depth);
+	float dy = dFdy(depth);
+	float secondMoment = depth * depth + 0.25 * (dx * dx + dy * dy);
+
+	/* the pipeline's write mask keeps rg for opaque casters and ba for translucent ones */
+	oMoments = vec4(depth, secondMoment, depth, secondMoment);
+
+	/* for the purposes of this project's implementation transmission is assumed to be the same as diffuse colour,
+		the same light blocking probability as the CSSM passes */
+	vec4 texSample = texture(uColourTex, iUV);
+	vec3 transmission = texSample.rgb * 0.5;
+	vec3 lightProb = texSample.a * (1.0 - transmission);
+
+	/* multiplied into the attachment by the blend state */
+	oTransmittance = vec4(1.0 - lightProb, 1.0);
+}
@@ -0,0 +1,185 @@
+#version 450
+
+/* CSSM_MSAA lookup: the coloured stochastic shadow map is multisampled, every sample of the texels under the kernel is
+	fetched and averaged, so a lower resolution map and a smaller kernel see as many stochastic results as before */
+
+float eps = 0.0001;
+float pi = 3.141592;
+
+/* specialisation constants, set from PipelineFeatures::shadowFilter. a pcf_kernel of 0 takes the radius from
+	samplingInfo.y every frame, any other fixes it when the pipeline is made so the kernel's loops unroll */
+layout(constant_id = 0) const uint pcf_kernel = 0u;
+layout(constant_id = 1) const float depth_bias = 0.001;
+layout(constant_id = 2) const float normal_bias = 0.0; /* the depth bias does the work, this is only for a tier that wants one */
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projCam;
+	vec4 position;
+} cameraData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+struct DirectionalLight
+{
+	vec4 direction;
+	vec4 colour;
+};
+
+struct AmbientLight
+{
+	vec4 colour;
+};
+
+layout(set = 2, binding = 0) uniform LightData
+{
+	DirectionalLight sunLight;
+	AmbientLight ambientLight;
+} lightingData;
+
+layout(set = 3, binding = 0) uniform sampler2DMSArray shadowDepthMap;
+layout(set = 3, binding = 1) uniform sampler2DMSArray shadowColourMap;
+layout(set = 3, binding = 2) uniform DirectionalShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo; /* x: cascade count, y: CSSM colour format, z: rendered resolution */
+	uvec4 temporalInfo;
+	uvec4 samplingInfo; /* y: PCF radius, in texels of the multisampled map */
+} shadowData;
+
+/* Helper functions */
+
+float pos(float x)
+{
+	return max(0.0, x);
+}
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+float ColourDepthTolerance(float depth)
+{
+	/* one encoding step of the CSSM colour format at this depth, so rounding the stored depths doesn't self shadow
+		(cascadeInfo.y matches Renderer::CSSMColourFormat) */
+	switch (shadowData.cascadeInfo.y)
+	{
+		case 1u: return 1.0 / 65535.0; /* RGBA16_UNORM */
+		case 2u: return exp2(floor(log2(max(depth, 0.00006103515625))) - 10.0); /* RGBA16_SFLOAT, 10 bit mantissa */
+		case 3u: return 1.0 / 1023.0; /* RGB10A2_UNORM */
+		default: return 0.0; /* RGBA32_SFLOAT */
+	}
+}
+
+uint SelectCascade(vec3 position)
+{
+	/* the first cascade whose far split lies beyond the fragment's view depth */
+	float viewDepth = abs((cameraData.view * vec4(position, 1.0)).z);
+	uint cascade = 0;
+	for (uint i = 0; i + 1 < shadowData.cascadeInfo.x; i++)
+		cascade += uint(viewDepth > shadowData.cascadeSplits[i]);
+	return cascade;
+}
+
+int PCFRadius()
+{
+	return (pcf_kernel > 0u) ? int(pcf_kernel) : int(max(shadowData.samplingInfo.y, 1u));
+}
+
+ivec2 ShadowTexel(vec2 uv, ivec2 offset)
+{
+	/* offsets -r..r-1 give the 2r x 2r texels centred on uv. only the top left cascadeInfo.z texels are rendered,
+		never read past them */
+	int region = int(shadowData.cascadeInfo.z);
+	return clamp(ivec2(floor(uv * float(region) - 0.5)) + offset + 1, ivec2(0), ivec2(region - 1));
+}
+
+/* Lighting and Shading Calculations */
+
+vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
+{
+	/* direct lighting strength componenets */ 
+	vec3 to_cam = normalize(cameraPosition.rgb - position);
+	vec3 to_light = normalize(-lightingData.sunLight.direction.rgb);
+	vec3 half_vector = normalize(to_cam + to_light);
+
+	/* shadow coverage calculation */
+	vec3 normalBiasVector = normal * normal_bias;
+	uint cascade = SelectCascade(position);
+	vec4 shadowViewPosition = shadowData.cascadeProjView[cascade] * vec4(position + normalBiasVector, 1.0);
+	vec4 shadowCoords = vec4(shadowViewPosition / shadowViewPosition.w);
+	shadowCoords.x = shadowCoords.x * 0.5 + 0.5;
+	shadowCoords.y = shadowCoords.y * 0.5 + 0.5;
+	shadowCoords.z -= depth_bias;
+	shadowCoords.w = 1.0;
+
+	/* every sample of every texel under the kernel, each one is a separate stochastic result. the colour is only
+		counted where the opaque depth lets the light through */
+	float shadowStrength = 0.0;
+	vec3 shadowColour = vec3(0.0, 0.0, 0.0);
+	float tolerance = ColourDepthTolerance(shadowCoords.z);
+	int samples = textureSamples(shadowColourMap);
+	int radius = PCFRadius();
+	float totalSamples = 0.0;
+	for (int u = -radius; u < radius; u++)
+	{
+		for (int v = -radius; v < radius; v++)
+		{
+			ivec3 texel = ivec3(ShadowTexel(shadowCoords.xy, ivec2(u, v)), int(cascade));
+			for (int s = 0; s < samples; s++)
+			{
+				float opaque = float(shadowCoords.z <= texelFetch(shadowDepthMap, texel, s).r);
+				vec3 shadowSample = texelFetch(shadowColourMap, texel, s).rgb;
+				shadowStrength += opaque;
+				shadowColour += opaque * vec3(greaterThanEqual(shadowSample + tolerance, vec3(shadowCoords.z)));
+				totalSamples += 1.0;
+			}
+		}
+	}
+	shadowStrength /= totalSamples;
+	shadowColour /= max(shadowStrength * totalSamples, 1.0);
+
+	vec3 direct = (lightingData.sunLight.colour.rgb * shadowColour * shadowStrength * diffuse);
+	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
+
+	return ambient + (posDot(normal, to_light)) * direct;
+}
+
+/* main() */
+
+void main()
+{
+	vec3 diffuse = texture(uColourTex, iUV).rgb;
+	float metallic = uMaterialData.metallic;// * texture(UMetallicRoughnessTex, iUV).r;
+	float roughness = uMaterialData.roughness;// * texture(UMetallicRoughnessTex, iUV).g;
+	vec3 lit = uMaterialData.emissive + LightingCalculation(iPosition, normalize(iNormal), diffuse, 0.0, 0.0, cameraData.position.rgb);
+	oColour = vec4(lit, texture(uColourTex, iUV).a);
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#version 450
+
+/* CSSM_MSAA: the transparent pass of the coloured stochastic shadow map into a multisampled target. instead of one
+	stochastic test per texel, the fragment covers as many of the texel's samples as its most opaque channel blocks
+	(through gl_SampleMask), so every texel holds several stochastic results for the cost of one fragment */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform ShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
+	uvec4 temporalInfo; /* x: noise frame */
+	uvec4 samplingInfo; /* x: noise pattern */
+} shadowData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+layout(set = 2, binding = 0) uniform sampler2D uNoiseTex;
+
+/* Helper functions */
+
+uint Hash(uint value)
+{
+	/* pcg, the sample rotation must not correlate with the noise texture's thresholds */
+	uint state = value * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+/* samplingInfo.x 0: white noise looked up with a hashed world position, otherwise a tileable per shadow map texel pattern */
+vec4 NoiseSample()
+{
+	/* a new pattern every frame when the shadow is accumulated over time (R2 sequence offset) */
+	vec2 frameOffset = fract(float(shadowData.temporalInfo.x) * vec2(0.7548776662, 0.5698402910));
+
+	if (shadowData.samplingInfo.x == 0u)
+	{
+		vec2 samplingUV = vec2(iPosition.x + iPosition.y + iUV.x, iPosition.z - iPosition.y + iUV.y);
+		samplingUV.x = samplingUV.x - floor(samplingUV.x) * 1000.0;
+		samplingUV.y = samplingUV.y - floor(samplingUV.y) * 1000.0;
+		return textureLod(uNoiseTex, samplingUV + frameOffset, 0);
+	}
+
+	/* neighbouring shadow map texels get evenly spread thresholds, so a small PCF kernel already averages out the coverage.
+		each primitive shifts the tile so stacked translucent layers don't share thresholds */
+	ivec2 size = textureSize(uNoiseTex, 0);
+	uint hash = uint(gl_PrimitiveID) * 747796405u + 2891336453u;
+	hash = ((hash >> ((hash >> 28u) + 4u)) ^ hash) * 277803737u;
+	ivec2 shift = ivec2(hash & 0xffffu, hash >> 16u) + ivec2(frameOffset * vec2(size));
+
+	return texelFetch(uNoiseTex, (ivec2(gl_FragCoord.xy) + shift) % size, 0);
+}
+
+void main()
+{
+	vec3 random = NoiseSample().rgb;
+
+	/* calculate the fragment alpha */
+	vec4 texSample = texture(uColourTex, iUV);
+	float alpha = texSample.a;
+
+	/* for the purposes of this project's implementation transmission is assumed to be the same as diffuse colour */
+	vec3 transmission =  texSample.rgb * 0.5;
+	vec3 lightProb = alpha * (1.0 - transmission);
+	float maxProb = max(max(lightProb.r, lightProb.g), lightProb.b);
+
+	/* stratified coverage: the most opaque channel blocks that fraction of the samples, rounded stochastically
+		so the expected coverage is exact */
+	uint samples = uint(gl_NumSamples);
+	uint hash = Hash(uint(gl_FragCoord.x) + Hash(uint(gl_FragCoord.y) + Hash(uint(gl_PrimitiveID) + shadowData.temporalInfo.x)));
+	float rounding = float(hash & 0xffffu) / 65536.0;
+	uint covered = min(uint(floor(maxProb * float(samples) + rounding)), samples);
+	if (covered == 0u)
+		discard;
+
+	/* rotated per fragment, so overlapping layers block different samples rather than all the same ones */
+	uint sampleBits = (1u << samples) - 1u;
+	uint mask = (1u << covered) - 1u;
+	uint rotate = (hash >> 16u) % samples;
+	mask = ((mask << rotate) | (mask >> (samples - rotate))) & sampleBits;
+	gl_SampleMask[0] = int(mask);
+
+	/* fragment depth */
+	float depth = gl_FragCoord.z / gl_FragCoord.w;
+
+	/* each channel blocks the covered samples with the probability that's left over, lightProb / maxProb */
+	oColour.r = max(depth, float(random.r * maxProb >= lightProb.r));
+	oColour.g = max(depth, float(random.g * maxProb >= lightProb.g));
+	oColour.b = max(depth, float(random.b * maxProb >= lightProb.b));
+	oColour.a = 1.0;
+}
@@ -5,6 +5,19 @@ layout(location = 1) in vec2 iUV;
 
 layout(location = 0) out vec4 oColour;
 
+layout(set = 0, binding = 0) uniform ShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
+	uvec4 temporalInfo; /* x: noise frame */
+	uvec4 samplingInfo; /* x: noise pattern */
+} shadowData;
+
 layout(set = 1, binding = 0) uniform sampler2D uColourTex;
 layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
 
@@ -20,13 +33,35 @@ layout(set = 1, binding = 2) uniform MaterialData
 
 layout(set = 2, binding = 0) uniform sampler2D uNoiseTex;
 
+/* Helper functions */
+
+/* samplingInfo.x 0: white noise looked up with a hashed world position, otherwise a tileable per shadow map texel pattern */
+vec4 NoiseSample()
+{
+	/* a new pattern every frame when the shadow is accumulated over time (R2 sequence offset) */
+	vec2 frameOffset = fract(float(shadowData.temporalInfo.x) * vec2(0.7548776662, 0.5698402910));
+
+	if (shadowData.samplingInfo.x == 0u)
+	{
+		vec2 samplingUV = vec2(iPosition.x + iPosition.y + iUV.x, iPosition.z - iPosition.y + iUV.y);
+		samplingUV.x = samplingUV.x - floor(samplingUV.x) * 1000.0;
+		samplingUV.y = samplingUV.y - floor(samplingUV.y) * 1000.0;
+		return textureLod(uNoiseTex, samplingUV + frameOffset, 0);
+	}
+
+	/* neighbouring shadow map texels get evenly spread thresholds, so a small PCF kernel already averages out the coverage.
+		each primitive shifts the tile so stacked translucent layers don't share thresholds */
+	ivec2 size = textureSize(uNoiseTex, 0);
+	uint hash = uint(gl_PrimitiveID) * 747796405u + 2891336453u;
+	hash = ((hash >> ((hash >> 28u) + 4u)) ^ hash) * 277803737u;
+	ivec2 shift = ivec2(hash & 0xffffu, hash >> 16u) + ivec2(frameOffset * vec2(size));
+
+	return texelFetch(uNoiseTex, (ivec2(gl_FragCoord.xy) + shift) % size, 0);
+}
+
 void main()
 {
-	/* perhaps make the method of sampling the noise better */
-	vec2 samplingUV = vec2(iPosition.x + iPosition.y + iUV.x, iPosition.z - iPosition.y + iUV.y);
-	samplingUV.x = samplingUV.x - floor(samplingUV.x) * 1000.0;
-	samplingUV.y = samplingUV.y - floor(samplingUV.y) * 1000.0;
-	vec3 random = textureLod(uNoiseTex, samplingUV, 0).rgb;
+	vec3 random = NoiseSample().rgb;
 
 	/* calculate the fragment alpha */
 	vec4 texSample = texture(uColourTex, iUV);
@@ -0,0 +1,186 @@
+#version 450
+
+float eps = 0.0001;
+float pi = 3.141592;
+
+float depth_bias = 0.002;
+float normal_bias = 0.08;
+int opaque_pcf_radius = 1;
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projCam;
+	vec4 position;
+} cameraData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+struct DirectionalLight
+{
+	vec4 direction;
+	vec4 colour;
+};
+
+struct AmbientLight
+{
+	vec4 colour;
+};
+
+layout(set = 2, binding = 0) uniform LightData
+{
+	DirectionalLight sunLight;
+	AmbientLight ambientLight;
+} lightingData;
+
+layout(set = 3, binding = 0) uniform sampler2DArray fomAbsorbance; /* rgb: absorbance, a: a0 */
+layout(set = 3, binding = 1) uniform sampler2DArray fomCoefficients1; /* a1, b1, a2, b2 */
+layout(set = 3, binding = 2) uniform sampler2DArray fomCoefficients2; /* a3, b3, a4, b4 */
+layout(set = 3, binding = 3) uniform sampler2DArrayShadow shadowMap; /* opaque casters */
+layout(set = 3, binding = 4) uniform DirectionalShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo; /* x: cascade count, y: CSSM colour format, z: rendered resolution */
+} shadowData;
+
+/* Helper functions */
+
+float pos(float x)
+{
+	return max(0.0, x);
+}
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+uint SelectCascade(vec3 position)
+{
+	/* the first cascade whose far split lies beyond the fragment's view depth */
+	float viewDepth = abs((cameraData.view * vec4(position, 1.0)).z);
+	uint cascade = 0;
+	for (uint i = 0; i + 1 < shadowData.cascadeInfo.x; i++)
+		cascade += uint(viewDepth > shadowData.cascadeSplits[i]);
+	return cascade;
+}
+
+vec2 ShadowRegion(vec2 uv, vec2 mapSize)
+{
+	/* the map may be rendered below its allocated size, into the top left cascadeInfo.z texels,
+		clamp to that region so stale texels from a larger resolution are never read */
+	float region = float(shadowData.cascadeInfo.z);
+	return clamp(uv * region, vec2(0.5), vec2(region - 0.5)) / mapSize;
+}
+
+vec3 FourierTransmittance(vec3 sampleCoords, float depth)
+{
+	/* the coefficients are sums, so they're filtered linearly like any other texture */
+	vec4 absorbance = texture(fomAbsorbance, sampleCoords);
+	if (absorbance.a <= eps)
+		return vec3(1.0);
+
+	vec4 c1 = texture(fomCoefficients1, sampleCoords);
+	vec4 c2 = texture(fomCoefficients2, sampleCoords);
+	float a[4] = float[4](c1.x, c1.z, c2.x, c2.z);
+	float b[4] = float[4](c1.y, c1.w, c2.y, c2.w);
+
+	/* the integral of the truncated density from the light to this depth, each harmonic damped by a
+		sinc (lanczos) window, which trades a little sharpness for much less ringing */
+	float integral = 0.5 * absorbance.a * depth;
+	for (int k = 1; k <= 4; k++)
+	{
+		float window = sin(pi * float(k) / 5.0) / (pi * float(k) / 5.0);
+		float phase = 2.0 * pi * float(k) * depth;
+		integral += window * (a[k - 1] * sin(phase) + b[k - 1] * (1.0 - cos(phase))) / (2.0 * pi * float(k));
+	}
+
+	/* the fraction of the absorbance in front of the fragment, applied to each channel's total */
+	float inFront = clamp(integral / (0.5 * absorbance.a), 0.0, 1.0);
+	return exp(-absorbance.rgb * inFront);
+}
+
+float OpaqueVisibility(vec2 uv, float cascade, float depth, vec2 mapSize)
+{
+	float visibility = 0.0;
+	for (int y = -opaque_pcf_radius; y <= opaque_pcf_radius; y++)
+	{
+		for (int x = -opaque_pcf_radius; x <= opaque_pcf_radius; x++)
+		{
+			vec2 tapUV = ShadowRegion(uv + vec2(x, y) / float(shadowData.cascadeInfo.z), mapSize);
+			visibility += texture(shadowMap, vec4(tapUV, cascade, depth));
+		}
+	}
+
+	float taps = float((2 * opaque_pcf_radius + 1) * (2 * opaque_pcf_radius + 1));
+	return visibility / taps;
+}
+
+/* Lighting and Shading Calculations */
+
+vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
+{
+	/* direct lighting strength componenets */ 
+	vec3 to_cam = normalize(cameraPosition.rgb - position);
+	vec3 to_light = normalize(-lightingData.sunLight.direction.rgb);
+	vec3 half_vector = normalize(to_cam + to_light);
+
+	/* shadow coverage calculation */
+	vec3 normalBiasVector = normal * normal_bias;
+	uint cascade = SelectCascade(position);
+	vec4 shadowViewPosition = shadowData.cascadeProjView[cascade] * vec4(position + normalBiasVector, 1.0);
+	vec4 shadowCoords = vec4(shadowViewPosition / shadowViewPosition.w);
+	shadowCoords.x = shadowCoords.x * 0.5 + 0.5;
+	shadowCoords.y = shadowCoords.y * 0.5 + 0.5;
+	shadowCoords.z -= depth_bias;
+	shadowCoords.w = 1.0;
+
+	/* opaque casters block the light, the translucent casters in front of the fragment attenuate it,
+		at the same cost however many of them there are */
+	vec2 mapSize = vec2(textureSize(fomAbsorbance, 0).xy);
+	vec3 sampleCoords = vec3(ShadowRegion(shadowCoords.xy, mapSize), float(cascade));
+	float shadowStrength = OpaqueVisibility(shadowCoords.xy, float(cascade), shadowCoords.z, mapSize);
+	vec3 shadowColour = FourierTransmittance(sampleCoords, shadowCoords.z);
+
+	vec3 direct = (lightingData.sunLight.colour.rgb * shadowColour * shadowStrength * diffuse);
+	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
+
+	return ambient + (posDot(normal, to_light)) * direct;
+}
+
+/* main() */
+
+void main()
+{
+	vec3 diffuse = texture(uColourTex, iUV).rgb;
+	float metallic = uMaterialData.metallic;// * texture(UMetallicRoughnessTex, iUV).r;
+	float roughness = uMaterialData.roughness;// * texture(UMetallicRoughnessTex, iUV).g;
+	vec3 lit = uMaterialData.emissive + LightingCalculation(iPosition, normalize(iNormal), diffuse, 0.0, 0.0, cameraData.position.rgb);
+	oColour = vec4(lit, texture(uColourTex, iUV).a);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#version 450
+
+/* fourier opacity map: every translucent caster adds its absorbance and the fourier coefficients of a delta at its
+	depth, so the sums (and so the reconstruction) don't depend on draw order or on how many casters overlap */
+
+const float pi = 3.141592;
+const float max_light_prob = 0.9999; /* keeps the absorbance finite for fully opaque texels of translucent meshes */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+
+layout(location = 0) out vec4 oAbsorbance; /* rgb: absorbance, a: a0 */
+layout(location = 1) out vec4 oCoefficients1; /* a1, b1, a2, b2 */
+layout(location = 2) out vec4 oCoefficients2; /* a3, b3, a4, b4 */
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+void main()
+{
+	/* the cascades are orthographic, so the window depth is already linear in [0, 1] */
+	float depth = gl_FragCoord.z;
+
+	/* for the purposes of this project's implementation transmission is assumed to be the same as diffuse colour,
+		the same light blocking probability as the CSSM passes */
+	vec4 texSample = texture(uColourTex, iUV);
+	vec3 transmission = texSample.rgb * 0.5;
+	vec3 lightProb = min(texSample.a * (1.0 - transmission), vec3(max_light_prob));
+
+	/* transmittance multiplies, so its log (the absorbance) adds */
+	vec3 absorbance = -log(1.0 - lightProb);
+
+	/* one scalar density carries the depth distribution for all three channels, weighted by the mean absorbance */
+	float weight = 2.0 * (absorbance.r + absorbance.g + absorbance.b) / 3.0;
+	float phase = 2.0 * pi * depth;
+
+	oAbsorbance = vec4(absorbance, weight);
+	oCoefficients1 = weight * vec4(cos(phase), sin(phase), cos(2.0 * phase), sin(2.0 * phase));
+	oCoefficients2 = weight * vec4(cos(3.0 * phase), sin(3.0 * phase), cos(4.0 * phase), sin(4.0 * phase));
+}
@@ -3,8 +3,12 @@
 float eps = 0.0001;
 float pi = 3.141592;
 
-float normal_bias = 0.08;
-float pcf_radius = 4;
+/* specialisation constants, set from PipelineFeatures::shadowFilter. a pcf_kernel of 0 takes the radius from
+	samplingInfo.y every frame, any other fixes it when the pipeline is made so the kernel's loops unroll */
+layout(constant_id = 0) const uint pcf_kernel = 0u;
+layout(constant_id = 1) const float depth_bias = 0.0;
+layout(constant_id = 2) const float normal_bias = 0.08;
+float pyramid_cell = 16.0; /* SHADOW_PYRAMID_CELL in Constants.hpp */
 
 /* Here be data */
 
@@ -52,14 +56,20 @@ layout(set = 2, binding = 0) uniform LightData
 	AmbientLight ambientLight;
 } lightingData;
 
-layout(set = 3, binding = 0) uniform sampler2DShadow shadowMap;
+layout(set = 3, binding = 0) uniform sampler2DArrayShadow shadowMap;
 layout(set = 3, binding = 1) uniform DirectionalShadowData
 {
 	mat4 view;
 	mat4 projection;
 	mat4 projView;
 	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
+	uvec4 temporalInfo;
+	uvec4 samplingInfo; /* y: PCF radius, smaller for the stratified noise patterns */
 } shadowData;
+layout(set = 3, binding = 2) uniform sampler2DArray shadowPyramid; /* r: min depth, g: max depth */
 
 /* Helper functions */
 
@@ -74,6 +84,54 @@ float posDot(vec3 left, vec3 right)
 	return max(0.0, dot_val);
 }
 
+uint SelectCascade(vec3 position)
+{
+	/* the first cascade whose far split lies beyond the fragment's view depth */
+	float viewDepth = abs((cameraData.view * vec4(position, 1.0)).z);
+	uint cascade = 0;
+	for (uint i = 0; i + 1 < shadowData.cascadeInfo.x; i++)
+		cascade += uint(viewDepth > shadowData.cascadeSplits[i]);
+	return cascade;
+}
+
+int PCFRadius()
+{
+	return (pcf_kernel > 0u) ? int(pcf_kernel) : int(max(shadowData.samplingInfo.y, 1u));
+}
+
+vec2 ShadowRegion(vec2 uv, vec2 mapSize)
+{
+	/* the map may be rendered below its allocated size, into the top left cascadeInfo.z texels,
+		clamp to that region so stale texels from a larger resolution are never read */
+	float region = float(shadowData.cascadeInfo.z);
+	return clamp(uv * region, vec2(0.5), vec2(region - 0.5)) / mapSize;
+}
+
+vec3 ShadowDepthRange(vec2 uv, uint cascade)
+{
+	/* min/max depth under the whole PCF footprint (the taps plus the filtered compare's texel either side),
+		from the first pyramid level whose cells are at least as wide, where it covers at most 2x2 of them */
+	float region = float(shadowData.cascadeInfo.z);
+	float reach = float(PCFRadius()) + 1.0;
+	int level = max(0, int(ceil(log2(2.0 * reach / pyramid_cell))));
+	float cell = pyramid_cell * exp2(float(level));
+
+	ivec2 levelSize = textureSize(shadowPyramid, level).xy;
+	vec2 texel = clamp(uv * region, vec2(0.5), vec2(region - 0.5));
+	ivec2 first = clamp(ivec2(floor((texel - reach) / cell)), ivec2(0), levelSize - 1);
+	ivec2 last = clamp(ivec2(floor((texel + reach) / cell)), ivec2(0), levelSize - 1);
+
+	vec3 a = texelFetch(shadowPyramid, ivec3(first.x, first.y, cascade), level).rgb;
+	vec3 b = texelFetch(shadowPyramid, ivec3(last.x, first.y, cascade), level).rgb;
+	vec3 c = texelFetch(shadowPyramid, ivec3(first.x, last.y, cascade), level).rgb;
+	vec3 d = texelFetch(shadowPyramid, ivec3(last.x, last.y, cascade), level).rgb;
+
+	return vec3(
+		min(min(a.x, b.x), min(c.x, d.x)),
+		max(max(a.y, b.y), max(c.y, d.y)),
+		min(min(a.z, b.z), min(c.z, d.z)));
+}
+
 /* Lighting and Shading Calculations */
 
 vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
@@ -85,25 +143,40 @@ vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metalli
 
 	/* shadow coverage calculation */
 	vec3 normalBiasVector = normal * normal_bias;
-	vec4 shadowViewPosition = shadowData.projView * vec4(position + normalBiasVector, 1.0);
+	uint cascade = SelectCascade(position);
+	vec4 shadowViewPosition = shadowData.cascadeProjView[cascade] * vec4(position + normalBiasVector, 1.0);
 	vec4 shadowCoords = vec4(shadowViewPosition / shadowViewPosition.w);
 	shadowCoords.x = shadowCoords.x * 0.5 + 0.5;
 	shadowCoords.y = shadowCoords.y * 0.5 + 0.5;
+	shadowCoords.z -= depth_bias;
 	shadowCoords.w = 1.0;
 
+	/* only penumbrae need the full kernel, elsewhere every tap would agree */
 	float shadowStrength = 0.0;
-	float totalSamples = 0.0;
-	vec2 texelSize = vec2(textureSize(shadowMap, 0));
-	for (float u = -pcf_radius; u < pcf_radius; u += 1.0)
+	vec3 depthRange = ShadowDepthRange(shadowCoords.xy, cascade);
+	if (shadowCoords.z < depthRange.x)
+	{
+		shadowStrength = 1.0;
+	}
+	else if (shadowCoords.z < depthRange.y)
 	{
-		for (float v = -pcf_radius; v < pcf_radius; v += 1.0)
+		float totalSamples = 0.0;
+		vec2 mapSize = vec2(textureSize(shadowMap, 0).xy);
+		float texelSize = float(shadowData.cascadeInfo.z);
+		int radius = PCFRadius();
+		for (int u = -radius; u < radius; u++)
 		{
-			shadowStrength += textureProj(shadowMap, shadowCoords + vec4(u / texelSize.x, v / texelSize.y, 0.0, 0.0));
-			totalSamples += 1.0;
+			for (int v = -radius; v < radius; v++)
+			{
+				/* explicit gradients, the taps are in non-uniform control flow */
+				vec2 sampleCoords = ShadowRegion(shadowCoords.xy + vec2(u, v) / texelSize, mapSize);
+				shadowStrength += textureGrad(shadowMap, vec4(sampleCoords, float(cascade), shadowCoords.z), vec2(0.0), vec2(0.0));
+				totalSamples += 1.0;
+			}
 		}
+		shadowStrength /= totalSamples;
 	}
-	shadowStrength /= totalSamples;
-	// shadowStrength = textureProj(shadowMap, shadowCoords); /* uncomment this line to ignore PCF calculation */
+	// shadowStrength = texture(shadowMap, vec4(ShadowRegion(shadowCoords.xy, mapSize), float(cascade), shadowCoords.z)); /* uncomment this line to ignore PCF calculation */
 
 	vec3 direct = lightingData.sunLight.colour.rgb * diffuse * shadowStrength;
 	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
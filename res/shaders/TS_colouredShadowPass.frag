@@ -11,6 +11,7 @@ layout(location = 0) in vec3 iPosition;
 layout(location = 1) in vec2 iUV;
 
 layout(location = 0) out vec4 oColour;
+layout(location = 1) out float oNearestDepth; /* only bound in the single-pass (MRT) variant */
 
 layout(set = 1, binding = 0) uniform sampler2D uColourTex;
 layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
@@ -39,4 +40,7 @@ void main()
 	// vec3 lightProb = texSample.rgb;
 
 	oColour = vec4(lightProb, texSample.a);
+
+	/* min-blended, so this keeps the translucent surface closest to the light */
+	oNearestDepth = gl_FragCoord.z;
 }
\ No newline at end of file
@@ -3,7 +3,9 @@
 float eps = 0.0001;
 float pi = 3.141592;
 
-float normal_bias = 0.035;
+/* specialisation constant 2, set from PipelineFeatures::shadowFilter (0 and 1 are the PCF lookups' radius and depth bias) */
+layout(constant_id = 2) const float normal_bias = 0.035;
+float colour_lod = 1.0; /* mip of the translucent colour map that's read, the coarser the softer the coloured shadows */
 
 /* Here be data */
 
@@ -51,15 +53,18 @@ layout(set = 2, binding = 0) uniform LightData
 	AmbientLight ambientLight;
 } lightingData;
 
-layout(set = 3, binding = 0) uniform sampler2DShadow opaqueShadowMap;
-layout(set = 3, binding = 1) uniform sampler2DShadow transparentShadowMap;
-layout(set = 3, binding = 2) uniform sampler2D colouredShadowMap;
+layout(set = 3, binding = 0) uniform sampler2DArrayShadow opaqueShadowMap;
+layout(set = 3, binding = 1) uniform sampler2DArray transparentDepthMap; /* depth or R32 colour, compared manually */
+layout(set = 3, binding = 2) uniform sampler2DArray colouredShadowMap;
 layout(set = 3, binding = 3) uniform DirectionalShadowData
 {
 	mat4 view;
 	mat4 projection;
 	mat4 projView;
 	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
 } shadowData;
 
 /* Helper functions */
@@ -75,6 +80,37 @@ float posDot(vec3 left, vec3 right)
 	return max(0.0, dot_val);
 }
 
+uint SelectCascade(vec3 position)
+{
+	/* the first cascade whose far split lies beyond the fragment's view depth */
+	float viewDepth = abs((cameraData.view * vec4(position, 1.0)).z);
+	uint cascade = 0;
+	for (uint i = 0; i + 1 < shadowData.cascadeInfo.x; i++)
+		cascade += uint(viewDepth > shadowData.cascadeSplits[i]);
+	return cascade;
+}
+
+vec2 ShadowRegion(vec2 uv, vec2 mapSize)
+{
+	/* the map may be rendered below its allocated size, into the top left cascadeInfo.z texels of the opaque map
+		and the same fraction of the smaller translucent maps, clamp to that region so stale texels are never read */
+	float region = float(shadowData.cascadeInfo.z) * mapSize.x / float(textureSize(opaqueShadowMap, 0).x);
+	return clamp(uv * region, vec2(0.5), vec2(region - 0.5)) / mapSize;
+}
+
+/* bilinear weighted depth comparison, equivalent to textureProj() on a sampler2DShadow */
+float TranslucentCoverage(vec2 uv, uint cascade, float depth)
+{
+	vec2 texelPos = uv * vec2(textureSize(transparentDepthMap, 0).xy) - 0.5;
+	vec2 weights = fract(texelPos);
+
+	/* gather order: (0, 1), (1, 1), (1, 0), (0, 0) */
+	vec4 nearestDepths = textureGather(transparentDepthMap, vec3(uv, float(cascade)), 0);
+	vec4 covered = vec4(greaterThan(vec4(depth), nearestDepths));
+
+	return mix(mix(covered.w, covered.z, weights.x), mix(covered.x, covered.y, weights.x), weights.y);
+}
+
 /* Lighting and Shading Calculations */
 
 vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
@@ -86,16 +122,18 @@ vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metalli
 
 	/* shadow coverage calculation */
 	vec3 normalBiasVector = normal * normal_bias;
-	vec4 shadowViewPosition = shadowData.projView * vec4(position + normalBiasVector, 1.0);
+	uint cascade = SelectCascade(position);
+	vec4 shadowViewPosition = shadowData.cascadeProjView[cascade] * vec4(position + normalBiasVector, 1.0);
 	vec4 shadowCoords = vec4(shadowViewPosition / shadowViewPosition.w);
 	shadowCoords.x = shadowCoords.x * 0.5 + 0.5;
 	shadowCoords.y = shadowCoords.y * 0.5 + 0.5;
 	shadowCoords.w = 1.0;
 
-	float shadowStrength = textureProj(opaqueShadowMap, shadowCoords);
+	float shadowStrength = texture(opaqueShadowMap, vec4(ShadowRegion(shadowCoords.xy, vec2(textureSize(opaqueShadowMap, 0).xy)), float(cascade), shadowCoords.z));
 
-	float colouredShadowStrength = 1.0 - textureProj(transparentShadowMap, shadowCoords);
-	vec3 shadowColour = vec3(1.0, 1.0, 1.0) + (texture(colouredShadowMap, shadowCoords.xy).rgb - vec3(1.0, 1.0, 1.0)) * colouredShadowStrength;
+	float colouredShadowStrength = TranslucentCoverage(ShadowRegion(shadowCoords.xy, vec2(textureSize(transparentDepthMap, 0).xy)), cascade, shadowCoords.z);
+	vec2 colourUV = ShadowRegion(shadowCoords.xy, vec2(textureSize(colouredShadowMap, 0).xy));
+	vec3 shadowColour = vec3(1.0, 1.0, 1.0) + (textureLod(colouredShadowMap, vec3(colourUV, float(cascade)), colour_lod).rgb - vec3(1.0, 1.0, 1.0)) * colouredShadowStrength;
 
 	vec3 direct = lightingData.sunLight.colour.rgb * diffuse * shadowStrength * shadowColour;
 	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
@@ -0,0 +1,31 @@
+#version 450
+#extension GL_EXT_multiview : require
+
+/* the translucent colour pass's own depth, at TS_COLOUR_MAP_RESOLUTION: the farthest opaque depth under each of its texels,
+	so a translucent caster is only left out of the colour where every opaque map texel it covers has an opaque caster in front */
+
+int colour_divisor = 2; /* TS_COLOUR_MAP_DIVISOR in Constants.hpp */
+
+/* Here be data */
+
+layout(set = 0, binding = 0) uniform sampler2DArray opaqueShadowMap; /* point sampled, never compared */
+
+/* main() */
+
+void main()
+{
+	ivec2 mapSize = textureSize(opaqueShadowMap, 0).xy;
+	ivec2 first = ivec2(gl_FragCoord.xy) * colour_divisor;
+
+	float farthest = 0.0;
+	for (int y = 0; y < colour_divisor; y++)
+	{
+		for (int x = 0; x < colour_divisor; x++)
+		{
+			ivec2 texel = min(first + ivec2(x, y), mapSize - 1);
+			farthest = max(farthest, texelFetch(opaqueShadowMap, ivec3(texel, gl_ViewIndex), 0).r);
+		}
+	}
+
+	gl_FragDepth = farthest;
+}
@@ -0,0 +1,188 @@
+#version 450
+
+float eps = 0.0001;
+float pi = 3.141592;
+
+float depth_bias = 0.001;
+float normal_bias = 0.08;
+float pcf_radius = 4;
+
+/* virtual shadow map layout, matches Constants.hpp */
+const uint VSM_PAGE_SIZE = 128u;
+const uint VSM_VIRTUAL_PAGES = 128u;
+const uint VSM_POOL_PAGES = 16u;
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projCam;
+	vec4 position;
+} cameraData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+struct DirectionalLight
+{
+	vec4 direction;
+	vec4 colour;
+};
+
+struct AmbientLight
+{
+	vec4 colour;
+};
+
+layout(set = 2, binding = 0) uniform LightData
+{
+	DirectionalLight sunLight;
+	AmbientLight ambientLight;
+} lightingData;
+
+layout(set = 3, binding = 0) uniform sampler2DShadow shadowDepthMap; /* physical page pools */
+layout(set = 3, binding = 1) uniform sampler2D shadowColourMap;
+layout(set = 3, binding = 2) uniform DirectionalShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4]; /* [0]: the virtual shadow map */
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo; /* x: cascade count, y: CSSM colour format */
+} shadowData;
+layout(set = 3, binding = 3) readonly buffer VirtualPageTable
+{
+	uint entries[];
+} pageTable;
+
+/* Helper functions */
+
+float pos(float x)
+{
+	return max(0.0, x);
+}
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+float ColourDepthTolerance(float depth)
+{
+	/* one encoding step of the CSSM colour format at this depth, so rounding the stored depths doesn't self shadow
+		(cascadeInfo.y matches Renderer::CSSMColourFormat) */
+	switch (shadowData.cascadeInfo.y)
+	{
+		case 1u: return 1.0 / 65535.0; /* RGBA16_UNORM */
+		case 2u: return exp2(floor(log2(max(depth, 0.00006103515625))) - 10.0); /* RGBA16_SFLOAT, 10 bit mantissa */
+		case 3u: return 1.0 / 1023.0; /* RGB10A2_UNORM */
+		default: return 0.0; /* RGBA32_SFLOAT */
+	}
+}
+
+/* virtual shadow map uv -> physical pool uv, false when the page isn't resident (yet).
+	pages aren't neighbours in the pool, so filtering is clamped to the page's bounds (texel centres) */
+bool VirtualToPhysical(vec2 virtualUV, out vec2 physicalUV, out vec4 pageBounds)
+{
+	physicalUV = vec2(0.0);
+	pageBounds = vec4(0.0);
+
+	if (any(lessThan(virtualUV, vec2(0.0))) || any(greaterThanEqual(virtualUV, vec2(1.0))))
+		return false;
+
+	vec2 virtualTexel = virtualUV * float(VSM_PAGE_SIZE * VSM_VIRTUAL_PAGES);
+	uvec2 page = uvec2(virtualTexel) / VSM_PAGE_SIZE;
+	uint entry = pageTable.entries[page.y * VSM_VIRTUAL_PAGES + page.x];
+	if (entry == 0u)
+		return false;
+
+	uint slot = entry - 1u;
+	vec2 slotOrigin = vec2(uvec2(slot % VSM_POOL_PAGES, slot / VSM_POOL_PAGES) * VSM_PAGE_SIZE);
+	float poolResolution = float(VSM_PAGE_SIZE * VSM_POOL_PAGES);
+
+	physicalUV = (slotOrigin + virtualTexel - vec2(page * VSM_PAGE_SIZE)) / poolResolution;
+	pageBounds = vec4(slotOrigin + 0.5, slotOrigin + float(VSM_PAGE_SIZE) - 0.5) / poolResolution;
+	return true;
+}
+
+/* Lighting and Shading Calculations */
+
+vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
+{
+	/* direct lighting strength componenets */ 
+	vec3 to_cam = normalize(cameraPosition.rgb - position);
+	vec3 to_light = normalize(-lightingData.sunLight.direction.rgb);
+	vec3 half_vector = normalize(to_cam + to_light);
+
+	/* shadow coverage calculation */
+	vec3 normalBiasVector = normal * normal_bias;
+	vec4 shadowViewPosition = shadowData.cascadeProjView[0] * vec4(position, 1.0);
+	vec3 shadowCoords = shadowViewPosition.xyz / shadowViewPosition.w;
+	shadowCoords.z -= depth_bias;
+
+	/* pages that aren't resident yet are treated as lit */
+	float shadowStrength = 1.0;
+	vec3 shadowColour = vec3(1.0, 1.0, 1.0);
+	vec2 physicalUV;
+	vec4 pageBounds;
+	if (VirtualToPhysical(shadowCoords.xy * 0.5 + 0.5, physicalUV, pageBounds))
+	{
+		shadowStrength = 0.0;
+		shadowColour = vec3(0.0, 0.0, 0.0);
+		float totalSamples = 0.0;
+		float tolerance = ColourDepthTolerance(shadowCoords.z);
+		vec2 texelSize = vec2(textureSize(shadowColourMap, 0));
+		for (float u = -pcf_radius; u < pcf_radius; u += 1.0)
+		{
+			for (float v = -pcf_radius; v < pcf_radius; v += 1.0)
+			{
+				vec2 sampleCoords = clamp(physicalUV + vec2(u / texelSize.x, v / texelSize.y), pageBounds.xy, pageBounds.zw);
+				shadowStrength += texture(shadowDepthMap, vec3(sampleCoords, shadowCoords.z));
+				vec3 shadowSample = textureLod(shadowColourMap, sampleCoords, 0).rgb;
+				shadowColour.r += float(shadowSample.r + tolerance >= shadowCoords.z);
+				shadowColour.g += float(shadowSample.g + tolerance >= shadowCoords.z);
+				shadowColour.b += float(shadowSample.b + tolerance >= shadowCoords.z);
+				totalSamples += 1.0;
+			}
+		}
+		shadowStrength /= totalSamples;
+		shadowColour /= totalSamples;
+	}
+
+	vec3 direct = (lightingData.sunLight.colour.rgb * shadowColour * shadowStrength * diffuse);
+	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
+
+	return ambient + (posDot(normal, to_light)) * direct;
+}
+
+/* main() */
+
+void main()
+{
+	vec3 diffuse = texture(uColourTex, iUV).rgb;
+	float metallic = uMaterialData.metallic;// * texture(UMetallicRoughnessTex, iUV).r;
+	float roughness = uMaterialData.roughness;// * texture(UMetallicRoughnessTex, iUV).g;
+	vec3 lit = uMaterialData.emissive + LightingCalculation(iPosition, normalize(iNormal), diffuse, 0.0, 0.0, cameraData.position.rgb);
+	oColour = vec4(lit, texture(uColourTex, iUV).a);
+}
\ No newline at end of file
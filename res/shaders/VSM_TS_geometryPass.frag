@@ -0,0 +1,171 @@
+#version 450
+
+float eps = 0.0001;
+float pi = 3.141592;
+
+float normal_bias = 0.035;
+
+/* virtual shadow map layout, matches Constants.hpp */
+const uint VSM_PAGE_SIZE = 128u;
+const uint VSM_VIRTUAL_PAGES = 128u;
+const uint VSM_POOL_PAGES = 16u;
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projCam;
+	vec4 position;
+} cameraData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+struct DirectionalLight
+{
+	vec4 direction;
+	vec4 colour;
+};
+
+struct AmbientLight
+{
+	vec4 colour;
+};
+
+layout(set = 2, binding = 0) uniform LightData
+{
+	DirectionalLight sunLight;
+	AmbientLight ambientLight;
+} lightingData;
+
+layout(set = 3, binding = 0) uniform sampler2DShadow opaqueShadowMap; /* physical page pools */
+layout(set = 3, binding = 1) uniform sampler2D transparentDepthMap; /* R32 colour, compared manually */
+layout(set = 3, binding = 2) uniform sampler2D colouredShadowMap;
+layout(set = 3, binding = 3) uniform DirectionalShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4]; /* [0]: the virtual shadow map */
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
+} shadowData;
+layout(set = 3, binding = 4) readonly buffer VirtualPageTable
+{
+	uint entries[];
+} pageTable;
+
+/* Helper functions */
+
+float pos(float x)
+{
+	return max(0.0, x);
+}
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+/* bilinear weighted depth comparison, equivalent to textureProj() on a sampler2DShadow */
+float TranslucentCoverage(vec2 uv, float depth)
+{
+	vec2 texelPos = uv * vec2(textureSize(transparentDepthMap, 0)) - 0.5;
+	vec2 weights = fract(texelPos);
+
+	/* gather order: (0, 1), (1, 1), (1, 0), (0, 0) */
+	vec4 nearestDepths = textureGather(transparentDepthMap, uv, 0);
+	vec4 covered = vec4(greaterThan(vec4(depth), nearestDepths));
+
+	return mix(mix(covered.w, covered.z, weights.x), mix(covered.x, covered.y, weights.x), weights.y);
+}
+
+/* virtual shadow map uv -> physical pool uv, false when the page isn't resident (yet).
+	pages aren't neighbours in the pool, so filtering is clamped to the page's bounds (texel centres) */
+bool VirtualToPhysical(vec2 virtualUV, out vec2 physicalUV, out vec4 pageBounds)
+{
+	physicalUV = vec2(0.0);
+	pageBounds = vec4(0.0);
+
+	if (any(lessThan(virtualUV, vec2(0.0))) || any(greaterThanEqual(virtualUV, vec2(1.0))))
+		return false;
+
+	vec2 virtualTexel = virtualUV * float(VSM_PAGE_SIZE * VSM_VIRTUAL_PAGES);
+	uvec2 page = uvec2(virtualTexel) / VSM_PAGE_SIZE;
+	uint entry = pageTable.entries[page.y * VSM_VIRTUAL_PAGES + page.x];
+	if (entry == 0u)
+		return false;
+
+	uint slot = entry - 1u;
+	vec2 slotOrigin = vec2(uvec2(slot % VSM_POOL_PAGES, slot / VSM_POOL_PAGES) * VSM_PAGE_SIZE);
+	float poolResolution = float(VSM_PAGE_SIZE * VSM_POOL_PAGES);
+
+	physicalUV = (slotOrigin + virtualTexel - vec2(page * VSM_PAGE_SIZE)) / poolResolution;
+	pageBounds = vec4(slotOrigin + 0.5, slotOrigin + float(VSM_PAGE_SIZE) - 0.5) / poolResolution;
+	return true;
+}
+
+/* Lighting and Shading Calculations */
+
+vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
+{
+	/* direct lighting strength componenets */ 
+	vec3 to_cam = normalize(cameraPosition.rgb - position);
+	vec3 to_light = normalize(-lightingData.sunLight.direction.rgb);
+	vec3 half_vector = normalize(to_cam + to_light);
+
+	/* shadow coverage calculation */
+	vec3 normalBiasVector = normal * normal_bias;
+	vec4 shadowViewPosition = shadowData.cascadeProjView[0] * vec4(position + normalBiasVector, 1.0);
+	vec3 shadowCoords = shadowViewPosition.xyz / shadowViewPosition.w;
+
+	/* pages that aren't resident yet are treated as lit */
+	float shadowStrength = 1.0;
+	vec3 shadowColour = vec3(1.0, 1.0, 1.0);
+	vec2 physicalUV;
+	vec4 pageBounds;
+	if (VirtualToPhysical(shadowCoords.xy * 0.5 + 0.5, physicalUV, pageBounds))
+	{
+		physicalUV = clamp(physicalUV, pageBounds.xy, pageBounds.zw);
+		shadowStrength = texture(opaqueShadowMap, vec3(physicalUV, shadowCoords.z));
+
+		float colouredShadowStrength = TranslucentCoverage(physicalUV, shadowCoords.z);
+		shadowColour = vec3(1.0, 1.0, 1.0) + (texture(colouredShadowMap, physicalUV).rgb - vec3(1.0, 1.0, 1.0)) * colouredShadowStrength;
+	}
+
+	vec3 direct = lightingData.sunLight.colour.rgb * diffuse * shadowStrength * shadowColour;
+	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
+
+	return ambient + (posDot(normal, to_light)) * direct;
+}
+
+/* main() */
+
+void main()
+{
+	vec3 diffuse = texture(uColourTex, iUV).rgb;
+	float metallic = uMaterialData.metallic;// * texture(UMetallicRoughnessTex, iUV).r;
+	float roughness = uMaterialData.roughness;// * texture(UMetallicRoughnessTex, iUV).g;
+	vec3 lit = uMaterialData.emissive + LightingCalculation(iPosition, normalize(iNormal), diffuse, 0.0, 0.0, cameraData.position.rgb);
+	oColour = vec4(lit, texture(uColourTex, iUV).a);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 450
+
+/* only fragments that pass the depth test are visible, so only they request pages */
+layout(early_fragment_tests) in;
+
+const uint VSM_VIRTUAL_PAGES = 128u; /* VSM_VIRTUAL_PAGES in Constants.hpp */
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+
+layout(set = 1, binding = 0) uniform DirectionalShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4]; /* [0]: the virtual shadow map */
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
+} shadowData;
+
+layout(set = 1, binding = 1) buffer PageRequests
+{
+	uint bits[];
+} pageRequests;
+
+/* main() */
+
+void main()
+{
+	vec4 shadowViewPosition = shadowData.cascadeProjView[0] * vec4(iPosition, 1.0);
+	vec2 virtualUV = (shadowViewPosition.xy / shadowViewPosition.w) * 0.5 + 0.5;
+
+	if (any(lessThan(virtualUV, vec2(0.0))) || any(greaterThanEqual(virtualUV, vec2(1.0))))
+		return;
+
+	uvec2 page = uvec2(virtualUV * float(VSM_VIRTUAL_PAGES));
+	uint index = page.y * VSM_VIRTUAL_PAGES + page.x;
+	uint mask = 1u << (index % 32u);
+
+	/* most neighbouring fragments land on the same page, so skip the atomic once it's been marked */
+	if ((pageRequests.bits[index / 32u] & mask) == 0u)
+		atomicOr(pageRequests.bits[index / 32u], mask);
+}
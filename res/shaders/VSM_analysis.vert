@@ -0,0 +1,21 @@
+#version 450
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+
+layout(location = 0) out vec3 oPosition;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	vec4 position;
+} cameraData;
+
+void main()
+{
+	oPosition = iPosition;
+
+	gl_Position = cameraData.projView * vec4(iPosition, 1.0f);
+}
@@ -0,0 +1,184 @@
+#version 450
+
+float eps = 0.0001;
+float pi = 3.141592;
+
+float normal_bias = 0.035;
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projCam;
+	vec4 position;
+} cameraData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+struct DirectionalLight
+{
+	vec4 direction;
+	vec4 colour;
+};
+
+struct AmbientLight
+{
+	vec4 colour;
+};
+
+layout(set = 2, binding = 0) uniform LightData
+{
+	DirectionalLight sunLight;
+	AmbientLight ambientLight;
+} lightingData;
+
+layout(set = 3, binding = 0) uniform sampler2DArrayShadow shadowMap;
+layout(set = 3, binding = 1) uniform DirectionalShadowData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
+} shadowData;
+
+/* ShadowBake: layer i holds the transmittance past the i-th translucent surface along the sun (rgb) and its depth (a) */
+layout(set = 3, binding = 2) uniform sampler2DArray bakedShadows;
+layout(set = 3, binding = 3) uniform BakedShadowData
+{
+	mat4 projView;
+	uvec4 info; /* x: layer count, y: resolution */
+	vec4 bias; /* x: depth bias */
+} bakeData;
+
+/* Helper functions */
+
+float pos(float x)
+{
+	return max(0.0, x);
+}
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+uint SelectCascade(vec3 position)
+{
+	/* the first cascade whose far split lies beyond the fragment's view depth */
+	float viewDepth = abs((cameraData.view * vec4(position, 1.0)).z);
+	uint cascade = 0;
+	for (uint i = 0; i + 1 < shadowData.cascadeInfo.x; i++)
+		cascade += uint(viewDepth > shadowData.cascadeSplits[i]);
+	return cascade;
+}
+
+vec2 ShadowRegion(vec2 uv, vec2 mapSize)
+{
+	/* the map may be rendered below its allocated size, into the top left cascadeInfo.z texels,
+		clamp to that region so stale texels from a larger resolution are never read */
+	float region = float(shadowData.cascadeInfo.z);
+	return clamp(uv * region, vec2(0.5), vec2(region - 0.5)) / mapSize;
+}
+
+vec3 BakedTexel(ivec2 texel, float depth)
+{
+	/* the layers are nearest first, and each one's transmittance already includes the ones before it */
+	vec3 transmittance = vec3(1.0);
+	for (uint layer = 0; layer < bakeData.info.x; layer++)
+	{
+		vec4 baked = texelFetch(bakedShadows, ivec3(texel, int(layer)), 0);
+		if (depth <= baked.a + bakeData.bias.x)
+			break;
+		transmittance = baked.rgb;
+	}
+	return transmittance;
+}
+
+vec3 BakedTransmittance(vec3 position)
+{
+	vec4 bakeViewPosition = bakeData.projView * vec4(position, 1.0);
+	vec3 bakeCoords = bakeViewPosition.xyz / bakeViewPosition.w;
+	vec2 uv = bakeCoords.xy * 0.5 + 0.5;
+
+	/* nothing translucent was baked outside the casters' bounds */
+	if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))) || bakeCoords.z > 1.0)
+		return vec3(1.0);
+
+	/* each texel is compared on its own, then the four nearest are blended, so layer edges are filtered like PCF */
+	float resolution = float(bakeData.info.y);
+	vec2 texelPosition = uv * resolution - 0.5;
+	ivec2 base = ivec2(floor(texelPosition));
+	vec2 weight = fract(texelPosition);
+	ivec2 last = ivec2(bakeData.info.y - 1);
+
+	vec3 t00 = BakedTexel(clamp(base, ivec2(0), last), bakeCoords.z);
+	vec3 t10 = BakedTexel(clamp(base + ivec2(1, 0), ivec2(0), last), bakeCoords.z);
+	vec3 t01 = BakedTexel(clamp(base + ivec2(0, 1), ivec2(0), last), bakeCoords.z);
+	vec3 t11 = BakedTexel(clamp(base + ivec2(1, 1), ivec2(0), last), bakeCoords.z);
+
+	return mix(mix(t00, t10, weight.x), mix(t01, t11, weight.x), weight.y);
+}
+
+/* Lighting and Shading Calculations */
+
+vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
+{
+	/* direct lighting strength componenets */ 
+	vec3 to_cam = normalize(cameraPosition.rgb - position);
+	vec3 to_light = normalize(-lightingData.sunLight.direction.rgb);
+	vec3 half_vector = normalize(to_cam + to_light);
+
+	/* shadow coverage calculation */
+	vec3 normalBiasVector = normal * normal_bias;
+	uint cascade = SelectCascade(position);
+	vec4 shadowViewPosition = shadowData.cascadeProjView[cascade] * vec4(position + normalBiasVector, 1.0);
+	vec4 shadowCoords = vec4(shadowViewPosition / shadowViewPosition.w);
+	shadowCoords.x = shadowCoords.x * 0.5 + 0.5;
+	shadowCoords.y = shadowCoords.y * 0.5 + 0.5;
+	shadowCoords.w = 1.0;
+
+	vec2 shadowUV = ShadowRegion(shadowCoords.xy, vec2(textureSize(shadowMap, 0).xy));
+	float shadowStrength = texture(shadowMap, vec4(shadowUV, float(cascade), shadowCoords.z));
+
+	/* the opaque casters from the shadow map, the static translucent ones from the bake */
+	vec3 transmittance = BakedTransmittance(position + normalBiasVector);
+
+	vec3 direct = lightingData.sunLight.colour.rgb * diffuse * shadowStrength * transmittance;
+	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
+
+	return ambient + (posDot(normal, to_light)) * direct;
+}
+
+/* main() */
+
+void main()
+{
+	vec3 diffuse = texture(uColourTex, iUV).rgb;
+	float metallic = uMaterialData.metallic;// * texture(UMetallicRoughnessTex, iUV).r;
+	float roughness = uMaterialData.roughness;// * texture(UMetallicRoughnessTex, iUV).g;
+	vec3 lit = uMaterialData.emissive + LightingCalculation(iPosition, normalize(iNormal), diffuse, 0.0, 0.0, cameraData.position.rgb);
+	oColour = vec4(lit, texture(uColourTex, iUV).a);
+}
\ No newline at end of file
@@ -2,14 +2,23 @@
 
 for %%a in (*.vert) do (
 	..\..\ext\shaderc\tools\glslc.exe %%a -o %%a.spv
+	if errorlevel 1 exit /b 1
 	echo generated %%a.spv
 )
 
 for %%a in (*.frag) do (
 	..\..\ext\shaderc\tools\glslc.exe %%a -o %%a.spv
+	if errorlevel 1 exit /b 1
+	echo generated %%a.spv
+)
+
+for %%a in (*.comp) do (
+	..\..\ext\shaderc\tools\glslc.exe %%a -o %%a.spv
+	if errorlevel 1 exit /b 1
 	echo generated %%a.spv
 )
 
 echo completed
 
-pause
\ No newline at end of file
+rem the pre-build step passes nopause, it can't answer the prompt
+if not "%1"=="nopause" pause
\ No newline at end of file
@@ -51,13 +51,16 @@ layout(set = 2, binding = 0) uniform LightData
 	AmbientLight ambientLight;
 } lightingData;
 
-layout(set = 3, binding = 0) uniform sampler2DShadow shadowMap;
+layout(set = 3, binding = 0) uniform sampler2DArrayShadow shadowMap;
 layout(set = 3, binding = 1) uniform DirectionalShadowData
 {
 	mat4 view;
 	mat4 projection;
 	mat4 projView;
 	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
 } shadowData;
 
 /* Helper functions */
@@ -73,6 +76,24 @@ float posDot(vec3 left, vec3 right)
 	return max(0.0, dot_val);
 }
 
+uint SelectCascade(vec3 position)
+{
+	/* the first cascade whose far split lies beyond the fragment's view depth */
+	float viewDepth = abs((cameraData.view * vec4(position, 1.0)).z);
+	uint cascade = 0;
+	for (uint i = 0; i + 1 < shadowData.cascadeInfo.x; i++)
+		cascade += uint(viewDepth > shadowData.cascadeSplits[i]);
+	return cascade;
+}
+
+vec2 ShadowRegion(vec2 uv, vec2 mapSize)
+{
+	/* the map may be rendered below its allocated size, into the top left cascadeInfo.z texels,
+		clamp to that region so stale texels from a larger resolution are never read */
+	float region = float(shadowData.cascadeInfo.z);
+	return clamp(uv * region, vec2(0.5), vec2(region - 0.5)) / mapSize;
+}
+
 /* Lighting and Shading Calculations */
 
 vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metallic, float roughness, vec3 cameraPosition)
@@ -84,13 +105,15 @@ vec3 LightingCalculation(vec3 position, vec3 normal, vec3 diffuse, float metalli
 
 	/* shadow coverage calculation */
 	vec3 normalBiasVector = normal * normal_bias;
-	vec4 shadowViewPosition = shadowData.projView * vec4(position + normalBiasVector, 1.0);
+	uint cascade = SelectCascade(position);
+	vec4 shadowViewPosition = shadowData.cascadeProjView[cascade] * vec4(position + normalBiasVector, 1.0);
 	vec4 shadowCoords = vec4(shadowViewPosition / shadowViewPosition.w);
 	shadowCoords.x = shadowCoords.x * 0.5 + 0.5;
 	shadowCoords.y = shadowCoords.y * 0.5 + 0.5;
 	shadowCoords.w = 1.0;
 
-	float shadowStrength = textureProj(shadowMap, shadowCoords);
+	vec2 shadowUV = ShadowRegion(shadowCoords.xy, vec2(textureSize(shadowMap, 0).xy));
+	float shadowStrength = texture(shadowMap, vec4(shadowUV, float(cascade), shadowCoords.z));
 
 	vec3 direct = lightingData.sunLight.colour.rgb * diffuse * shadowStrength;
 	vec3 ambient = lightingData.ambientLight.colour.rgb * diffuse;
@@ -0,0 +1,79 @@
+#version 450
+
+/* Here be data */
+
+layout(location = 0) in vec2 iUV;
+
+layout(location = 0) out vec4 oColour;
+
+struct DirectionalLight
+{
+	vec4 direction;
+	vec4 colour;
+};
+
+struct AmbientLight
+{
+	vec4 colour;
+};
+
+layout(set = 0, binding = 0) uniform LightData
+{
+	DirectionalLight sunLight;
+	AmbientLight ambientLight;
+} lightingData;
+
+layout(set = 1, binding = 0) uniform sampler2D gAlbedo;
+layout(set = 1, binding = 1) uniform sampler2D gNormal; /* octahedral */
+layout(set = 1, binding = 2) uniform sampler2D gEmissive;
+layout(set = 1, binding = 3) uniform sampler2D gDepth;
+layout(set = 1, binding = 4) uniform sampler2D shadowMask; /* rgb: shadow transmittance, from shadowMask.comp */
+
+/* Helper functions */
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+vec2 SignNotZero(vec2 v)
+{
+	return vec2((v.x >= 0.0) ? 1.0 : -1.0, (v.y >= 0.0) ? 1.0 : -1.0);
+}
+
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * SignNotZero(n.xy);
+
+	return normalize(n);
+}
+
+/* main() */
+
+void main()
+{
+	/* the G-buffer can be bigger than the window, so everything is fetched per pixel */
+	ivec2 texel = min(ivec2(gl_FragCoord.xy), textureSize(gDepth, 0) - 1);
+
+	float depth = texelFetch(gDepth, texel, 0).r;
+	if (depth <= 0.0 || depth >= 1.0)
+		discard; /* nothing opaque here (still cleared, to 1 or to 0 when reversed), keep the clear colour */
+
+	vec4 albedo = texelFetch(gAlbedo, texel, 0);
+	vec3 normal = OctahedralDecode(texelFetch(gNormal, texel, 0).rg);
+	vec3 emissive = texelFetch(gEmissive, texel, 0).rgb;
+	vec3 shadow = texelFetch(shadowMask, texel, 0).rgb;
+
+	/* same lighting as the forward path */
+	vec3 to_light = normalize(-lightingData.sunLight.direction.rgb);
+	vec3 direct = lightingData.sunLight.colour.rgb * albedo.rgb * shadow;
+	vec3 ambient = lightingData.ambientLight.colour.rgb * albedo.rgb;
+
+	oColour = vec4(emissive + ambient + posDot(normal, to_light) * direct, albedo.a);
+
+	/* the forward translucent geometry still depth tests against the opaque surfaces */
+	gl_FragDepth = depth;
+}
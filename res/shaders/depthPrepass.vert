@@ -0,0 +1,19 @@
+#version 450
+
+/* opaque camera depth only, for the screen-space shadow mask */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projView;
+	vec4 position;
+} cameraData;
+
+void main()
+{
+	gl_Position = cameraData.projView * vec4(iPosition, 1.0f);
+}
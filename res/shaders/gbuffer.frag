@@ -0,0 +1,47 @@
+#version 450
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oAlbedo; /* rgb: albedo, a: alpha */
+layout(location = 1) out vec2 oNormal; /* octahedral world space normal */
+layout(location = 2) out vec3 oEmissive;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+/* Helper functions */
+
+vec2 SignNotZero(vec2 v)
+{
+	return vec2((v.x >= 0.0) ? 1.0 : -1.0, (v.y >= 0.0) ? 1.0 : -1.0);
+}
+
+/* unit vector -> [-1, 1]^2, the lower hemisphere is folded over the diagonals */
+vec2 OctahedralEncode(vec3 n)
+{
+	n /= (abs(n.x) + abs(n.y) + abs(n.z));
+	return (n.z >= 0.0) ? n.xy : (1.0 - abs(n.yx)) * SignNotZero(n.xy);
+}
+
+/* main() */
+
+void main()
+{
+	oAlbedo = texture(uColourTex, iUV);
+	oNormal = OctahedralEncode(normalize(iNormal));
+	oEmissive = uMaterialData.emissive;
+}
@@ -0,0 +1,148 @@
+#version 450
+
+/* additive pass for the local (spot and point) lights, drawn over whatever the technique already lit.
+	every light is shadowed from its tiles of the shared atlas: an opaque depth comparison,
+	then the translucent casters' colour wherever the fragment lies behind the nearest of them */
+
+float eps = 0.0001;
+
+float normal_bias = 1.5; /* in atlas texels, scaled by the distance to the light */
+
+/* Here be data */
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+layout(location = 2) in vec3 iNormal;
+
+layout(location = 0) out vec4 oColour;
+
+layout(set = 0, binding = 0) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	mat4 projCam;
+	vec4 position;
+} cameraData;
+
+layout(set = 1, binding = 0) uniform sampler2D uColourTex;
+layout(set = 1, binding = 1) uniform sampler2D UMetallicRoughnessTex;
+
+layout(set = 1, binding = 2) uniform MaterialData
+{
+	vec4 albedo;
+	vec3 emissive;
+	float roughness;
+	vec3 transmission;
+	float metallic;
+	float _padding[4];
+} uMaterialData;
+
+struct LocalLight
+{
+	vec4 position; /* w: range */
+	vec4 direction; /* w: cosine of the outer cone angle */
+	vec4 colour; /* w: cosine of the inner cone angle */
+	uvec4 info; /* x: type (0 spot, 1 point), y: first shadow view, z: shadow view count */
+};
+
+struct LocalShadowView
+{
+	mat4 projView;
+	vec4 rect; /* xy: atlas uv offset, zw: atlas uv size */
+	vec4 bias; /* x: world size of a texel one unit from the light */
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer LocalLightList
+{
+	uvec4 counts; /* x: light count, y: view count */
+	LocalLight lights[8];
+	LocalShadowView views[32];
+} lightList;
+
+layout(set = 2, binding = 1) uniform sampler2DShadow atlasDepth;
+layout(set = 2, binding = 2) uniform sampler2D atlasTranslucentDepth; /* R32 colour, compared manually */
+layout(set = 2, binding = 3) uniform sampler2D atlasColour;
+
+/* Helper functions */
+
+float posDot(vec3 left, vec3 right)
+{
+	float dot_val = dot(left, right);
+	return max(0.0, dot_val);
+}
+
+uint CubeFace(vec3 fromLight)
+{
+	/* +x -x +y -y +z -z, as the atlas lays out a point light's views */
+	vec3 a = abs(fromLight);
+	if (a.x >= a.y && a.x >= a.z)
+		return (fromLight.x >= 0.0) ? 0u : 1u;
+	if (a.y >= a.z)
+		return (fromLight.y >= 0.0) ? 2u : 3u;
+	return (fromLight.z >= 0.0) ? 4u : 5u;
+}
+
+vec3 LocalShadow(LocalLight light, vec3 position, vec3 normal, float distanceToLight)
+{
+	if (light.info.z == 0u)
+		return vec3(1.0);
+
+	uint face = (light.info.x == 1u) ? CubeFace(position - light.position.xyz) : 0u;
+	LocalShadowView shadowView = lightList.views[light.info.y + min(face, light.info.z - 1u)];
+
+	/* the texel footprint grows with the distance from the light, so does the offset */
+	vec3 offsetPosition = position + normal * normal_bias * shadowView.bias.x * distanceToLight;
+	vec4 shadowViewPosition = shadowView.projView * vec4(offsetPosition, 1.0);
+	vec3 shadowCoords = shadowViewPosition.xyz / shadowViewPosition.w;
+
+	/* keep the filter inside the view's own tile */
+	vec2 atlasSize = vec2(textureSize(atlasDepth, 0));
+	vec2 uv = shadowView.rect.xy + (shadowCoords.xy * 0.5 + 0.5) * shadowView.rect.zw;
+	uv = clamp(uv, shadowView.rect.xy + 0.5 / atlasSize, shadowView.rect.xy + shadowView.rect.zw - 0.5 / atlasSize);
+
+	float shadowStrength = texture(atlasDepth, vec3(uv, shadowCoords.z));
+	float translucent = float(shadowCoords.z > texture(atlasTranslucentDepth, uv).r + eps);
+	vec3 shadowColour = vec3(1.0) + (texture(atlasColour, uv).rgb - vec3(1.0)) * translucent;
+
+	return shadowStrength * shadowColour;
+}
+
+vec3 LocalLighting(vec3 position, vec3 normal, vec3 diffuse)
+{
+	vec3 lit = vec3(0.0);
+
+	for (uint i = 0u; i < lightList.counts.x; i++)
+	{
+		LocalLight light = lightList.lights[i];
+
+		vec3 toLight = light.position.xyz - position;
+		float distanceToLight = length(toLight);
+		float range = light.position.w;
+		if (distanceToLight >= range)
+			continue;
+		toLight /= max(distanceToLight, eps);
+
+		/* windowed inverse square, reaching zero exactly at the range */
+		float window = clamp(1.0 - pow(distanceToLight / range, 4.0), 0.0, 1.0);
+		float attenuation = window * window / (distanceToLight * distanceToLight + 1.0);
+
+		if (light.info.x == 0u)
+			attenuation *= smoothstep(light.direction.w, light.colour.w, dot(-toLight, normalize(light.direction.xyz)));
+
+		float NdotL = posDot(normal, toLight);
+		if (attenuation * NdotL <= 0.0)
+			continue;
+
+		lit += light.colour.rgb * attenuation * NdotL * LocalShadow(light, position, normal, distanceToLight);
+	}
+
+	return lit * diffuse;
+}
+
+/* main() */
+
+void main()
+{
+	vec4 texSample = texture(uColourTex, iUV);
+	oColour = vec4(LocalLighting(iPosition, normalize(iNormal), texSample.rgb), texSample.a);
+}
\ No newline at end of file
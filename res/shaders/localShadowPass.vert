@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iUV;
+
+layout(location = 0) out vec3 oPosition;
+layout(location = 1) out vec2 oUV;
+
+/* one atlas view, the viewport already places it in its tile */
+layout(set = 0, binding = 0) uniform LocalShadowView
+{
+	mat4 projView;
+	vec4 rect;
+	vec4 bias;
+} shadowView;
+
+void main()
+{
+	oPosition = iPosition;
+	oUV = iUV;
+
+	gl_Position = shadowView.projView * vec4(iPosition, 1.0f);
+}
\ No newline at end of file
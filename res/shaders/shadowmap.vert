@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_multiview : require
 
 layout(location = 0) in vec3 iPosition;
 layout(location = 1) in vec2 iUV;
@@ -9,9 +10,13 @@ layout(set = 0, binding = 0) uniform ShadowData
 	mat4 projection;
 	mat4 projView;
 	mat4 invView;
+	mat4 cascadeProjView[4];
+	vec4 cascadeSplits;
+	uvec4 cascadeInfo;
 } shadowData;
 
 void main()
 {
-	gl_Position = shadowData.projView * vec4(iPosition, 1.0f);
+	/* each multiview view renders one cascade */
+	gl_Position = shadowData.cascadeProjView[gl_ViewIndex] * vec4(iPosition, 1.0f);
 }
\ No newline at end of file
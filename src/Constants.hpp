@@ -1,4 +1,39 @@
 #pragma once
 
-#define SHADOW_MAP_RESOLUTION 8192
-#define SHADOW_MAP_RESOLUTION_F 8192.0f
+#define SHADOW_MAP_RESOLUTION 2048
+#define SHADOW_MAP_RESOLUTION_F 2048.0f
+
+/* translucent shadow colour (and, single pass, nearest translucent depth): coloured transmittance is low frequency,
+	so it's rendered at a fraction of the opaque map's resolution and read through a mip chain */
+#define TS_COLOUR_MAP_DIVISOR 2
+#define TS_COLOUR_MAP_RESOLUTION (SHADOW_MAP_RESOLUTION / TS_COLOUR_MAP_DIVISOR)
+
+/* directional shadow cascades, each one a layer of the shadow map array images
+	(a single 8192 cascade reproduces the old un-cascaded shadow map) */
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_CASCADE_MAX 4
+
+/* min/max shadow depth pyramid: each base level texel covers SHADOW_PYRAMID_CELL^2 shadow map texels,
+	at least the PCF footprint so a lookup only ever needs a 2x2 block of it (pyramid_cell in the shaders) */
+#define SHADOW_PYRAMID_CELL 16
+
+/* virtual shadow map: a (VSM_PAGE_SIZE * VSM_VIRTUAL_PAGES)^2 virtual depth texture split into pages,
+	only pages the camera can see are backed by the (VSM_PAGE_SIZE * VSM_POOL_PAGES)^2 physical pool */
+#define VSM_PAGE_SIZE 128
+#define VSM_VIRTUAL_PAGES 128
+#define VSM_VIRTUAL_RESOLUTION (VSM_PAGE_SIZE * VSM_VIRTUAL_PAGES)
+#define VSM_POOL_PAGES 16
+#define VSM_POOL_RESOLUTION (VSM_PAGE_SIZE * VSM_POOL_PAGES)
+
+/* local (spot and point) light shadows: every shadow view is a square tile of one LOCAL_ATLAS_RESOLUTION^2 atlas,
+	a power of two between LOCAL_TILE_MIN and LOCAL_TILE_MAX picked from the light's size on screen */
+#define LOCAL_LIGHT_MAX 8
+#define LOCAL_VIEW_MAX 32
+#define LOCAL_ATLAS_RESOLUTION 4096
+#define LOCAL_TILE_MIN 128
+#define LOCAL_TILE_MAX 1024
+
+/* baked translucent shadows: the transmittance past each of the first BAKED_SHADOW_LAYERS translucent surfaces
+	along every texel's sun ray, one layer of a BAKED_SHADOW_RESOLUTION^2 array each, over the whole scene */
+#define BAKED_SHADOW_RESOLUTION 1024
+#define BAKED_SHADOW_LAYERS 4
@@ -10,16 +10,18 @@ namespace Renderer
 	{
 		using namespace labutils;
 
-		VkDescriptorPoolSize const pools[2] =
+		VkDescriptorPoolSize const pools[4] =
 		{
 			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxDescriptors },
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxDescriptors }
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxDescriptors },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxDescriptors },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxDescriptors }
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		poolInfo.maxSets = maxSets;
-		poolInfo.poolSizeCount = 2;
+		poolInfo.poolSizeCount = 4;
 		poolInfo.pPoolSizes = pools;
 
 		VkDescriptorPool pool = VK_NULL_HANDLE;
@@ -70,7 +72,7 @@ namespace Renderer
 
 		return Sampler(window.device, sampler);
 	}
-	labutils::Sampler CreateDefaultShadowSampler(const labutils::VulkanWindow& window)
+	labutils::Sampler CreateDefaultShadowSampler(const labutils::VulkanWindow& window, bool depthCompare)
 	{
 		using namespace labutils;
 
@@ -89,8 +91,8 @@ namespace Renderer
 		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
 		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
-			/* Compare ops */
-		samplerInfo.compareEnable = VK_TRUE;
+			/* Compare ops (off when the shader does its own comparisons) */
+		samplerInfo.compareEnable = depthCompare ? VK_TRUE : VK_FALSE;
 		samplerInfo.compareOp = VK_COMPARE_OP_LESS;
 
 		VkSampler sampler = VK_NULL_HANDLE;
@@ -19,5 +19,5 @@ namespace Renderer
 	labutils::Sampler CreateDefaultSampler(const labutils::VulkanWindow& window,
 		VkFilter minFilter = VK_FILTER_LINEAR, VkFilter magFilter = VK_FILTER_LINEAR,
 		bool anisotropicFiltering = true, float anisotropy = 16.0f);
-	labutils::Sampler CreateDefaultShadowSampler(const labutils::VulkanWindow& window);
+	labutils::Sampler CreateDefaultShadowSampler(const labutils::VulkanWindow& window, bool depthCompare = true);
 }
\ No newline at end of file
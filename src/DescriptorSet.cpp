@@ -85,10 +85,11 @@ namespace Renderer
 		for (uint32_t i = 0; i < descriptorCount; i++)
 		{
 			/* The dataset cannot be ambiguous or lacking data */
-			assert(pDescriptorsData[i].u_Buffer != VK_NULL_HANDLE ||
+			assert(pDescriptorsData[i].u_Buffer != VK_NULL_HANDLE || pDescriptorsData[i].sb_Buffer != VK_NULL_HANDLE ||
+				pDescriptorsData[i].si_View != VK_NULL_HANDLE ||
 				(pDescriptorsData[i].s_View != VK_NULL_HANDLE && pDescriptorsData[i].s_Sampler != VK_NULL_HANDLE));
 
-			if (pDescriptorsData[i].u_Buffer != VK_NULL_HANDLE)
+			if (pDescriptorsData[i].u_Buffer != VK_NULL_HANDLE || pDescriptorsData[i].sb_Buffer != VK_NULL_HANDLE)
 			{
 				bufferCount++;
 			}
@@ -112,19 +113,40 @@ namespace Renderer
 			descWrites[i].descriptorCount = 1;
 
 			/* The dataset cannot be ambiguous or lacking data */
-			assert(pDescriptorsData[i].u_Buffer != VK_NULL_HANDLE ||
+			assert(pDescriptorsData[i].u_Buffer != VK_NULL_HANDLE || pDescriptorsData[i].sb_Buffer != VK_NULL_HANDLE ||
+				pDescriptorsData[i].si_View != VK_NULL_HANDLE ||
 				(pDescriptorsData[i].s_View != VK_NULL_HANDLE && pDescriptorsData[i].s_Sampler != VK_NULL_HANDLE));
 
 			if (pDescriptorsData[i].u_Buffer != VK_NULL_HANDLE)
 			{
 				uint32_t index = bufferCount++;
 				bufferInfo[index].buffer = pDescriptorsData[i].u_Buffer;
+				bufferInfo[index].offset = pDescriptorsData[i].u_Offset;
+				bufferInfo[index].range = pDescriptorsData[i].u_Range;
+
+				descWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				descWrites[i].pBufferInfo = &bufferInfo[index];
+			}
+			else if (pDescriptorsData[i].sb_Buffer != VK_NULL_HANDLE)
+			{
+				uint32_t index = bufferCount++;
+				bufferInfo[index].buffer = pDescriptorsData[i].sb_Buffer;
 				bufferInfo[index].offset = 0;
 				bufferInfo[index].range = VK_WHOLE_SIZE;
 
-				descWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				descWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 				descWrites[i].pBufferInfo = &bufferInfo[index];
 			}
+			else if (pDescriptorsData[i].si_View != VK_NULL_HANDLE)
+			{
+				uint32_t index = imageCount++;
+				imageInfo[index].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+				imageInfo[index].imageView = pDescriptorsData[i].si_View;
+				imageInfo[index].sampler = VK_NULL_HANDLE;
+
+				descWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				descWrites[i].pImageInfo = &imageInfo[index];
+			}
 			else
 			{
 				uint32_t index = imageCount++;
@@ -149,7 +171,7 @@ namespace Renderer
 		assert(_state == State::READY);
 
 		vkCmdBindDescriptorSets(*environment->CurrentCmdBuffer(),
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipeline->BindPoint(),
 			*pipeline->GetPipelineLayout(),
 			set_index, 1, &_set, 0, nullptr);
 	}
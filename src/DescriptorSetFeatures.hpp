@@ -14,9 +14,17 @@ namespace Renderer
 
 		/* data for uniform buffers*/
 		VkBuffer u_Buffer{};
+		VkDeviceSize u_Offset = 0;
+		VkDeviceSize u_Range = VK_WHOLE_SIZE;
+
+		/* data for storage buffers */
+		VkBuffer sb_Buffer{};
 		
 		/* data for texture samplers */
 		VkImageView s_View{};
 		VkSampler s_Sampler{};
+
+		/* data for storage images (kept in VK_IMAGE_LAYOUT_GENERAL) */
+		VkImageView si_View{};
 	};
 }
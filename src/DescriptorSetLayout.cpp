@@ -60,6 +60,9 @@ namespace Renderer
 		if (init_data.stages.geometry)
 			stages |= VK_SHADER_STAGE_GEOMETRY_BIT;
 
+		if (init_data.stages.compute)
+			stages |= VK_SHADER_STAGE_COMPUTE_BIT;
+
 		/* set up each of the layout bindings */
 		for (uint32_t i = 0; i < init_data.bindingCount; i++)
 		{
@@ -76,6 +79,14 @@ namespace Renderer
 					bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 
 					break;
+
+				case (DescriptorSetType::STORAGE_BUFFER):
+					bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					break;
+
+				case (DescriptorSetType::STORAGE_IMAGE):
+					bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+					break;
 			}
 			bindings[i].stageFlags = stages;
 		}
@@ -13,7 +13,9 @@ namespace Renderer
 	enum class DescriptorSetType
 	{
 		UNIFORM_BUFFER = 0,
-		SAMPLER
+		SAMPLER,
+		STORAGE_BUFFER,
+		STORAGE_IMAGE
 	};
 
 	struct ShaderStages
@@ -21,6 +23,7 @@ namespace Renderer
 		bool vertex = false;
 		bool fragment = false;
 		bool geometry = false;
+		bool compute = false;
 	};
 
 	namespace ShaderStageConstants
@@ -45,11 +48,19 @@ namespace Renderer
 			false,
 			true
 		};
+
+		const ShaderStages COMPUTE_STAGE
+		{
+			false,
+			false,
+			false,
+			true
+		};
 	}
 
 	struct DescriptorSetLayoutFeatures
 	{
-		ShaderStages stages{ false, false, false };
+		ShaderStages stages{ false, false, false, false };
 		uint32_t bindingCount = 0;
 		DescriptorSetType* pBindingTypes = nullptr;
 	};
@@ -24,12 +24,16 @@ namespace Renderer
 		_allocator = lut::create_allocator(_window);
 		_cmdPool = lut::create_command_pool(_window, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 		_descPool = CreateDescriptorPool(_window.device);
+		_pipelineCache = new PipelineCache(&_window, "../res/cache/pipeline_cache.bin");
 
 		_frameStrat = &ENV_STRAT_FIRSTFRAME_INIT;
 	}
 
 	Environment::~Environment()
 	{
+		/* waits for any pipelines still compiling, then writes the cache out while the device is still around */
+		delete _pipelineCache;
+
 		if (_intermediateTextureSet[0] == nullptr)
 			delete _intermediateTextureSet[0];
 
@@ -39,12 +43,12 @@ namespace Renderer
 
 	/* private member functions */
 
-	void Environment::createDepthBuffer()
+	void Environment::createDepthBuffer(VkFormat format)
 	{
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageInfo.format = VK_FORMAT_D32_SFLOAT;
+		imageInfo.format = format;
 		imageInfo.extent.width = _window.swapchainExtent.width;
 		imageInfo.extent.height = _window.swapchainExtent.height;
 		imageInfo.extent.depth = 1;
@@ -74,7 +78,7 @@ namespace Renderer
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 		viewInfo.image = depthImage.image;
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		viewInfo.format = VK_FORMAT_D32_SFLOAT;
+		viewInfo.format = format;
 		viewInfo.components = VkComponentMapping{};
 		viewInfo.subresourceRange = VkImageSubresourceRange
 		{
@@ -278,6 +282,97 @@ namespace Renderer
 		assert(_window.swapViews.size() == _swapChainFramebuffers.size());
 	}
 
+	VkImageView Environment::createSideImage(VkFormat format, VkImageUsageFlags usage,
+		VkImageAspectFlags aspect, VkExtent2D resolution, uint32_t layers, bool arrayView, VkSampleCountFlagBits samples, uint32_t mipLevels)
+	{
+		/* creates a side image + view and stores both in the newest side buffer slot,
+			the view is of mip 0 alone so it can be a framebuffer attachment */
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = resolution.width;
+		imageInfo.extent.height = resolution.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = mipLevels;
+		imageInfo.arrayLayers = layers;
+		imageInfo.samples = samples;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		VkImage image = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if (const auto& res = vmaCreateImage(_allocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
+		{
+			throw lut::Error("VK: vmaCreateImage() failed while creating a side image. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		lut::Image sideImage(_allocator.allocator, image, allocation);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = sideImage.image;
+		viewInfo.viewType = arrayView ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.components = VkComponentMapping
+		{
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY
+		};
+		viewInfo.subresourceRange = VkImageSubresourceRange
+		{
+			aspect,
+			0, 1,
+			0, layers
+		};
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (const auto& res = vkCreateImageView(_window.device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkCreateImageView() failed to create an image view for a side image. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_sideBuffers.back().push_back(std::move(sideImage));
+		_sideBufferViews.back().push_back(lut::ImageView(_window.device, view));
+
+		return view;
+	}
+
+	lut::ImageView Environment::createMipView(VkImage image, VkFormat format, uint32_t layers, bool arrayView, uint32_t mipLevels)
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = arrayView ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.components = VkComponentMapping{};
+		viewInfo.subresourceRange = VkImageSubresourceRange
+		{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, mipLevels,
+			0, layers
+		};
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (const auto& res = vkCreateImageView(_window.device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkCreateImageView() failed to create a mip chain view for a side image. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		return lut::ImageView(_window.device, view);
+	}
+
 	/* public member functions */
 
 	void Environment::InitialiseSwapChain(std::vector<Renderer::RenderPass*> render_passes)
@@ -285,7 +380,7 @@ namespace Renderer
 		assert(_state == State::UNINITIALISED);
 
 		/* Swap chain, framebuffers, command pool, and associated synch resources */
-		createDepthBuffer();
+		createDepthBuffer(DepthVkFormat(render_passes[0]->Features().depthFormat));
 		createIntermediateBuffers();
 		_intermediateFramebuffers.clear();
 		createIntermediateFramebuffers(render_passes[0]);
@@ -322,12 +417,15 @@ namespace Renderer
 			const auto changes = repairSwapChain();
 
 			if (changes.changedFormat)
+			{
 				render_passes[1]->Repair(&_window);
+				ret = ErrorCode::FORMAT_CHANGED;
+			}
 
 			_swapChainFramebuffers.clear();
 
 			if (changes.changedSize)
-				createDepthBuffer();
+				createDepthBuffer(DepthVkFormat(render_passes[0]->Features().depthFormat));
 
 			_intermediateFramebuffers.clear();
 			createIntermediateFramebuffers(render_passes[0]);
@@ -336,7 +434,8 @@ namespace Renderer
 			_swapChainFramebuffers.clear();
 			createPresentationFramebuffers(render_passes[1]);
 
-			ret = ErrorCode::FAILURE;
+			if (ret == ErrorCode::SUCCESS)
+				ret = ErrorCode::FAILURE;
 			_swapState = SwapChainState::READY;
 		}
 
@@ -419,17 +518,18 @@ namespace Renderer
 		VkExtent2D resolution = { targetWidth, targetHeight };
 		if (resolution.width == 0 || resolution.height == 0)
 		{
-			resolution = (render_pass->Features().renderTarget == RenderTarget::TEXTURE_SHADOWMAP) ?
-				VkExtent2D{ SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION } : _window.swapchainExtent;
+			resolution = (side_buffer_index != -1) ?
+				_sideBufferExtents[side_buffer_index] : _window.swapchainExtent;
 		}
 
 		/* Get ready to start the render pass */
 		std::vector<VkClearValue> clearValues{};
 
-		if (render_pass->Features().colourPass == ColourPass::ENABLED &&
+		for (uint32_t i = 0; i < render_pass->ColourAttachmentCount() &&
 			(render_pass->Features().clearColour == ClearColour::ENABLED ||
-			render_pass->Features().clearDepth == ClearDepth::ENABLED))
+			render_pass->Features().clearDepth == ClearDepth::ENABLED); i++)
 		{
+			/* white is also the farthest depth for depth-as-colour attachments */
 			clearValues.push_back({});
 			/*clearValues.back().color.float32[0] = 0.53f;
 			clearValues.back().color.float32[1] = 0.81f;
@@ -440,12 +540,16 @@ namespace Renderer
 			clearValues.back().color.float32[1] = 1.0f;
 			clearValues.back().color.float32[2] = 1.0f;
 			clearValues.back().color.float32[3] = 1.0f;
+
+			/* except the fourier coefficients, which are summed, so start from nothing */
+			if (render_pass->Features().specialColour == SpecialColour::FOM_COEFFICIENTS)
+				clearValues.back().color = {};
 		}
 
 		if (render_pass->Features().depthTest == DepthTest::ENABLED && render_pass->Features().clearDepth == ClearDepth::ENABLED)
 		{
 			clearValues.push_back({});
-			clearValues.back().depthStencil.depth = 1.0f;
+			clearValues.back().depthStencil.depth = (render_pass->Features().depthRange == DepthRange::REVERSED) ? 0.0f : 1.0f;
 		}
 
 		VkRenderPassBeginInfo passInfo{};
@@ -474,6 +578,9 @@ namespace Renderer
 		vkCmdBeginRenderPass(_cmdBuffers[_currentSwapImage], &passInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 		_state = State::RECORDING_RENDERPASS;
+
+		/* every pipeline's viewport and scissor are dynamic, they cover the whole target unless a pass narrows them */
+		CmdSetViewport(resolution);
 	}
 
 	void Environment::EndRenderPass()
@@ -485,6 +592,60 @@ namespace Renderer
 		_state = State::RECORDING_NOPASS;
 	}
 
+	void Environment::CmdSetViewport(const VkViewport& viewport, const VkRect2D& scissor)
+	{
+		/* replaces the whole target viewport BeginRenderPass() set, e.g. for a shadow atlas tile or a virtual shadow map page */
+		assert(_state == State::RECORDING_RENDERPASS);
+
+		vkCmdSetViewport(_cmdBuffers[_currentSwapImage], 0, 1, &viewport);
+		vkCmdSetScissor(_cmdBuffers[_currentSwapImage], 0, 1, &scissor);
+	}
+
+	void Environment::CmdSetViewport(const VkExtent2D& extent)
+	{
+		/* the top left of the target, e.g. a shadow map rendered below its allocated resolution */
+		VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+		VkRect2D scissor{ { 0, 0 }, extent };
+
+		CmdSetViewport(viewport, scissor);
+	}
+
+	void Environment::CmdClearRegion(const Renderer::RenderPass* render_pass, const VkRect2D& region, bool clear_colour, bool clear_depth)
+	{
+		assert(_state == State::RECORDING_RENDERPASS);
+
+		/* same clear values as BeginRenderPass(), but only inside the region */
+		std::vector<VkClearAttachment> clears{};
+
+		for (uint32_t i = 0; i < render_pass->ColourAttachmentCount() && clear_colour; i++)
+		{
+			clears.push_back({});
+			clears.back().aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			clears.back().colorAttachment = i;
+			clears.back().clearValue.color.float32[0] = 1.0f;
+			clears.back().clearValue.color.float32[1] = 1.0f;
+			clears.back().clearValue.color.float32[2] = 1.0f;
+			clears.back().clearValue.color.float32[3] = 1.0f;
+		}
+
+		if (render_pass->Features().depthTest == DepthTest::ENABLED && clear_depth)
+		{
+			clears.push_back({});
+			clears.back().aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			clears.back().clearValue.depthStencil.depth = (render_pass->Features().depthRange == DepthRange::REVERSED) ? 0.0f : 1.0f;
+		}
+
+		if (clears.empty())
+			return;
+
+		VkClearRect clearRect{};
+		clearRect.rect = region;
+		clearRect.baseArrayLayer = 0;
+		clearRect.layerCount = 1;
+
+		vkCmdClearAttachments(_cmdBuffers[_currentSwapImage], static_cast<uint32_t>(clears.size()), clears.data(), 1, &clearRect);
+	}
+
 	void Environment::EndFrameCommands()
 	{
 		assert(_state == State::RECORDING_NOPASS || _state == State::RECORDING_RENDERPASS);
@@ -645,7 +806,8 @@ namespace Renderer
 		SideBufferShareData* shareData,
 		int Width,
 		int Height,
-		bool cssm_colour)
+		bool cssm_colour,
+		uint32_t colourMipLevels)
 	{
 		assert(count > 0);
 		assert((sharedBuffers) ? (shareData != nullptr) : true);
@@ -654,6 +816,11 @@ namespace Renderer
 		uint32_t height = (Height >= 0) ? Height : ((type == SideBufferType::DEPTH) ? SHADOW_MAP_RESOLUTION : _window.swapchainExtent.height);
 		VkExtent2D resolution = { width, height };
 
+		/* multiview passes (shadow cascades) render to one array layer per view */
+		uint32_t layers = render_pass->ViewCount();
+		bool arrayView = (render_pass->Features().multiview != Multiview::DISABLED);
+		VkSampleCountFlagBits samples = SampleCountVkFlag(render_pass->Features().sampleCount);
+
 		uint32_t ret = static_cast<uint32_t>(_sideBufferViews.size());
 
 		for (uint32_t i = 0; i < count; i++)
@@ -664,6 +831,8 @@ namespace Renderer
 			/* make a new vector for new images and image views */
 			_sideBuffers.push_back({});
 			_sideBufferViews.push_back({});
+			_sideBufferMipViews.push_back({});
+			_sideBufferMipLevels.push_back(1);
 
 			if (type == SideBufferType::COLOUR || type == SideBufferType::COMBINED)
 			{
@@ -674,78 +843,78 @@ namespace Renderer
 				else
 				{
 					/* create COLOUR image and image view */
-					VkImageCreateInfo imageInfo{};
-					imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-					imageInfo.imageType = VK_IMAGE_TYPE_2D;
-					imageInfo.format = cssm_colour ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_B8G8R8A8_SRGB;
-					imageInfo.extent.width = resolution.width;
-					imageInfo.extent.height = resolution.height;
-					imageInfo.extent.depth = 1;
-					imageInfo.mipLevels = 1;
-					imageInfo.arrayLayers = 1;
-					imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-					imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-					imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-					imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-					imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-					VmaAllocationCreateInfo allocInfo{};
-					allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-					VkImage image = VK_NULL_HANDLE;
-					VmaAllocation allocation = VK_NULL_HANDLE;
-
-					if (const auto& res = vmaCreateImage(_allocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
+					VkFormat colourFormat = VK_FORMAT_B8G8R8A8_SRGB;
+					if (cssm_colour)
+						colourFormat = CSSMColourVkFormat(render_pass->Features().cssmColourFormat);
+					else if (render_pass->Features().specialColour == SpecialColour::CMSM_MOMENTS)
+						colourFormat = CMSMAttachmentVkFormat(0);
+					else if (render_pass->Features().specialColour == SpecialColour::GBUFFER)
+						colourFormat = GBufferAttachmentVkFormat(0);
+					else if (render_pass->Features().specialColour == SpecialColour::FOM_COEFFICIENTS)
+						colourFormat = FOMAttachmentVkFormat(0);
+
+					/* a mip chain is blitted down from mip 0 after rendering */
+					VkImageUsageFlags colourUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+					if (colourMipLevels > 1)
+						colourUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+					views.push_back(createSideImage(
+						colourFormat,
+						colourUsage,
+						VK_IMAGE_ASPECT_COLOR_BIT,
+						resolution, layers, arrayView, samples, colourMipLevels));
+
+					if (colourMipLevels > 1)
 					{
-						throw lut::Error("VK: vmaCreateImage() failed while creating a deferred intermediate image. err: %s",
-							lut::to_string(res).c_str());
+						_sideBufferMipViews.back() = createMipView(*_sideBuffers.back().back(), colourFormat, layers, arrayView, colourMipLevels);
+						_sideBufferMipLevels.back() = colourMipLevels;
 					}
+				}
 
-					lut::Image sideImage(_allocator.allocator, image, allocation);
+				if (render_pass->Features().specialColour == SpecialColour::TS_COLOUR_AND_DEPTH)
+				{
+					/* second colour attachment: nearest translucent depth, written alongside the colour */
+					views.push_back(createSideImage(
+						VK_FORMAT_R32_SFLOAT,
+						VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+						VK_IMAGE_ASPECT_COLOR_BIT,
+						resolution, layers, arrayView, samples));
+				}
 
-					VkImageViewCreateInfo viewInfo{};
-					viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-					viewInfo.image = sideImage.image;
-					viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-					if (cssm_colour == false)
-					{
-						viewInfo.format = VK_FORMAT_B8G8R8A8_SRGB;
-						viewInfo.components = VkComponentMapping
-						{
-							VK_COMPONENT_SWIZZLE_IDENTITY,
-							VK_COMPONENT_SWIZZLE_IDENTITY,
-							VK_COMPONENT_SWIZZLE_IDENTITY,
-							VK_COMPONENT_SWIZZLE_IDENTITY
-						};
-					}
-					else
-					{
-						viewInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-						viewInfo.components = VkComponentMapping
-						{
-							VK_COMPONENT_SWIZZLE_IDENTITY,
-							VK_COMPONENT_SWIZZLE_IDENTITY,
-							VK_COMPONENT_SWIZZLE_IDENTITY
-						};
-					}
-					viewInfo.subresourceRange = VkImageSubresourceRange
-					{
+				if (render_pass->Features().specialColour == SpecialColour::CMSM_MOMENTS)
+				{
+					/* second colour attachment: translucent transmittance, written alongside the moments */
+					views.push_back(createSideImage(
+						CMSMAttachmentVkFormat(1),
+						VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 						VK_IMAGE_ASPECT_COLOR_BIT,
-						0, 1,
-						0, 1
-					};
+						resolution, layers, arrayView, samples));
+				}
 
-					VkImageView view = VK_NULL_HANDLE;
-					if (const auto& res = vkCreateImageView(_window.device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
+				if (render_pass->Features().specialColour == SpecialColour::GBUFFER)
+				{
+					/* further colour attachments: the octahedral normal and the emissive colour */
+					for (uint32_t a = 1; a < render_pass->ColourAttachmentCount(); a++)
 					{
-						throw lut::Error("VK: vkCreateImageView() failed to create an image view for a side image. err: %s",
-							lut::to_string(res).c_str());
+						views.push_back(createSideImage(
+							GBufferAttachmentVkFormat(a),
+							VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+							VK_IMAGE_ASPECT_COLOR_BIT,
+							resolution, layers, arrayView, samples));
 					}
+				}
 
-					_sideBuffers.back().push_back(std::move(sideImage));
-					_sideBufferViews.back().push_back(lut::ImageView(_window.device, view));
-
-					views.push_back(view);
+				if (render_pass->Features().specialColour == SpecialColour::FOM_COEFFICIENTS)
+				{
+					/* further colour attachments: the fourier coefficients */
+					for (uint32_t a = 1; a < render_pass->ColourAttachmentCount(); a++)
+					{
+						views.push_back(createSideImage(
+							FOMAttachmentVkFormat(a),
+							VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+							VK_IMAGE_ASPECT_COLOR_BIT,
+							resolution, layers, arrayView, samples));
+					}
 				}
 			}
 			if (type == SideBufferType::DEPTH || type == SideBufferType::COMBINED)
@@ -756,60 +925,12 @@ namespace Renderer
 				}
 				else
 				{
-					/* create DEPTH image and image view */
-					VkImageCreateInfo imageInfo{};
-					imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-					imageInfo.imageType = VK_IMAGE_TYPE_2D;
-					imageInfo.format = VK_FORMAT_D32_SFLOAT;
-					imageInfo.extent.width = resolution.width;
-					imageInfo.extent.height = resolution.height;
-					imageInfo.extent.depth = 1;
-					imageInfo.mipLevels = 1;
-					imageInfo.arrayLayers = 1;
-					imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-					imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-					imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-					imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-					imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-					VmaAllocationCreateInfo allocInfo{};
-					allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-					VkImage image = VK_NULL_HANDLE;
-					VmaAllocation allocation = VK_NULL_HANDLE;
-
-					if (const auto& res = vmaCreateImage(_allocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
-					{
-						throw lut::Error("VK: vmaCreateImage() failed while creating a depth buffer image. err: %s",
-							lut::to_string(res).c_str());
-					}
-
-					lut::Image depthImage(_allocator.allocator, image, allocation);
-
-					VkImageViewCreateInfo viewInfo{};
-					viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-					viewInfo.image = depthImage.image;
-					viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-					viewInfo.format = VK_FORMAT_D32_SFLOAT;
-					viewInfo.components = VkComponentMapping{};
-					viewInfo.subresourceRange = VkImageSubresourceRange
-					{
+					/* create DEPTH image and image view, a transfer destination for depth rasterized on the CPU */
+					views.push_back(createSideImage(
+						DepthVkFormat(render_pass->Features().depthFormat),
+						VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 						VK_IMAGE_ASPECT_DEPTH_BIT,
-						0, 1,
-						0, 1
-					};
-
-					VkImageView view = VK_NULL_HANDLE;
-					if (const auto& res = vkCreateImageView(_window.device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
-					{
-						throw lut::Error("VK: vkCreateImageView() failed to create an image view for a depth buffer image. err: %s",
-							lut::to_string(res).c_str());
-					}
-
-					_sideBuffers.back().push_back(std::move(depthImage));
-					_sideBufferViews.back().push_back(lut::ImageView(_window.device, view));
-
-					views.push_back(view);
+						resolution, layers, arrayView, samples));
 				}
 			}
 
@@ -833,6 +954,7 @@ namespace Renderer
 			}
 
 			_sideFramebuffers.push_back(lut::Framebuffer(_window.device, framebuffer));
+			_sideBufferExtents.push_back(resolution);
 		}
 
 		return ret;
@@ -849,6 +971,25 @@ namespace Renderer
 
 		return &_sideBufferViews[index];
 	}
+	VkExtent2D Environment::GetSideBufferExtent(uint32_t index) const
+	{
+		assert(index < _sideBufferExtents.size());
+
+		return _sideBufferExtents[index];
+	}
+	const lut::ImageView* Environment::GetSideBufferMipView(uint32_t index) const
+	{
+		assert(index < _sideBufferMipViews.size());
+		assert(_sideBufferMipLevels[index] > 1);
+
+		return &_sideBufferMipViews[index];
+	}
+	uint32_t Environment::GetSideBufferMipLevels(uint32_t index) const
+	{
+		assert(index < _sideBufferMipLevels.size());
+
+		return _sideBufferMipLevels[index];
+	}
 
 	const lut::Allocator& Environment::Allocator() const
 	{
@@ -878,12 +1019,21 @@ namespace Renderer
 		return &_descPool;
 	}
 
+	PipelineCache* Environment::Pipelines() const
+	{
+		return _pipelineCache;
+	}
+
 	const VkCommandBuffer* Environment::CurrentCmdBuffer()
 	{
 		assert(_state == State::RECORDING_NOPASS || _state == State::RECORDING_RENDERPASS);
 
 		return &_cmdBuffers[_currentSwapImage];
 	}
+	uint32_t Environment::CurrentSwapImageIndex() const
+	{
+		return _currentSwapImage;
+	}
 	const lut::Framebuffer* Environment::CurrentPresentationFramebuffer()
 	{
 		assert(_state == State::RECORDING_NOPASS || _state == State::RECORDING_RENDERPASS);
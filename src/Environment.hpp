@@ -4,6 +4,7 @@
 #include "ErrorCode.hpp"
 #include "DescriptorSets.hpp"
 #include "Env_Strat_FirstFrame.hpp"
+#include "PipelineCache.hpp"
 
 /* labutils */
 #include "../labutils/vkimage.hpp"
@@ -69,6 +70,7 @@ namespace Renderer
 			lut::Allocator _allocator{};
 			lut::CommandPool _cmdPool{};
 			lut::DescriptorPool _descPool{};
+			PipelineCache* _pipelineCache = nullptr;
 
 			std::vector<lut::Framebuffer> _intermediateFramebuffers{};
 			std::vector<lut::Framebuffer> _postProcessingFramebuffers{};
@@ -87,6 +89,9 @@ namespace Renderer
 
 			std::vector<std::vector<lut::Image>> _sideBuffers{};
 			std::vector<std::vector<lut::ImageView>> _sideBufferViews{};
+			std::vector<VkExtent2D> _sideBufferExtents{};
+			std::vector<lut::ImageView> _sideBufferMipViews{}; /* every mip of the first colour image, null without a mip chain */
+			std::vector<uint32_t> _sideBufferMipLevels{};
 
 			lut::Sampler _intermediateSampler{};
 			DescriptorSetLayoutFeatures _postPresentLayoutData{};
@@ -103,12 +108,16 @@ namespace Renderer
 
 			/* private member functions */
 
-			void createDepthBuffer();
+			void createDepthBuffer(VkFormat format);
 			void createIntermediateBuffers();
 			lut::SwapChanges repairSwapChain();
 			void createIntermediateFramebuffers(const Renderer::RenderPass* render_pass);
 			void createPostProcessingFramebuffers(const Renderer::RenderPass* render_pass);
 			void createPresentationFramebuffers(const Renderer::RenderPass* render_pass);
+			VkImageView createSideImage(VkFormat format, VkImageUsageFlags usage,
+				VkImageAspectFlags aspect, VkExtent2D resolution, uint32_t layers = 1, bool arrayView = false,
+				VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT, uint32_t mipLevels = 1);
+			lut::ImageView createMipView(VkImage image, VkFormat format, uint32_t layers, bool arrayView, uint32_t mipLevels);
 
 		public:
 
@@ -128,6 +137,9 @@ namespace Renderer
 			void BeginRenderPass(const Renderer::RenderPass* render_pass, int32_t side_buffer_index = -1,
 				uint32_t targetWidth = 0, uint32_t targetHeight = 0);
 			void EndRenderPass();
+			void CmdSetViewport(const VkViewport& viewport, const VkRect2D& scissor);
+			void CmdSetViewport(const VkExtent2D& extent);
+			void CmdClearRegion(const Renderer::RenderPass* render_pass, const VkRect2D& region, bool clear_colour = true, bool clear_depth = true);
 			void EndFrameCommands();
 			ErrorCode Present();
 
@@ -142,9 +154,13 @@ namespace Renderer
 				SideBufferShareData* shareData = nullptr,
 				int Width = -1,
 				int Height = -1,
-				bool cssm_colour = false);
+				bool cssm_colour = false,
+				uint32_t colourMipLevels = 1);
 			std::vector<lut::Image>* GetSideBufferImage(uint32_t index);
 			std::vector<lut::ImageView>* GetSideBufferImageView(uint32_t index);
+			VkExtent2D GetSideBufferExtent(uint32_t index) const;
+			const lut::ImageView* GetSideBufferMipView(uint32_t index) const;
+			uint32_t GetSideBufferMipLevels(uint32_t index) const;
 
 			/* getters */
 
@@ -160,7 +176,10 @@ namespace Renderer
 			const lut::DescriptorPool& DescPool() const;
 			const lut::DescriptorPool* DescPoolPtr() const;
 
+			PipelineCache* Pipelines() const;
+
 			const VkCommandBuffer* CurrentCmdBuffer();
+			uint32_t CurrentSwapImageIndex() const;
 			const lut::Framebuffer* CurrentPresentationFramebuffer();
 			const lut::Framebuffer* IntermediateDrawFramebuffer();
 			const lut::Framebuffer* IntermediatePresentFramebuffer();
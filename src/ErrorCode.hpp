@@ -5,5 +5,6 @@
 enum class ErrorCode : uint32_t
 {
 	SUCCESS = 0,
-	FAILURE
+	FAILURE,
+	FORMAT_CHANGED /* CheckSwapChain(): the swap chain was recreated with a new format, so the present pass was too */
 };
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include <cstring>
 
 /* c++ */
+#include <algorithm>
+#include <iterator>
+#include <limits>
 #include <list>
 
 /* renderer */
@@ -195,6 +198,8 @@ namespace Renderer
 				glm::vec3 minBound = -glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]);
 				glm::vec3 maxBound = -glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]);
 				_meshes[offset].centerPt = (minBound + maxBound) * 0.5f;
+				_meshes[offset].boundsMin = -maxBound;
+				_meshes[offset].boundsMax = -minBound;
 
 				/* upload normal data */
 				acc_index = primitive.attributes.at("NORMAL");
@@ -287,6 +292,47 @@ namespace Renderer
 		return runningAverage;
 	}
 
+	template <typename T>
+	void Model::appendAttribute(int accessorIndex, std::vector<T>* values) const
+	{
+		/* with the stride createDataVectors() uploads the attribute with */
+		const tinygltf::Accessor& accessor = _model->accessors[accessorIndex];
+		const tinygltf::BufferView& bufferView = _model->bufferViews[accessor.bufferView];
+		const unsigned char* data = _model->buffers[bufferView.buffer].data.data() + bufferView.byteOffset;
+		size_t stride = bufferView.byteLength / accessor.count;
+
+		for (size_t v = 0; v < accessor.count; v++)
+		{
+			T value;
+			std::memcpy(&value, data + stride * v, sizeof(T));
+			values->push_back(value);
+		}
+	}
+
+	void Model::appendIndices(int accessorIndex, uint32_t first, std::vector<uint32_t>* indices) const
+	{
+		const tinygltf::Accessor& accessor = _model->accessors[accessorIndex];
+		const tinygltf::BufferView& bufferView = _model->bufferViews[accessor.bufferView];
+		const unsigned char* data = _model->buffers[bufferView.buffer].data.data() + bufferView.byteOffset;
+
+		for (size_t i = 0; i < accessor.count; i++)
+		{
+			uint32_t index = 0;
+			if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+				std::memcpy(&index, data + i * sizeof(uint32_t), sizeof(uint32_t));
+			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+			{
+				uint16_t shortIndex = 0;
+				std::memcpy(&shortIndex, data + i * sizeof(uint16_t), sizeof(uint16_t));
+				index = shortIndex;
+			}
+			else
+				index = data[i];
+
+			indices->push_back(first + index);
+		}
+	}
+
 	/* public member functions */
 
 	void Model::CmdDrawOpaque(Environment* environment, Pipeline* pipeline, bool materialOverriden)
@@ -464,6 +510,116 @@ namespace Renderer
 		}
 	}
 
+	void Model::CasterBounds(std::vector<glm::vec3>* bounds) const
+	{
+		/* every mesh casts, the translucent ones colour their shadows */
+		bounds->clear();
+		bounds->reserve(_meshes.size() * 2);
+
+		for (const MeshData& mesh : _meshes)
+		{
+			bounds->push_back(mesh.boundsMin);
+			bounds->push_back(mesh.boundsMax);
+		}
+	}
+
+	void Model::OpaqueGeometry(std::vector<glm::vec3>* positions, std::vector<uint32_t>* indices) const
+	{
+		/* the opaque primitives' world space triangles, read from the glTF buffers as createDataVectors() uploads them */
+		positions->clear();
+		indices->clear();
+
+		for (const tinygltf::Mesh& mesh : _model->meshes)
+		{
+			for (const tinygltf::Primitive& primitive : mesh.primitives)
+			{
+				if (_materialData[primitive.material].alphaBlend == true)
+					continue;
+
+				uint32_t first = static_cast<uint32_t>(positions->size());
+				appendAttribute(primitive.attributes.at("POSITION"), positions);
+				appendIndices(primitive.indices, first, indices);
+			}
+		}
+	}
+
+	void Model::CpuGeometry(SceneGeometry* scene) const
+	{
+		/* every primitive with the attributes, textures and material values the default shaders read */
+		*scene = SceneGeometry{};
+
+		for (const tinygltf::Mesh& mesh : _model->meshes)
+		{
+			for (const tinygltf::Primitive& primitive : mesh.primitives)
+			{
+				uint32_t first = static_cast<uint32_t>(scene->positions.size());
+				appendAttribute(primitive.attributes.at("POSITION"), &scene->positions);
+				appendAttribute(primitive.attributes.at("NORMAL"), &scene->normals);
+				appendAttribute(primitive.attributes.at("TEXCOORD_0"), &scene->uvs);
+
+				appendIndices(primitive.indices, first, &scene->indices);
+				scene->triangleMaterials.resize(scene->indices.size() / 3, static_cast<uint32_t>(primitive.material));
+			}
+		}
+
+		for (const tinygltf::Texture& texture : _model->textures)
+		{
+			const tinygltf::Image& image = _model->images[texture.source];
+
+			SceneTexture sceneTexture;
+			sceneTexture.width = static_cast<uint32_t>(image.width);
+			sceneTexture.height = static_cast<uint32_t>(image.height);
+			sceneTexture.components = static_cast<uint32_t>(image.component);
+			sceneTexture.texels = image.image.data();
+			scene->textures.push_back(sceneTexture);
+		}
+
+		for (size_t m = 0; m < _model->materials.size(); m++)
+		{
+			SceneMaterial sceneMaterial;
+			sceneMaterial.emissive = _materialData[m].data.data.inner_data.emissive;
+			sceneMaterial.colourTexture = _model->materials[m].pbrMetallicRoughness.baseColorTexture.index;
+			sceneMaterial.alphaBlend = _materialData[m].alphaBlend;
+			scene->materials.push_back(sceneMaterial);
+		}
+	}
+
+	bool Model::VisibleBounds(const glm::mat4& projView, glm::vec3* minimum, glm::vec3* maximum) const
+	{
+		/* the bounds of every mesh whose box isn't entirely outside one of the frustum planes */
+		*minimum = glm::vec3(std::numeric_limits<float>::max());
+		*maximum = glm::vec3(std::numeric_limits<float>::lowest());
+		bool visible = false;
+
+		for (const MeshData& mesh : _meshes)
+		{
+			uint32_t outside[6]{};
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				glm::vec4 corner = projView * glm::vec4(
+					(i & 1) ? mesh.boundsMax.x : mesh.boundsMin.x,
+					(i & 2) ? mesh.boundsMax.y : mesh.boundsMin.y,
+					(i & 4) ? mesh.boundsMax.z : mesh.boundsMin.z, 1.0f);
+
+				outside[0] += (corner.x < -corner.w);
+				outside[1] += (corner.x > corner.w);
+				outside[2] += (corner.y < -corner.w);
+				outside[3] += (corner.y > corner.w);
+				outside[4] += (corner.z < 0.0f);
+				outside[5] += (corner.z > corner.w);
+			}
+
+			if (std::find(std::begin(outside), std::end(outside), 8u) != std::end(outside))
+				continue;
+
+			*minimum = glm::min(*minimum, mesh.boundsMin);
+			*maximum = glm::max(*maximum, mesh.boundsMax);
+			visible = true;
+		}
+
+		return visible;
+	}
+
 	void Model::CmdDrawTransparentLightFrontToBack(Environment* environment, Pipeline* pipeline, bool materialOverriden)
 	{
 		CmdDrawTransparentLightFrontToBack(environment, pipeline, 0, _transparentMeshes.size(), materialOverriden);
@@ -31,6 +31,34 @@ namespace Renderer
 {
 	namespace lut = labutils;
 
+	/* a CPU side copy of the scene as the GPU draws it, for rendering it without Vulkan.
+		the texels point into the model's loaded images, so it's valid for as long as the Model */
+	struct SceneTexture
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t components = 0; /* 8 bits each, sRGB encoded */
+		const unsigned char* texels = nullptr;
+	};
+
+	struct SceneMaterial
+	{
+		glm::vec3 emissive = glm::vec3(0.0f);
+		int colourTexture = -1;
+		bool alphaBlend = false;
+	};
+
+	struct SceneGeometry
+	{
+		std::vector<glm::vec3> positions{};
+		std::vector<glm::vec3> normals{};
+		std::vector<glm::vec2> uvs{};
+		std::vector<uint32_t> indices{};
+		std::vector<uint32_t> triangleMaterials{};
+		std::vector<SceneTexture> textures{};
+		std::vector<SceneMaterial> materials{};
+	};
+
 	class Model
 	{
 		public:
@@ -98,6 +126,8 @@ namespace Renderer
 				DescriptorSet* descriptorSet{};
 
 				glm::vec3 centerPt = glm::vec3(0);
+				glm::vec3 boundsMin = glm::vec3(0); /* world space, where centerPt is negated like the camera position */
+				glm::vec3 boundsMax = glm::vec3(0);
 
 				int materialIndex = -1;
 			};
@@ -125,6 +155,10 @@ namespace Renderer
 				const tinygltf::BufferView* bufferView,
 				tinygltf::Buffer* buffer);
 
+			template <typename T>
+			void appendAttribute(int accessorIndex, std::vector<T>* values) const;
+			void appendIndices(int accessorIndex, uint32_t first, std::vector<uint32_t>* indices) const;
+
 			public:
 
 			/* public member functions */
@@ -141,6 +175,11 @@ namespace Renderer
 
 			void SortTransparentGeometry(glm::vec3 lightPosition, glm::vec3 cameraPosition, bool sortLight = true, bool sortCamera = true);
 
+			void CasterBounds(std::vector<glm::vec3>* bounds) const;
+			void OpaqueGeometry(std::vector<glm::vec3>* positions, std::vector<uint32_t>* indices) const;
+			void CpuGeometry(SceneGeometry* scene) const;
+			bool VisibleBounds(const glm::mat4& projView, glm::vec3* minimum, glm::vec3* maximum) const;
+
 			void CmdDrawTransparentLightFrontToBack(Environment* environment, Pipeline* pipeline, bool materialOverriden = false);
 			void CmdDrawTransparentLightFrontToBack(Environment* environment, Pipeline* pipeline, size_t start, size_t end, bool materialOverriden = false);
 			void CmdDrawTransparentLightFrontToBack_DepthOnly(Environment* environment, Pipeline* pipeline, bool materialOverriden = false);
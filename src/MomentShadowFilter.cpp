@@ -0,0 +1,317 @@
+#include "MomentShadowFilter.hpp"
+
+/* c++ */
+#include <algorithm>
+#include <cmath>
+
+/* renderer */
+#include "Environment.hpp" // <- class Environment
+#include "RenderPass.hpp" // <- CMSMAttachmentVkFormat()
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/vkutil.hpp"
+
+namespace Renderer
+{
+	/* constructors, etc. */
+
+	MomentShadowFilter::MomentShadowFilter(const Environment* environment, uint32_t resolution, uint32_t layers,
+		const lut::ImageView* moment_view, const lut::ImageView* transmittance_view,
+		VkSampler sampler, VkBuffer shadow_data)
+	{
+		_resolution = resolution;
+		_layers = layers;
+		_mipLevels = static_cast<uint32_t>(std::floor(std::log2(static_cast<float>(resolution)))) + 1;
+
+		/* the mip chain is built with linear blits */
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			VkFormatProperties props{};
+			vkGetPhysicalDeviceFormatProperties(environment->Window().physicalDevice, CMSMAttachmentVkFormat(i), &props);
+
+			const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+				VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			if ((props.optimalTilingFeatures & required) != required)
+			{
+				throw lut::Error("VK: the CMSM format (VkFormat %d) can't be stored, blitted, or linearly filtered on this device",
+					static_cast<int>(CMSMAttachmentVkFormat(i)));
+			}
+		}
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			VkFormat format = CMSMAttachmentVkFormat(i);
+
+			_blurred[i] = createImage(environment, format, 1, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+			_filtered[i] = createImage(environment, format, _mipLevels,
+				VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+			_blurredViews[i] = createView(environment, *_blurred[i], format, 1);
+			_filteredStorageViews[i] = createView(environment, *_filtered[i], format, 1);
+			_filteredViews[i] = createView(environment, *_filtered[i], format, _mipLevels);
+		}
+
+		/* both passes read two maps and write two maps, in the shader's order */
+		DescriptorSetLayoutFeatures layoutData{};
+		layoutData.stages = ShaderStageConstants::COMPUTE_STAGE;
+		layoutData.bindingCount = 5;
+		DescriptorSetType layoutTypes[5]
+		{
+			DescriptorSetType::SAMPLER, /* source moments */
+			DescriptorSetType::SAMPLER, /* source transmittance */
+			DescriptorSetType::STORAGE_IMAGE, /* blurred moments */
+			DescriptorSetType::STORAGE_IMAGE, /* blurred transmittance */
+			DescriptorSetType::UNIFORM_BUFFER /* shadow data, for the rendered resolution */
+		};
+		layoutData.pBindingTypes = layoutTypes;
+		_layout = new DescriptorSetLayout(environment, layoutData);
+
+		DescriptorSetFeatures bindingData[5]{};
+		for (uint32_t i = 0; i < 5; i++)
+			bindingData[i].binding = i;
+
+		bindingData[0].s_View = **moment_view;
+		bindingData[0].s_Sampler = sampler;
+		bindingData[1].s_View = **transmittance_view;
+		bindingData[1].s_Sampler = sampler;
+		bindingData[2].si_View = *_blurredViews[0];
+		bindingData[3].si_View = *_blurredViews[1];
+		bindingData[4].u_Buffer = shadow_data;
+		_horizontalSet = new DescriptorSet(environment, _layout, 5, bindingData);
+
+		bindingData[0].s_View = *_blurredViews[0];
+		bindingData[1].s_View = *_blurredViews[1];
+		bindingData[2].si_View = *_filteredStorageViews[0];
+		bindingData[3].si_View = *_filteredStorageViews[1];
+		_verticalSet = new DescriptorSet(environment, _layout, 5, bindingData);
+
+		std::vector<const VkDescriptorSetLayout*> layouts = { &**_layout };
+		PipelineFeatures pipelineData = Pipeline_Default;
+		pipelineData.specialMode = SpecialMode::CMSM_BLUR_HORIZONTAL;
+		_horizontalPipeline = new Pipeline(environment, pipelineData, nullptr, layouts);
+
+		pipelineData.specialMode = SpecialMode::CMSM_BLUR_VERTICAL;
+		_verticalPipeline = new Pipeline(environment, pipelineData, nullptr, layouts);
+	}
+
+	MomentShadowFilter::~MomentShadowFilter()
+	{
+		delete _verticalPipeline;
+		delete _horizontalPipeline;
+		delete _verticalSet;
+		delete _horizontalSet;
+		delete _layout;
+	}
+
+	/* private member functions */
+
+	lut::Image MomentShadowFilter::createImage(const Environment* environment, VkFormat format, uint32_t mip_levels, VkImageUsageFlags usage)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = _resolution;
+		imageInfo.extent.height = _resolution;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = mip_levels;
+		imageInfo.arrayLayers = _layers;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		VkImage image = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if (const auto& res = vmaCreateImage(environment->Allocator().allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
+		{
+			throw lut::Error("VK: vmaCreateImage() failed while creating a CMSM filter image. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		return lut::Image(environment->Allocator().allocator, image, allocation);
+	}
+
+	lut::ImageView MomentShadowFilter::createView(const Environment* environment, VkImage image, VkFormat format, uint32_t mip_levels)
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		viewInfo.format = format;
+		viewInfo.components = VkComponentMapping{};
+		viewInfo.subresourceRange = VkImageSubresourceRange
+		{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, mip_levels,
+			0, _layers
+		};
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (const auto& res = vkCreateImageView(environment->Window().device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkCreateImageView() failed to create a CMSM filter image view. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		return lut::ImageView(environment->Window().device, view);
+	}
+
+	void MomentShadowFilter::cmdBuildMips(Environment* environment)
+	{
+		VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			/* BARRIER: compute write -> blit source (mip 0) */
+			lut::image_barrier(cmdBuffer, *_filtered[i],
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, _layers });
+
+			int32_t size = static_cast<int32_t>(_resolution);
+			for (uint32_t mip = 1; mip < _mipLevels; mip++)
+			{
+				/* BARRIER: undefined -> blit destination */
+				lut::image_barrier(cmdBuffer, *_filtered[i],
+					0,
+					VK_ACCESS_TRANSFER_WRITE_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+					VK_PIPELINE_STAGE_TRANSFER_BIT,
+					VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, _layers });
+
+				int32_t half = std::max(size / 2, 1);
+
+				VkImageBlit blit{};
+				blit.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, _layers };
+				blit.srcOffsets[1] = VkOffset3D{ size, size, 1 };
+				blit.dstSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, _layers };
+				blit.dstOffsets[1] = VkOffset3D{ half, half, 1 };
+
+				vkCmdBlitImage(cmdBuffer,
+					*_filtered[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					*_filtered[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					1, &blit, VK_FILTER_LINEAR);
+
+				/* BARRIER: blit destination -> blit source, for the next level */
+				lut::image_barrier(cmdBuffer, *_filtered[i],
+					VK_ACCESS_TRANSFER_WRITE_BIT,
+					VK_ACCESS_TRANSFER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					VK_PIPELINE_STAGE_TRANSFER_BIT,
+					VK_PIPELINE_STAGE_TRANSFER_BIT,
+					VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, _layers });
+
+				size = half;
+			}
+
+			/* BARRIER: blit source -> shader read (every mip) */
+			lut::image_barrier(cmdBuffer, *_filtered[i],
+				VK_ACCESS_TRANSFER_READ_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, _mipLevels, 0, _layers });
+		}
+	}
+
+	/* public member functions */
+
+	void MomentShadowFilter::CmdFilter(Environment* environment, const lut::Image* moments, const lut::Image* transmittance)
+	{
+		VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+		const VkImageSubresourceRange layerRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, _layers };
+
+		/* the maps come straight from the moment pass */
+		const lut::Image* sources[2] = { moments, transmittance };
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			/* BARRIER: colour attachment -> compute read */
+			lut::image_barrier(cmdBuffer, **sources[i],
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				layerRange);
+
+			/* BARRIER: last frame's reads -> compute write, the old contents aren't needed */
+			lut::image_barrier(cmdBuffer, *_blurred[i],
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				layerRange);
+
+			lut::image_barrier(cmdBuffer, *_filtered[i],
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				layerRange);
+		}
+
+		/* one workgroup per GROUP_SIZE texels of a row (or column), for every row and cascade. the whole map is
+			filtered, texels outside the rendered region take its edge so the coarser mips never average in stale data */
+		uint32_t groups = (_resolution + GROUP_SIZE - 1) / GROUP_SIZE;
+
+		_horizontalPipeline->CmdBind(environment);
+		_horizontalSet->CmdBind(environment, _horizontalPipeline, 0);
+		vkCmdDispatch(cmdBuffer, groups, _resolution, _layers);
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			/* BARRIER: compute write -> compute read */
+			lut::image_barrier(cmdBuffer, *_blurred[i],
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				layerRange);
+		}
+
+		_verticalPipeline->CmdBind(environment);
+		_verticalSet->CmdBind(environment, _verticalPipeline, 0);
+		vkCmdDispatch(cmdBuffer, groups, _resolution, _layers);
+
+		cmdBuildMips(environment);
+	}
+
+	/* getters */
+
+	const lut::ImageView& MomentShadowFilter::MomentView() const
+	{
+		return _filteredViews[0];
+	}
+	const lut::ImageView& MomentShadowFilter::TransmittanceView() const
+	{
+		return _filteredViews[1];
+	}
+	uint32_t MomentShadowFilter::MipLevels() const
+	{
+		return _mipLevels;
+	}
+}
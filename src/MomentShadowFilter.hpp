@@ -0,0 +1,78 @@
+#pragma once
+
+/* c++ */
+#include <vector>
+
+/* renderer */
+#include "DescriptorSet.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "Pipeline.hpp"
+
+/* labutils */
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+
+namespace Renderer
+{
+	class Environment;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* prefilters a coloured moment shadow map: a separable gaussian blur in two compute passes,
+		then a mip chain, so the lookup is a single filtered fetch whatever the filter width */
+	class MomentShadowFilter
+	{
+		public:
+			/* constructors, etc. */
+
+			MomentShadowFilter(const Environment* environment, uint32_t resolution, uint32_t layers,
+				const lut::ImageView* moment_view, const lut::ImageView* transmittance_view,
+				VkSampler sampler, VkBuffer shadow_data);
+			~MomentShadowFilter();
+
+			MomentShadowFilter(const MomentShadowFilter&) = delete;
+			MomentShadowFilter& operator=(const MomentShadowFilter&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr uint32_t GROUP_SIZE = 64; /* local_size_x in CMSM_blur.comp */
+
+			uint32_t _resolution = 0;
+			uint32_t _layers = 1;
+			uint32_t _mipLevels = 1;
+
+			/* [0]: moments, [1]: transmittance */
+			lut::Image _blurred[2]{}; /* horizontal pass output */
+			lut::Image _filtered[2]{}; /* vertical pass output + mip chain */
+			lut::ImageView _blurredViews[2]{};
+			lut::ImageView _filteredStorageViews[2]{}; /* mip 0 only */
+			lut::ImageView _filteredViews[2]{}; /* every mip, for the lookup */
+
+			DescriptorSetLayout* _layout = nullptr;
+			DescriptorSet* _horizontalSet = nullptr;
+			DescriptorSet* _verticalSet = nullptr;
+			Pipeline* _horizontalPipeline = nullptr;
+			Pipeline* _verticalPipeline = nullptr;
+
+			/* private member functions */
+
+			lut::Image createImage(const Environment* environment, VkFormat format, uint32_t mip_levels, VkImageUsageFlags usage);
+			lut::ImageView createView(const Environment* environment, VkImage image, VkFormat format, uint32_t mip_levels);
+			void cmdBuildMips(Environment* environment);
+
+		public:
+			/* public member functions */
+
+			void CmdFilter(Environment* environment, const lut::Image* moments, const lut::Image* transmittance);
+
+			/* getters */
+
+			const lut::ImageView& MomentView() const;
+			const lut::ImageView& TransmittanceView() const;
+			uint32_t MipLevels() const;
+	};
+}
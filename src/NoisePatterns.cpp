@@ -0,0 +1,299 @@
+#include "NoisePatterns.hpp"
+
+/* c */
+#include <cstdio>
+
+/* c++ */
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <random>
+
+/* renderer */
+#include "DescriptorSetLayout.hpp" // <- class DescriptorSetLayout
+#include "Environment.hpp" // <- class Environment
+#include "TextureUtilities.hpp" // <- CreateImageView()
+
+/* stb */
+#include <stb_image_write.h>
+
+namespace Renderer
+{
+	const char* NoisePatternName(NoisePattern pattern)
+	{
+		switch (pattern)
+		{
+			case NoisePattern::WHITE:
+				return "white";
+
+			case NoisePattern::BLUE:
+				return "blue";
+
+			case NoisePattern::BAYER:
+			default:
+				return "bayer";
+		}
+	}
+
+	/* constructors, etc. */
+
+	NoisePatterns::NoisePatterns(const Environment* environment, const DescriptorSetLayout* layout, VkSampler sampler,
+		const std::string& cache_directory, NoisePattern initial)
+	{
+		_pattern = initial;
+
+		for (uint32_t i = 0; i < NOISE_PATTERN_COUNT; i++)
+		{
+			NoisePattern pattern = static_cast<NoisePattern>(i);
+			std::string path = patternPath(pattern, cache_directory);
+
+			if (pattern == NoisePattern::WHITE || std::filesystem::exists(path))
+			{
+				_images[i] = lut::load_image_texture2d(path.c_str(),
+					environment->Window(), *environment->CommandPool(), environment->Allocator(), VK_FORMAT_R8G8B8A8_UNORM);
+			}
+			else
+			{
+				/* the texels are uploaded straight from memory, the cache only saves generating them next time */
+				std::vector<uint8_t> rgba = generatePattern(pattern);
+				cachePattern(pattern, path, rgba);
+
+				_images[i] = lut::image_from_data_texture2d(std::move(rgba), NOISE_TILE_SIZE, NOISE_TILE_SIZE, 4,
+					environment->Window(), *environment->CommandPool(), environment->Allocator(), VK_FORMAT_R8G8B8A8_UNORM);
+			}
+
+			_views[i] = CreateImageView(environment, *_images[i], VK_FORMAT_R8G8B8A8_UNORM);
+			_sets[i] = new DescriptorSet(environment, layout, *_views[i], sampler);
+		}
+	}
+
+	NoisePatterns::~NoisePatterns()
+	{
+		for (uint32_t i = 0; i < NOISE_PATTERN_COUNT; i++)
+			delete _sets[i];
+	}
+
+	/* private member functions */
+
+	std::vector<uint8_t> NoisePatterns::generateBlueNoise(uint32_t size, uint32_t seed)
+	{
+		/* void-and-cluster: every texel is ranked by the order it's added in, always into the largest gap,
+			so any threshold picks an evenly spread set of texels */
+		const uint32_t count = size * size;
+		const float sigma = 1.5f;
+
+		/* the gaussian energy a point adds at every (toroidal) offset, so the pattern tiles */
+		std::vector<float> kernel(count);
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				float dx = static_cast<float>(std::min(x, size - x));
+				float dy = static_cast<float>(std::min(y, size - y));
+				kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+			}
+		}
+
+		std::vector<uint8_t> points(count, 0);
+		std::vector<float> energy(count, 0.0f);
+
+		auto splat = [&](uint32_t p, float sign)
+		{
+			uint32_t px = p % size;
+			uint32_t py = p / size;
+			for (uint32_t y = 0; y < size; y++)
+			{
+				for (uint32_t x = 0; x < size; x++)
+					energy[((y + py) % size) * size + (x + px) % size] += sign * kernel[y * size + x];
+			}
+		};
+		auto tightestCluster = [&]()
+		{
+			uint32_t best = 0;
+			float bestEnergy = -1.0f;
+			for (uint32_t p = 0; p < count; p++)
+			{
+				if (points[p] != 0 && energy[p] > bestEnergy)
+				{
+					best = p;
+					bestEnergy = energy[p];
+				}
+			}
+			return best;
+		};
+		auto largestVoid = [&]()
+		{
+			uint32_t best = 0;
+			float bestEnergy = std::numeric_limits<float>::max();
+			for (uint32_t p = 0; p < count; p++)
+			{
+				if (points[p] == 0 && energy[p] < bestEnergy)
+				{
+					best = p;
+					bestEnergy = energy[p];
+				}
+			}
+			return best;
+		};
+
+		/* a tenth of the texels at random */
+		std::mt19937 rng(seed);
+		const uint32_t initial = count / 10;
+		for (uint32_t placed = 0; placed < initial;)
+		{
+			uint32_t p = rng() % count;
+			if (points[p] == 0)
+			{
+				points[p] = 1;
+				splat(p, 1.0f);
+				placed++;
+			}
+		}
+
+		/* spread them out, the tightest cluster's point moves to the largest void until it would move straight back */
+		for (;;)
+		{
+			uint32_t cluster = tightestCluster();
+			points[cluster] = 0;
+			splat(cluster, -1.0f);
+
+			uint32_t gap = largestVoid();
+			points[gap] = 1;
+			splat(gap, 1.0f);
+
+			if (gap == cluster)
+				break;
+		}
+
+		std::vector<uint32_t> rank(count, 0);
+		std::vector<uint8_t> prototype = points;
+		std::vector<float> prototypeEnergy = energy;
+
+		/* the initial points are ranked from the tightest cluster down */
+		for (uint32_t r = initial; r-- > 0;)
+		{
+			uint32_t cluster = tightestCluster();
+			points[cluster] = 0;
+			splat(cluster, -1.0f);
+			rank[cluster] = r;
+		}
+
+		/* the rest fill the largest void. past half full the original method ranks the tightest cluster of the empty texels,
+			with a toroidal gaussian that's the same texel as the largest void, so one loop does both */
+		points = prototype;
+		energy = prototypeEnergy;
+		for (uint32_t r = initial; r < count; r++)
+		{
+			uint32_t gap = largestVoid();
+			points[gap] = 1;
+			splat(gap, 1.0f);
+			rank[gap] = r;
+		}
+
+		std::vector<uint8_t> thresholds(count);
+		for (uint32_t p = 0; p < count; p++)
+			thresholds[p] = static_cast<uint8_t>((static_cast<uint64_t>(rank[p]) * 256) / count);
+
+		return thresholds;
+	}
+
+	std::vector<uint8_t> NoisePatterns::generateBayer(uint32_t size, uint32_t shift)
+	{
+		/* the recursive 2x2 ordered dither, the finest level is the most significant */
+		uint32_t levels = 0;
+		while ((1u << levels) < size)
+			levels++;
+
+		const uint32_t count = size * size;
+		std::vector<uint8_t> thresholds(count);
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				uint32_t sx = (x + shift) % size;
+				uint32_t sy = (y + shift * 3) % size;
+
+				uint32_t index = 0;
+				for (uint32_t bit = 0; bit < levels; bit++)
+				{
+					uint32_t xb = (sx >> bit) & 1;
+					uint32_t yb = (sy >> bit) & 1;
+					index |= (((xb ^ yb) << 1) | yb) << (2 * (levels - 1 - bit));
+				}
+
+				thresholds[y * size + x] = static_cast<uint8_t>((static_cast<uint64_t>(index) * 256) / count);
+			}
+		}
+
+		return thresholds;
+	}
+
+	std::string NoisePatterns::patternPath(NoisePattern pattern, const std::string& cache_directory)
+	{
+		if (pattern == NoisePattern::WHITE)
+			return "../res/images/rgb_noise_2048.png";
+
+		return cache_directory + "/noise_" + NoisePatternName(pattern) + "_" + std::to_string(NOISE_TILE_SIZE) + ".png";
+	}
+
+	std::vector<uint8_t> NoisePatterns::generatePattern(NoisePattern pattern)
+	{
+		/* an independent pattern per channel, CSSM thresholds each colour separately */
+		std::vector<uint8_t> channels[4];
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			channels[c] = (pattern == NoisePattern::BLUE) ? generateBlueNoise(NOISE_TILE_SIZE, 1337u + c) :
+				generateBayer(NOISE_TILE_SIZE, c * (NOISE_TILE_SIZE / 4 + 1));
+		}
+
+		const uint32_t count = NOISE_TILE_SIZE * NOISE_TILE_SIZE;
+		std::vector<uint8_t> rgba(count * 4);
+		for (uint32_t p = 0; p < count; p++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+				rgba[p * 4 + c] = channels[c][p];
+		}
+
+		return rgba;
+	}
+
+	void NoisePatterns::cachePattern(NoisePattern pattern, const std::string& path, const std::vector<uint8_t>& rgba)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+		/* written upside down, load_image_texture2d() flips on load, so a cached pattern matches the one uploaded from memory */
+		stbi_flip_vertically_on_write(1);
+		int written = stbi_write_png(path.c_str(), NOISE_TILE_SIZE, NOISE_TILE_SIZE, 4, rgba.data(), NOISE_TILE_SIZE * 4);
+		stbi_flip_vertically_on_write(0);
+
+		/* not fatal, the pattern is just generated again next run */
+		if (written == 0)
+			printf("The %s noise pattern couldn't be cached at [%s]\n", NoisePatternName(pattern), path.c_str());
+	}
+
+	/* public member functions */
+
+	void NoisePatterns::Select(NoisePattern pattern)
+	{
+		_pattern = pattern;
+	}
+
+	void NoisePatterns::Cycle()
+	{
+		_pattern = static_cast<NoisePattern>((static_cast<uint32_t>(_pattern) + 1) % NOISE_PATTERN_COUNT);
+	}
+
+	/* getters */
+
+	NoisePattern NoisePatterns::Pattern() const
+	{
+		return _pattern;
+	}
+
+	DescriptorSet* NoisePatterns::Set()
+	{
+		return _sets[static_cast<uint32_t>(_pattern)];
+	}
+}
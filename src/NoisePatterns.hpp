@@ -0,0 +1,79 @@
+#pragma once
+
+/* c++ */
+#include <string>
+#include <vector>
+
+/* renderer */
+#include "DescriptorSet.hpp"
+
+/* labutils */
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+
+namespace Renderer
+{
+	class DescriptorSetLayout;
+	class Environment;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* the threshold the stochastic shadow passes compare alpha against, the shaders' samplingInfo.x */
+	enum class NoisePattern
+	{
+		WHITE = 0, /* rgb_noise_2048.png, looked up with a hashed world position */
+		BLUE, /* void-and-cluster, per shadow map texel */
+		BAYER /* ordered dither, per shadow map texel */
+	};
+
+	static const uint32_t NOISE_PATTERN_COUNT = 3;
+	static const uint32_t NOISE_TILE_SIZE = 64; /* texels per side of the generated, tileable patterns */
+
+	const char* NoisePatternName(NoisePattern pattern);
+
+	/* every noise pattern, loaded once so switching between them at runtime only rebinds a set.
+		the generated patterns are uploaded as they're generated and written to cache_directory as pngs, which later runs load instead */
+	class NoisePatterns
+	{
+		public:
+			/* constructors, etc. */
+
+			NoisePatterns(const Environment* environment, const DescriptorSetLayout* layout, VkSampler sampler,
+				const std::string& cache_directory, NoisePattern initial = NoisePattern::BLUE);
+			~NoisePatterns();
+
+			NoisePatterns(const NoisePatterns&) = delete;
+			NoisePatterns& operator=(const NoisePatterns&) = delete;
+
+		private:
+			/* private member variables */
+
+			NoisePattern _pattern = NoisePattern::BLUE;
+
+			lut::Image _images[NOISE_PATTERN_COUNT]{};
+			lut::ImageView _views[NOISE_PATTERN_COUNT]{};
+			DescriptorSet* _sets[NOISE_PATTERN_COUNT]{};
+
+			/* private member functions */
+
+			static std::vector<uint8_t> generateBlueNoise(uint32_t size, uint32_t seed);
+			static std::vector<uint8_t> generateBayer(uint32_t size, uint32_t shift);
+			static std::string patternPath(NoisePattern pattern, const std::string& cache_directory);
+			static std::vector<uint8_t> generatePattern(NoisePattern pattern);
+			static void cachePattern(NoisePattern pattern, const std::string& path, const std::vector<uint8_t>& rgba);
+
+		public:
+			/* public member functions */
+
+			void Select(NoisePattern pattern);
+			void Cycle();
+
+			/* getters */
+
+			NoisePattern Pattern() const;
+			DescriptorSet* Set();
+	};
+}
@@ -4,6 +4,10 @@
 #include "RenderPass.hpp" // <- class RenderPass
 #include "Environment.hpp" // <- class Environment
 #include "Constants.hpp"
+#include "PipelineCache.hpp" // <- class PipelineCache
+
+/* c */
+#include <cstddef>
 
 /* labutils */
 #include "../labutils/error.hpp"
@@ -23,12 +27,23 @@ namespace Renderer
 		_initData = init_data;
 
 		createPipelineLayout(environment, descSets);
-		createPipeline(environment);
+
+		_pending = environment->Pipelines()->Submit([this, environment] {
+			_pipeline = createPipeline(environment, _initData.shadowFilter);
+		});
 	}
 
 	Pipeline::~Pipeline()
 	{
-		/* Everything is a member variable, so I don't *think* anything needs to be here... */
+		/* the compiles may still be using this object, an exception they threw doesn't matter anymore */
+		if (_pending.valid())
+			_pending.wait();
+
+		for (auto& [filter, variant] : _variants)
+		{
+			if (variant.pending.valid())
+				variant.pending.wait();
+		}
 	}
 
 
@@ -61,14 +76,17 @@ namespace Renderer
 		_layout = PipelineLayout(environment->Window().device, layout);
 	}
 
-	void Pipeline::createPipeline(const Environment* environment)
+	labutils::Pipeline Pipeline::createPipeline(const Environment* environment, const ShadowFilter& filter) const
 	{
 		using namespace labutils;
-		
-		_currentExtent = environment->Window().swapchainExtent;
 
-		ShaderModule vert{};
-		ShaderModule frag{};
+		if (IsCompute())
+			return createComputePipeline(environment);
+
+		PipelineCache* cache = environment->Pipelines();
+
+		VkShaderModule vert = VK_NULL_HANDLE;
+		VkShaderModule frag = VK_NULL_HANDLE;
 		std::vector<VkPipelineShaderStageCreateInfo> stagesInfo{};
 
 		if (_initData.specialMode == SpecialMode::NONE)
@@ -77,8 +95,8 @@ namespace Renderer
 			{
 				case (FragmentMode::SIMPLE):
 				default:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "default.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "default.frag.spv");
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "default.frag.spv");
 					stagesInfo.resize(2);
 					break;
 			}
@@ -89,59 +107,154 @@ namespace Renderer
 			switch (_initData.specialMode)
 			{
 				case SpecialMode::SCREEN_QUAD_PRESENT:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "fullscreen.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "present_quad.frag.spv");
+					vert = cache->Module("../res/shaders/" "fullscreen.vert.spv");
+					frag = cache->Module("../res/shaders/" "present_quad.frag.spv");
 					break;
 
 				case SpecialMode::SHADOW_MAP:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "shadowmap.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "shadowmap.frag.spv");
+					vert = cache->Module("../res/shaders/" "shadowmap.vert.spv");
+					frag = cache->Module("../res/shaders/" "shadowmap.frag.spv");
 					break;
 
 				case SpecialMode::TS_GEOMETRY:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "default.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "TS_geometryPass.frag.spv");
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "TS_geometryPass.frag.spv");
 					break;
 					
 				case SpecialMode::TS_COLOURED_SHADOW_MAP:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "TS_colouredShadowPass.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "TS_colouredShadowPass.frag.spv");
+					vert = cache->Module("../res/shaders/" "TS_colouredShadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "TS_colouredShadowPass.frag.spv");
+					break;
+
+				case SpecialMode::TS_OPAQUE_DEPTH:
+					vert = cache->Module("../res/shaders/" "fullscreen.vert.spv");
+					frag = cache->Module("../res/shaders/" "TS_opaqueDepth.frag.spv");
 					break;
 
 				case SpecialMode::SSM_STOCHASTIC_SHADOW_MAP:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "SSM_shadowPass.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "SSM_shadowPass.frag.spv");
+					vert = cache->Module("../res/shaders/" "SSM_shadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "SSM_shadowPass.frag.spv");
 					break;
 
 				case SpecialMode::SSM_DEFAULT_BIG_PCF:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "default.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "SSM_defaultPCF.frag.spv");
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "SSM_defaultPCF.frag.spv");
 					break;
 
 				case SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "SSM_shadowPass.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "CSSM_shadowPass.frag.spv");
+					vert = cache->Module("../res/shaders/" "SSM_shadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "CSSM_shadowPass.frag.spv");
 					break;
 
 				case SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP_2:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "SSM_shadowPass.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "CSSM_secondShadowPass.frag.spv");
+					vert = cache->Module("../res/shaders/" "SSM_shadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "CSSM_secondShadowPass.frag.spv");
 					break;
 
 				case SpecialMode::CSSM_DEFAULT:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "default.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "CSSM_defaultPCF.frag.spv");
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "CSSM_defaultPCF.frag.spv");
+					break;
+
+				case SpecialMode::CSSM_MSAA_SHADOW_MAP:
+					vert = cache->Module("../res/shaders/" "SSM_shadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "CSSM_msaaShadowPass.frag.spv");
+					break;
+
+				case SpecialMode::CSSM_MSAA_DEFAULT:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "CSSM_msaaPCF.frag.spv");
 					break;
 
 				case SpecialMode::DPTS_GEOMETRY:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "default.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "DPTS_geometryPass.frag.spv");
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "DPTS_geometryPass.frag.spv");
+					break;
+
+				case SpecialMode::VSM_ANALYSIS:
+					vert = cache->Module("../res/shaders/" "VSM_analysis.vert.spv");
+					frag = cache->Module("../res/shaders/" "VSM_analysis.frag.spv");
+					break;
+
+				case SpecialMode::VSM_DEFAULT:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "VSM_default.frag.spv");
+					break;
+
+				case SpecialMode::VSM_TS_GEOMETRY:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "VSM_TS_geometryPass.frag.spv");
+					break;
+
+				case SpecialMode::VSM_CSSM_DEFAULT:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "VSM_CSSM_defaultPCF.frag.spv");
+					break;
+
+				case SpecialMode::CMSM_MOMENT_SHADOW_MAP:
+					vert = cache->Module("../res/shaders/" "SSM_shadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "CMSM_shadowPass.frag.spv");
+					break;
+
+				case SpecialMode::CMSM_DEFAULT:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "CMSM_default.frag.spv");
+					break;
+
+				case SpecialMode::FOM_SHADOW_MAP:
+					vert = cache->Module("../res/shaders/" "SSM_shadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "FOM_shadowPass.frag.spv");
+					break;
+
+				case SpecialMode::FOM_DEFAULT:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "FOM_default.frag.spv");
+					break;
+
+				case SpecialMode::LOCAL_SHADOW_MAP:
+					vert = cache->Module("../res/shaders/" "localShadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "shadowmap.frag.spv");
+					break;
+
+				case SpecialMode::LOCAL_TS_SHADOW_MAP:
+					vert = cache->Module("../res/shaders/" "localShadowPass.vert.spv");
+					frag = cache->Module("../res/shaders/" "TS_colouredShadowPass.frag.spv");
+					break;
+
+				case SpecialMode::LOCAL_LIGHTING:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "localLights.frag.spv");
+					break;
+
+				case SpecialMode::BAKED_DEFAULT:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "bakedShadows.frag.spv");
+					break;
+
+				case SpecialMode::SHADOW_MASK_DEPTH:
+					vert = cache->Module("../res/shaders/" "depthPrepass.vert.spv");
+					frag = cache->Module("../res/shaders/" "shadowmap.frag.spv");
+					break;
+
+				case SpecialMode::SHADOW_MASK_DEFAULT:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "shadowMask_default.frag.spv");
+					break;
+
+				case SpecialMode::DEFERRED_GBUFFER:
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "gbuffer.frag.spv");
+					break;
+
+				case SpecialMode::DEFERRED_LIGHTING:
+					vert = cache->Module("../res/shaders/" "fullscreen.vert.spv");
+					frag = cache->Module("../res/shaders/" "deferredLighting.frag.spv");
 					break;
 
 				case SpecialMode::DPTS_SHADOWMAP:
 					default:
-					vert = load_shader_module(environment->Window(), "../res/shaders/" "default.vert.spv");
-					frag = load_shader_module(environment->Window(), "../res/shaders/" "DPTS_shadowPass.frag.spv");
+					vert = cache->Module("../res/shaders/" "default.vert.spv");
+					frag = cache->Module("../res/shaders/" "DPTS_shadowPass.frag.spv");
 					break;
 			}
 
@@ -152,15 +265,34 @@ namespace Renderer
 		/* Vertex Shader */
 		stagesInfo[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stagesInfo[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		stagesInfo[0].module = *vert;
+		stagesInfo[0].module = vert;
 		stagesInfo[0].pName = "main";
 
 		/* Fragment Shader */
 		stagesInfo[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stagesInfo[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		stagesInfo[1].module = *frag;
+		stagesInfo[1].module = frag;
 		stagesInfo[1].pName = "main";
 
+		/* the shadow filter's settings that are set, the shaders' own values stand in for the rest.
+			constant ids a shader doesn't declare are ignored, so every fragment shader can be given them */
+		std::vector<VkSpecializationMapEntry> specEntries{};
+		if (filter.pcfRadius > 0)
+			specEntries.push_back({ 0, offsetof(ShadowFilter, pcfRadius), sizeof(uint32_t) });
+		if (filter.depthBias >= 0.0f)
+			specEntries.push_back({ 1, offsetof(ShadowFilter, depthBias), sizeof(float) });
+		if (filter.normalBias >= 0.0f)
+			specEntries.push_back({ 2, offsetof(ShadowFilter, normalBias), sizeof(float) });
+
+		VkSpecializationInfo specInfo{};
+		specInfo.mapEntryCount = static_cast<uint32_t>(specEntries.size());
+		specInfo.pMapEntries = specEntries.data();
+		specInfo.dataSize = sizeof(ShadowFilter);
+		specInfo.pData = &filter;
+
+		if (specEntries.empty() == false)
+			stagesInfo[1].pSpecializationInfo = &specInfo;
+
 		/* Vertex input info */
 		std::vector<VkVertexInputBindingDescription> vertexInputs{};
 		std::vector <VkVertexInputAttributeDescription> vertexAttributes{};
@@ -169,7 +301,12 @@ namespace Renderer
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-		if (_initData.specialMode == SpecialMode::NONE || _initData.specialMode != SpecialMode::SCREEN_QUAD_PRESENT)
+		/* full screen passes make their triangle from gl_VertexIndex */
+		bool fullscreen = (_initData.specialMode == SpecialMode::SCREEN_QUAD_PRESENT ||
+			_initData.specialMode == SpecialMode::DEFERRED_LIGHTING ||
+			_initData.specialMode == SpecialMode::TS_OPAQUE_DEPTH);
+
+		if (fullscreen == false)
 		{
 			/* Vertex input info continued */
 
@@ -201,7 +338,17 @@ namespace Renderer
 				_initData.specialMode == SpecialMode::TS_GEOMETRY ||
 				_initData.specialMode == SpecialMode::SSM_DEFAULT_BIG_PCF ||
 				_initData.specialMode == SpecialMode::CSSM_DEFAULT ||
-				_initData.specialMode == SpecialMode::DPTS_GEOMETRY)
+				_initData.specialMode == SpecialMode::CSSM_MSAA_DEFAULT ||
+				_initData.specialMode == SpecialMode::DPTS_GEOMETRY ||
+				_initData.specialMode == SpecialMode::VSM_DEFAULT ||
+				_initData.specialMode == SpecialMode::VSM_TS_GEOMETRY ||
+				_initData.specialMode == SpecialMode::VSM_CSSM_DEFAULT ||
+				_initData.specialMode == SpecialMode::CMSM_DEFAULT ||
+				_initData.specialMode == SpecialMode::FOM_DEFAULT ||
+				_initData.specialMode == SpecialMode::LOCAL_LIGHTING ||
+				_initData.specialMode == SpecialMode::SHADOW_MASK_DEFAULT ||
+				_initData.specialMode == SpecialMode::DEFERRED_GBUFFER ||
+				_initData.specialMode == SpecialMode::BAKED_DEFAULT)
 			{
 					/* Normals input info */
 				vertexInputs.push_back({});
@@ -230,40 +377,22 @@ namespace Renderer
 		inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
 
 		/* Viewport Info */
-		VkViewport viewport{};
-		VkRect2D scissorRect{};
-
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		scissorRect.offset = VkOffset2D{ 0, 0 };
-		if (_initData.specialMode == SpecialMode::SHADOW_MAP ||
-			_initData.specialMode == SpecialMode::TS_COLOURED_SHADOW_MAP ||
-			_initData.specialMode == SpecialMode::SSM_STOCHASTIC_SHADOW_MAP ||
-			_initData.specialMode == SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP ||
-			_initData.specialMode == SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP_2 ||
-			_initData.specialMode == SpecialMode::DPTS_SHADOWMAP)
-		{
-			viewport.width = SHADOW_MAP_RESOLUTION_F;
-			viewport.height = SHADOW_MAP_RESOLUTION_F;
-			scissorRect.extent = VkExtent2D{ SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION };
-			_currentExtent = VkExtent2D{ SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION };
-		}
-		else
-		{
-			viewport.width = static_cast<float>(_currentExtent.width);
-			viewport.height = static_cast<float>(_currentExtent.height);
-			scissorRect.extent = VkExtent2D{ _currentExtent.width, _currentExtent.height };
-		}
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-
 
+		/* the viewport and scissor are always dynamic, Environment::BeginRenderPass() sets them to the target's extent,
+			so a pipeline is used at any resolution and never rebuilt for a resize */
 		VkPipelineViewportStateCreateInfo viewportInfo{};
 		viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 		viewportInfo.viewportCount = 1;
-		viewportInfo.pViewports = &viewport;
+		viewportInfo.pViewports = nullptr;
 		viewportInfo.scissorCount = 1;
-		viewportInfo.pScissors = &scissorRect;
+		viewportInfo.pScissors = nullptr;
+
+		const VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkPipelineDynamicStateCreateInfo dynamicInfo{};
+		dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicInfo.dynamicStateCount = 2;
+		dynamicInfo.pDynamicStates = dynamicStates;
 
 		/* Depth Stencil Settings */
 		VkPipelineDepthStencilStateCreateInfo depthInfo{};
@@ -274,7 +403,21 @@ namespace Renderer
 			depthInfo.depthWriteEnable = (_initData.depthWrite == DepthWrite::ENABLED) ? VK_TRUE : VK_FALSE;
 			depthInfo.depthTestEnable = VK_TRUE;
 
-			switch(_initData.depthOp)
+			/* the op is named for the standard depth range, a reversed pass mirrors it */
+			DepthOp depthOp = _initData.depthOp;
+			if (_epRenderPass->Features().depthRange == DepthRange::REVERSED)
+			{
+				if (depthOp == DepthOp::LEQUAL)
+					depthOp = DepthOp::GEQUAL;
+				else if (depthOp == DepthOp::GEQUAL)
+					depthOp = DepthOp::LEQUAL;
+				else if (depthOp == DepthOp::LESS)
+					depthOp = DepthOp::GREATER;
+				else if (depthOp == DepthOp::GREATER)
+					depthOp = DepthOp::LESS;
+			}
+
+			switch(depthOp)
 			{
 				case DepthOp::LEQUAL:
 					depthInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
@@ -291,6 +434,10 @@ namespace Renderer
 				case DepthOp::GREATER:
 					depthInfo.depthCompareOp = VK_COMPARE_OP_GREATER;
 					break;
+
+				case DepthOp::ALWAYS:
+					depthInfo.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+					break;
 			}
 		}
 		else
@@ -324,10 +471,11 @@ namespace Renderer
 
 		VkPipelineMultisampleStateCreateInfo multisampleInfo{};
 		multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		multisampleInfo.rasterizationSamples = SampleCountVkFlag(_epRenderPass->Features().sampleCount);
 
 		/* Blend Info */
-		VkPipelineColorBlendAttachmentState blendState[1]{};
+		uint32_t blendCount = (_epRenderPass->ColourAttachmentCount() > 1) ? _epRenderPass->ColourAttachmentCount() : 1;
+		std::vector<VkPipelineColorBlendAttachmentState> blendState(blendCount, VkPipelineColorBlendAttachmentState{});
 		if (_initData.alphaBlend == AlphaBlend::ENABLED)
 		{
 			blendState[0].blendEnable = VK_TRUE;
@@ -343,6 +491,12 @@ namespace Renderer
 				blendState[0].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
 				blendState[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
 			}
+			else if (_initData.blendMode == BlendMode::ADD_SRC_ONE)
+			{
+				blendState[0].colorBlendOp = VK_BLEND_OP_ADD;
+				blendState[0].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+				blendState[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			}
 			blendState[0].alphaBlendOp = VK_BLEND_OP_ADD;
 			blendState[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
 			blendState[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
@@ -356,10 +510,77 @@ namespace Renderer
 		else
 			blendState[0].colorWriteMask = 0;
 
+		if (_epRenderPass->Features().specialColour == SpecialColour::TS_COLOUR_AND_DEPTH)
+		{
+			/* the second attachment keeps the nearest translucent depth, regardless of draw order */
+			blendState[1].blendEnable = VK_TRUE;
+			blendState[1].colorBlendOp = VK_BLEND_OP_MIN;
+			blendState[1].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[1].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[1].alphaBlendOp = VK_BLEND_OP_MIN;
+			blendState[1].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[1].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[1].colorWriteMask = (_initData.colorWrite == ColorWrite::ENABLED) ? VK_COLOR_COMPONENT_R_BIT : 0;
+		}
+
+		if (_epRenderPass->Features().specialColour == SpecialColour::CMSM_MOMENTS)
+		{
+			/* opaque casters write their depth moments to rg. translucent casters keep the nearest
+				translucent moments in ba and multiply their transmittance into the second attachment */
+			bool translucent = (_initData.alphaBlend == AlphaBlend::ENABLED);
+
+			blendState[0].blendEnable = (translucent) ? VK_TRUE : VK_FALSE;
+			blendState[0].colorBlendOp = VK_BLEND_OP_MIN;
+			blendState[0].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[0].alphaBlendOp = VK_BLEND_OP_MIN;
+			blendState[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[0].colorWriteMask = (translucent) ?
+				(VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT) : (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT);
+
+			blendState[1].blendEnable = VK_TRUE;
+			blendState[1].colorBlendOp = VK_BLEND_OP_ADD;
+			blendState[1].srcColorBlendFactor = VK_BLEND_FACTOR_DST_COLOR;
+			blendState[1].dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+			blendState[1].alphaBlendOp = VK_BLEND_OP_ADD;
+			blendState[1].srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+			blendState[1].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendState[1].colorWriteMask = (translucent) ?
+				(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT) : 0;
+		}
+
+		if (_epRenderPass->Features().specialColour == SpecialColour::FOM_COEFFICIENTS)
+		{
+			/* translucent casters add their absorbance and coefficients, so any draw order gives the same sums.
+				opaque casters only fill the depth attachment */
+			bool translucent = (_initData.alphaBlend == AlphaBlend::ENABLED);
+
+			for (uint32_t i = 0; i < blendCount; i++)
+			{
+				blendState[i].blendEnable = (translucent) ? VK_TRUE : VK_FALSE;
+				blendState[i].colorBlendOp = VK_BLEND_OP_ADD;
+				blendState[i].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+				blendState[i].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+				blendState[i].alphaBlendOp = VK_BLEND_OP_ADD;
+				blendState[i].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+				blendState[i].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+				blendState[i].colorWriteMask = (translucent) ?
+					(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT) : 0;
+			}
+		}
+
+		if (_epRenderPass->Features().specialColour == SpecialColour::GBUFFER)
+		{
+			/* every G-buffer attachment is overwritten */
+			for (uint32_t i = 1; i < blendCount; i++)
+				blendState[i] = blendState[0];
+		}
+
 		VkPipelineColorBlendStateCreateInfo blendInfo{};
 		blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		blendInfo.attachmentCount = 1;
-		blendInfo.pAttachments = blendState;
+		blendInfo.attachmentCount = blendCount;
+		blendInfo.pAttachments = blendState.data();
 		blendInfo.logicOpEnable = VK_FALSE;
 
 		/* Create the Pipeline (finally) */
@@ -377,43 +598,181 @@ namespace Renderer
 		plInfo.pMultisampleState = &multisampleInfo;
 		plInfo.pColorBlendState = &blendInfo;
 		plInfo.pDepthStencilState = &depthInfo;
+		plInfo.pDynamicState = &dynamicInfo;
 
 		plInfo.layout = *_layout;
 		plInfo.renderPass = **_epRenderPass;
 		plInfo.subpass = 0;
 
 		VkPipeline pipeline = VK_NULL_HANDLE;
-		if (const auto res = vkCreateGraphicsPipelines(environment->Window().device, VK_NULL_HANDLE, 1, &plInfo, nullptr, &pipeline); res != VK_SUCCESS)
+		if (const auto res = vkCreateGraphicsPipelines(environment->Window().device, cache->Handle(), 1, &plInfo, nullptr, &pipeline); res != VK_SUCCESS)
 		{
 			throw Error("VK: vkCreateGraphicsPipelines() failed. err: %s",
 				to_string(res).c_str());
 		}
 
-		_pipeline = labutils::Pipeline(environment->Window().device, pipeline);
+		return labutils::Pipeline(environment->Window().device, pipeline);
 	}
 
-	/* public member functions */
+	labutils::Pipeline Pipeline::createComputePipeline(const Environment* environment) const
+	{
+		using namespace labutils;
+
+		PipelineCache* cache = environment->Pipelines();
 
-	bool Pipeline::IsCompatible(const Environment* environment) const
+		VkShaderModule comp = VK_NULL_HANDLE;
+		uint32_t variant = 0;
+
+		switch (_initData.specialMode)
+		{
+			case SpecialMode::SHADOW_PYRAMID_BASE:
+			case SpecialMode::SHADOW_PYRAMID_BASE_COLOUR:
+			case SpecialMode::SHADOW_PYRAMID_DOWNSAMPLE:
+				comp = cache->Module("../res/shaders/" "shadowPyramid.comp.spv");
+				variant = (_initData.specialMode == SpecialMode::SHADOW_PYRAMID_BASE) ? 0 :
+					(_initData.specialMode == SpecialMode::SHADOW_PYRAMID_BASE_COLOUR) ? 1 : 2;
+				break;
+
+			case SpecialMode::SHADOW_MASK_SSM:
+			case SpecialMode::SHADOW_MASK_CSSM:
+			case SpecialMode::SHADOW_MASK_TS:
+				comp = cache->Module("../res/shaders/" "shadowMask.comp.spv");
+				variant = (_initData.specialMode == SpecialMode::SHADOW_MASK_SSM) ? 0 :
+					(_initData.specialMode == SpecialMode::SHADOW_MASK_CSSM) ? 1 : 2;
+				break;
+
+			case SpecialMode::SHADOW_MASK_TEMPORAL:
+				comp = cache->Module("../res/shaders/" "shadowMaskTemporal.comp.spv");
+				break;
+
+			case SpecialMode::SHADOW_MASK_GUIDE:
+			case SpecialMode::SHADOW_MASK_DENOISE_HORIZONTAL:
+			case SpecialMode::SHADOW_MASK_DENOISE_VERTICAL:
+				comp = cache->Module("../res/shaders/" "shadowMaskDenoise.comp.spv");
+				variant = (_initData.specialMode == SpecialMode::SHADOW_MASK_GUIDE) ? 0 :
+					(_initData.specialMode == SpecialMode::SHADOW_MASK_DENOISE_HORIZONTAL) ? 1 : 2;
+				break;
+
+			case SpecialMode::CMSM_BLUR_HORIZONTAL:
+			case SpecialMode::CMSM_BLUR_VERTICAL:
+			default:
+				comp = cache->Module("../res/shaders/" "CMSM_blur.comp.spv");
+				variant = (_initData.specialMode == SpecialMode::CMSM_BLUR_VERTICAL) ? 1 : 0;
+				break;
+		}
+
+		/* the variant (blur direction, pyramid source, mask technique, denoise pass) is a specialisation constant, so related passes share one shader */
+		VkSpecializationMapEntry specEntry{ 0, 0, sizeof(uint32_t) };
+
+		VkSpecializationInfo specInfo{};
+		specInfo.mapEntryCount = 1;
+		specInfo.pMapEntries = &specEntry;
+		specInfo.dataSize = sizeof(uint32_t);
+		specInfo.pData = &variant;
+
+		VkComputePipelineCreateInfo plInfo{};
+		plInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		plInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		plInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		plInfo.stage.module = comp;
+		plInfo.stage.pName = "main";
+		plInfo.stage.pSpecializationInfo = &specInfo;
+		plInfo.layout = *_layout;
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		if (const auto res = vkCreateComputePipelines(environment->Window().device, cache->Handle(), 1, &plInfo, nullptr, &pipeline); res != VK_SUCCESS)
+		{
+			throw Error("VK: vkCreateComputePipelines() failed. err: %s",
+				to_string(res).c_str());
+		}
+
+		return labutils::Pipeline(environment->Window().device, pipeline);
+	}
+
+	void Pipeline::waitReady() const
 	{
-		if (_initData.specialMode == SpecialMode::NONE)
-			return (environment->Window().swapchainExtent.width == _currentExtent.width &&
-				environment->Window().swapchainExtent.height == _currentExtent.height);
-		else
-			return true;
+		/* get() hands any failure in the compile over to this thread */
+		if (_pending.valid())
+			_pending.get();
 	}
 
+	void Pipeline::waitVariants()
+	{
+		for (auto& [filter, variant] : _variants)
+		{
+			if (variant.pending.valid())
+				variant.pending.get();
+		}
+	}
+
+	/* public member functions */
+
 	void Pipeline::Repair(const Environment* environment, const Renderer::RenderPass* render_pass)
 	{
+		waitReady();
+		waitVariants();
+
 		if (render_pass != nullptr)
 			_epRenderPass = render_pass;
 
-		createPipeline(environment);
+		/* rebuilt straight away, the cache makes it cheap */
+		_pipeline = createPipeline(environment, _initData.shadowFilter);
+
+		for (auto& [filter, variant] : _variants)
+			variant.pipeline = createPipeline(environment, filter);
+	}
+
+	bool Pipeline::IsCompute() const
+	{
+		/* compute pipelines have no render pass */
+		return (_initData.specialMode == SpecialMode::CMSM_BLUR_HORIZONTAL ||
+			_initData.specialMode == SpecialMode::CMSM_BLUR_VERTICAL ||
+			_initData.specialMode == SpecialMode::SHADOW_PYRAMID_BASE ||
+			_initData.specialMode == SpecialMode::SHADOW_PYRAMID_BASE_COLOUR ||
+			_initData.specialMode == SpecialMode::SHADOW_PYRAMID_DOWNSAMPLE ||
+			_initData.specialMode == SpecialMode::SHADOW_MASK_SSM ||
+			_initData.specialMode == SpecialMode::SHADOW_MASK_CSSM ||
+			_initData.specialMode == SpecialMode::SHADOW_MASK_TS ||
+			_initData.specialMode == SpecialMode::SHADOW_MASK_TEMPORAL ||
+			_initData.specialMode == SpecialMode::SHADOW_MASK_GUIDE ||
+			_initData.specialMode == SpecialMode::SHADOW_MASK_DENOISE_HORIZONTAL ||
+			_initData.specialMode == SpecialMode::SHADOW_MASK_DENOISE_VERTICAL);
 	}
 
 	void Pipeline::CmdBind(Environment* environment)
 	{
-		vkCmdBindPipeline(*environment->CurrentCmdBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, *_pipeline);
+		waitReady();
+		vkCmdBindPipeline(*environment->CurrentCmdBuffer(), BindPoint(), *_pipeline);
+	}
+
+	void Pipeline::PrepareVariant(const Environment* environment, const ShadowFilter& filter)
+	{
+		/* compute shaders don't filter shadows */
+		if (IsCompute() || filter == _initData.shadowFilter || _variants.contains(filter))
+			return;
+
+		/* map nodes never move, so the worker writes into this one while others are added */
+		Variant& variant = _variants[filter];
+		variant.pending = environment->Pipelines()->Submit([this, environment, filter, &variant] {
+			variant.pipeline = createPipeline(environment, filter);
+		});
+	}
+
+	void Pipeline::CmdBind(Environment* environment, const ShadowFilter& filter)
+	{
+		if (IsCompute() || filter == _initData.shadowFilter)
+		{
+			CmdBind(environment);
+			return;
+		}
+
+		PrepareVariant(environment, filter);
+
+		Variant& variant = _variants[filter];
+		if (variant.pending.valid())
+			variant.pending.get();
+
+		vkCmdBindPipeline(*environment->CurrentCmdBuffer(), BindPoint(), *variant.pipeline);
 	}
 
 	/* getters */
@@ -424,6 +783,11 @@ namespace Renderer
 	}
 	const labutils::Pipeline& Pipeline::GetPipeline() const
 	{
+		waitReady();
 		return _pipeline;
 	}
+	VkPipelineBindPoint Pipeline::BindPoint() const
+	{
+		return (IsCompute()) ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
+	}
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <cstdint>
 
 /* c++ */
+#include <future>
+#include <map>
 #include <vector>
 
 /* renderer */ 
@@ -22,6 +24,11 @@ namespace Renderer
 {
 	namespace lut = labutils;
 
+	/* the layout is made straight away, the pipeline itself is compiled on one of the environment's PipelineCache workers
+		and waited for the first time it's needed, so constructing a batch of them overlaps their compiles with each other
+		and with whatever the caller does next.
+		the same pipeline specialised for other shadow filters is compiled the same way, once per filter, and kept alongside
+		it with the same layout and render pass, so filter quality tiers are switched per draw without another .frag */
 	class Pipeline
 	{
 
@@ -44,27 +51,45 @@ namespace Renderer
 			lut::PipelineLayout _layout{};
 			lut::Pipeline _pipeline{};
 			PipelineFeatures _initData{};
-			VkExtent2D _currentExtent{};
 
 			const Renderer::RenderPass* _epRenderPass = nullptr;
 
+			mutable std::future<void> _pending{}; /* the compile, while it hasn't been waited for */
+
+			/* a specialised copy, and its compile while it hasn't been waited for */
+			struct Variant
+			{
+				lut::Pipeline pipeline{};
+				std::future<void> pending{};
+			};
+
+			std::map<ShadowFilter, Variant> _variants{}; /* every shadow filter but _initData's asked for so far */
+
 			/* private member functions */
 
 			void createPipelineLayout(const Environment* environment,
 				const std::vector<const VkDescriptorSetLayout*>& descSets);
-			void createPipeline(const Environment* environment);
+			lut::Pipeline createPipeline(const Environment* environment, const ShadowFilter& filter) const;
+			lut::Pipeline createComputePipeline(const Environment* environment) const;
+			void waitReady() const;
+			void waitVariants();
 
 		public:
 			/* public functions */
 
-			bool IsCompatible(const Environment* environment) const;
+			bool IsCompute() const;
 			void Repair(const Environment* environment, const Renderer::RenderPass* render_pass = nullptr);
 
 			void CmdBind(Environment* environment);
 
+			/* starts compiling the variant for filter if it hasn't been already, CmdBind() with that filter waits for it */
+			void PrepareVariant(const Environment* environment, const ShadowFilter& filter);
+			void CmdBind(Environment* environment, const ShadowFilter& filter);
+
 			/* getters */
 
 			const lut::PipelineLayout& GetPipelineLayout() const;
 			const lut::Pipeline& GetPipeline() const;
+			VkPipelineBindPoint BindPoint() const;
 	};
 }
\ No newline at end of file
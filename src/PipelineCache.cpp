@@ -0,0 +1,240 @@
+#include "PipelineCache.hpp"
+
+/* c */
+#include <cstring>
+
+/* c++ */
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/vkutil.hpp"
+
+namespace Renderer
+{
+	/* constructors, etc. */
+
+	PipelineCache::PipelineCache(const lut::VulkanWindow* window, const std::string& path, uint32_t thread_count)
+	{
+		_window = window;
+		_path = path;
+
+		std::vector<char> data = load();
+		_loadedSize = data.size();
+
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = data.size();
+		cacheInfo.pInitialData = (data.empty()) ? nullptr : data.data();
+
+		if (const auto res = vkCreatePipelineCache(_window->device, &cacheInfo, nullptr, &_cache); res != VK_SUCCESS)
+		{
+			/* data the driver won't take is no worse than none */
+			cacheInfo.initialDataSize = 0;
+			cacheInfo.pInitialData = nullptr;
+			_loadedSize = 0;
+
+			if (const auto retry = vkCreatePipelineCache(_window->device, &cacheInfo, nullptr, &_cache); retry != VK_SUCCESS)
+			{
+				throw lut::Error("VK: vkCreatePipelineCache() failed. err: %s",
+					lut::to_string(retry).c_str());
+			}
+		}
+
+		/* the main thread keeps loading while these compile, so leave it a core */
+		if (thread_count == 0)
+			thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		for (uint32_t i = 0; i < thread_count; i++)
+			_workers.emplace_back(&PipelineCache::workerLoop, this);
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_jobMutex);
+			_quit = true;
+		}
+		_wake.notify_all();
+
+		for (std::thread& worker : _workers)
+			worker.join();
+
+		save();
+
+		_modules.clear();
+		vkDestroyPipelineCache(_window->device, _cache, nullptr);
+	}
+
+	/* private member functions */
+
+	PipelineCache::FileHeader PipelineCache::header() const
+	{
+		VkPhysicalDeviceIDProperties idProps{};
+		idProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 props{};
+		props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props.pNext = &idProps;
+		vkGetPhysicalDeviceProperties2(_window->physicalDevice, &props);
+
+		FileHeader result{};
+		std::memcpy(result.magic, MAGIC, sizeof(MAGIC));
+		result.version = VERSION;
+		result.vendorID = props.properties.vendorID;
+		result.deviceID = props.properties.deviceID;
+		result.driverVersion = props.properties.driverVersion;
+		std::memcpy(result.deviceUUID, idProps.deviceUUID, VK_UUID_SIZE);
+		std::memcpy(result.driverUUID, idProps.driverUUID, VK_UUID_SIZE);
+		return result;
+	}
+
+	std::vector<char> PipelineCache::load() const
+	{
+		std::ifstream file(_path, std::ios::binary);
+		if (file.is_open() == false)
+			return {};
+
+		FileHeader expected = header();
+		FileHeader found{};
+		if (!file.read(reinterpret_cast<char*>(&found), sizeof(FileHeader)))
+			return {};
+
+		/* everything but the size has to match */
+		expected.dataSize = found.dataSize;
+		if (std::memcmp(&found, &expected, sizeof(FileHeader)) != 0)
+		{
+			printf("Pipeline cache at [%s] is from another device or driver, starting cold\n", _path.c_str());
+			return {};
+		}
+
+		std::vector<char> data(static_cast<size_t>(found.dataSize));
+		if (!file.read(data.data(), data.size()))
+			return {};
+
+		return data;
+	}
+
+	void PipelineCache::save() const
+	{
+		size_t size = 0;
+		if (vkGetPipelineCacheData(_window->device, _cache, &size, nullptr) != VK_SUCCESS || size == 0)
+			return;
+
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(_window->device, _cache, &size, data.data()) != VK_SUCCESS)
+			return;
+
+		FileHeader fileHeader = header();
+		fileHeader.dataSize = size;
+
+		/* only a cache, a failed write costs the next run a cold start */
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(_path).parent_path(), error);
+
+		std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+		if (file.is_open())
+		{
+			file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(FileHeader));
+			file.write(data.data(), size);
+		}
+
+		if (file.is_open() == false || file.fail())
+			printf("Pipeline cache couldn't be written to [%s]\n", _path.c_str());
+	}
+
+	void PipelineCache::workerLoop()
+	{
+		while (true)
+		{
+			std::packaged_task<void()> job;
+
+			{
+				std::unique_lock<std::mutex> lock(_jobMutex);
+				_wake.wait(lock, [this] { return _quit || _jobs.empty() == false; });
+
+				if (_jobs.empty())
+					return;
+
+				job = std::move(_jobs.front());
+				_jobs.pop_front();
+				_running++;
+			}
+
+			/* any exception is kept in the job's future */
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(_jobMutex);
+				_running--;
+			}
+			_idle.notify_all();
+		}
+	}
+
+	/* public member functions */
+
+	VkShaderModule PipelineCache::Module(const char* path)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_moduleMutex);
+			if (auto found = _modules.find(path); found != _modules.end())
+				return *found->second;
+		}
+
+		/* loaded outside the lock so different files load side by side, a module loaded twice at once keeps the first */
+		lut::ShaderModule module = lut::load_shader_module(*_window, path);
+
+		std::lock_guard<std::mutex> lock(_moduleMutex);
+		auto inserted = _modules.try_emplace(path, std::move(module));
+		return *inserted.first->second;
+	}
+
+	std::future<void> PipelineCache::Submit(std::function<void()> job)
+	{
+		std::packaged_task<void()> task(std::move(job));
+		std::future<void> result = task.get_future();
+
+		/* without workers the job runs here and now */
+		if (_workers.empty())
+		{
+			task();
+			return result;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_jobMutex);
+			_jobs.push_back(std::move(task));
+		}
+		_wake.notify_one();
+
+		return result;
+	}
+
+	void PipelineCache::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(_jobMutex);
+		_idle.wait(lock, [this] { return _jobs.empty() && _running == 0; });
+	}
+
+	/* getters */
+
+	VkPipelineCache PipelineCache::Handle() const
+	{
+		return _cache;
+	}
+
+	size_t PipelineCache::LoadedSize() const
+	{
+		return _loadedSize;
+	}
+
+	uint32_t PipelineCache::ModuleCount()
+	{
+		std::lock_guard<std::mutex> lock(_moduleMutex);
+		return static_cast<uint32_t>(_modules.size());
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/* c */
+#include <cstdint>
+
+/* c++ */
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* labutils */
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vulkan_window.hpp"
+
+/* volk */
+#include <volk/volk.h>
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* everything pipeline creation shares: a VkPipelineCache that's written to disk on exit and read back on the next run,
+		while the device and driver are the same ones, each SPIR-V module loaded once however many pipelines use it,
+		and a few worker threads the pipelines are compiled on while the main thread gets on with loading the scene */
+	class PipelineCache
+	{
+		public:
+			/* constructors, etc. */
+
+			PipelineCache(const lut::VulkanWindow* window, const std::string& path, uint32_t thread_count = 0);
+			~PipelineCache();
+
+			PipelineCache(const PipelineCache&) = delete;
+			PipelineCache& operator=(const PipelineCache&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr char MAGIC[8] = { 'P', 'I', 'P', 'E', 'C', 'A', 'C', 'H' };
+			static constexpr uint32_t VERSION = 1;
+
+			/* the driver checks its own header too, this one keeps another device's or driver's data from ever reaching it */
+			struct FileHeader
+			{
+				char magic[8]{};
+				uint32_t version = 0;
+				uint32_t vendorID = 0;
+				uint32_t deviceID = 0;
+				uint32_t driverVersion = 0;
+				uint8_t deviceUUID[VK_UUID_SIZE]{};
+				uint8_t driverUUID[VK_UUID_SIZE]{};
+				uint64_t dataSize = 0;
+			};
+
+			const lut::VulkanWindow* _window = nullptr;
+			std::string _path{};
+			VkPipelineCache _cache = VK_NULL_HANDLE;
+			size_t _loadedSize = 0;
+
+			std::mutex _moduleMutex{};
+			std::unordered_map<std::string, lut::ShaderModule> _modules{};
+
+			std::vector<std::thread> _workers{};
+			std::mutex _jobMutex{};
+			std::condition_variable _wake{};
+			std::condition_variable _idle{};
+			std::deque<std::packaged_task<void()>> _jobs{};
+			uint32_t _running = 0;
+			bool _quit = false;
+
+			/* private member functions */
+
+			FileHeader header() const;
+			std::vector<char> load() const;
+			void save() const;
+			void workerLoop();
+
+		public:
+			/* public member functions */
+
+			/* the module for a .spv, loaded the first time it's asked for, safe from any thread */
+			VkShaderModule Module(const char* path);
+
+			/* runs job on a worker thread, the future rethrows anything it threw */
+			std::future<void> Submit(std::function<void()> job);
+			void WaitIdle();
+
+			/* getters */
+
+			VkPipelineCache Handle() const;
+			size_t LoadedSize() const; /* bytes of cache data read at start up, 0 on a cold start */
+			uint32_t ModuleCount();
+	};
+}
@@ -1,5 +1,12 @@
 #pragma once
 
+/* c */
+#include <cstdint>
+
+/* c++ */
+#include <compare>
+#include <vector>
+
 #include "SharedFeatures.hpp"
 
 namespace Renderer
@@ -36,7 +43,38 @@ namespace Renderer
 		CSSM_COLORED_STOCHASTIC_SHADOW_MAP_2,
 		CSSM_DEFAULT,
 		DPTS_GEOMETRY,
-		DPTS_SHADOWMAP
+		DPTS_SHADOWMAP,
+		VSM_ANALYSIS,
+		VSM_DEFAULT,
+		VSM_TS_GEOMETRY,
+		VSM_CSSM_DEFAULT,
+		CMSM_MOMENT_SHADOW_MAP,
+		CMSM_DEFAULT,
+		CSSM_MSAA_SHADOW_MAP,
+		CSSM_MSAA_DEFAULT,
+		FOM_SHADOW_MAP,
+		FOM_DEFAULT,
+		LOCAL_SHADOW_MAP,
+		LOCAL_TS_SHADOW_MAP,
+		LOCAL_LIGHTING,
+		SHADOW_MASK_DEPTH,
+		SHADOW_MASK_DEFAULT,
+		DEFERRED_GBUFFER,
+		DEFERRED_LIGHTING,
+		BAKED_DEFAULT,
+		TS_OPAQUE_DEPTH,
+		CMSM_BLUR_HORIZONTAL, /* compute */
+		CMSM_BLUR_VERTICAL, /* compute */
+		SHADOW_PYRAMID_BASE, /* compute */
+		SHADOW_PYRAMID_BASE_COLOUR, /* compute */
+		SHADOW_PYRAMID_DOWNSAMPLE, /* compute */
+		SHADOW_MASK_SSM, /* compute */
+		SHADOW_MASK_CSSM, /* compute */
+		SHADOW_MASK_TS, /* compute */
+		SHADOW_MASK_TEMPORAL, /* compute */
+		SHADOW_MASK_GUIDE, /* compute */
+		SHADOW_MASK_DENOISE_HORIZONTAL, /* compute */
+		SHADOW_MASK_DENOISE_VERTICAL /* compute */
 	};
 
 	enum class DepthWrite
@@ -50,7 +88,8 @@ namespace Renderer
 		LEQUAL = 0,
 		GEQUAL,
 		LESS,
-		GREATER
+		GREATER,
+		ALWAYS
 	};
 
 	enum class ColorWrite
@@ -62,7 +101,19 @@ namespace Renderer
 	enum class BlendMode
 	{
 		ADD_SRC_ONEMINUSSRC = 0,
-		MIN_ONE_ONE
+		MIN_ONE_ONE,
+		ADD_SRC_ONE /* additive lighting passes, weighted by the surface's alpha */
+	};
+
+	/* the shadow lookups' filter, specialisation constants 0 to 2 of their fragment shaders so each setting is its own
+		fully unrolled variant. anything left unset keeps the shader's value, a pcfRadius of 0 follows samplingInfo.y */
+	struct ShadowFilter
+	{
+		uint32_t pcfRadius = 0;
+		float depthBias = -1.0f; /* negative: unset */
+		float normalBias = -1.0f; /* negative: unset */
+
+		auto operator<=>(const ShadowFilter&) const = default;
 	};
 
 	struct PipelineFeatures
@@ -77,6 +128,7 @@ namespace Renderer
 		ColorWrite colorWrite{};
 		BlendMode blendMode{};
 		std::vector<uint32_t> sideBuffers{};
+		ShadowFilter shadowFilter{};
 	};
 
 	/* Default Settings */
@@ -91,6 +143,7 @@ namespace Renderer
 		DepthOp::LEQUAL,
 		ColorWrite::ENABLED,
 		BlendMode::ADD_SRC_ONEMINUSSRC,
+		{},
 		{}
 	};
 }
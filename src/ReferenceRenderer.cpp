@@ -0,0 +1,593 @@
+#include "ReferenceRenderer.hpp"
+
+/* c */
+#include <cmath>
+
+/* c++ */
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <utility>
+
+/* renderer */
+#include "ViewerCamera.hpp" // <- class ViewerCamera
+
+/* labutils */
+#include "../labutils/error.hpp"
+
+/* stb */
+#include <stb_image_write.h>
+
+/* simd */
+#include <immintrin.h>
+
+namespace Renderer
+{
+	/* as Environment::BeginRenderPass() clears the frame */
+	static const glm::vec3 BackgroundColour = glm::vec3(1.0f);
+
+	/* how far a ray starts past the surface it leaves, relative to the distance travelled */
+	static inline float RayEpsilon(float t)
+	{
+		return 1e-4f * std::max(1.0f, t);
+	}
+
+	/* the textures are sampled as the GPU does with an sRGB format */
+	static float SRGBToLinear(unsigned char value)
+	{
+		static const std::array<float, 256> table = [] {
+			std::array<float, 256> values{};
+			for (size_t i = 0; i < values.size(); i++)
+			{
+				float c = static_cast<float>(i) / 255.0f;
+				values[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return values;
+		}();
+
+		return table[value];
+	}
+
+	static unsigned char LinearToSRGB(float value)
+	{
+		float c = std::clamp(value, 0.0f, 1.0f);
+		c = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return static_cast<unsigned char>(c * 255.0f + 0.5f);
+	}
+
+	/* constructors, etc. */
+
+	ReferenceRenderer::ReferenceRenderer(const Model* model, uint32_t thread_count)
+	{
+		model->CpuGeometry(&_scene);
+
+		uint32_t triangleCount = static_cast<uint32_t>(_scene.indices.size() / 3);
+
+		std::vector<glm::vec3> centroids(triangleCount);
+		for (uint32_t i = 0; i < triangleCount; i++)
+		{
+			centroids[i] = (_scene.positions[_scene.indices[i * 3]] +
+				_scene.positions[_scene.indices[i * 3 + 1]] +
+				_scene.positions[_scene.indices[i * 3 + 2]]) / 3.0f;
+		}
+
+		std::vector<uint32_t> order(triangleCount);
+		std::iota(order.begin(), order.end(), 0u);
+
+		if (triangleCount > 0)
+			build(&order, centroids, 0, triangleCount);
+
+		/* the leaves index ranges of the final order */
+		_triangles.resize(triangleCount);
+		for (uint32_t i = 0; i < triangleCount; i++)
+		{
+			const glm::vec3& v0 = _scene.positions[_scene.indices[order[i] * 3]];
+			const glm::vec3& v1 = _scene.positions[_scene.indices[order[i] * 3 + 1]];
+			const glm::vec3& v2 = _scene.positions[_scene.indices[order[i] * 3 + 2]];
+
+			_triangles[i].v0 = v0;
+			_triangles[i].edge1 = v1 - v0;
+			_triangles[i].edge2 = v2 - v0;
+			_triangles[i].index = order[i];
+		}
+
+		_threadCount = (thread_count > 0) ? thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	/* private member functions */
+
+	int32_t ReferenceRenderer::build(std::vector<uint32_t>* order, const std::vector<glm::vec3>& centroids, uint32_t begin, uint32_t end)
+	{
+		int32_t nodeIndex = static_cast<int32_t>(_nodes.size());
+		_nodes.emplace_back();
+
+		/* halve the largest part at the median of its centroids' longest axis until there are four */
+		std::vector<std::pair<uint32_t, uint32_t>> parts = { { begin, end } };
+		while (parts.size() < 4)
+		{
+			auto largest = std::max_element(parts.begin(), parts.end(), [](const auto& left, const auto& right) {
+				return (left.second - left.first) < (right.second - right.first);
+			});
+
+			if (largest->second - largest->first <= LEAF_SIZE)
+				break;
+
+			glm::vec3 centroidMin = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 centroidMax = glm::vec3(std::numeric_limits<float>::lowest());
+			for (uint32_t i = largest->first; i < largest->second; i++)
+			{
+				centroidMin = glm::min(centroidMin, centroids[(*order)[i]]);
+				centroidMax = glm::max(centroidMax, centroids[(*order)[i]]);
+			}
+
+			glm::vec3 extent = centroidMax - centroidMin;
+			int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : ((extent.y > extent.z) ? 1 : 2);
+
+			uint32_t first = largest->first;
+			uint32_t last = largest->second;
+			uint32_t middle = (first + last) / 2;
+			std::nth_element(order->begin() + first, order->begin() + middle, order->begin() + last, [&](uint32_t left, uint32_t right) {
+				return centroids[left][axis] < centroids[right][axis];
+			});
+
+			*largest = { first, middle };
+			parts.push_back({ middle, last });
+		}
+
+		/* children are built before the node is written, _nodes may move while they are */
+		BvhNode node;
+		for (size_t c = 0; c < parts.size(); c++)
+		{
+			glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+			for (uint32_t i = parts[c].first; i < parts[c].second; i++)
+			{
+				for (uint32_t v = 0; v < 3; v++)
+				{
+					boundsMin = glm::min(boundsMin, _scene.positions[_scene.indices[(*order)[i] * 3 + v]]);
+					boundsMax = glm::max(boundsMax, _scene.positions[_scene.indices[(*order)[i] * 3 + v]]);
+				}
+			}
+
+			node.minX[c] = boundsMin.x;
+			node.minY[c] = boundsMin.y;
+			node.minZ[c] = boundsMin.z;
+			node.maxX[c] = boundsMax.x;
+			node.maxY[c] = boundsMax.y;
+			node.maxZ[c] = boundsMax.z;
+
+			uint32_t count = parts[c].second - parts[c].first;
+			if (count <= LEAF_SIZE)
+			{
+				node.child[c] = static_cast<int32_t>(parts[c].first);
+				node.count[c] = count;
+			}
+			else
+				node.child[c] = build(order, centroids, parts[c].first, parts[c].second);
+		}
+
+		_nodes[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	bool ReferenceRenderer::closestHit(const glm::vec3& origin, const glm::vec3& direction, float t_min, float t_max, Hit* hit) const
+	{
+		if (_nodes.empty())
+			return false;
+
+		/* no zero components, so the slabs never multiply zero by infinity */
+		glm::vec3 inverse;
+		for (int i = 0; i < 3; i++)
+			inverse[i] = 1.0f / ((std::abs(direction[i]) > 1e-20f) ? direction[i] : std::copysign(1e-20f, direction[i]));
+
+		const __m128 originX = _mm_set1_ps(origin.x);
+		const __m128 originY = _mm_set1_ps(origin.y);
+		const __m128 originZ = _mm_set1_ps(origin.z);
+		const __m128 inverseX = _mm_set1_ps(inverse.x);
+		const __m128 inverseY = _mm_set1_ps(inverse.y);
+		const __m128 inverseZ = _mm_set1_ps(inverse.z);
+		const __m128 nearest = _mm_set1_ps(t_min);
+
+		struct Entry
+		{
+			int32_t node;
+			float t;
+		};
+
+		Entry stack[128];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, t_min };
+
+		float closest = t_max;
+		bool found = false;
+
+		while (stackSize > 0)
+		{
+			Entry entry = stack[--stackSize];
+			if (entry.t > closest)
+				continue;
+
+			const BvhNode& node = _nodes[entry.node];
+
+			/* the ray against all four children's slabs */
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), originX), inverseX);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), originX), inverseX);
+			__m128 tNear = _mm_min_ps(t0, t1);
+			__m128 tFar = _mm_max_ps(t0, t1);
+
+			t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), originY), inverseY);
+			t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), originY), inverseY);
+			tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+			tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+
+			t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), originZ), inverseZ);
+			t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), originZ), inverseZ);
+			tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+			tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+
+			tNear = _mm_max_ps(tNear, nearest);
+			tFar = _mm_min_ps(tFar, _mm_set1_ps(closest));
+
+			int mask = _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+			if (mask == 0)
+				continue;
+
+			alignas(16) float entryT[4];
+			_mm_store_ps(entryT, tNear);
+
+			/* leaves are intersected straight away, inner children are pushed farthest first so the nearest is popped next */
+			Entry children[4];
+			uint32_t childCount = 0;
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				if ((mask & (1 << c)) == 0 || node.child[c] < 0)
+					continue;
+
+				if (node.count[c] == 0)
+				{
+					children[childCount++] = { node.child[c], entryT[c] };
+					continue;
+				}
+
+				for (uint32_t i = static_cast<uint32_t>(node.child[c]); i < node.child[c] + node.count[c]; i++)
+				{
+					/* Moller-Trumbore, both faces as nothing is culled */
+					const Triangle& triangle = _triangles[i];
+
+					glm::vec3 p = glm::cross(direction, triangle.edge2);
+					float determinant = glm::dot(triangle.edge1, p);
+					if (std::abs(determinant) < 1e-12f)
+						continue;
+
+					float inverseDeterminant = 1.0f / determinant;
+					glm::vec3 s = origin - triangle.v0;
+					float u = glm::dot(s, p) * inverseDeterminant;
+					if (u < 0.0f || u > 1.0f)
+						continue;
+
+					glm::vec3 q = glm::cross(s, triangle.edge1);
+					float v = glm::dot(direction, q) * inverseDeterminant;
+					if (v < 0.0f || u + v > 1.0f)
+						continue;
+
+					float t = glm::dot(triangle.edge2, q) * inverseDeterminant;
+					if (t <= t_min || t >= closest)
+						continue;
+
+					closest = t;
+					*hit = Hit{ t, u, v, i };
+					found = true;
+				}
+			}
+
+			std::sort(children, children + childCount, [](const Entry& left, const Entry& right) {
+				return left.t > right.t;
+			});
+
+			for (uint32_t c = 0; c < childCount && stackSize < std::size(stack); c++)
+				stack[stackSize++] = children[c];
+		}
+
+		return found;
+	}
+
+	ReferenceRenderer::SurfacePoint ReferenceRenderer::surface(const glm::vec3& origin, const glm::vec3& direction, const Hit& hit) const
+	{
+		const Triangle& triangle = _triangles[hit.triangle];
+		const uint32_t* indices = &_scene.indices[triangle.index * 3];
+		float w = 1.0f - hit.u - hit.v;
+
+		SurfacePoint point;
+		point.position = origin + direction * hit.t;
+		point.normal = glm::normalize(_scene.normals[indices[0]] * w + _scene.normals[indices[1]] * hit.u + _scene.normals[indices[2]] * hit.v);
+		point.faceNormal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+		point.material = &_scene.materials[_scene.triangleMaterials[triangle.index]];
+
+		glm::vec2 uv = _scene.uvs[indices[0]] * w + _scene.uvs[indices[1]] * hit.u + _scene.uvs[indices[2]] * hit.v;
+		point.colour = sampleColour(point.material->colourTexture, uv);
+
+		return point;
+	}
+
+	glm::vec4 ReferenceRenderer::sampleColour(int texture, glm::vec2 uv) const
+	{
+		/* the default sampler: nearest, repeating. always the top mip, the GPU picks a smaller one in the distance */
+		if (texture < 0)
+			return glm::vec4(1.0f);
+
+		const SceneTexture& image = _scene.textures[texture];
+		uint32_t x = std::min(static_cast<uint32_t>((uv.x - std::floor(uv.x)) * image.width), image.width - 1);
+		uint32_t y = std::min(static_cast<uint32_t>((uv.y - std::floor(uv.y)) * image.height), image.height - 1);
+		const unsigned char* texel = image.texels + (static_cast<size_t>(y) * image.width + x) * image.components;
+
+		/* the missing channels read as an R, RG or RGB format's would */
+		glm::vec4 colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		for (uint32_t c = 0; c < std::min(image.components, 3u); c++)
+			colour[c] = SRGBToLinear(texel[c]);
+		if (image.components == 4)
+			colour.a = static_cast<float>(texel[3]) / 255.0f;
+
+		return colour;
+	}
+
+	glm::vec3 ReferenceRenderer::shadowTransmittance(const glm::vec3& origin, const glm::vec3& to_light) const
+	{
+		/* every surface between here and the sun, nearest first: an opaque one blocks the light,
+			a translucent one passes what its light blocking probability leaves, as the shadow passes work it out */
+		glm::vec3 transmittance = glm::vec3(1.0f);
+		float tMin = 0.0f;
+
+		for (uint32_t layer = 0; layer < MAX_LAYERS; layer++)
+		{
+			Hit hit;
+			if (closestHit(origin, to_light, tMin, std::numeric_limits<float>::max(), &hit) == false)
+				break;
+
+			SurfacePoint point = surface(origin, to_light, hit);
+			if (point.material->alphaBlend == false)
+				return glm::vec3(0.0f);
+
+			glm::vec3 transmission = glm::vec3(point.colour) * 0.5f;
+			transmittance *= glm::vec3(1.0f) - point.colour.a * (glm::vec3(1.0f) - transmission);
+
+			if (std::max({ transmittance.r, transmittance.g, transmittance.b }) < 1.0f / 1024.0f)
+				return glm::vec3(0.0f);
+
+			tMin = hit.t + RayEpsilon(hit.t);
+		}
+
+		return transmittance;
+	}
+
+	glm::vec3 ReferenceRenderer::shade(const SurfacePoint& point, const Uniforms::LightData* lights) const
+	{
+		/* default.frag's lighting, with the shadow traced rather than looked up */
+		glm::vec3 diffuse = glm::vec3(point.colour);
+		glm::vec3 toLight = glm::normalize(-glm::vec3(lights->sunLight.direction));
+
+		glm::vec3 lit = point.material->emissive + glm::vec3(lights->ambientLight.colour) * diffuse;
+
+		float NdotL = glm::dot(point.normal, toLight);
+		if (NdotL > 0.0f)
+		{
+			/* off the face on the light's side, so the ray doesn't start inside it */
+			glm::vec3 offset = (glm::dot(point.faceNormal, toLight) < 0.0f) ? -point.faceNormal : point.faceNormal;
+			glm::vec3 origin = point.position + offset * RayEpsilon(glm::length(point.position));
+
+			lit += NdotL * glm::vec3(lights->sunLight.colour) * diffuse * shadowTransmittance(origin, toLight);
+		}
+
+		return lit;
+	}
+
+	glm::vec3 ReferenceRenderer::tracePixel(const glm::vec3& near_point, const glm::vec3& far_point, const Uniforms::LightData* lights) const
+	{
+		/* between the clip planes. the translucent surfaces are blended over what's behind them in order,
+			as the forward pass does with its back to front draws */
+		glm::vec3 direction = far_point - near_point;
+		float length = glm::length(direction);
+		direction /= length;
+
+		glm::vec3 colour = glm::vec3(0.0f);
+		float coverage = 1.0f; /* what the surfaces in front still let through */
+		float tMin = 0.0f;
+
+		for (uint32_t layer = 0; layer < MAX_LAYERS; layer++)
+		{
+			Hit hit;
+			if (closestHit(near_point, direction, tMin, length, &hit) == false)
+				return colour + coverage * BackgroundColour;
+
+			SurfacePoint point = surface(near_point, direction, hit);
+			glm::vec3 lit = shade(point, lights);
+
+			if (point.material->alphaBlend == false)
+				return colour + coverage * lit;
+
+			colour += coverage * point.colour.a * lit;
+			coverage *= 1.0f - point.colour.a;
+
+			tMin = hit.t + RayEpsilon(hit.t);
+		}
+
+		return colour;
+	}
+
+	/* public member functions */
+
+	uint32_t ReferenceRenderer::TransmittanceLayers(const glm::vec3& origin, const glm::vec3& direction, float t_max,
+		TransmittanceLayer* layers, uint32_t max_layers) const
+	{
+		/* as shadowTransmittance(), keeping every step, until the first opaque surface */
+		glm::vec3 transmittance = glm::vec3(1.0f);
+		uint32_t count = 0;
+		float tMin = 0.0f;
+
+		for (uint32_t layer = 0; layer < MAX_LAYERS; layer++)
+		{
+			Hit hit;
+			if (closestHit(origin, direction, tMin, t_max, &hit) == false)
+				break;
+
+			SurfacePoint point = surface(origin, direction, hit);
+			if (point.material->alphaBlend == false)
+				break;
+
+			glm::vec3 transmission = glm::vec3(point.colour) * 0.5f;
+			transmittance *= glm::vec3(1.0f) - point.colour.a * (glm::vec3(1.0f) - transmission);
+
+			/* past the last layer, the rest darken it from where it is */
+			if (count < max_layers)
+				layers[count++] = TransmittanceLayer{ hit.t, transmittance };
+			else
+				layers[count - 1].transmittance = transmittance;
+
+			tMin = hit.t + RayEpsilon(hit.t);
+		}
+
+		return count;
+	}
+
+	void ReferenceRenderer::ForEachPixel(uint32_t width, uint32_t height, const std::function<void(uint32_t, uint32_t)>& pixel) const
+	{
+		uint32_t tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+		uint32_t tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+		uint32_t tileCount = tilesX * tilesY;
+
+		/* each thread starts with a contiguous run of tiles, taken from the front,
+			and once it's out steals from the back of the others' */
+		struct TileQueue
+		{
+			std::mutex mutex;
+			std::deque<uint32_t> tiles;
+		};
+
+		uint32_t threadCount = std::max(std::min(_threadCount, tileCount), 1u);
+		std::vector<TileQueue> queues(threadCount);
+		for (uint32_t t = 0; t < threadCount; t++)
+		{
+			for (uint32_t tile = tileCount * t / threadCount; tile < tileCount * (t + 1) / threadCount; tile++)
+				queues[t].tiles.push_back(tile);
+		}
+
+		auto worker = [&](uint32_t self) {
+			while (true)
+			{
+				uint32_t tile = 0;
+				bool found = false;
+
+				for (uint32_t i = 0; i < threadCount && found == false; i++)
+				{
+					TileQueue& queue = queues[(self + i) % threadCount];
+					std::lock_guard<std::mutex> lock(queue.mutex);
+
+					if (queue.tiles.empty())
+						continue;
+
+					if (i == 0)
+					{
+						tile = queue.tiles.front();
+						queue.tiles.pop_front();
+					}
+					else
+					{
+						tile = queue.tiles.back();
+						queue.tiles.pop_back();
+					}
+					found = true;
+				}
+
+				/* nothing is queued once the work starts, so empty queues everywhere means done */
+				if (found == false)
+					return;
+
+				uint32_t x0 = (tile % tilesX) * TILE_SIZE;
+				uint32_t y0 = (tile / tilesX) * TILE_SIZE;
+				for (uint32_t y = y0; y < std::min(y0 + TILE_SIZE, height); y++)
+				{
+					for (uint32_t x = x0; x < std::min(x0 + TILE_SIZE, width); x++)
+						pixel(x, y);
+				}
+			}
+		};
+
+		/* the calling thread works too */
+		std::vector<std::thread> threads;
+		for (uint32_t t = 1; t < threadCount; t++)
+			threads.emplace_back(worker, t);
+
+		worker(0);
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	void ReferenceRenderer::Render(const ViewerCamera* camera, const Uniforms::LightData* lights, uint32_t width, uint32_t height)
+	{
+		_width = width;
+		_height = height;
+		_image.assign(static_cast<size_t>(width) * height, glm::vec3(0.0f));
+
+		const glm::mat4& invProjView = camera->InvProjView();
+		float nearDepth = (camera->ReversedDepth()) ? 1.0f : 0.0f;
+		float farDepth = 1.0f - nearDepth;
+
+		ForEachPixel(width, height, [&](uint32_t x, uint32_t y) {
+			/* the pixel centre, top row first as the viewport maps it */
+			glm::vec2 ndc = glm::vec2(
+				(static_cast<float>(x) + 0.5f) / static_cast<float>(width) * 2.0f - 1.0f,
+				(static_cast<float>(y) + 0.5f) / static_cast<float>(height) * 2.0f - 1.0f);
+
+			glm::vec4 nearPoint = invProjView * glm::vec4(ndc, nearDepth, 1.0f);
+			glm::vec4 farPoint = invProjView * glm::vec4(ndc, farDepth, 1.0f);
+
+			_image[static_cast<size_t>(y) * width + x] = tracePixel(
+				glm::vec3(nearPoint) / nearPoint.w, glm::vec3(farPoint) / farPoint.w, lights);
+		});
+	}
+
+	void ReferenceRenderer::WritePNG(const char* path) const
+	{
+		/* encoded as the sRGB swapchain would */
+		std::vector<unsigned char> rgb(_image.size() * 3);
+		for (size_t i = 0; i < _image.size(); i++)
+		{
+			rgb[i * 3] = LinearToSRGB(_image[i].r);
+			rgb[i * 3 + 1] = LinearToSRGB(_image[i].g);
+			rgb[i * 3 + 2] = LinearToSRGB(_image[i].b);
+		}
+
+		std::error_code error;
+		std::filesystem::path directory = std::filesystem::path(path).parent_path();
+		if (directory.empty() == false)
+			std::filesystem::create_directories(directory, error);
+
+		if (stbi_write_png(path, static_cast<int>(_width), static_cast<int>(_height), 3, rgb.data(), static_cast<int>(_width) * 3) == 0)
+			throw lut::Error("STBI: stbi_write_png() failed to write the reference image at [%s]", path);
+	}
+
+	/* getters */
+
+	const std::vector<glm::vec3>& ReferenceRenderer::Image() const
+	{
+		return _image;
+	}
+	uint32_t ReferenceRenderer::NodeCount() const
+	{
+		return static_cast<uint32_t>(_nodes.size());
+	}
+	uint32_t ReferenceRenderer::TriangleCount() const
+	{
+		return static_cast<uint32_t>(_triangles.size());
+	}
+	uint32_t ReferenceRenderer::ThreadCount() const
+	{
+		return _threadCount;
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+/* c++ */
+#include <functional>
+#include <vector>
+
+/* renderer */
+#include "Model.hpp"
+#include "Uniforms.hpp"
+
+/* glm */
+#include <glm/glm.hpp>
+
+namespace Renderer
+{
+	class ViewerCamera;
+}
+
+namespace Renderer
+{
+	/* ground truth for the shadow techniques: the same scene, traced on the CPU through a 4 wide BVH whose children
+		are tested against a ray with one SSE slab test. every camera ray composites the translucent surfaces it passes
+		in front to back order, and every shadow ray multiplies the RGB transmittance of each translucent surface it meets,
+		nearest to farthest, until it leaves the scene or reaches an opaque one. the image tiles are shared out between
+		threads that steal from each other once their own run out.
+		it shades as default.frag does, so its image lines up pixel for pixel with the frame drawn from the same camera */
+	class ReferenceRenderer
+	{
+		public:
+			/* constructors, etc. */
+
+			ReferenceRenderer(const Model* model, uint32_t thread_count = 0);
+			~ReferenceRenderer() = default;
+
+			ReferenceRenderer(const ReferenceRenderer&) = delete;
+			ReferenceRenderer& operator=(const ReferenceRenderer&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr uint32_t LEAF_SIZE = 4; /* most triangles in a leaf */
+			static constexpr uint32_t TILE_SIZE = 16; /* pixels per tile side, the unit of work that's stolen */
+			static constexpr uint32_t MAX_LAYERS = 64; /* translucent surfaces a ray passes through before it gives up */
+
+			/* four children's bounds side by side, so they load straight into SSE registers */
+			struct alignas(16) BvhNode
+			{
+				float minX[4]{};
+				float minY[4]{};
+				float minZ[4]{};
+				float maxX[4]{};
+				float maxY[4]{};
+				float maxZ[4]{};
+				int32_t child[4]{ -1, -1, -1, -1 }; /* inner node, or the leaf's first triangle, -1: empty */
+				uint32_t count[4]{}; /* the leaf's triangle count, 0: inner node */
+			};
+
+			/* in leaf order, set up for Moller-Trumbore */
+			struct Triangle
+			{
+				glm::vec3 v0 = glm::vec3(0.0f);
+				glm::vec3 edge1 = glm::vec3(0.0f);
+				glm::vec3 edge2 = glm::vec3(0.0f);
+				uint32_t index = 0; /* into the scene's triangles */
+			};
+
+			struct Hit
+			{
+				float t = 0.0f;
+				float u = 0.0f;
+				float v = 0.0f;
+				uint32_t triangle = 0; /* into _triangles */
+			};
+
+			struct SurfacePoint
+			{
+				glm::vec3 position = glm::vec3(0.0f);
+				glm::vec3 normal = glm::vec3(0.0f); /* interpolated */
+				glm::vec3 faceNormal = glm::vec3(0.0f);
+				glm::vec4 colour = glm::vec4(1.0f); /* linear */
+				const SceneMaterial* material = nullptr;
+			};
+
+			SceneGeometry _scene{};
+			std::vector<BvhNode> _nodes{};
+			std::vector<Triangle> _triangles{};
+			uint32_t _threadCount = 1;
+
+			std::vector<glm::vec3> _image{}; /* linear, top row first */
+			uint32_t _width = 0;
+			uint32_t _height = 0;
+
+			/* private member functions */
+
+			int32_t build(std::vector<uint32_t>* order, const std::vector<glm::vec3>& centroids, uint32_t begin, uint32_t end);
+
+			bool closestHit(const glm::vec3& origin, const glm::vec3& direction, float t_min, float t_max, Hit* hit) const;
+			SurfacePoint surface(const glm::vec3& origin, const glm::vec3& direction, const Hit& hit) const;
+			glm::vec4 sampleColour(int texture, glm::vec2 uv) const;
+
+			glm::vec3 shadowTransmittance(const glm::vec3& origin, const glm::vec3& to_light) const;
+			glm::vec3 shade(const SurfacePoint& point, const Uniforms::LightData* lights) const;
+			glm::vec3 tracePixel(const glm::vec3& near_point, const glm::vec3& far_point, const Uniforms::LightData* lights) const;
+
+		public:
+			/* a translucent surface along a ray, and the transmittance past it */
+			struct TransmittanceLayer
+			{
+				float t = 0.0f;
+				glm::vec3 transmittance = glm::vec3(1.0f);
+			};
+
+			/* public member functions */
+
+			/* the translucent surfaces nearest first, up to the first opaque one, those past max_layers darken the last */
+			uint32_t TransmittanceLayers(const glm::vec3& origin, const glm::vec3& direction, float t_max,
+				TransmittanceLayer* layers, uint32_t max_layers) const;
+
+			/* pixel is called from several threads at once, each pixel exactly once */
+			void ForEachPixel(uint32_t width, uint32_t height, const std::function<void(uint32_t, uint32_t)>& pixel) const;
+
+			void Render(const ViewerCamera* camera, const Uniforms::LightData* lights, uint32_t width, uint32_t height);
+			void WritePNG(const char* path) const;
+
+			/* getters */
+
+			const std::vector<glm::vec3>& Image() const;
+			uint32_t NodeCount() const;
+			uint32_t TriangleCount() const;
+			uint32_t ThreadCount() const;
+	};
+}
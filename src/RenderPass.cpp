@@ -1,5 +1,8 @@
 #include "RenderPass.hpp"
 
+/* renderer */
+#include "Constants.hpp"
+
 /* labutils */
 #include "../labutils/error.hpp"
 #include "../labutils/to_string.hpp"
@@ -34,9 +37,9 @@ namespace Renderer
 		/* I know this function could be a lot more efficient, but time constraints are... constraining. */
 
 		int32_t attachmentCount = 0;
+		int32_t colourCount = static_cast<int32_t>(ColourAttachmentCount());
 
-		if (_initData.colourPass == ColourPass::ENABLED)
-			attachmentCount++;
+		attachmentCount += colourCount;
 
 		if (_initData.depthTest == DepthTest::ENABLED)
 			attachmentCount++;
@@ -46,30 +49,128 @@ namespace Renderer
 		int32_t colourInd = -1;
 		int32_t depthInd = -1;
 
-		if (_initData.colourPass == ColourPass::ENABLED)
+		VkSampleCountFlagBits samples = SampleCountVkFlag(_initData.sampleCount);
+		if (samples != VK_SAMPLE_COUNT_1_BIT)
 		{
-			/* Colour Buffer */
-			attachments[curAttachInd].format = (_initData.specialColour == SpecialColour::NONE) ? window->swapchainFormat : VK_FORMAT_R32G32B32A32_SFLOAT;
-			attachments[curAttachInd].samples = VK_SAMPLE_COUNT_1_BIT;
-			attachments[curAttachInd].loadOp = (_initData.clearColour == ClearColour::ENABLED) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-			attachments[curAttachInd].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			attachments[curAttachInd].initialLayout = (_initData.clearColour == ClearColour::ENABLED) ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-			if (_initData.renderTarget == RenderTarget::PRESENT)
-				attachments[curAttachInd].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-			else if (_initData.renderTarget == RenderTarget::TEXTURE_GEOMETRY ||
-				_initData.renderTarget == RenderTarget::TEXTURE_POST_PROC ||
-				_initData.renderTarget == RenderTarget::TEXTURE_COLORDEPTH)
-				attachments[curAttachInd].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			/* the attachments are rendered to and then read per sample, so both limits apply */
+			VkPhysicalDeviceProperties props{};
+			vkGetPhysicalDeviceProperties(window->physicalDevice, &props);
+
+			VkSampleCountFlags supported = VK_SAMPLE_COUNT_FLAG_BITS_MAX_ENUM;
+			if (_initData.colourPass == ColourPass::ENABLED)
+				supported &= props.limits.framebufferColorSampleCounts & props.limits.sampledImageColorSampleCounts;
+			if (_initData.depthTest == DepthTest::ENABLED)
+				supported &= props.limits.framebufferDepthSampleCounts & props.limits.sampledImageDepthSampleCounts;
+
+			if ((supported & samples) == 0)
+			{
+				throw Error("VK: %d samples per texel can't be rendered to and sampled on this device",
+					static_cast<int>(samples));
+			}
+		}
+
+		if (_initData.colourPass == ColourPass::ENABLED && _initData.specialColour == SpecialColour::CSSM_SHADOWMAP)
+		{
+			/* the stochastic depths are min blended, which the compact formats don't guarantee */
+			VkFormatProperties props{};
+			vkGetPhysicalDeviceFormatProperties(window->physicalDevice, CSSMColourVkFormat(_initData.cssmColourFormat), &props);
+
+			const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+			if ((props.optimalTilingFeatures & required) != required)
+			{
+				throw Error("VK: the CSSM colour format (VkFormat %d) can't be blended or sampled on this device",
+					static_cast<int>(CSSMColourVkFormat(_initData.cssmColourFormat)));
+			}
+		}
+
+		if (_initData.colourPass == ColourPass::ENABLED && _initData.specialColour == SpecialColour::CMSM_MOMENTS)
+		{
+			/* the translucent moments are min blended, and 32 bit float blending is optional */
+			VkFormatProperties props{};
+			vkGetPhysicalDeviceFormatProperties(window->physicalDevice, CMSMAttachmentVkFormat(0), &props);
+
+			const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+			if ((props.optimalTilingFeatures & required) != required)
+			{
+				throw Error("VK: the CMSM moment format (VkFormat %d) can't be blended or sampled on this device",
+					static_cast<int>(CMSMAttachmentVkFormat(0)));
+			}
+		}
+
+		if (_initData.colourPass == ColourPass::ENABLED && _initData.specialColour == SpecialColour::FOM_COEFFICIENTS)
+		{
+			/* the coefficients are summed with an additive blend and read with a linear filter */
+			for (int32_t i = 0; i < colourCount; i++)
+			{
+				VkFormatProperties props{};
+				vkGetPhysicalDeviceFormatProperties(window->physicalDevice, FOMAttachmentVkFormat(static_cast<uint32_t>(i)), &props);
 
+				const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+					VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+				if ((props.optimalTilingFeatures & required) != required)
+				{
+					throw Error("VK: the FOM coefficient format (VkFormat %d) can't be blended or filtered on this device",
+						static_cast<int>(FOMAttachmentVkFormat(static_cast<uint32_t>(i))));
+				}
+			}
+		}
+
+		if (_initData.colourPass == ColourPass::ENABLED && _initData.specialColour == SpecialColour::GBUFFER)
+		{
+			/* the compact normal and emissive formats aren't guaranteed render targets */
+			for (int32_t i = 0; i < colourCount; i++)
+			{
+				VkFormatProperties props{};
+				vkGetPhysicalDeviceFormatProperties(window->physicalDevice, GBufferAttachmentVkFormat(static_cast<uint32_t>(i)), &props);
+
+				const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+				if ((props.optimalTilingFeatures & required) != required)
+				{
+					throw Error("VK: the G-buffer format (VkFormat %d) can't be rendered to or sampled on this device",
+						static_cast<int>(GBufferAttachmentVkFormat(static_cast<uint32_t>(i))));
+				}
+			}
+		}
+
+		if (_initData.colourPass == ColourPass::ENABLED)
+		{
 			colourInd = curAttachInd;
-			curAttachInd++;
+
+			for (int32_t i = 0; i < colourCount; i++)
+			{
+				/* Colour Buffer(s) */
+				if (_initData.specialColour == SpecialColour::NONE)
+					attachments[curAttachInd].format = window->swapchainFormat;
+				else if (_initData.specialColour == SpecialColour::TS_COLOUR_AND_DEPTH)
+					attachments[curAttachInd].format = (i == 0) ? VK_FORMAT_B8G8R8A8_SRGB : VK_FORMAT_R32_SFLOAT;
+				else if (_initData.specialColour == SpecialColour::CMSM_MOMENTS)
+					attachments[curAttachInd].format = CMSMAttachmentVkFormat(static_cast<uint32_t>(i));
+				else if (_initData.specialColour == SpecialColour::GBUFFER)
+					attachments[curAttachInd].format = GBufferAttachmentVkFormat(static_cast<uint32_t>(i));
+				else if (_initData.specialColour == SpecialColour::FOM_COEFFICIENTS)
+					attachments[curAttachInd].format = FOMAttachmentVkFormat(static_cast<uint32_t>(i));
+				else
+					attachments[curAttachInd].format = CSSMColourVkFormat(_initData.cssmColourFormat);
+				attachments[curAttachInd].samples = samples;
+				attachments[curAttachInd].loadOp = (_initData.clearColour == ClearColour::ENABLED) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+				attachments[curAttachInd].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+				attachments[curAttachInd].initialLayout = (_initData.clearColour == ClearColour::ENABLED) ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				if (_initData.renderTarget == RenderTarget::PRESENT)
+					attachments[curAttachInd].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+				else if (_initData.renderTarget == RenderTarget::TEXTURE_GEOMETRY ||
+					_initData.renderTarget == RenderTarget::TEXTURE_POST_PROC ||
+					_initData.renderTarget == RenderTarget::TEXTURE_COLORDEPTH)
+					attachments[curAttachInd].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+				curAttachInd++;
+			}
 		}
 
 		if (_initData.depthTest == DepthTest::ENABLED)
 		{
 			/* Depth Buffer */
-			attachments[curAttachInd].format = VK_FORMAT_D32_SFLOAT;
-			attachments[curAttachInd].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[curAttachInd].format = DepthVkFormat(_initData.depthFormat);
+			attachments[curAttachInd].samples = samples;
 			attachments[curAttachInd].loadOp = (_initData.clearDepth == ClearDepth::ENABLED) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
 			attachments[curAttachInd].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 			attachments[curAttachInd].initialLayout = (_initData.clearDepth == ClearDepth::ENABLED) ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
@@ -79,11 +180,11 @@ namespace Renderer
 			curAttachInd++;
 		}
 
-		VkAttachmentReference subpassAttachment{};
-		if (colourInd >= 0)
+		std::vector<VkAttachmentReference> subpassAttachments(colourCount, VkAttachmentReference{});
+		for (int32_t i = 0; i < colourCount; i++)
 		{
-			subpassAttachment.attachment = colourInd;
-			subpassAttachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			subpassAttachments[i].attachment = colourInd + i;
+			subpassAttachments[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		}
 
 		VkAttachmentReference depthAttachment{};
@@ -95,12 +196,23 @@ namespace Renderer
 
 		VkSubpassDescription subpasses[1]{};
 		subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpasses[0].colorAttachmentCount = (colourInd >= 0) ? 1 : 0;
-		subpasses[0].pColorAttachments = (colourInd >= 0) ? &subpassAttachment : nullptr;
+		subpasses[0].colorAttachmentCount = static_cast<uint32_t>(colourCount);
+		subpasses[0].pColorAttachments = (colourCount > 0) ? subpassAttachments.data() : nullptr;
 		subpasses[0].pDepthStencilAttachment = (depthInd >= 0) ? &depthAttachment : nullptr;
 
+		/* multiview: every draw is broadcast to each cascade layer */
+		uint32_t viewMask = (1u << ViewCount()) - 1u;
+
+		VkRenderPassMultiviewCreateInfo multiviewInfo{};
+		multiviewInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+		multiviewInfo.subpassCount = 1;
+		multiviewInfo.pViewMasks = &viewMask;
+		multiviewInfo.correlationMaskCount = 1;
+		multiviewInfo.pCorrelationMasks = &viewMask;
+
 		VkRenderPassCreateInfo passInfo{};
 		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		passInfo.pNext = (_initData.multiview == Multiview::SHADOW_CASCADES) ? &multiviewInfo : nullptr;
 		passInfo.attachmentCount = attachmentCount;
 		passInfo.pAttachments = attachments.data();
 		passInfo.subpassCount = 1;
@@ -125,6 +237,25 @@ namespace Renderer
 
 	/* getters */
 
+	uint32_t RenderPass::ColourAttachmentCount() const
+	{
+		if (_initData.colourPass == ColourPass::DISABLED)
+			return 0;
+
+		/* the single-pass translucent shadow map also writes the nearest translucent depth,
+			the moment shadow map also writes the translucent transmittance,
+			the G-buffer writes albedo, normal and emissive,
+			and the fourier opacity map writes the absorbance and two sets of coefficients */
+		if (_initData.specialColour == SpecialColour::GBUFFER || _initData.specialColour == SpecialColour::FOM_COEFFICIENTS)
+			return 3;
+
+		return (_initData.specialColour == SpecialColour::TS_COLOUR_AND_DEPTH ||
+			_initData.specialColour == SpecialColour::CMSM_MOMENTS) ? 2 : 1;
+	}
+	uint32_t RenderPass::ViewCount() const
+	{
+		return (_initData.multiview == Multiview::SHADOW_CASCADES) ? SHADOW_CASCADE_COUNT : 1;
+	}
 	const VkRenderPass& RenderPass::operator*() const
 	{
 		return *_renderPass;
@@ -133,4 +264,80 @@ namespace Renderer
 	{
 		return _initData;
 	}
+
+	/* free functions */
+
+	VkFormat CSSMColourVkFormat(CSSMColourFormat format)
+	{
+		switch (format)
+		{
+			case CSSMColourFormat::RGBA16_UNORM:
+				return VK_FORMAT_R16G16B16A16_UNORM;
+
+			case CSSMColourFormat::RGBA16_SFLOAT:
+				return VK_FORMAT_R16G16B16A16_SFLOAT;
+
+			case CSSMColourFormat::RGB10A2_UNORM:
+				return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+
+			case CSSMColourFormat::RGBA32_SFLOAT:
+			default:
+				return VK_FORMAT_R32G32B32A32_SFLOAT;
+		}
+	}
+
+	VkFormat CMSMAttachmentVkFormat(uint32_t attachment)
+	{
+		/* 0: depth moments (opaque z, z^2, translucent z, z^2), 1: translucent transmittance */
+		return (attachment == 0) ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R16G16B16A16_SFLOAT;
+	}
+
+	VkFormat GBufferAttachmentVkFormat(uint32_t attachment)
+	{
+		/* 0: albedo and alpha, 1: octahedral normal, 2: emissive. depth is the usual depth attachment */
+		switch (attachment)
+		{
+			case 0:
+				return VK_FORMAT_R8G8B8A8_UNORM;
+
+			case 1:
+				return VK_FORMAT_R16G16_SFLOAT;
+
+			case 2:
+			default:
+				return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+		}
+	}
+
+	VkFormat FOMAttachmentVkFormat(uint32_t attachment)
+	{
+		/* 0: rgb absorbance and the constant coefficient, which the reconstruction divides by, so full precision.
+			1, 2: the cosine and sine coefficients of harmonics 1-2 and 3-4, bounded by the constant one */
+		return (attachment == 0) ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R16G16B16A16_SFLOAT;
+	}
+
+	VkFormat DepthVkFormat(DepthFormat format)
+	{
+		/* both are required to support depth attachments and sampling, so neither needs checking */
+		return (format == DepthFormat::D16_UNORM) ? VK_FORMAT_D16_UNORM : VK_FORMAT_D32_SFLOAT;
+	}
+
+	VkSampleCountFlagBits SampleCountVkFlag(SampleCount count)
+	{
+		switch (count)
+		{
+			case SampleCount::X2:
+				return VK_SAMPLE_COUNT_2_BIT;
+
+			case SampleCount::X4:
+				return VK_SAMPLE_COUNT_4_BIT;
+
+			case SampleCount::X8:
+				return VK_SAMPLE_COUNT_8_BIT;
+
+			case SampleCount::X1:
+			default:
+				return VK_SAMPLE_COUNT_1_BIT;
+		}
+	}
 }
@@ -44,7 +44,16 @@ namespace Renderer
 
 			/* getters */
 
+			uint32_t ColourAttachmentCount() const;
+			uint32_t ViewCount() const;
 			const VkRenderPass& operator*() const;
 			const RenderPassFeatures& Features() const;
 	};
+
+	VkFormat CSSMColourVkFormat(CSSMColourFormat format);
+	VkFormat CMSMAttachmentVkFormat(uint32_t attachment);
+	VkFormat GBufferAttachmentVkFormat(uint32_t attachment);
+	VkFormat FOMAttachmentVkFormat(uint32_t attachment);
+	VkFormat DepthVkFormat(DepthFormat format);
+	VkSampleCountFlagBits SampleCountVkFlag(SampleCount count);
 }
@@ -24,7 +24,17 @@ namespace Renderer
 	enum class SpecialColour
 	{
 		NONE = 0,
-		CSSM_SHADOWMAP
+		CSSM_SHADOWMAP,
+		TS_COLOUR_AND_DEPTH, /* translucent shadow colour + nearest translucent depth (MRT) */
+		CMSM_MOMENTS, /* opaque + nearest translucent depth moments, and translucent transmittance (MRT) */
+		GBUFFER, /* deferred opaque albedo, octahedral normal and emissive (MRT) */
+		FOM_COEFFICIENTS /* fourier opacity: absorbance, then the cosine and sine coefficients of its depth density (MRT) */
+	};
+
+	enum class Multiview
+	{
+		DISABLED = 0,
+		SHADOW_CASCADES /* one view per shadow cascade, rendered to the layers of array images */
 	};
 
 	enum class ClearDepth
@@ -39,6 +49,39 @@ namespace Renderer
 		DISABLED
 	};
 
+	/* CSSM colour shadow map encodings of the three stochastic depths */
+	enum class CSSMColourFormat
+	{
+		RGBA32_SFLOAT = 0,
+		RGBA16_UNORM,
+		RGBA16_SFLOAT,
+		RGB10A2_UNORM /* three 10 bit depths packed into 32 bits */
+	};
+
+	/* depth attachment format, D16_UNORM halves a shadow map as long as its light-space depth range is kept tight */
+	enum class DepthFormat
+	{
+		D32_SFLOAT = 0,
+		D16_UNORM
+	};
+
+	/* REVERSED: the depth is cleared to 0 and the near plane is at 1, which spreads a float depth's precision evenly
+		along a perspective view. pipelines keep naming their DepthOp for the standard range and the pass mirrors it */
+	enum class DepthRange
+	{
+		STANDARD = 0,
+		REVERSED
+	};
+
+	/* samples per texel of every attachment, CSSM_MSAA spreads the stochastic coverage over them */
+	enum class SampleCount
+	{
+		X1 = 0,
+		X2,
+		X4,
+		X8
+	};
+
 	struct RenderPassFeatures
 	{
 		ColourPass colourPass{};
@@ -47,6 +90,11 @@ namespace Renderer
 		SpecialColour specialColour{};
 		ClearDepth clearDepth{};
 		ClearColour clearColour{};
+		Multiview multiview{};
+		CSSMColourFormat cssmColourFormat{};
+		SampleCount sampleCount{};
+		DepthFormat depthFormat{};
+		DepthRange depthRange{};
 	};
 
 	/* Default Settings */
@@ -57,6 +105,11 @@ namespace Renderer
 		RenderTarget::PRESENT,
 		SpecialColour::NONE,
 		ClearDepth::ENABLED,
-		ClearColour::ENABLED
+		ClearColour::ENABLED,
+		Multiview::DISABLED,
+		CSSMColourFormat::RGBA32_SFLOAT,
+		SampleCount::X1,
+		DepthFormat::D32_SFLOAT,
+		DepthRange::STANDARD
 	};
 }
@@ -0,0 +1,355 @@
+#include "ShadowAtlas.hpp"
+
+/* c++ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+/* renderer */
+#include "BufferUtilities.hpp"
+#include "Environment.hpp" // <- class Environment
+#include "Pipeline.hpp" // <- class Pipeline
+#include "ViewerCamera.hpp" // <- class ViewerCamera
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+
+/* glm */
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace Renderer
+{
+	static const uint32_t LOCAL_ATLAS_CELLS = LOCAL_ATLAS_RESOLUTION / LOCAL_TILE_MIN;
+
+	static_assert(sizeof(Uniforms::LocalLightList) <= 65536, "the light list is uploaded with vkCmdUpdateBuffer()");
+	static_assert((LOCAL_TILE_MIN & (LOCAL_TILE_MIN - 1)) == 0 && (LOCAL_TILE_MAX & (LOCAL_TILE_MAX - 1)) == 0 &&
+		LOCAL_TILE_MAX <= LOCAL_ATLAS_RESOLUTION, "the atlas tiles are powers of two, packed along a z-order curve");
+
+	/* point light faces: +x -x +y -y +z -z, the lookup picks the face from the major axis in the same order */
+	static const glm::vec3 CUBE_FORWARD[6] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	static const glm::vec3 CUBE_UP[6] =
+	{
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)
+	};
+
+	static uint32_t compactBits(uint32_t x)
+	{
+		/* every other bit of x, packed into the low half */
+		x &= 0x55555555u;
+		x = (x | (x >> 1)) & 0x33333333u;
+		x = (x | (x >> 2)) & 0x0F0F0F0Fu;
+		x = (x | (x >> 4)) & 0x00FF00FFu;
+		x = (x | (x >> 8)) & 0x0000FFFFu;
+		return x;
+	}
+
+	/* constructors, etc. */
+
+	ShadowAtlas::ShadowAtlas(const Environment* environment, const DescriptorSetLayout* view_layout, float near_plane)
+	{
+		_near = near_plane;
+
+		/* each view's transform is its own aligned slice of one uniform buffer */
+		VkPhysicalDeviceProperties props{};
+		vkGetPhysicalDeviceProperties(environment->Window().physicalDevice, &props);
+		VkDeviceSize alignment = std::max<VkDeviceSize>(props.limits.minUniformBufferOffsetAlignment, 16);
+		_viewStride = ((sizeof(Uniforms::LocalShadowView) + alignment - 1) / alignment) * alignment;
+
+		_listBuffer = lut::create_buffer(environment->Allocator(), sizeof(Uniforms::LocalLightList),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		_viewBuffer = lut::create_buffer(environment->Allocator(), _viewStride * LOCAL_VIEW_MAX,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+		FreeUpdateBuffer(environment, &_listBuffer, 0, sizeof(Uniforms::LocalLightList), &_list);
+
+		for (uint32_t i = 0; i < LOCAL_VIEW_MAX; i++)
+		{
+			DescriptorSetFeatures viewData{};
+			viewData.binding = 0;
+			viewData.u_Buffer = *_viewBuffer;
+			viewData.u_Offset = _viewStride * i;
+			viewData.u_Range = sizeof(Uniforms::LocalShadowView);
+			_viewSets[i] = new DescriptorSet(environment, view_layout, 1, &viewData);
+		}
+
+		_requests.reserve(LOCAL_VIEW_MAX);
+	}
+
+	ShadowAtlas::~ShadowAtlas()
+	{
+		for (uint32_t i = 0; i < LOCAL_VIEW_MAX; i++)
+			delete _viewSets[i];
+	}
+
+	/* private member functions */
+
+	uint32_t ShadowAtlas::tileSize(const ViewerCamera* camera, const Uniforms::LocalLight& light, float* importance) const
+	{
+		/* from the inverse view, the camera looks down its -z */
+		glm::vec3 eye = glm::vec3(camera->InvView()[3]);
+		glm::vec3 forward = -glm::vec3(camera->InvView()[2]);
+
+		glm::vec3 toLight = glm::vec3(light.position) - eye;
+		float range = light.position.w;
+		float distance = glm::length(toLight);
+
+		/* entirely behind the camera, nothing it lights can be seen */
+		if (glm::dot(toLight, glm::normalize(forward)) < -range)
+		{
+			*importance = 0.0f;
+			return 0;
+		}
+
+		/* the fraction of the screen's height the light's sphere of influence covers */
+		float coverage = 1.0f;
+		if (distance > range)
+		{
+			float angle = std::asin(range / distance);
+			coverage = std::min(std::tan(angle) / std::tan(camera->FOVY() * 0.5f), 1.0f);
+		}
+		*importance = coverage;
+
+		/* a point light spreads the same budget over its six faces */
+		float wanted = static_cast<float>(LOCAL_TILE_MAX) * coverage;
+		if (static_cast<Uniforms::LocalLightType>(light.info.x) == Uniforms::LocalLightType::POINT)
+			wanted *= 0.5f;
+
+		uint32_t size = LOCAL_TILE_MAX;
+		while (size > LOCAL_TILE_MIN && static_cast<float>(size) > wanted)
+			size /= 2;
+
+		return size;
+	}
+
+	glm::mat4 ShadowAtlas::viewProjection(const Uniforms::LocalLight& light, uint32_t face, float* texel_scale) const
+	{
+		glm::vec3 position = glm::vec3(light.position);
+		float range = std::max(light.position.w, _near * 2.0f);
+
+		if (static_cast<Uniforms::LocalLightType>(light.info.x) == Uniforms::LocalLightType::POINT)
+		{
+			*texel_scale = 2.0f;
+			glm::mat4 view = glm::lookAtRH(position, position + CUBE_FORWARD[face], CUBE_UP[face]);
+			return glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, _near, range) * view;
+		}
+
+		glm::vec3 forward = glm::normalize(glm::vec3(light.direction));
+		glm::vec3 upHint = (std::abs(forward.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		float fov = glm::clamp(2.0f * std::acos(glm::clamp(light.direction.w, -1.0f, 1.0f)), glm::radians(1.0f), glm::radians(170.0f));
+
+		*texel_scale = 2.0f * std::tan(fov * 0.5f);
+		glm::mat4 view = glm::lookAtRH(position, position + forward, upHint);
+		return glm::perspectiveRH_ZO(fov, 1.0f, _near, range) * view;
+	}
+
+	void ShadowAtlas::pack()
+	{
+		/* largest first, so every tile starts on a multiple of its own size along the curve and none overlap */
+		std::stable_sort(_requests.begin(), _requests.end(),
+			[](const ViewRequest& a, const ViewRequest& b) { return a.size > b.size || (a.size == b.size && a.importance > b.importance); });
+
+		/* too many big tiles, shrink the least important of the largest ones until they fit */
+		auto cells = [](const std::vector<ViewRequest>& requests)
+		{
+			uint32_t total = 0;
+			for (const ViewRequest& request : requests)
+				total += (request.size / LOCAL_TILE_MIN) * (request.size / LOCAL_TILE_MIN);
+			return total;
+		};
+
+		while (cells(_requests) > LOCAL_ATLAS_CELLS * LOCAL_ATLAS_CELLS)
+		{
+			uint32_t largest = _requests.front().size;
+			if (largest == LOCAL_TILE_MIN)
+				break;
+
+			/* the last of the largest tiles is the least important one */
+			size_t last = 0;
+			while (last + 1 < _requests.size() && _requests[last + 1].size == largest)
+				last++;
+
+			_requests[last].size /= 2;
+			std::stable_sort(_requests.begin(), _requests.end(),
+				[](const ViewRequest& a, const ViewRequest& b) { return a.size > b.size || (a.size == b.size && a.importance > b.importance); });
+		}
+	}
+
+	/* public member functions */
+
+	void ShadowAtlas::Update(const ViewerCamera* camera, const std::vector<Uniforms::LocalLight>& lights)
+	{
+		Uniforms::LocalLightList list{};
+		uint32_t lightCount = static_cast<uint32_t>(std::min<size_t>(lights.size(), LOCAL_LIGHT_MAX));
+		list.counts.x = lightCount;
+
+		/* most important lights first, a light whose views don't all fit is left unshadowed */
+		struct LightOrder
+		{
+			uint32_t light;
+			uint32_t size;
+			float importance;
+		};
+		std::vector<LightOrder> order{};
+		for (uint32_t i = 0; i < lightCount; i++)
+		{
+			list.lights[i] = lights[i];
+			list.lights[i].info.y = 0;
+			list.lights[i].info.z = 0;
+
+			float importance = 0.0f;
+			uint32_t size = tileSize(camera, lights[i], &importance);
+			if (size > 0)
+				order.push_back({ i, size, importance });
+		}
+		std::stable_sort(order.begin(), order.end(), [](const LightOrder& a, const LightOrder& b) { return a.importance > b.importance; });
+
+		_requests.clear();
+		for (const LightOrder& light : order)
+		{
+			uint32_t faces = (static_cast<Uniforms::LocalLightType>(lights[light.light].info.x) == Uniforms::LocalLightType::POINT) ? 6 : 1;
+			if (_requests.size() + faces > LOCAL_VIEW_MAX)
+				continue;
+
+			for (uint32_t face = 0; face < faces; face++)
+				_requests.push_back({ light.light, face, light.size, light.importance });
+		}
+
+		pack();
+
+		/* a light's views are contiguous in the list, in face order */
+		std::vector<uint32_t> firstView(lightCount, 0);
+		uint32_t viewCount = 0;
+		for (uint32_t i = 0; i < lightCount; i++)
+		{
+			uint32_t faces = static_cast<uint32_t>(std::count_if(_requests.begin(), _requests.end(),
+				[i](const ViewRequest& request) { return request.light == i; }));
+
+			list.lights[i].info.y = viewCount;
+			list.lights[i].info.z = faces;
+			firstView[i] = viewCount;
+			viewCount += faces;
+		}
+		list.counts.y = viewCount;
+
+		/* place the tiles along the z-order curve, in LOCAL_TILE_MIN cells */
+		uint32_t cursor = 0;
+		for (const ViewRequest& request : _requests)
+		{
+			uint32_t cellX = compactBits(cursor);
+			uint32_t cellY = compactBits(cursor >> 1);
+			uint32_t span = request.size / LOCAL_TILE_MIN;
+			cursor += span * span;
+
+			Uniforms::LocalShadowView& view = list.views[firstView[request.light] + request.face];
+
+			float texelScale = 1.0f;
+			view.projView = viewProjection(lights[request.light], request.face, &texelScale);
+			view.rect = glm::vec4(
+				static_cast<float>(cellX * LOCAL_TILE_MIN),
+				static_cast<float>(cellY * LOCAL_TILE_MIN),
+				static_cast<float>(request.size),
+				static_cast<float>(request.size)) / static_cast<float>(LOCAL_ATLAS_RESOLUTION);
+			view.bias = glm::vec4(texelScale / static_cast<float>(request.size), 0.0f, 0.0f, 0.0f);
+		}
+
+		/* the atlas only needs rendering again when a light or a tile moved */
+		if (std::memcmp(&list, &_list, sizeof(Uniforms::LocalLightList)) != 0)
+		{
+			_list = list;
+			_dirty = true;
+			_uploadPending = true;
+		}
+	}
+
+	void ShadowAtlas::Invalidate()
+	{
+		/* casters changed */
+		_dirty = true;
+	}
+
+	void ShadowAtlas::MarkRendered()
+	{
+		_dirty = false;
+	}
+
+	void ShadowAtlas::CmdUpload(Environment* environment)
+	{
+		if (_uploadPending == false)
+			return;
+
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_listBuffer,
+			VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_viewBuffer,
+			VK_ACCESS_UNIFORM_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		vkCmdUpdateBuffer(*environment->CurrentCmdBuffer(), *_listBuffer, 0, sizeof(Uniforms::LocalLightList), &_list);
+		for (uint32_t i = 0; i < _list.counts.y; i++)
+			vkCmdUpdateBuffer(*environment->CurrentCmdBuffer(), *_viewBuffer, _viewStride * i, sizeof(Uniforms::LocalShadowView), &_list.views[i]);
+
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_listBuffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_viewBuffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_UNIFORM_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+
+		_uploadPending = false;
+	}
+
+	void ShadowAtlas::CmdBeginView(Environment* environment, uint32_t view)
+	{
+		assert(view < _list.counts.y);
+
+		const glm::vec4 rect = _list.views[view].rect * static_cast<float>(LOCAL_ATLAS_RESOLUTION);
+
+		VkViewport viewport{};
+		viewport.x = rect.x;
+		viewport.y = rect.y;
+		viewport.width = rect.z;
+		viewport.height = rect.w;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+
+		VkRect2D scissor{};
+		scissor.offset = VkOffset2D{ static_cast<int32_t>(rect.x), static_cast<int32_t>(rect.y) };
+		scissor.extent = VkExtent2D{ static_cast<uint32_t>(rect.z), static_cast<uint32_t>(rect.w) };
+
+		environment->CmdSetViewport(viewport, scissor);
+	}
+
+	void ShadowAtlas::CmdBindView(Environment* environment, Pipeline* pipeline, uint32_t view, uint32_t set_index)
+	{
+		assert(view < LOCAL_VIEW_MAX);
+		_viewSets[view]->CmdBind(environment, pipeline, set_index);
+	}
+
+	/* getters */
+
+	bool ShadowAtlas::Dirty() const
+	{
+		return _dirty;
+	}
+	uint32_t ShadowAtlas::LightCount() const
+	{
+		return _list.counts.x;
+	}
+	uint32_t ShadowAtlas::ViewCount() const
+	{
+		return _list.counts.y;
+	}
+	const lut::Buffer& ShadowAtlas::LightListBuffer() const
+	{
+		return _listBuffer;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+/* c++ */
+#include <vector>
+
+/* renderer */
+#include "Constants.hpp"
+#include "DescriptorSet.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "Uniforms.hpp"
+
+/* labutils */
+#include "../labutils/vkbuffer.hpp"
+
+/* glm */
+#include <glm/glm.hpp>
+
+namespace Renderer
+{
+	class Environment;
+	class Pipeline;
+	class ViewerCamera;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* shadows for the local (spot and point) lights: every shadow view gets a square power of two tile of one atlas,
+		sized by how much of the screen its light can reach, and the whole atlas is rendered in one pass,
+		one viewport per view. the lights and their views are also the lighting shaders' light list */
+	class ShadowAtlas
+	{
+		public:
+			/* constructors, etc. */
+
+			ShadowAtlas(const Environment* environment, const DescriptorSetLayout* view_layout, float near_plane = 0.05f);
+			~ShadowAtlas();
+
+			ShadowAtlas(const ShadowAtlas&) = delete;
+			ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+		private:
+			/* private member variables */
+
+			struct ViewRequest
+			{
+				uint32_t light = 0;
+				uint32_t face = 0;
+				uint32_t size = LOCAL_TILE_MIN;
+				float importance = 0.0f;
+			};
+
+			float _near = 0.05f;
+			VkDeviceSize _viewStride = 0;
+
+			/* the light list is read by the lighting shaders, each view's own slot of _viewBuffer by the atlas pass */
+			Uniforms::LocalLightList _list{};
+			lut::Buffer _listBuffer{};
+			lut::Buffer _viewBuffer{};
+			DescriptorSet* _viewSets[LOCAL_VIEW_MAX]{};
+
+			std::vector<ViewRequest> _requests{};
+			bool _dirty = true;
+			bool _uploadPending = true;
+
+			/* private member functions */
+
+			uint32_t tileSize(const ViewerCamera* camera, const Uniforms::LocalLight& light, float* importance) const;
+			glm::mat4 viewProjection(const Uniforms::LocalLight& light, uint32_t face, float* texel_scale) const;
+			void pack();
+
+		public:
+			/* public member functions */
+
+			void Update(const ViewerCamera* camera, const std::vector<Uniforms::LocalLight>& lights);
+			void Invalidate();
+			void MarkRendered();
+
+			void CmdUpload(Environment* environment);
+			void CmdBeginView(Environment* environment, uint32_t view);
+			void CmdBindView(Environment* environment, Pipeline* pipeline, uint32_t view, uint32_t set_index);
+
+			/* getters */
+
+			bool Dirty() const;
+			uint32_t LightCount() const;
+			uint32_t ViewCount() const;
+			const lut::Buffer& LightListBuffer() const;
+	};
+}
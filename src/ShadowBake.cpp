@@ -0,0 +1,392 @@
+#include "ShadowBake.hpp"
+
+/* c */
+#include <cmath>
+#include <cstring>
+
+/* c++ */
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+/* renderer */
+#include "BufferUtilities.hpp" // <- FreeUpdateBuffer()
+#include "Environment.hpp" // <- class Environment
+#include "Model.hpp" // <- class Model
+#include "ReferenceRenderer.hpp" // <- class ReferenceRenderer
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/vkutil.hpp"
+
+/* glm */
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace Renderer
+{
+	static uint16_t PackUnorm16(float value)
+	{
+		return static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+
+	static uint64_t HashFile(const std::string& path)
+	{
+		/* 64 bit FNV-1a, 0 when the file can't be read so a missing model never matches a bake */
+		std::ifstream file(path, std::ios::binary);
+		if (file.is_open() == false)
+			return 0;
+
+		uint64_t hash = 14695981039346656037ull;
+		char chunk[64 * 1024];
+		while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0)
+		{
+			for (std::streamsize i = 0; i < file.gcount(); i++)
+			{
+				hash ^= static_cast<uint8_t>(chunk[i]);
+				hash *= 1099511628211ull;
+			}
+		}
+
+		return hash;
+	}
+
+	/* constructors, etc. */
+
+	ShadowBake::ShadowBake(const Environment* environment, const Model* model, const std::string& model_path, const glm::vec3& light_direction)
+	{
+		_data.projView = fitLight(model, light_direction);
+
+		std::string path = BakePath(model_path);
+		FileHeader expected = header(model_path, light_direction);
+
+		_loaded = load(path, expected);
+		if (_loaded == false)
+		{
+			bake(model, light_direction);
+			save(path, expected);
+		}
+
+		upload(environment);
+	}
+
+	/* private member functions */
+
+	glm::mat4 ShadowBake::fitLight(const Model* model, const glm::vec3& light_direction) const
+	{
+		/* as DirectionalShadowData::Update() looks down the sun, fitted around every caster's bounds */
+		glm::vec3 lightForward = glm::normalize(light_direction);
+		glm::vec3 upHint = (std::abs(lightForward.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::mat4 lightView = glm::lookAtRH(glm::vec3(0.0f), lightForward, upHint);
+
+		std::vector<glm::vec3> bounds;
+		model->CasterBounds(&bounds);
+
+		glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 maximum = glm::vec3(std::numeric_limits<float>::lowest());
+		for (size_t i = 0; i + 1 < bounds.size(); i += 2)
+		{
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				glm::vec3 point = glm::vec3(
+					(corner & 1) ? bounds[i + 1].x : bounds[i].x,
+					(corner & 2) ? bounds[i + 1].y : bounds[i].y,
+					(corner & 4) ? bounds[i + 1].z : bounds[i].z);
+
+				glm::vec3 viewPoint = glm::vec3(lightView * glm::vec4(point, 1.0f));
+				minimum = glm::min(minimum, viewPoint);
+				maximum = glm::max(maximum, viewPoint);
+			}
+		}
+
+		if (bounds.empty())
+		{
+			minimum = glm::vec3(-1.0f);
+			maximum = glm::vec3(1.0f);
+		}
+
+		/* a little room so the outermost casters aren't on the edge texels, the view looks down -z */
+		glm::vec3 margin = glm::max((maximum - minimum) * 0.01f, glm::vec3(0.01f));
+		minimum -= margin;
+		maximum += margin;
+
+		glm::mat4 projection = glm::orthoRH_ZO(minimum.x, maximum.x, minimum.y, maximum.y, -maximum.z, -minimum.z);
+		return projection * lightView;
+	}
+
+	ShadowBake::FileHeader ShadowBake::header(const std::string& model_path, const glm::vec3& light_direction) const
+	{
+		FileHeader result{};
+		std::memcpy(result.magic, MAGIC, sizeof(MAGIC));
+		result.version = VERSION;
+		result.resolution = BAKED_SHADOW_RESOLUTION;
+		result.layers = BAKED_SHADOW_LAYERS;
+
+		std::error_code error;
+		uintmax_t size = std::filesystem::file_size(model_path, error);
+		result.modelSize = (error) ? 0 : static_cast<uint64_t>(size);
+		result.modelHash = HashFile(model_path);
+
+		result.lightDirection = glm::vec4(glm::normalize(light_direction), 0.0f);
+		result.projView = _data.projView;
+		return result;
+	}
+
+	bool ShadowBake::load(const std::string& path, const FileHeader& expected)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (file.is_open() == false)
+			return false;
+
+		FileHeader found{};
+		if (!file.read(reinterpret_cast<char*>(&found), sizeof(FileHeader)) || std::memcmp(&found, &expected, sizeof(FileHeader)) != 0)
+		{
+			printf("Shadow bake at [%s] is out of date, baking again\n", path.c_str());
+			return false;
+		}
+
+		_texels.resize(static_cast<size_t>(BAKED_SHADOW_RESOLUTION) * BAKED_SHADOW_RESOLUTION * BAKED_SHADOW_LAYERS * 4);
+		if (!file.read(reinterpret_cast<char*>(_texels.data()), _texels.size() * sizeof(uint16_t)))
+		{
+			printf("Shadow bake at [%s] is truncated, baking again\n", path.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	void ShadowBake::save(const std::string& path, const FileHeader& header) const
+	{
+		/* the bake is only a cache, so failing to keep it costs the next run a bake and nothing more */
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (file.is_open())
+		{
+			file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+			file.write(reinterpret_cast<const char*>(_texels.data()), _texels.size() * sizeof(uint16_t));
+		}
+
+		if (file.is_open() == false || file.fail())
+			printf("Shadow bake couldn't be written to [%s]\n", path.c_str());
+	}
+
+	void ShadowBake::bake(const Model* model, const glm::vec3& light_direction)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		ReferenceRenderer tracer(model);
+
+		const uint32_t resolution = BAKED_SHADOW_RESOLUTION;
+		const size_t layerTexels = static_cast<size_t>(resolution) * resolution;
+		_texels.assign(layerTexels * BAKED_SHADOW_LAYERS * 4, 0);
+
+		/* each texel's ray leaves the near plane along the sun, its distance over the depth range is the projection's depth */
+		glm::mat4 invProjView = glm::inverse(_data.projView);
+		glm::vec3 lightForward = glm::normalize(light_direction);
+		glm::vec4 nearCentre = invProjView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		glm::vec4 farCentre = invProjView * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		float depthRange = glm::length(glm::vec3(farCentre) - glm::vec3(nearCentre));
+
+		tracer.ForEachPixel(resolution, resolution, [&](uint32_t x, uint32_t y) {
+			glm::vec2 ndc = glm::vec2(
+				(static_cast<float>(x) + 0.5f) / static_cast<float>(resolution) * 2.0f - 1.0f,
+				(static_cast<float>(y) + 0.5f) / static_cast<float>(resolution) * 2.0f - 1.0f);
+			glm::vec3 origin = glm::vec3(invProjView * glm::vec4(ndc, 0.0f, 1.0f));
+
+			ReferenceRenderer::TransmittanceLayer layers[BAKED_SHADOW_LAYERS]{};
+			uint32_t count = tracer.TransmittanceLayers(origin, lightForward, depthRange, layers, BAKED_SHADOW_LAYERS);
+
+			/* the empty layers sit at the far plane with the last transmittance, so they never change the lookup */
+			glm::vec3 transmittance = glm::vec3(1.0f);
+			for (uint32_t layer = 0; layer < BAKED_SHADOW_LAYERS; layer++)
+			{
+				float depth = 1.0f;
+				if (layer < count)
+				{
+					transmittance = layers[layer].transmittance;
+					depth = layers[layer].t / depthRange;
+				}
+
+				uint16_t* texel = &_texels[(layer * layerTexels + static_cast<size_t>(y) * resolution + x) * 4];
+				texel[0] = PackUnorm16(transmittance.r);
+				texel[1] = PackUnorm16(transmittance.g);
+				texel[2] = PackUnorm16(transmittance.b);
+				texel[3] = PackUnorm16(depth);
+			}
+		});
+
+		_bakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void ShadowBake::upload(const Environment* environment)
+	{
+		const VkFormat format = VK_FORMAT_R16G16B16A16_UNORM;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = BAKED_SHADOW_RESOLUTION;
+		imageInfo.extent.height = BAKED_SHADOW_RESOLUTION;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = BAKED_SHADOW_LAYERS;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		VkImage image = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if (const auto& res = vmaCreateImage(environment->Allocator().allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
+		{
+			throw lut::Error("VK: vmaCreateImage() failed while creating the shadow bake image. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_image = lut::Image(environment->Allocator().allocator, image, allocation);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = *_image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		viewInfo.format = format;
+		viewInfo.components = VkComponentMapping{};
+		viewInfo.subresourceRange = VkImageSubresourceRange
+		{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, 1,
+			0, BAKED_SHADOW_LAYERS
+		};
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (const auto& res = vkCreateImageView(environment->Window().device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkCreateImageView() failed to create the shadow bake image view. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_view = lut::ImageView(environment->Window().device, view);
+
+		/* the texels go through a staging buffer, copied over once at load time */
+		VkDeviceSize numBytes = _texels.size() * sizeof(uint16_t);
+		lut::Buffer staging = lut::create_buffer(environment->Allocator(), numBytes,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+		void* dataPtr = nullptr;
+		if (const auto& res = vmaMapMemory(environment->Allocator().allocator, staging.allocation, &dataPtr); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vmaMapMemory() failed to map the shadow bake staging buffer. err: %s",
+				lut::to_string(res).c_str());
+		}
+		std::memcpy(dataPtr, _texels.data(), numBytes);
+		vmaUnmapMemory(environment->Allocator().allocator, staging.allocation);
+
+		lut::Fence uploadComplete = lut::create_fence(environment->Window());
+		lut::CommandPool uploadPool = lut::create_command_pool(environment->Window());
+		VkCommandBuffer uploadCmd = lut::alloc_command_buffer(environment->Window(), *uploadPool);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+		if (const auto& res = vkBeginCommandBuffer(uploadCmd, &beginInfo); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkBeginCommandBuffer() failed to begin the shadow bake upload. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, BAKED_SHADOW_LAYERS };
+
+		/* BARRIER: undefined -> transfer destination */
+		lut::image_barrier(uploadCmd, *_image,
+			0,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			range);
+
+		VkBufferImageCopy copy{};
+		copy.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, BAKED_SHADOW_LAYERS };
+		copy.imageExtent = VkExtent3D{ BAKED_SHADOW_RESOLUTION, BAKED_SHADOW_RESOLUTION, 1 };
+
+		vkCmdCopyBufferToImage(uploadCmd, *staging, *_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+		/* BARRIER: transfer destination -> shader read, where it stays */
+		lut::image_barrier(uploadCmd, *_image,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			range);
+
+		if (const auto& res = vkEndCommandBuffer(uploadCmd); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkEndCommandBuffer() failed to end the shadow bake upload. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &uploadCmd;
+
+		if (const auto& res = vkQueueSubmit(environment->Window().graphicsQueue, 1, &submitInfo, *uploadComplete); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkQueueSubmit() failed to submit the shadow bake upload. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		if (const auto& res = vkWaitForFences(environment->Window().device, 1, &*uploadComplete, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkWaitForFences() failed while waiting for the shadow bake upload. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_texels.clear();
+		_texels.shrink_to_fit();
+
+		_buffer = lut::create_buffer(environment->Allocator(), sizeof(Uniforms::BakedShadowData),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		FreeUpdateBuffer(environment, &_buffer, 0, sizeof(Uniforms::BakedShadowData), &_data);
+	}
+
+	/* public member functions */
+
+	std::string ShadowBake::BakePath(const std::string& model_path)
+	{
+		return std::filesystem::path(model_path).replace_extension(".shadowbake").string();
+	}
+
+	/* getters */
+
+	const lut::ImageView& ShadowBake::View() const
+	{
+		return _view;
+	}
+
+	VkBuffer ShadowBake::Buffer() const
+	{
+		return *_buffer;
+	}
+
+	bool ShadowBake::Loaded() const
+	{
+		return _loaded;
+	}
+
+	double ShadowBake::BakeSeconds() const
+	{
+		return _bakeSeconds;
+	}
+}
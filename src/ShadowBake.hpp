@@ -0,0 +1,103 @@
+#pragma once
+
+/* c++ */
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* renderer */
+#include "Constants.hpp"
+#include "Uniforms.hpp"
+
+/* labutils */
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+
+/* volk */
+#include <volk/volk.h>
+
+/* glm */
+#include <glm/glm.hpp>
+
+namespace Renderer
+{
+	class Environment;
+	class Model;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* the sun's coloured shadows from the static translucent casters, traced once on the CPU and kept next to the model.
+		one orthographic light view covers every caster, and each of its texels stores, for the first BAKED_SHADOW_LAYERS
+		translucent surfaces along its ray, the depth of the surface and the RGB transmittance past it (layer i in array layer i).
+		the bake is reloaded while the model, the sun, and the bake's settings are unchanged, and traced again otherwise.
+		the opaque casters aren't baked, they stay in the ordinary shadow map so anything that moves still casts */
+	class ShadowBake
+	{
+		public:
+			/* constructors, etc. */
+
+			ShadowBake(const Environment* environment, const Model* model, const std::string& model_path, const glm::vec3& light_direction);
+			~ShadowBake() = default;
+
+			ShadowBake(const ShadowBake&) = delete;
+			ShadowBake& operator=(const ShadowBake&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr char MAGIC[8] = { 'S', 'H', 'D', 'W', 'B', 'A', 'K', 'E' };
+			static constexpr uint32_t VERSION = 2;
+
+			/* everything the bake depends on, a file whose header differs is stale */
+			struct FileHeader
+			{
+				char magic[8]{};
+				uint32_t version = 0;
+				uint32_t resolution = 0;
+				uint32_t layers = 0;
+				uint32_t _padding = 0;
+				uint64_t modelSize = 0; /* bytes in the .glb */
+				uint64_t modelHash = 0; /* FNV-1a of the .glb's contents, so an edit that keeps its size still rebakes */
+				glm::vec4 lightDirection = glm::vec4(0.0f);
+				glm::mat4 projView = glm::mat4(1.0f);
+			};
+
+			Uniforms::BakedShadowData _data{};
+			std::vector<uint16_t> _texels{}; /* RGBA16, layer by layer, emptied once uploaded */
+
+			lut::Image _image{};
+			lut::ImageView _view{};
+			lut::Buffer _buffer{};
+
+			bool _loaded = false;
+			double _bakeSeconds = 0.0;
+
+			/* private member functions */
+
+			glm::mat4 fitLight(const Model* model, const glm::vec3& light_direction) const;
+			FileHeader header(const std::string& model_path, const glm::vec3& light_direction) const;
+
+			bool load(const std::string& path, const FileHeader& expected);
+			void save(const std::string& path, const FileHeader& header) const;
+			void bake(const Model* model, const glm::vec3& light_direction);
+
+			void upload(const Environment* environment);
+
+		public:
+			/* public member functions */
+
+			/* the .glb's path with its extension replaced */
+			static std::string BakePath(const std::string& model_path);
+
+			/* getters */
+
+			const lut::ImageView& View() const;
+			VkBuffer Buffer() const;
+			bool Loaded() const; /* read from disk rather than traced */
+			double BakeSeconds() const;
+	};
+}
@@ -0,0 +1,192 @@
+#include "ShadowCache.hpp"
+
+/* c++ */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/* renderer */
+#include "Uniforms.hpp"
+
+/* glm */
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace Renderer
+{
+	/* constructors, etc. */
+
+	ShadowCache::ShadowCache(float guard_band, bool amortise)
+	{
+		_guardBand = guard_band;
+		_amortise = amortise;
+	}
+
+	ShadowCache::~ShadowCache()
+	{
+		/* This space intentionally left blank */
+	}
+
+	/* private member functions */
+
+	bool ShadowCache::regionContains(uint32_t cascade, const glm::vec3& minimum, const glm::vec3& maximum, float margin) const
+	{
+		/* margin shrinks the region, so a positive margin asks "is there still that much guard band left?" */
+		glm::vec3 centre = glm::vec3(_regions[cascade]);
+		float halfExtent = _regions[cascade].w - margin;
+
+		return glm::all(glm::greaterThanEqual(minimum, centre - halfExtent)) &&
+			glm::all(glm::lessThanEqual(maximum, centre + halfExtent));
+	}
+
+	void ShadowCache::refitRegion(uint32_t cascade, const glm::vec3* lightCorners)
+	{
+		/* a bounding sphere keeps the region size independent of the camera's orientation */
+		glm::vec3 centre = glm::vec3(0.0f);
+		for (size_t i = 0; i < 8; i++)
+			centre += lightCorners[i] * 0.125f;
+
+		float radius = 0.0f;
+		for (size_t i = 0; i < 8; i++)
+			radius = std::max(radius, glm::length(lightCorners[i] - centre));
+
+		/* round the radius up so float noise doesn't change the texel size between refits */
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+		float halfExtent = radius * (1.0f + _guardBand);
+
+		/* snap the centre to whole shadow texels so static geometry doesn't shimmer when refitting */
+		float texelSize = (2.0f * halfExtent) / _resolution;
+		centre.x = std::floor(centre.x / texelSize + 0.5f) * texelSize;
+		centre.y = std::floor(centre.y / texelSize + 0.5f) * texelSize;
+
+		_regions[cascade] = glm::vec4(centre, halfExtent);
+		_radii[cascade] = radius;
+		_regionValid[cascade] = true;
+	}
+
+	/* public member functions */
+
+	void ShadowCache::FitCascades(const glm::mat4& light_view, const glm::vec3* slice_corners, uint32_t cascade_count,
+		float buffer_distance, glm::mat4* projections, const Uniforms::ShadowFitBounds* fit_bounds)
+	{
+		/* a new light orientation invalidates every cascade */
+		if (_lightValid == false || light_view != _lightView)
+		{
+			_lightView = light_view;
+			_lightValid = true;
+
+			for (uint32_t i = 0; i < SHADOW_CASCADE_MAX; i++)
+				_regionValid[i] = false;
+		}
+
+		glm::vec3 lightCorners[SHADOW_CASCADE_MAX][8];
+		glm::vec3 minimum[SHADOW_CASCADE_MAX];
+		glm::vec3 maximum[SHADOW_CASCADE_MAX];
+		bool refit[SHADOW_CASCADE_MAX]{};
+		bool anyRefit = false;
+
+		for (uint32_t c = 0; c < cascade_count; c++)
+		{
+			minimum[c] = glm::vec3(std::numeric_limits<float>::max());
+			maximum[c] = glm::vec3(std::numeric_limits<float>::lowest());
+
+			for (size_t i = 0; i < 8; i++)
+			{
+				lightCorners[c][i] = glm::vec3(_lightView * glm::vec4(slice_corners[c * 8 + i], 1.0f));
+				minimum[c] = glm::min(minimum[c], lightCorners[c][i]);
+				maximum[c] = glm::max(maximum[c], lightCorners[c][i]);
+			}
+
+			/* only refit once the slice leaves the guard band */
+			refit[c] = (_regionValid[c] == false || regionContains(c, minimum[c], maximum[c], 0.0f) == false);
+			anyRefit = anyRefit || refit[c];
+		}
+
+		/* all cascades are re-rendered together, so when one has to be refit also refit any
+			that have used up half their guard band, rather than paying for another re-render soon */
+		if (_amortise && anyRefit)
+		{
+			for (uint32_t c = 0; c < cascade_count; c++)
+			{
+				if (refit[c] == false)
+					refit[c] = (regionContains(c, minimum[c], maximum[c], _radii[c] * _guardBand * 0.5f) == false);
+			}
+		}
+
+		for (uint32_t c = 0; c < cascade_count; c++)
+		{
+			if (refit[c])
+			{
+				refitRegion(c, lightCorners[c]);
+				_refits++;
+				_dirty = true;
+			}
+
+			/* the light looks down -z, so the buffer pulls the near plane back towards the light */
+			const glm::vec4& region = _regions[c];
+			float nearZ = region.z + region.w + buffer_distance;
+			float farZ = region.z - region.w;
+
+			/* or the near plane sits on the nearest caster over the region, the casters don't move
+				so the projection still only changes when the region is refit */
+			if (fit_bounds != nullptr)
+			{
+				glm::vec2 casterDepth = Uniforms::CasterDepthRange(*fit_bounds, _lightView,
+					glm::vec2(region) - region.w, glm::vec2(region) + region.w);
+				if (casterDepth.x >= casterDepth.y)
+				{
+					nearZ = casterDepth.x;
+					farZ = std::max(farZ, casterDepth.y);
+				}
+				nearZ = std::max(nearZ, farZ + 0.01f);
+			}
+
+			projections[c] = glm::orthoRH_ZO(
+				region.x - region.w, region.x + region.w,
+				region.y - region.w, region.y + region.w,
+				-nearZ,
+				-farZ);
+		}
+	}
+
+	void ShadowCache::Invalidate()
+	{
+		/* casters changed, the regions are still fine but the maps need re-rendering */
+		_dirty = true;
+	}
+
+	void ShadowCache::SetResolution(uint32_t resolution)
+	{
+		if (static_cast<float>(resolution) == _resolution)
+			return;
+
+		/* the texel size changed, so the regions have to be snapped again before re-rendering */
+		_resolution = static_cast<float>(resolution);
+		for (uint32_t i = 0; i < SHADOW_CASCADE_MAX; i++)
+			_regionValid[i] = false;
+
+		_dirty = true;
+	}
+
+	void ShadowCache::MarkRendered()
+	{
+		if (_dirty)
+			_renders++;
+
+		_dirty = false;
+	}
+
+	/* getters */
+
+	bool ShadowCache::Dirty() const
+	{
+		return _dirty;
+	}
+	uint32_t ShadowCache::RefitCount() const
+	{
+		return _refits;
+	}
+	uint32_t ShadowCache::RenderCount() const
+	{
+		return _renders;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+/* renderer */
+#include "Constants.hpp"
+
+/* glm */
+#include <glm/glm.hpp>
+
+namespace Renderer
+{
+	namespace Uniforms
+	{
+		struct ShadowFitBounds;
+	}
+}
+
+namespace Renderer
+{
+	class ShadowCache
+	{
+		public:
+			/* constructors, etc. */
+
+			ShadowCache(float guard_band = 0.15f, bool amortise = true);
+			~ShadowCache();
+
+			ShadowCache(const ShadowCache&) = delete;
+			ShadowCache& operator=(const ShadowCache&) = delete;
+
+		private:
+			/* private member variables */
+
+			float _guardBand = 0.15f;
+			bool _amortise = true;
+			float _resolution = SHADOW_MAP_RESOLUTION_F;
+
+			bool _dirty = true;
+			bool _lightValid = false;
+			glm::mat4 _lightView = glm::mat4(1);
+
+			/* cached cascade regions in light view space
+				xy: texel snapped centre, z: centre depth, w: half extent (including the guard band) */
+			bool _regionValid[SHADOW_CASCADE_MAX]{};
+			glm::vec4 _regions[SHADOW_CASCADE_MAX]{};
+			float _radii[SHADOW_CASCADE_MAX]{};
+
+			uint32_t _refits = 0;
+			uint32_t _renders = 0;
+
+			/* private member functions */
+
+			bool regionContains(uint32_t cascade, const glm::vec3& minimum, const glm::vec3& maximum, float margin) const;
+			void refitRegion(uint32_t cascade, const glm::vec3* lightCorners);
+
+		public:
+			/* public member functions */
+
+			void FitCascades(const glm::mat4& light_view, const glm::vec3* slice_corners, uint32_t cascade_count,
+				float buffer_distance, glm::mat4* projections, const Uniforms::ShadowFitBounds* fit_bounds = nullptr);
+			void Invalidate();
+			void MarkRendered();
+			void SetResolution(uint32_t resolution);
+
+			/* getters */
+
+			bool Dirty() const;
+			uint32_t RefitCount() const;
+			uint32_t RenderCount() const;
+	};
+}
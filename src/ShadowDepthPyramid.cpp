@@ -0,0 +1,211 @@
+#include "ShadowDepthPyramid.hpp"
+
+/* c++ */
+#include <algorithm>
+#include <cmath>
+
+/* renderer */
+#include "Environment.hpp" // <- class Environment
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/vkutil.hpp"
+
+namespace Renderer
+{
+	/* constructors, etc. */
+
+	ShadowDepthPyramid::ShadowDepthPyramid(const Environment* environment, uint32_t resolution, uint32_t layers,
+		const lut::ImageView* depth_view, const lut::ImageView* colour_view,
+		VkSampler sampler, VkBuffer shadow_data)
+	{
+		_layers = layers;
+		_baseSize = std::max((resolution + SHADOW_PYRAMID_CELL - 1) / SHADOW_PYRAMID_CELL, 1u);
+		_levels = static_cast<uint32_t>(std::floor(std::log2(static_cast<float>(_baseSize)))) + 1;
+
+		createPyramid(environment);
+
+		/* every pass reads two maps and writes one level */
+		DescriptorSetLayoutFeatures layoutData{};
+		layoutData.stages = ShaderStageConstants::COMPUTE_STAGE;
+		layoutData.bindingCount = 4;
+		DescriptorSetType layoutTypes[4]
+		{
+			DescriptorSetType::SAMPLER, /* shadow depth, or the previous level */
+			DescriptorSetType::SAMPLER, /* CSSM colour (base level only) */
+			DescriptorSetType::STORAGE_IMAGE, /* level being built */
+			DescriptorSetType::UNIFORM_BUFFER /* shadow data, for the rendered resolution */
+		};
+		layoutData.pBindingTypes = layoutTypes;
+		_layout = new DescriptorSetLayout(environment, layoutData);
+
+		DescriptorSetFeatures bindingData[4]{};
+		for (uint32_t i = 0; i < 4; i++)
+			bindingData[i].binding = i;
+
+		bindingData[0].s_View = **depth_view;
+		bindingData[0].s_Sampler = sampler;
+		bindingData[1].s_View = (colour_view != nullptr) ? **colour_view : **depth_view;
+		bindingData[1].s_Sampler = sampler;
+		bindingData[2].si_View = *_levelViews[0];
+		bindingData[3].u_Buffer = shadow_data;
+		_sets.push_back(new DescriptorSet(environment, _layout, 4, bindingData));
+
+		for (uint32_t i = 1; i < _levels; i++)
+		{
+			bindingData[0].s_View = *_levelViews[i - 1];
+			bindingData[1].s_View = *_levelViews[i - 1];
+			bindingData[2].si_View = *_levelViews[i];
+			_sets.push_back(new DescriptorSet(environment, _layout, 4, bindingData));
+		}
+
+		std::vector<const VkDescriptorSetLayout*> layouts = { &**_layout };
+		PipelineFeatures pipelineData = Pipeline_Default;
+		pipelineData.specialMode = (colour_view != nullptr) ? SpecialMode::SHADOW_PYRAMID_BASE_COLOUR : SpecialMode::SHADOW_PYRAMID_BASE;
+		_basePipeline = new Pipeline(environment, pipelineData, nullptr, layouts);
+
+		pipelineData.specialMode = SpecialMode::SHADOW_PYRAMID_DOWNSAMPLE;
+		_downsamplePipeline = new Pipeline(environment, pipelineData, nullptr, layouts);
+	}
+
+	ShadowDepthPyramid::~ShadowDepthPyramid()
+	{
+		delete _downsamplePipeline;
+		delete _basePipeline;
+		for (DescriptorSet* set : _sets)
+			delete set;
+		delete _layout;
+	}
+
+	/* private member functions */
+
+	void ShadowDepthPyramid::createPyramid(const Environment* environment)
+	{
+		/* full precision depths, the early out must never disagree with the PCF taps */
+		const VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = _baseSize;
+		imageInfo.extent.height = _baseSize;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = _levels;
+		imageInfo.arrayLayers = _layers;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		VkImage image = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if (const auto& res = vmaCreateImage(environment->Allocator().allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
+		{
+			throw lut::Error("VK: vmaCreateImage() failed while creating the shadow depth pyramid. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_pyramid = lut::Image(environment->Allocator().allocator, image, allocation);
+
+		for (uint32_t i = 0; i <= _levels; i++)
+		{
+			/* the last view covers every level */
+			bool whole = (i == _levels);
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = *_pyramid;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+			viewInfo.format = format;
+			viewInfo.components = VkComponentMapping{};
+			viewInfo.subresourceRange = VkImageSubresourceRange
+			{
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				(whole) ? 0 : i, (whole) ? _levels : 1,
+				0, _layers
+			};
+
+			VkImageView view = VK_NULL_HANDLE;
+			if (const auto& res = vkCreateImageView(environment->Window().device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
+			{
+				throw lut::Error("VK: vkCreateImageView() failed to create a shadow depth pyramid view. err: %s",
+					lut::to_string(res).c_str());
+			}
+
+			if (whole)
+				_view = lut::ImageView(environment->Window().device, view);
+			else
+				_levelViews.emplace_back(environment->Window().device, view);
+		}
+	}
+
+	/* public member functions */
+
+	void ShadowDepthPyramid::CmdBuild(Environment* environment)
+	{
+		VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+
+		/* BARRIER: shadow pass writes -> compute read, the maps are already in their read layout */
+		VkMemoryBarrier renderedBarrier{};
+		renderedBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		renderedBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		renderedBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(cmdBuffer,
+			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &renderedBarrier, 0, nullptr, 0, nullptr);
+
+		/* BARRIER: last lookup's reads -> compute write, the old contents aren't needed */
+		lut::image_barrier(cmdBuffer, *_pyramid,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, _levels, 0, _layers });
+
+		uint32_t size = _baseSize;
+		for (uint32_t i = 0; i < _levels; i++)
+		{
+			/* the base pass is a workgroup per texel (a cell of the shadow map), later passes a thread per texel */
+			Pipeline* pipeline = (i == 0) ? _basePipeline : _downsamplePipeline;
+			uint32_t groups = (i == 0) ? size : (size + GROUP_SIZE - 1) / GROUP_SIZE;
+
+			pipeline->CmdBind(environment);
+			_sets[i]->CmdBind(environment, pipeline, 0);
+			vkCmdDispatch(cmdBuffer, groups, groups, _layers);
+
+			/* BARRIER: compute write -> next level's read and the lookup */
+			lut::image_barrier(cmdBuffer, *_pyramid,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, _layers });
+
+			size = std::max(size / 2, 1u);
+		}
+	}
+
+	/* getters */
+
+	const lut::ImageView& ShadowDepthPyramid::View() const
+	{
+		return _view;
+	}
+	uint32_t ShadowDepthPyramid::Levels() const
+	{
+		return _levels;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+/* c++ */
+#include <vector>
+
+/* renderer */
+#include "Constants.hpp"
+#include "DescriptorSet.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "Pipeline.hpp"
+
+/* labutils */
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+
+namespace Renderer
+{
+	class Environment;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* min/max depth pyramid over a cascaded shadow map, so the lookup can skip PCF wherever the whole kernel is
+		in front of or behind every occluder. r: min depth, g: max depth, b: min CSSM colour depth (1 without one) */
+	class ShadowDepthPyramid
+	{
+		public:
+			/* constructors, etc. */
+
+			ShadowDepthPyramid(const Environment* environment, uint32_t resolution, uint32_t layers,
+				const lut::ImageView* depth_view, const lut::ImageView* colour_view,
+				VkSampler sampler, VkBuffer shadow_data);
+			~ShadowDepthPyramid();
+
+			ShadowDepthPyramid(const ShadowDepthPyramid&) = delete;
+			ShadowDepthPyramid& operator=(const ShadowDepthPyramid&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr uint32_t GROUP_SIZE = 8; /* local_size_x/y in shadowPyramid.comp */
+
+			uint32_t _layers = 1;
+			uint32_t _baseSize = 1;
+			uint32_t _levels = 1;
+
+			lut::Image _pyramid{};
+			std::vector<lut::ImageView> _levelViews{}; /* one mip each, written by one pass and read by the next */
+			lut::ImageView _view{}; /* every mip, for the lookup */
+
+			DescriptorSetLayout* _layout = nullptr;
+			std::vector<DescriptorSet*> _sets{}; /* [0]: shadow map -> base level, [i]: level i - 1 -> level i */
+			Pipeline* _basePipeline = nullptr;
+			Pipeline* _downsamplePipeline = nullptr;
+
+			/* private member functions */
+
+			void createPyramid(const Environment* environment);
+
+		public:
+			/* public member functions */
+
+			void CmdBuild(Environment* environment);
+
+			/* getters */
+
+			const lut::ImageView& View() const;
+			uint32_t Levels() const;
+	};
+}
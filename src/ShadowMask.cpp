@@ -0,0 +1,506 @@
+#include "ShadowMask.hpp"
+
+/* c++ */
+#include <algorithm>
+#include <vector>
+
+/* renderer */
+#include "CreationUtilities.hpp" // <- CreateDefaultSampler()
+#include "Environment.hpp" // <- class Environment
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/vkutil.hpp"
+
+namespace Renderer
+{
+	/* constructors, etc. */
+
+	ShadowMask::ShadowMask(const Environment* environment, uint32_t width, uint32_t height, ShadowMaskSource source,
+		const lut::ImageView* camera_depth, VkBuffer camera_data, VkBuffer shadow_data,
+		const lut::ImageView* depth_map, const lut::ImageView* colour_map, const lut::ImageView* tint_map,
+		VkSampler sampler, bool temporal, bool denoise)
+	{
+		_width = width;
+		_height = height;
+		_temporal = temporal;
+		_denoise = denoise;
+
+		/* rgb transmittance, 8 bits is plenty for a value the lighting only multiplies by */
+		_mask = createImage(environment, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+		_view = createView(environment, *_mask, VK_FORMAT_R8G8B8A8_UNORM);
+
+		if (_temporal || _denoise)
+		{
+			_current = createImage(environment, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+			_currentView = createView(environment, *_current, VK_FORMAT_R8G8B8A8_UNORM);
+		}
+
+		if (_denoise)
+		{
+			/* the view depth needs more than 8 bits, and the normal keeps its sign */
+			_guide = createImage(environment, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+			_guideView = createView(environment, *_guide, VK_FORMAT_R16G16B16A16_SFLOAT);
+			_filtered = createImage(environment, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+			_filteredView = createView(environment, *_filtered, VK_FORMAT_R8G8B8A8_UNORM);
+		}
+
+		if (_temporal)
+		{
+			/* the history is blended with small weights, which 8 bits would round away */
+			for (uint32_t i = 0; i < 2; i++)
+			{
+				_history[i] = createImage(environment, VK_FORMAT_R16G16B16A16_SFLOAT,
+					VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+				_historyViews[i] = createView(environment, *_history[i], VK_FORMAT_R16G16B16A16_SFLOAT);
+			}
+
+			/* the reprojected position is between pixels */
+			_historySampler = CreateDefaultSampler(environment->Window(), VK_FILTER_LINEAR, VK_FILTER_LINEAR, false);
+		}
+
+		/* camera depth and data, the technique's shadow maps, and the mask, in the shader's order */
+		DescriptorSetLayoutFeatures layoutData{};
+		layoutData.stages = ShaderStageConstants::COMPUTE_STAGE;
+		layoutData.bindingCount = 7;
+		DescriptorSetType layoutTypes[7]
+		{
+			DescriptorSetType::SAMPLER, /* camera depth pre-pass */
+			DescriptorSetType::UNIFORM_BUFFER, /* camera data */
+			DescriptorSetType::UNIFORM_BUFFER, /* shadow data */
+			DescriptorSetType::SAMPLER, /* opaque shadow depth */
+			DescriptorSetType::SAMPLER, /* CSSM colour depths or TS translucent depth */
+			DescriptorSetType::SAMPLER, /* TS translucent colour */
+			DescriptorSetType::STORAGE_IMAGE /* mask */
+		};
+		layoutData.pBindingTypes = layoutTypes;
+		_layout = new DescriptorSetLayout(environment, layoutData);
+
+		DescriptorSetFeatures bindingData[7]{};
+		for (uint32_t i = 0; i < 7; i++)
+			bindingData[i].binding = i;
+
+		bindingData[0].s_View = **camera_depth;
+		bindingData[0].s_Sampler = sampler;
+		bindingData[1].u_Buffer = camera_data;
+		bindingData[2].u_Buffer = shadow_data;
+		bindingData[3].s_View = **depth_map;
+		bindingData[3].s_Sampler = sampler;
+		bindingData[4].s_View = **colour_map;
+		bindingData[4].s_Sampler = sampler;
+		bindingData[5].s_View = **tint_map;
+		bindingData[5].s_Sampler = sampler;
+		bindingData[6].si_View = (_temporal || _denoise) ? *_currentView : *_view;
+		_set = new DescriptorSet(environment, _layout, 7, bindingData);
+
+		std::vector<const VkDescriptorSetLayout*> layouts = { &**_layout };
+		PipelineFeatures pipelineData = Pipeline_Default;
+		pipelineData.specialMode = (source == ShadowMaskSource::STOCHASTIC) ? SpecialMode::SHADOW_MASK_SSM :
+			(source == ShadowMaskSource::COLOURED_STOCHASTIC) ? SpecialMode::SHADOW_MASK_CSSM : SpecialMode::SHADOW_MASK_TS;
+		_pipeline = new Pipeline(environment, pipelineData, nullptr, layouts);
+
+		if (_denoise)
+		{
+			/* camera depth and data, shadow data, the pass's input, the guide, and the outputs, in the shader's order.
+				every pass binds all of them, each only touches its own */
+			DescriptorSetLayoutFeatures denoiseLayoutData{};
+			denoiseLayoutData.stages = ShaderStageConstants::COMPUTE_STAGE;
+			denoiseLayoutData.bindingCount = 7;
+			DescriptorSetType denoiseLayoutTypes[7]
+			{
+				DescriptorSetType::SAMPLER, /* camera depth pre-pass */
+				DescriptorSetType::UNIFORM_BUFFER, /* camera data */
+				DescriptorSetType::UNIFORM_BUFFER, /* shadow data */
+				DescriptorSetType::SAMPLER, /* input mask */
+				DescriptorSetType::SAMPLER, /* guide */
+				DescriptorSetType::STORAGE_IMAGE, /* output mask */
+				DescriptorSetType::STORAGE_IMAGE /* guide output */
+			};
+			denoiseLayoutData.pBindingTypes = denoiseLayoutTypes;
+			_denoiseLayout = new DescriptorSetLayout(environment, denoiseLayoutData);
+
+			/* horizontal: this frame's mask -> filtered, vertical: filtered -> this frame's mask again when it's accumulated,
+				otherwise straight into the mask the lighting reads */
+			const VkImageView inputs[3] = { *_currentView, *_currentView, *_filteredView };
+			const VkImageView outputs[3] = { *_filteredView, *_filteredView, (_temporal) ? *_currentView : *_view };
+			const SpecialMode modes[3] = { SpecialMode::SHADOW_MASK_GUIDE, SpecialMode::SHADOW_MASK_DENOISE_HORIZONTAL,
+				SpecialMode::SHADOW_MASK_DENOISE_VERTICAL };
+
+			std::vector<const VkDescriptorSetLayout*> denoiseLayouts = { &**_denoiseLayout };
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				DescriptorSetFeatures denoiseData[7]{};
+				for (uint32_t b = 0; b < 7; b++)
+					denoiseData[b].binding = b;
+
+				denoiseData[0].s_View = **camera_depth;
+				denoiseData[0].s_Sampler = sampler;
+				denoiseData[1].u_Buffer = camera_data;
+				denoiseData[2].u_Buffer = shadow_data;
+				denoiseData[3].s_View = inputs[i];
+				denoiseData[3].s_Sampler = sampler;
+				denoiseData[4].s_View = *_guideView;
+				denoiseData[4].s_Sampler = sampler;
+				denoiseData[5].si_View = outputs[i];
+				denoiseData[6].si_View = *_guideView;
+				_denoiseSets[i] = new DescriptorSet(environment, _denoiseLayout, 7, denoiseData);
+
+				PipelineFeatures denoisePipelineData = Pipeline_Default;
+				denoisePipelineData.specialMode = modes[i];
+				_denoisePipelines[i] = new Pipeline(environment, denoisePipelineData, nullptr, denoiseLayouts);
+			}
+		}
+
+		if (_temporal == false)
+			return;
+
+		/* camera depth and data, this frame's mask, the history read and the two outputs, in the shader's order */
+		DescriptorSetLayoutFeatures temporalLayoutData{};
+		temporalLayoutData.stages = ShaderStageConstants::COMPUTE_STAGE;
+		temporalLayoutData.bindingCount = 6;
+		DescriptorSetType temporalLayoutTypes[6]
+		{
+			DescriptorSetType::SAMPLER, /* camera depth pre-pass */
+			DescriptorSetType::UNIFORM_BUFFER, /* camera data */
+			DescriptorSetType::SAMPLER, /* this frame's mask */
+			DescriptorSetType::SAMPLER, /* last frame's history */
+			DescriptorSetType::STORAGE_IMAGE, /* mask */
+			DescriptorSetType::STORAGE_IMAGE /* this frame's history */
+		};
+		temporalLayoutData.pBindingTypes = temporalLayoutTypes;
+		_temporalLayout = new DescriptorSetLayout(environment, temporalLayoutData);
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			DescriptorSetFeatures temporalData[6]{};
+			for (uint32_t b = 0; b < 6; b++)
+				temporalData[b].binding = b;
+
+			temporalData[0].s_View = **camera_depth;
+			temporalData[0].s_Sampler = sampler;
+			temporalData[1].u_Buffer = camera_data;
+			temporalData[2].s_View = *_currentView;
+			temporalData[2].s_Sampler = sampler;
+			temporalData[3].s_View = *_historyViews[1 - i];
+			temporalData[3].s_Sampler = *_historySampler;
+			temporalData[4].si_View = *_view;
+			temporalData[5].si_View = *_historyViews[i];
+			_temporalSets[i] = new DescriptorSet(environment, _temporalLayout, 6, temporalData);
+		}
+
+		std::vector<const VkDescriptorSetLayout*> temporalLayouts = { &**_temporalLayout };
+		PipelineFeatures temporalPipelineData = Pipeline_Default;
+		temporalPipelineData.specialMode = SpecialMode::SHADOW_MASK_TEMPORAL;
+		_temporalPipeline = new Pipeline(environment, temporalPipelineData, nullptr, temporalLayouts);
+	}
+
+	ShadowMask::~ShadowMask()
+	{
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			delete _denoisePipelines[i];
+			delete _denoiseSets[i];
+		}
+		delete _denoiseLayout;
+
+		delete _temporalPipeline;
+		delete _temporalSets[0];
+		delete _temporalSets[1];
+		delete _temporalLayout;
+
+		delete _pipeline;
+		delete _set;
+		delete _layout;
+	}
+
+	/* private member functions */
+
+	lut::Image ShadowMask::createImage(const Environment* environment, VkFormat format, VkImageUsageFlags usage)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = _width;
+		imageInfo.extent.height = _height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		VkImage image = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if (const auto& res = vmaCreateImage(environment->Allocator().allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); VK_SUCCESS != res)
+		{
+			throw lut::Error("VK: vmaCreateImage() failed while creating the shadow mask. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		return lut::Image(environment->Allocator().allocator, image, allocation);
+	}
+
+	lut::ImageView ShadowMask::createView(const Environment* environment, VkImage image, VkFormat format)
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.components = VkComponentMapping{};
+		viewInfo.subresourceRange = VkImageSubresourceRange
+		{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, 1,
+			0, 1
+		};
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (const auto& res = vkCreateImageView(environment->Window().device, &viewInfo, nullptr, &view); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkCreateImageView() failed to create the shadow mask view. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		return lut::ImageView(environment->Window().device, view);
+	}
+
+	void ShadowMask::cmdResetHistory(Environment* environment, VkImage image)
+	{
+		VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+		const VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		/* BARRIER: any earlier use -> clear */
+		lut::image_barrier(cmdBuffer, image,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			range);
+
+		/* zero frames accumulated, so the first blend takes this frame's mask as it is */
+		VkClearColorValue clear{};
+		vkCmdClearColorImage(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1, &range);
+
+		/* BARRIER: clear -> the temporal pass's read */
+		lut::image_barrier(cmdBuffer, image,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+	}
+
+	void ShadowMask::cmdDenoise(Environment* environment, uint32_t groups_x, uint32_t groups_y)
+	{
+		VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+		const VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		/* BARRIER: this frame's mask write -> the horizontal pass's read */
+		lut::image_barrier(cmdBuffer, *_current,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+
+		/* BARRIER: last frame's reads -> the guide and horizontal writes, the old contents aren't needed */
+		lut::image_barrier(cmdBuffer, *_guide,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+		lut::image_barrier(cmdBuffer, *_filtered,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+
+		_denoisePipelines[0]->CmdBind(environment);
+		_denoiseSets[0]->CmdBind(environment, _denoisePipelines[0], 0);
+		vkCmdDispatch(cmdBuffer, groups_x, groups_y, 1);
+
+		/* BARRIER: guide write -> both filter passes' reads */
+		lut::image_barrier(cmdBuffer, *_guide,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+
+		_denoisePipelines[1]->CmdBind(environment);
+		_denoiseSets[1]->CmdBind(environment, _denoisePipelines[1], 0);
+		vkCmdDispatch(cmdBuffer, groups_x, groups_y, 1);
+
+		/* BARRIER: horizontal write -> vertical read */
+		lut::image_barrier(cmdBuffer, *_filtered,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+
+		/* BARRIER: the horizontal pass's (or last frame's lighting) reads -> the vertical write, which leaves the image
+			as the mask pass would have, so accumulation or the lighting carries on the same */
+		lut::image_barrier(cmdBuffer, (_temporal) ? *_current : *_mask,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+
+		_denoisePipelines[2]->CmdBind(environment);
+		_denoiseSets[2]->CmdBind(environment, _denoisePipelines[2], 0);
+		vkCmdDispatch(cmdBuffer, groups_x, groups_y, 1);
+	}
+
+	/* public member functions */
+
+	void ShadowMask::CmdBuild(Environment* environment, VkExtent2D extent)
+	{
+		VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+
+		/* BARRIER: depth pre-pass and shadow pass writes -> compute read, the maps are already in their read layout */
+		VkMemoryBarrier renderedBarrier{};
+		renderedBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		renderedBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		renderedBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(cmdBuffer,
+			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &renderedBarrier, 0, nullptr, 0, nullptr);
+
+		/* a thread per pixel of the rendered region, never more than was allocated */
+		uint32_t width = std::min(extent.width, _width);
+		uint32_t height = std::min(extent.height, _height);
+		uint32_t groupsX = (width + GROUP_SIZE - 1) / GROUP_SIZE;
+		uint32_t groupsY = (height + GROUP_SIZE - 1) / GROUP_SIZE;
+
+		const VkImageSubresourceRange maskRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkImage target = (_temporal || _denoise) ? *_current : *_mask;
+
+		/* BARRIER: last frame's reads -> compute write, the old contents aren't needed */
+		lut::image_barrier(cmdBuffer, target,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			maskRange);
+
+		_pipeline->CmdBind(environment);
+		_set->CmdBind(environment, _pipeline, 0);
+		vkCmdDispatch(cmdBuffer, groupsX, groupsY, 1);
+
+		if (_denoise)
+			cmdDenoise(environment, groupsX, groupsY);
+
+		if (_temporal)
+		{
+			/* BARRIER: this frame's mask write -> the temporal pass's read */
+			lut::image_barrier(cmdBuffer, *_current,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				maskRange);
+
+			/* a different rendered size maps the history's pixels somewhere else */
+			if (width != _historyExtent.width || height != _historyExtent.height)
+				_historyValid = false;
+
+			if (_historyValid == false)
+			{
+				cmdResetHistory(environment, *_history[1 - _drawHistory]);
+				_historyExtent = { width, height };
+				_historyValid = true;
+			}
+
+			/* BARRIER: last frame's reads -> the temporal pass's writes */
+			lut::image_barrier(cmdBuffer, *_mask,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				maskRange);
+			lut::image_barrier(cmdBuffer, *_history[_drawHistory],
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				maskRange);
+
+			_temporalPipeline->CmdBind(environment);
+			_temporalSets[_drawHistory]->CmdBind(environment, _temporalPipeline, 0);
+			vkCmdDispatch(cmdBuffer, groupsX, groupsY, 1);
+
+			/* BARRIER: this frame's history write -> next frame's temporal read */
+			lut::image_barrier(cmdBuffer, *_history[_drawHistory],
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				maskRange);
+
+			_drawHistory = 1 - _drawHistory;
+		}
+
+		/* BARRIER: compute write -> the opaque lighting's fetch */
+		lut::image_barrier(cmdBuffer, *_mask,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			maskRange);
+	}
+
+	void ShadowMask::ResetHistory()
+	{
+		_historyValid = false;
+	}
+
+	/* getters */
+
+	const lut::ImageView& ShadowMask::View() const
+	{
+		return _view;
+	}
+}
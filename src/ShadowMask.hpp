@@ -0,0 +1,110 @@
+#pragma once
+
+/* renderer */
+#include "DescriptorSet.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "Pipeline.hpp"
+
+/* labutils */
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+
+namespace Renderer
+{
+	class Environment;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* the shadow lookup the mask reproduces, the compute shader's technique specialisation constant */
+	enum class ShadowMaskSource
+	{
+		STOCHASTIC = 0, /* SSM */
+		COLOURED_STOCHASTIC, /* CSSM */
+		TRANSLUCENT /* TRANSLUCENT_SHADOWS */
+	};
+
+	/* screen-space shadow mask: the directional shadow is evaluated once per pixel of an opaque depth pre-pass,
+		in compute, so opaque lighting is a single fetch and overdraw never repeats the PCF kernel.
+		the mask is allocated at the largest size the pre-pass can be and filled in its top left corner.
+		temporal: each frame's (small kernel, fresh noise) result is blended into a reprojected history,
+		which is double buffered the same way as the environment's intermediate images.
+		denoise: the (small kernel) mask goes through a separable, depth and normal aware bilateral filter before
+		it's used or accumulated, its radius is the shadow data's samplingInfo.z so it can change every frame */
+	class ShadowMask
+	{
+		public:
+			/* constructors, etc. */
+
+			/* colour_map: CSSM colour depths or the TS nearest translucent depth, tint_map: the TS translucent colour.
+				unused maps can be any valid view, they're never read */
+			ShadowMask(const Environment* environment, uint32_t width, uint32_t height, ShadowMaskSource source,
+				const lut::ImageView* camera_depth, VkBuffer camera_data, VkBuffer shadow_data,
+				const lut::ImageView* depth_map, const lut::ImageView* colour_map, const lut::ImageView* tint_map,
+				VkSampler sampler, bool temporal = false, bool denoise = false);
+			~ShadowMask();
+
+			ShadowMask(const ShadowMask&) = delete;
+			ShadowMask& operator=(const ShadowMask&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr uint32_t GROUP_SIZE = 8; /* local_size_x/y in shadowMask.comp */
+
+			uint32_t _width = 0;
+			uint32_t _height = 0;
+
+			lut::Image _mask{};
+			lut::ImageView _view{};
+
+			DescriptorSetLayout* _layout = nullptr;
+			DescriptorSet* _set = nullptr;
+			Pipeline* _pipeline = nullptr;
+
+			/* temporal accumulation */
+			bool _temporal = false;
+			lut::Image _current{}; /* this frame's mask, before denoising and accumulation */
+			lut::ImageView _currentView{};
+			lut::Image _history[2]{};
+			lut::ImageView _historyViews[2]{};
+			uint32_t _drawHistory = 0; /* written this frame, the other one is read */
+			bool _historyValid = false;
+			VkExtent2D _historyExtent{ 0, 0 };
+			lut::Sampler _historySampler{};
+
+			DescriptorSetLayout* _temporalLayout = nullptr;
+			DescriptorSet* _temporalSets[2]{}; /* [i] writes _history[i] */
+			Pipeline* _temporalPipeline = nullptr;
+
+			/* denoising */
+			bool _denoise = false;
+			lut::Image _guide{}; /* normal and linear view depth, so each tap isn't reconstructed twice */
+			lut::ImageView _guideView{};
+			lut::Image _filtered{}; /* the horizontal pass's output */
+			lut::ImageView _filteredView{};
+
+			DescriptorSetLayout* _denoiseLayout = nullptr;
+			DescriptorSet* _denoiseSets[3]{}; /* guide, horizontal, vertical */
+			Pipeline* _denoisePipelines[3]{};
+
+			/* private member functions */
+
+			lut::Image createImage(const Environment* environment, VkFormat format, VkImageUsageFlags usage);
+			lut::ImageView createView(const Environment* environment, VkImage image, VkFormat format);
+			void cmdResetHistory(Environment* environment, VkImage image);
+			void cmdDenoise(Environment* environment, uint32_t groups_x, uint32_t groups_y);
+
+		public:
+			/* public member functions */
+
+			void CmdBuild(Environment* environment, VkExtent2D extent);
+			void ResetHistory();
+
+			/* getters */
+
+			const lut::ImageView& View() const;
+	};
+}
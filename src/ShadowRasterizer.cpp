@@ -0,0 +1,410 @@
+#include "ShadowRasterizer.hpp"
+
+/* c */
+#include <cstring>
+
+/* c++ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+/* renderer */
+#include "Environment.hpp" // <- class Environment
+#include "Model.hpp" // <- class Model
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/vkutil.hpp"
+
+/* simd */
+#include <immintrin.h>
+
+namespace Renderer
+{
+	/* the widest float vector the build targets (MSVC defines __AVX__ under /arch:AVX and /arch:AVX2, SSE2 is the x64 baseline) */
+	#if defined(__AVX__)
+		typedef __m256 Lanes;
+		static constexpr int32_t LANE_COUNT = 8;
+
+		static inline Lanes LanesSet(float value) { return _mm256_set1_ps(value); }
+		static inline Lanes LanesRamp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+		static inline Lanes LanesAdd(Lanes left, Lanes right) { return _mm256_add_ps(left, right); }
+		static inline Lanes LanesMul(Lanes left, Lanes right) { return _mm256_mul_ps(left, right); }
+		static inline Lanes LanesAnd(Lanes left, Lanes right) { return _mm256_and_ps(left, right); }
+		static inline Lanes LanesGreaterEqual(Lanes left, Lanes right) { return _mm256_cmp_ps(left, right, _CMP_GE_OQ); }
+		static inline Lanes LanesLessEqual(Lanes left, Lanes right) { return _mm256_cmp_ps(left, right, _CMP_LE_OQ); }
+		static inline Lanes LanesSelect(Lanes mask, Lanes chosen, Lanes other) { return _mm256_blendv_ps(other, chosen, mask); }
+		static inline int LanesAny(Lanes mask) { return _mm256_movemask_ps(mask); }
+		static inline Lanes LanesLoad(const float* data) { return _mm256_loadu_ps(data); }
+		static inline void LanesStore(float* data, Lanes value) { _mm256_storeu_ps(data, value); }
+	#else
+		typedef __m128 Lanes;
+		static constexpr int32_t LANE_COUNT = 4;
+
+		static inline Lanes LanesSet(float value) { return _mm_set1_ps(value); }
+		static inline Lanes LanesRamp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+		static inline Lanes LanesAdd(Lanes left, Lanes right) { return _mm_add_ps(left, right); }
+		static inline Lanes LanesMul(Lanes left, Lanes right) { return _mm_mul_ps(left, right); }
+		static inline Lanes LanesAnd(Lanes left, Lanes right) { return _mm_and_ps(left, right); }
+		static inline Lanes LanesGreaterEqual(Lanes left, Lanes right) { return _mm_cmpge_ps(left, right); }
+		static inline Lanes LanesLessEqual(Lanes left, Lanes right) { return _mm_cmple_ps(left, right); }
+		static inline Lanes LanesSelect(Lanes mask, Lanes chosen, Lanes other) { return _mm_or_ps(_mm_and_ps(mask, chosen), _mm_andnot_ps(mask, other)); }
+		static inline int LanesAny(Lanes mask) { return _mm_movemask_ps(mask); }
+		static inline Lanes LanesLoad(const float* data) { return _mm_loadu_ps(data); }
+		static inline void LanesStore(float* data, Lanes value) { _mm_storeu_ps(data, value); }
+	#endif
+
+	/* constructors, etc. */
+
+	ShadowRasterizer::ShadowRasterizer(const Environment* environment, const Model* model, DepthFormat format, uint32_t thread_count)
+	{
+		_allocator = environment->Allocator().allocator;
+		_format = format;
+		_texelSize = (format == DepthFormat::D16_UNORM) ? 2 : 4;
+
+		/* the casters are static, so their triangles are gathered once */
+		model->OpaqueGeometry(&_positions, &_indices);
+
+		/* the mapped buffer is written while the frames using the other swap images may still be copying from theirs */
+		VkDeviceSize stagingSize = static_cast<VkDeviceSize>(SHADOW_MAP_RESOLUTION) * SHADOW_MAP_RESOLUTION * SHADOW_CASCADE_COUNT * _texelSize;
+		for (size_t i = 0; i < environment->Window().swapImages.size(); i++)
+		{
+			_stagingBuffers.push_back(lut::create_buffer(environment->Allocator(), stagingSize,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY));
+
+			void* dataPtr = nullptr;
+			if (const auto& res = vmaMapMemory(_allocator, _stagingBuffers.back().allocation, &dataPtr); res != VK_SUCCESS)
+			{
+				throw lut::Error("VK: vmaMapMemory() failed to map a shadow rasterizer staging buffer. err: %s",
+					lut::to_string(res).c_str());
+			}
+
+			_stagingData.push_back(static_cast<unsigned char*>(dataPtr));
+		}
+
+		/* the calling thread works too */
+		if (thread_count == 0)
+			thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (uint32_t i = 1; i < thread_count; i++)
+			_workers.emplace_back(&ShadowRasterizer::workerLoop, this);
+	}
+
+	ShadowRasterizer::~ShadowRasterizer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_wake.notify_all();
+
+		for (std::thread& worker : _workers)
+			worker.join();
+
+		for (size_t i = 0; i < _stagingBuffers.size(); i++)
+			vmaUnmapMemory(_allocator, _stagingBuffers[i].allocation);
+	}
+
+	/* private member functions */
+
+	void ShadowRasterizer::workerLoop()
+	{
+		uint64_t seen = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wake.wait(lock, [&] { return _quit || _generation != seen; });
+
+				if (_quit)
+					return;
+
+				seen = _generation;
+			}
+
+			runJobs();
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (--_active == 0)
+					_done.notify_one();
+			}
+		}
+	}
+
+	void ShadowRasterizer::runJobs()
+	{
+		for (uint32_t i = _nextJob.fetch_add(1); i < _jobCount; i = _nextJob.fetch_add(1))
+			(this->*_job)(i);
+	}
+
+	void ShadowRasterizer::parallelFor(uint32_t count, Job job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_job = job;
+			_jobCount = count;
+			_nextJob = 0;
+			_active = static_cast<uint32_t>(_workers.size());
+			_generation++;
+		}
+		_wake.notify_all();
+
+		runJobs();
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_done.wait(lock, [&] { return _active == 0; });
+	}
+
+	void ShadowRasterizer::setupLayer(uint32_t layer)
+	{
+		std::vector<Triangle>& triangles = _triangles[layer];
+		std::vector<std::vector<uint32_t>>& bins = _bins[layer];
+
+		/* keeps the bins' capacity from the last time */
+		triangles.clear();
+		bins.resize(static_cast<size_t>(_tilesPerSide) * _tilesPerSide);
+		for (std::vector<uint32_t>& bin : bins)
+			bin.clear();
+
+		const glm::mat4& projView = _projViews[layer];
+		const float size = static_cast<float>(_resolution);
+		const int32_t last = static_cast<int32_t>(_resolution) - 1;
+
+		for (size_t i = 0; i + 2 < _indices.size(); i += 3)
+		{
+			/* to texels, the viewport the shadow pass sets */
+			glm::vec3 screen[3];
+			bool behind = false;
+			for (uint32_t v = 0; v < 3; v++)
+			{
+				glm::vec4 clip = projView * glm::vec4(_positions[_indices[i + v]], 1.0f);
+
+				/* the cascades are orthographic, so there's no near plane clipping */
+				if (clip.w <= 0.0f)
+				{
+					behind = true;
+					break;
+				}
+
+				glm::vec3 ndc = glm::vec3(clip) / clip.w;
+				screen[v] = glm::vec3((ndc.x * 0.5f + 0.5f) * size, (ndc.y * 0.5f + 0.5f) * size, ndc.z);
+			}
+
+			if (behind)
+				continue;
+			if ((screen[0].z < 0.0f && screen[1].z < 0.0f && screen[2].z < 0.0f) ||
+				(screen[0].z > 1.0f && screen[1].z > 1.0f && screen[2].z > 1.0f))
+				continue;
+
+			/* no culling, both windings are made counter clockwise */
+			float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+			if (area == 0.0f)
+				continue;
+			if (area < 0.0f)
+			{
+				std::swap(screen[1], screen[2]);
+				area = -area;
+			}
+
+			/* the texels whose centres can be covered */
+			Triangle triangle;
+			triangle.minX = std::max(static_cast<int32_t>(std::ceil(std::min({ screen[0].x, screen[1].x, screen[2].x }) - 0.5f)), 0);
+			triangle.minY = std::max(static_cast<int32_t>(std::ceil(std::min({ screen[0].y, screen[1].y, screen[2].y }) - 0.5f)), 0);
+			triangle.maxX = std::min(static_cast<int32_t>(std::floor(std::max({ screen[0].x, screen[1].x, screen[2].x }) - 0.5f)), last);
+			triangle.maxY = std::min(static_cast<int32_t>(std::floor(std::max({ screen[0].y, screen[1].y, screen[2].y }) - 0.5f)), last);
+
+			if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+				continue;
+
+			/* edge e runs from vertex e to the next, positive on the inside */
+			for (uint32_t e = 0; e < 3; e++)
+			{
+				const glm::vec3& from = screen[e];
+				const glm::vec3& to = screen[(e + 1) % 3];
+
+				triangle.a[e] = from.y - to.y;
+				triangle.b[e] = to.x - from.x;
+				triangle.c[e] = -(triangle.a[e] * from.x + triangle.b[e] * from.y);
+			}
+
+			/* each vertex's barycentric weight is the edge opposite it over the area */
+			float inverseArea = 1.0f / area;
+			triangle.depth[0] = (triangle.a[1] * screen[0].z + triangle.a[2] * screen[1].z + triangle.a[0] * screen[2].z) * inverseArea;
+			triangle.depth[1] = (triangle.b[1] * screen[0].z + triangle.b[2] * screen[1].z + triangle.b[0] * screen[2].z) * inverseArea;
+			triangle.depth[2] = (triangle.c[1] * screen[0].z + triangle.c[2] * screen[1].z + triangle.c[0] * screen[2].z) * inverseArea;
+
+			uint32_t index = static_cast<uint32_t>(triangles.size());
+			triangles.push_back(triangle);
+
+			for (int32_t y = triangle.minY / static_cast<int32_t>(TILE_SIZE); y <= triangle.maxY / static_cast<int32_t>(TILE_SIZE); y++)
+			{
+				for (int32_t x = triangle.minX / static_cast<int32_t>(TILE_SIZE); x <= triangle.maxX / static_cast<int32_t>(TILE_SIZE); x++)
+					bins[y * _tilesPerSide + x].push_back(index);
+			}
+		}
+	}
+
+	void ShadowRasterizer::rasterizeTile(uint32_t job)
+	{
+		uint32_t tilesPerLayer = _tilesPerSide * _tilesPerSide;
+		uint32_t layer = job / tilesPerLayer;
+		uint32_t tile = job % tilesPerLayer;
+		int32_t tileX = static_cast<int32_t>((tile % _tilesPerSide) * TILE_SIZE);
+		int32_t tileY = static_cast<int32_t>((tile / _tilesPerSide) * TILE_SIZE);
+
+		/* cleared to the far plane, like the shadow pass */
+		alignas(32) float depth[TILE_SIZE * TILE_SIZE];
+		std::fill(depth, depth + TILE_SIZE * TILE_SIZE, 1.0f);
+
+		const Lanes centres = LanesAdd(LanesRamp(), LanesSet(0.5f));
+		const Lanes zero = LanesSet(0.0f);
+
+		for (uint32_t index : _bins[layer][tile])
+		{
+			const Triangle& triangle = _triangles[layer][index];
+
+			/* x starts on a multiple of the lane count, so a step never leaves the tile's row */
+			int32_t x0 = std::max(triangle.minX, tileX);
+			x0 = tileX + ((x0 - tileX) & ~(LANE_COUNT - 1));
+			int32_t x1 = std::min(triangle.maxX, tileX + static_cast<int32_t>(TILE_SIZE) - 1);
+			int32_t y0 = std::max(triangle.minY, tileY);
+			int32_t y1 = std::min(triangle.maxY, tileY + static_cast<int32_t>(TILE_SIZE) - 1);
+
+			const Lanes startX = LanesAdd(LanesSet(static_cast<float>(x0)), centres);
+			Lanes a[3], steps[3];
+			for (uint32_t e = 0; e < 3; e++)
+			{
+				a[e] = LanesSet(triangle.a[e]);
+				steps[e] = LanesSet(triangle.a[e] * LANE_COUNT);
+			}
+			const Lanes depthA = LanesSet(triangle.depth[0]);
+			const Lanes depthStep = LanesSet(triangle.depth[0] * LANE_COUNT);
+
+			for (int32_t y = y0; y <= y1; y++)
+			{
+				float centreY = static_cast<float>(y) + 0.5f;
+
+				Lanes edges[3];
+				for (uint32_t e = 0; e < 3; e++)
+					edges[e] = LanesAdd(LanesMul(a[e], startX), LanesSet(triangle.b[e] * centreY + triangle.c[e]));
+				Lanes z = LanesAdd(LanesMul(depthA, startX), LanesSet(triangle.depth[1] * centreY + triangle.depth[2]));
+
+				float* row = depth + (y - tileY) * TILE_SIZE;
+				for (int32_t x = x0; x <= x1; x += LANE_COUNT)
+				{
+					/* LEQUAL against the stored depth also clips anything past the far plane */
+					Lanes inside = LanesAnd(LanesGreaterEqual(edges[0], zero), LanesGreaterEqual(edges[1], zero));
+					inside = LanesAnd(inside, LanesGreaterEqual(edges[2], zero));
+					inside = LanesAnd(inside, LanesGreaterEqual(z, zero));
+
+					if (LanesAny(inside) != 0)
+					{
+						float* texels = row + (x - tileX);
+						Lanes stored = LanesLoad(texels);
+						LanesStore(texels, LanesSelect(LanesAnd(inside, LanesLessEqual(z, stored)), z, stored));
+					}
+
+					for (uint32_t e = 0; e < 3; e++)
+						edges[e] = LanesAdd(edges[e], steps[e]);
+					z = LanesAdd(z, depthStep);
+				}
+			}
+		}
+
+		/* into the staging buffer, in the shadow map's format and the layout CmdUpload() copies */
+		uint32_t width = std::min(TILE_SIZE, _resolution - static_cast<uint32_t>(tileX));
+		uint32_t height = std::min(TILE_SIZE, _resolution - static_cast<uint32_t>(tileY));
+		size_t layerTexels = static_cast<size_t>(_resolution) * _resolution;
+
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const float* row = depth + y * TILE_SIZE;
+			size_t offset = layer * layerTexels + (static_cast<size_t>(tileY) + y) * _resolution + tileX;
+
+			if (_format == DepthFormat::D16_UNORM)
+			{
+				uint16_t* texels = reinterpret_cast<uint16_t*>(_target) + offset;
+				for (uint32_t x = 0; x < width; x++)
+					texels[x] = static_cast<uint16_t>(row[x] * 65535.0f + 0.5f);
+			}
+			else
+				std::memcpy(reinterpret_cast<float*>(_target) + offset, row, width * sizeof(float));
+		}
+	}
+
+	/* public member functions */
+
+	void ShadowRasterizer::Rasterize(const Environment* environment, const glm::mat4* proj_views, uint32_t layers, uint32_t resolution)
+	{
+		assert(layers <= SHADOW_CASCADE_COUNT && resolution <= SHADOW_MAP_RESOLUTION);
+
+		_projViews = proj_views;
+		_layers = layers;
+		_resolution = resolution;
+		_tilesPerSide = (resolution + TILE_SIZE - 1) / TILE_SIZE;
+		_target = _stagingData[environment->CurrentSwapImageIndex()];
+
+		/* every cascade's set up and binning, then every tile of every cascade */
+		parallelFor(layers, &ShadowRasterizer::setupLayer);
+		parallelFor(layers * _tilesPerSide * _tilesPerSide, &ShadowRasterizer::rasterizeTile);
+
+		_uploadPending = true;
+	}
+
+	void ShadowRasterizer::CmdUpload(Environment* environment, const lut::Image* shadow_map)
+	{
+		/* the shadow map is expected ready for writing (CmdTransitionForWrite()) and is left that way */
+		if (_uploadPending == false)
+			return;
+
+		_uploadPending = false;
+
+		VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+		const VkImageSubresourceRange range{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, _layers };
+
+		/* BARRIER: last reads -> transfer destination, the old contents aren't needed */
+		lut::image_barrier(cmdBuffer, **shadow_map,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			range);
+
+		/* the cascades follow each other in the buffer, into the rendered top left region of each layer */
+		VkBufferImageCopy copy{};
+		copy.bufferOffset = 0;
+		copy.bufferRowLength = _resolution;
+		copy.bufferImageHeight = _resolution;
+		copy.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, _layers };
+		copy.imageExtent = VkExtent3D{ _resolution, _resolution, 1 };
+
+		vkCmdCopyBufferToImage(cmdBuffer, *_stagingBuffers[environment->CurrentSwapImageIndex()], **shadow_map,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+		/* BARRIER: transfer destination -> depth attachment, as the shadow pass would have left it */
+		lut::image_barrier(cmdBuffer, **shadow_map,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			range);
+	}
+
+	/* getters */
+
+	uint32_t ShadowRasterizer::ThreadCount() const
+	{
+		return static_cast<uint32_t>(_workers.size()) + 1;
+	}
+	uint32_t ShadowRasterizer::TriangleCount() const
+	{
+		return static_cast<uint32_t>(_indices.size() / 3);
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+/* c++ */
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* renderer */
+#include "Constants.hpp"
+#include "RenderPassFeatures.hpp"
+
+/* labutils */
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/vkimage.hpp"
+
+/* volk */
+#include <volk/volk.h>
+
+/* glm */
+#include <glm/glm.hpp>
+
+namespace Renderer
+{
+	class Environment;
+	class Model;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* depth only software rasterizer for the static opaque casters. every cascade's triangles are set up and binned into
+		screen tiles, then a pool of worker threads rasterizes the tiles with SIMD edge functions (8 texels a step with AVX,
+		4 with SSE) and packs them straight into this swap image's staging buffer, which is copied into the opaque shadow map.
+		it matches the shadow pipeline: no culling, no bias, LEQUAL, depth outside [0, 1] clipped */
+	class ShadowRasterizer
+	{
+		public:
+			/* constructors, etc. */
+
+			ShadowRasterizer(const Environment* environment, const Model* model, DepthFormat format, uint32_t thread_count = 0);
+			~ShadowRasterizer();
+
+			ShadowRasterizer(const ShadowRasterizer&) = delete;
+			ShadowRasterizer& operator=(const ShadowRasterizer&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr uint32_t TILE_SIZE = 64; /* texels per tile side, a multiple of every SIMD width */
+
+			/* screen space set up: inside where all three edge functions (a * x + b * y + c) are positive,
+				depth is a plane over the screen */
+			struct Triangle
+			{
+				float a[3]{};
+				float b[3]{};
+				float c[3]{};
+				float depth[3]{}; /* z = depth[0] * x + depth[1] * y + depth[2] */
+				int32_t minX = 0;
+				int32_t minY = 0;
+				int32_t maxX = 0;
+				int32_t maxY = 0;
+			};
+
+			typedef void (ShadowRasterizer::*Job)(uint32_t);
+
+			VmaAllocator _allocator = VK_NULL_HANDLE;
+			DepthFormat _format = DepthFormat::D32_SFLOAT;
+			uint32_t _texelSize = 4;
+
+			std::vector<glm::vec3> _positions{};
+			std::vector<uint32_t> _indices{};
+
+			/* per cascade: set up triangles, and the triangles overlapping each tile */
+			const glm::mat4* _projViews = nullptr;
+			uint32_t _layers = 0;
+			uint32_t _resolution = 0;
+			uint32_t _tilesPerSide = 0;
+			std::vector<Triangle> _triangles[SHADOW_CASCADE_MAX]{};
+			std::vector<std::vector<uint32_t>> _bins[SHADOW_CASCADE_MAX]{};
+
+			/* one staging buffer per swap image, mapped for their lifetime */
+			std::vector<lut::Buffer> _stagingBuffers{};
+			std::vector<unsigned char*> _stagingData{};
+			unsigned char* _target = nullptr;
+			bool _uploadPending = false;
+
+			/* worker threads, woken for each parallelFor() and helped by the calling thread */
+			std::vector<std::thread> _workers{};
+			std::mutex _mutex{};
+			std::condition_variable _wake{};
+			std::condition_variable _done{};
+			uint64_t _generation = 0;
+			uint32_t _active = 0;
+			bool _quit = false;
+			Job _job = nullptr;
+			uint32_t _jobCount = 0;
+			std::atomic<uint32_t> _nextJob{ 0 };
+
+			/* private member functions */
+
+			void workerLoop();
+			void runJobs();
+			void parallelFor(uint32_t count, Job job);
+
+			void setupLayer(uint32_t layer);
+			void rasterizeTile(uint32_t job);
+
+		public:
+			/* public member functions */
+
+			void Rasterize(const Environment* environment, const glm::mat4* proj_views, uint32_t layers, uint32_t resolution);
+			void CmdUpload(Environment* environment, const lut::Image* shadow_map);
+
+			/* getters */
+
+			uint32_t ThreadCount() const;
+			uint32_t TriangleCount() const;
+	};
+}
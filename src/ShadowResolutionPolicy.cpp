@@ -0,0 +1,164 @@
+#include "ShadowResolutionPolicy.hpp"
+
+/* c++ */
+#include <algorithm>
+
+/* renderer */
+#include "Environment.hpp" // <- class Environment
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	/* constructors, etc. */
+
+	ShadowResolutionPolicy::ShadowResolutionPolicy(const Environment* environment, uint32_t max_resolution, float texel_world_size, float budget_ms, uint32_t hold_frames)
+	{
+		_device = environment->Window().device;
+		_timestampPeriod = static_cast<double>(environment->Window().features.timestampPeriod);
+		_texelWorldSize = texel_world_size;
+		_budget = budget_ms;
+		_holdFrames = hold_frames;
+		_framesSinceChange = hold_frames;
+
+		/* quarter steps up to the allocated size */
+		for (uint32_t i = 0; i < SHADOW_RESOLUTION_TIERS; i++)
+			_tiers[i] = (max_resolution * (i + 1)) / SHADOW_RESOLUTION_TIERS;
+
+		uint32_t swapImageCount = static_cast<uint32_t>(environment->Window().swapImages.size());
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryCount = swapImageCount * 2;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+
+		if (auto res = vkCreateQueryPool(_device, &poolInfo, nullptr, &_queryPool); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkCreateQueryPool() failed to create a query pool. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_written.resize(swapImageCount, false);
+	}
+
+	ShadowResolutionPolicy::~ShadowResolutionPolicy()
+	{
+		if (_queryPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(_device, _queryPool, nullptr);
+	}
+
+	/* private member functions */
+
+	uint32_t ShadowResolutionPolicy::qualityTier(const glm::mat4& cascade_proj_view) const
+	{
+		/* the light view is a rotation, so the length of the first row is the orthographic x scale,
+			which gives the width of the first cascade in world units */
+		float scale = glm::length(glm::vec3(cascade_proj_view[0][0], cascade_proj_view[1][0], cascade_proj_view[2][0]));
+		float width = 2.0f / std::max(scale, 0.000001f);
+		float wanted = width / _texelWorldSize;
+
+		/* the smallest tier that still meets the texel density, more than that is wasted */
+		for (uint32_t i = 0; i < SHADOW_RESOLUTION_TIERS; i++)
+		{
+			if (static_cast<float>(_tiers[i]) >= wanted)
+				return i;
+		}
+
+		return SHADOW_RESOLUTION_TIERS - 1;
+	}
+
+	uint32_t ShadowResolutionPolicy::budgetTier() const
+	{
+		if (_timeValid == false)
+			return SHADOW_RESOLUTION_TIERS - 1;
+
+		/* rendering cost is roughly proportional to the texel count */
+		if (_gpuTime > _budget)
+			return (_tier > 0) ? _tier - 1 : 0;
+
+		if (_tier + 1 < SHADOW_RESOLUTION_TIERS)
+		{
+			double ratio = static_cast<double>(_tiers[_tier + 1]) / static_cast<double>(_tiers[_tier]);
+			if (_gpuTime * ratio * ratio < _budget * 0.9)
+				return _tier + 1;
+		}
+
+		return _tier;
+	}
+
+	/* public member functions */
+
+	void ShadowResolutionPolicy::Update(const Environment* environment, const glm::mat4& cascade_proj_view)
+	{
+		/* this swap image's fence has signalled, so its previous timestamps are ready */
+		uint32_t image = environment->CurrentSwapImageIndex();
+		if (_written[image])
+		{
+			uint64_t timestamps[2]{};
+			if (vkGetQueryPoolResults(_device, _queryPool, image * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			{
+				double time = static_cast<double>(timestamps[1] - timestamps[0]) * _timestampPeriod / 1000000.0;
+				_gpuTime = (_timeValid) ? (_gpuTime * 0.9 + time * 0.1) : time;
+				_timeValid = true;
+			}
+
+			_written[image] = false;
+		}
+
+		_changed = false;
+		if (_framesSinceChange < _holdFrames)
+		{
+			_framesSinceChange++;
+			return;
+		}
+
+		/* never above what the view needs, never above what the budget allows */
+		uint32_t tier = std::min(qualityTier(cascade_proj_view), budgetTier());
+		if (tier != _tier)
+		{
+			/* the last time was measured at the old resolution, scale it to the new one */
+			double ratio = static_cast<double>(_tiers[tier]) / static_cast<double>(_tiers[_tier]);
+			_gpuTime *= ratio * ratio;
+
+			_tier = tier;
+			_changed = true;
+			_framesSinceChange = 0;
+		}
+	}
+
+	void ShadowResolutionPolicy::CmdBeginTiming(Environment* environment)
+	{
+		uint32_t image = environment->CurrentSwapImageIndex();
+
+		vkCmdResetQueryPool(*environment->CurrentCmdBuffer(), _queryPool, image * 2, 2);
+		vkCmdWriteTimestamp(*environment->CurrentCmdBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, image * 2);
+	}
+
+	void ShadowResolutionPolicy::CmdEndTiming(Environment* environment)
+	{
+		uint32_t image = environment->CurrentSwapImageIndex();
+
+		vkCmdWriteTimestamp(*environment->CurrentCmdBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, image * 2 + 1);
+		_written[image] = true;
+	}
+
+	/* getters */
+
+	uint32_t ShadowResolutionPolicy::Resolution() const
+	{
+		return _tiers[_tier];
+	}
+	bool ShadowResolutionPolicy::Changed() const
+	{
+		return _changed;
+	}
+	double ShadowResolutionPolicy::GpuTime() const
+	{
+		return _gpuTime;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+/* c++ */
+#include <vector>
+
+/* renderer */
+#include "Constants.hpp"
+
+/* volk */
+#include <volk/volk.h>
+
+/* glm */
+#include <glm/glm.hpp>
+
+namespace Renderer
+{
+	class Environment;
+}
+
+namespace Renderer
+{
+	static const uint32_t SHADOW_RESOLUTION_TIERS = 4;
+
+	/* picks the resolution the shadow maps are rendered at each frame. the maps stay allocated at
+		max_resolution and smaller tiers render into their top left corner, so changing tier is free */
+	class ShadowResolutionPolicy
+	{
+		public:
+			/* constructors, etc. */
+
+			ShadowResolutionPolicy(const Environment* environment, uint32_t max_resolution, float texel_world_size, float budget_ms, uint32_t hold_frames = 30);
+			~ShadowResolutionPolicy();
+
+			ShadowResolutionPolicy(const ShadowResolutionPolicy&) = delete;
+			ShadowResolutionPolicy& operator=(const ShadowResolutionPolicy&) = delete;
+
+		private:
+			/* private member variables */
+
+			VkDevice _device = VK_NULL_HANDLE;
+			double _timestampPeriod = 1.0;
+
+			uint32_t _tiers[SHADOW_RESOLUTION_TIERS]{};
+			uint32_t _tier = SHADOW_RESOLUTION_TIERS - 1;
+			bool _changed = false;
+
+			float _texelWorldSize = 0.005f;
+			float _budget = 2.0f;
+			uint32_t _holdFrames = 30;
+			uint32_t _framesSinceChange = 0;
+
+			/* two timestamps per swap image, read the next time the image comes around */
+			VkQueryPool _queryPool = VK_NULL_HANDLE;
+			std::vector<bool> _written{};
+			double _gpuTime = 0.0; /* ms, moving average of the frames the maps were rendered */
+			bool _timeValid = false;
+
+			/* private member functions */
+
+			uint32_t qualityTier(const glm::mat4& cascade_proj_view) const;
+			uint32_t budgetTier() const;
+
+		public:
+			/* public member functions */
+
+			void Update(const Environment* environment, const glm::mat4& cascade_proj_view);
+			void CmdBeginTiming(Environment* environment);
+			void CmdEndTiming(Environment* environment);
+
+			/* getters */
+
+			uint32_t Resolution() const;
+			bool Changed() const;
+			double GpuTime() const;
+	};
+}
@@ -1,10 +1,20 @@
 #include "TextureUtilities.hpp"
 
+/* c++ */
+#include <algorithm>
+#include <cstring>
+
+/* renderer */
+#include "BufferUtilities.hpp"
+
 /* labutils */
 #include "../labutils/error.hpp"
 #include "../labutils/to_string.hpp"
 #include "../labutils/vkutil.hpp"
 
+/* glm */
+#include <glm/gtc/packing.hpp>
+
 labutils::ImageView Renderer::CreateImageView(const Environment* environment, VkImage image, VkFormat format)
 {
 	using namespace labutils;
@@ -45,8 +55,8 @@ void Renderer::CmdPrimeImageForWrite(Environment* environment, const lut::Image*
 		VkImageSubresourceRange
 		{
 			static_cast<VkImageAspectFlags>((isDepth) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT),
-			0, 1,
-			0, 1
+			0, VK_REMAINING_MIP_LEVELS,
+			0, VK_REMAINING_ARRAY_LAYERS
 		});
 }
 
@@ -63,8 +73,8 @@ void Renderer::CmdPrimeImageForRead(Environment* environment, const lut::Image*
 		VkImageSubresourceRange
 		{
 			static_cast<VkImageAspectFlags>((isDepth) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT),
-			0, 1,
-			0, 1
+			0, VK_REMAINING_MIP_LEVELS,
+			0, VK_REMAINING_ARRAY_LAYERS
 		});
 }
 
@@ -82,7 +92,7 @@ void Renderer::CmdTransitionForWrite(Environment* environment, const lut::Image*
 		{
 			static_cast<VkImageAspectFlags>((isDepth) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT),
 			0, 1,
-			0, 1
+			0, VK_REMAINING_ARRAY_LAYERS
 		});
 }
 
@@ -100,6 +110,163 @@ void Renderer::CmdTransitionForRead(Environment* environment, const lut::Image*
 		{
 			static_cast<VkImageAspectFlags>((isDepth) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT),
 			0, 1,
-			0, 1
+			0, VK_REMAINING_ARRAY_LAYERS
 		});
 }
+
+void Renderer::CmdBuildColourMips(Environment* environment, const lut::Image* image, VkExtent2D extent,
+	uint32_t mip_levels, uint32_t layers)
+{
+	VkCommandBuffer cmdBuffer = *environment->CurrentCmdBuffer();
+
+	/* BARRIER: colour attachment -> blit source (mip 0) */
+	lut::image_barrier(cmdBuffer, **image,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_ACCESS_TRANSFER_READ_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layers });
+
+	int32_t width = static_cast<int32_t>(extent.width);
+	int32_t height = static_cast<int32_t>(extent.height);
+	for (uint32_t mip = 1; mip < mip_levels; mip++)
+	{
+		/* BARRIER: last frame's reads -> blit destination, the old contents aren't needed */
+		lut::image_barrier(cmdBuffer, **image,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, layers });
+
+		int32_t halfWidth = std::max(width / 2, 1);
+		int32_t halfHeight = std::max(height / 2, 1);
+
+		VkImageBlit blit{};
+		blit.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, layers };
+		blit.srcOffsets[1] = VkOffset3D{ width, height, 1 };
+		blit.dstSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, layers };
+		blit.dstOffsets[1] = VkOffset3D{ halfWidth, halfHeight, 1 };
+
+		vkCmdBlitImage(cmdBuffer,
+			**image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			**image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+
+		/* BARRIER: blit destination -> blit source, for the next level */
+		lut::image_barrier(cmdBuffer, **image,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, layers });
+
+		width = halfWidth;
+		height = halfHeight;
+	}
+
+	/* BARRIER: blit source -> shader read (every mip) */
+	lut::image_barrier(cmdBuffer, **image,
+		VK_ACCESS_TRANSFER_READ_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels, 0, layers });
+}
+
+void Renderer::CmdCopyImageToBuffer(Environment* environment, const lut::Image* image, VkBuffer buffer,
+	uint32_t width, uint32_t height, uint32_t layers)
+{
+	VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layers };
+
+	/* BARRIER: shader read -> transfer source */
+	lut::image_barrier(*environment->CurrentCmdBuffer(), **image,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT,
+		VK_ACCESS_TRANSFER_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		range);
+
+	VkBufferImageCopy copy{};
+	copy.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, layers };
+	copy.imageExtent = VkExtent3D{ width, height, 1 };
+	vkCmdCopyImageToBuffer(*environment->CurrentCmdBuffer(), **image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &copy);
+
+	/* BARRIER: transfer source -> shader read */
+	lut::image_barrier(*environment->CurrentCmdBuffer(), **image,
+		VK_ACCESS_TRANSFER_READ_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		range);
+
+	/* make the copy visible to the host once the frame's fence has signalled */
+	CreateBufferBarrier(*environment->CurrentCmdBuffer(), buffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+}
+
+uint32_t Renderer::CSSMColourTexelSize(CSSMColourFormat format)
+{
+	switch (format)
+	{
+		case CSSMColourFormat::RGBA16_UNORM:
+		case CSSMColourFormat::RGBA16_SFLOAT:
+			return 8;
+
+		case CSSMColourFormat::RGB10A2_UNORM:
+			return 4;
+
+		case CSSMColourFormat::RGBA32_SFLOAT:
+		default:
+			return 16;
+	}
+}
+
+float Renderer::DecodeCSSMColourDepth(const void* texel, CSSMColourFormat format, uint32_t channel)
+{
+	switch (format)
+	{
+		case CSSMColourFormat::RGBA16_UNORM:
+		{
+			uint16_t value = 0;
+			std::memcpy(&value, static_cast<const uint16_t*>(texel) + channel, sizeof(value));
+			return static_cast<float>(value) / 65535.0f;
+		}
+
+		case CSSMColourFormat::RGBA16_SFLOAT:
+		{
+			uint16_t value = 0;
+			std::memcpy(&value, static_cast<const uint16_t*>(texel) + channel, sizeof(value));
+			return glm::unpackHalf1x16(value);
+		}
+
+		case CSSMColourFormat::RGB10A2_UNORM:
+		{
+			/* A2B10G10R10: red in the low bits */
+			uint32_t value = 0;
+			std::memcpy(&value, texel, sizeof(value));
+			return static_cast<float>((value >> (channel * 10)) & 0x3FFu) / 1023.0f;
+		}
+
+		case CSSMColourFormat::RGBA32_SFLOAT:
+		default:
+		{
+			float value = 0.0f;
+			std::memcpy(&value, static_cast<const float*>(texel) + channel, sizeof(value));
+			return value;
+		}
+	}
+}
@@ -2,6 +2,7 @@
 
 /* renderer */
 #include "Environment.hpp"
+#include "RenderPassFeatures.hpp"
 
 /* labutils */
 #include "../labutils/vkimage.hpp"
@@ -16,4 +17,18 @@ namespace Renderer
 	void CmdPrimeImageForRead(Environment* environment, const lut::Image* image, bool isDepth = false);
 	void CmdTransitionForWrite(Environment* environment, const lut::Image* image, bool isDepth = false);
 	void CmdTransitionForRead(Environment* environment, const lut::Image* image, bool isDepth = false);
+
+	/* in place of CmdTransitionForRead(): blits a freshly rendered colour image's mip 0 down its mip chain
+		with a linear filter, and leaves every mip ready for reading. extent is the top left region that was
+		rendered, each mip only gets that region halved */
+	void CmdBuildColourMips(Environment* environment, const lut::Image* image, VkExtent2D extent,
+		uint32_t mip_levels, uint32_t layers = 1);
+
+	/* copies every layer of a colour image that is ready for reading, and leaves it ready for reading */
+	void CmdCopyImageToBuffer(Environment* environment, const lut::Image* image, VkBuffer buffer,
+		uint32_t width, uint32_t height, uint32_t layers = 1);
+
+	/* CSSM colour shadow map texels, as laid out by CSSMColourVkFormat() */
+	uint32_t CSSMColourTexelSize(CSSMColourFormat format);
+	float DecodeCSSMColourDepth(const void* texel, CSSMColourFormat format, uint32_t channel);
 }
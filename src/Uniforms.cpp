@@ -1,112 +1,187 @@
 #include "Uniforms.hpp"
 
 /* c++ */
-#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 /* Renderer */
+#include "ShadowCache.hpp" // <- class ShadowCache
 #include "ViewerCamera.hpp" // <- class ViewerCamera
 
 namespace Renderer
 {
 	namespace Uniforms
 	{
-		void DirectionalShadowData::Update(const ViewerCamera* camera, const LightData::DirectionalLight* sunLight, float bufferDistance, float shadowDistance)
+		static void lightSpaceBounds(const glm::mat4& light_view, const glm::vec3& world_min, const glm::vec3& world_max,
+			glm::vec3* minimum, glm::vec3* maximum)
 		{
-			/* first calculate the bounds of the camera frustum */
+			*minimum = glm::vec3(std::numeric_limits<float>::max());
+			*maximum = glm::vec3(std::numeric_limits<float>::lowest());
 
-			std::vector<glm::vec3> cameraLocalPoints;
-			std::vector<glm::vec3> worldPoints;
-			std::vector<glm::vec3> shadowLocalPoints;
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				glm::vec3 corner = glm::vec3(
+					(i & 1) ? world_max.x : world_min.x,
+					(i & 2) ? world_max.y : world_min.y,
+					(i & 4) ? world_max.z : world_min.z);
+				glm::vec3 lightLocal = glm::vec3(light_view * glm::vec4(corner, 1.0f));
+				*minimum = glm::min(*minimum, lightLocal);
+				*maximum = glm::max(*maximum, lightLocal);
+			}
+		}
 
-			float near = camera->NearDist();
-			float far = std::min(camera->FarDist(), shadowDistance);
-			if (shadowDistance <= camera->NearDist())
-				far = camera->FarDist();
-
-			/* near and far width and height */
-			float recipAspect = camera->Aspect();
-			float nearHeight = rightTriangleOpposite(camera->FOVY() / 2.0f, near);
-			float nearWidth = recipAspect * nearHeight;
-			float farHeight = rightTriangleOpposite(camera->FOVY() / 2.0f, far);
-			float farWidth = recipAspect * farHeight;
-
-			/* calculate the camera localPoints and midpoint */
-			for (float w = -1.0f; w < 1.01f; w += 2.0f)
+		glm::vec2 CasterDepthRange(const ShadowFitBounds& bounds, const glm::mat4& light_view, const glm::vec2& footprint_min, const glm::vec2& footprint_max)
+		{
+			/* the light looks down -z, so the nearest caster has the largest z */
+			glm::vec2 range = glm::vec2(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::max());
+
+			for (size_t i = 0; i + 1 < bounds.casters.size(); i += 2)
 			{
-				for (float h = -1.0f; h < 1.01f; h += 2.0f)
-				{
-					cameraLocalPoints.push_back(glm::vec3(nearWidth * w, nearHeight * h, near));
-					cameraLocalPoints.push_back(glm::vec3(farWidth * w, farHeight * h, far));
-				}
+				glm::vec3 minimum, maximum;
+				lightSpaceBounds(light_view, bounds.casters[i], bounds.casters[i + 1], &minimum, &maximum);
+
+				if (maximum.x < footprint_min.x || minimum.x > footprint_max.x ||
+					maximum.y < footprint_min.y || minimum.y > footprint_max.y)
+					continue;
+
+				range.x = std::max(range.x, maximum.z);
+				range.y = std::min(range.y, minimum.z);
 			}
 
-			/* calculate the light right and up values */
-			glm::vec3 lightForward = glm::normalize(sunLight->direction);
-			glm::vec3 lightRight = glm::normalize(glm::cross(lightForward, glm::vec3(0.0f, 1.0f, 0.0f)));
-			glm::vec3 lightUp = glm::normalize(glm::cross(lightRight, lightForward));
+			return range;
+		}
 
-			/* transform the points into world space */
-			for (size_t i = 0; i < cameraLocalPoints.size(); i++)
-				worldPoints.push_back(glm::vec4(cameraLocalPoints[i], 1.0f) * camera->InvView());
+		glm::mat4 DirectionalShadowData::fitOrthographic(const glm::vec3* corners, float bufferDistance, const ShadowFitBounds* fitBounds) const
+		{
+			/* bounds of the 8 frustum corners in light view space */
+			glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 maximum = glm::vec3(std::numeric_limits<float>::lowest());
 
-			/* calculate the camera orientation min and max */
+			for (size_t i = 0; i < 8; i++)
+			{
+				glm::vec3 lightLocal = glm::vec3(view * glm::vec4(corners[i], 1.0f));
+				minimum = glm::min(minimum, lightLocal);
+				maximum = glm::max(maximum, lightLocal);
+			}
 
-			float minX = std::numeric_limits<float>().max();
-			float maxX = std::numeric_limits<float>().min();
-			float minY = std::numeric_limits<float>().max();
-			float maxY = std::numeric_limits<float>().min();
-			float minZ = std::numeric_limits<float>().max();
-			float maxZ = std::numeric_limits<float>().min();
+			/* the light looks down -z, so the buffer pulls the near plane back towards the light
+				to catch casters that sit outside the camera frustum */
+			float nearZ = maximum.z + bufferDistance;
+			float farZ = minimum.z;
 
-			for (size_t i = 0; i < worldPoints.size(); i++)
+			if (fitBounds != nullptr)
 			{
-				float projX = glm::dot(worldPoints[i], lightRight);
-				float projY = glm::dot(worldPoints[i], lightUp);
-				float projZ = glm::dot(worldPoints[i], lightForward);
+				/* only what the camera can see receives a shadow, so the footprint shrinks to the visible receivers */
+				if (fitBounds->receiversVisible)
+				{
+					glm::vec3 receiverMin, receiverMax;
+					lightSpaceBounds(view, fitBounds->receiverMin, fitBounds->receiverMax, &receiverMin, &receiverMax);
+
+					glm::vec2 clippedMin = glm::max(glm::vec2(minimum), glm::vec2(receiverMin));
+					glm::vec2 clippedMax = glm::min(glm::vec2(maximum), glm::vec2(receiverMax));
+					if (clippedMin.x < clippedMax.x && clippedMin.y < clippedMax.y)
+					{
+						minimum = glm::vec3(clippedMin, minimum.z);
+						maximum = glm::vec3(clippedMax, maximum.z);
+						farZ = std::max(farZ, receiverMin.z);
+					}
+				}
+
+				/* the near plane sits on the nearest caster over the footprint rather than a fixed distance back,
+					and nothing past the farthest of them needs any depth */
+				glm::vec2 casterDepth = CasterDepthRange(*fitBounds, view, glm::vec2(minimum), glm::vec2(maximum));
+				if (casterDepth.x >= casterDepth.y)
+				{
+					nearZ = casterDepth.x;
+					farZ = std::max(farZ, casterDepth.y);
+				}
+				nearZ = std::max(nearZ, farZ + 0.01f);
+			}
 
-				if (projX < minX)
-					minX = projX;
+			return glm::orthoRH_ZO(
+				minimum.x, maximum.x,
+				minimum.y, maximum.y,
+				-nearZ,
+				-farZ);
+		}
 
-				if (projX > maxX)
-					maxX = projX;
+		void DirectionalShadowData::Update(const ViewerCamera* camera, const LightData::DirectionalLight* sunLight, float bufferDistance, float shadowDistance,
+			CascadeSplit splitScheme, float splitLambda, ShadowCache* cache, const ShadowFitBounds* fitBounds)
+		{
+			float near = camera->NearDist();
+			float far = camera->FarDist();
+			if (shadowDistance > near)
+				far = std::min(far, shadowDistance);
 
-				if (projY < minY)
-					minY = projY;
+			/* the light's orientation is shared by every cascade */
+			glm::vec3 lightForward = glm::normalize(glm::vec3(sunLight->direction));
+			glm::vec3 upHint = (std::abs(lightForward.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+			view = glm::lookAtRH(glm::vec3(0.0f), lightForward, upHint);
+			invView = glm::inverse(view);
 
-				if (projY > maxY)
-					maxY = projY;
+			/* whole range projection */
+			glm::vec3 corners[8];
+			camera->FrustumCorners(near, far, corners);
+			projection = fitOrthographic(corners, bufferDistance, fitBounds);
+			projView = projection * view;
 
-				if (projZ < minZ)
-					minZ = projZ;
+			/* cascade split distances */
+			for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++)
+			{
+				float p = static_cast<float>(i + 1) / static_cast<float>(SHADOW_CASCADE_COUNT);
+				float uniformSplit = near + (far - near) * p;
+				float logSplit = near * std::pow(far / near, p);
 
-				if (projZ > maxZ)
-					maxZ = projZ;
+				switch (splitScheme)
+				{
+					case CascadeSplit::UNIFORM:
+						cascadeSplits[i] = uniformSplit;
+						break;
+
+					case CascadeSplit::LOGARITHMIC:
+						cascadeSplits[i] = logSplit;
+						break;
+
+					case CascadeSplit::PRACTICAL:
+					default:
+						cascadeSplits[i] = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+						break;
+				}
 			}
 
-			float lightSpanX = maxX - minX;
-			float lightSpanY = maxY - minY;
-			float lightSpanZ = maxZ - minZ;
-
-			glm::vec3 lightTarget = glm::vec3(
-				(minX + maxX) * 0.5f,
-				(minY + maxY) * 0.5f,
-				(maxZ + minZ) * 0.5f);
+			/* per cascade projections, unused cascades fall back to the whole range */
+			glm::vec3 cascadeCorners[SHADOW_CASCADE_COUNT * 8];
+			for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++)
+				camera->FrustumCorners((i == 0) ? near : cascadeSplits[i - 1], cascadeSplits[i], &cascadeCorners[i * 8]);
 
-			glm::vec3 lightPosition = lightTarget - (lightSpanZ * 0.5f + bufferDistance) * glm::vec3(sunLight->direction);
+			glm::mat4 cascadeProjections[SHADOW_CASCADE_COUNT];
+			if (cache != nullptr)
+			{
+				/* stable, texel snapped projections that are only refit when the camera leaves the guard band */
+				cache->FitCascades(view, cascadeCorners, SHADOW_CASCADE_COUNT, bufferDistance, cascadeProjections, fitBounds);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++)
+					cascadeProjections[i] = fitOrthographic(&cascadeCorners[i * 8], bufferDistance, fitBounds);
+			}
 
-			/* calculate the shadow projection-view matrix */
-			projection = glm::orthoRH_ZO(
-				-lightSpanX * 0.5f,
-				lightSpanX * 0.5f,
-				-lightSpanY * 0.5f,
-				lightSpanY * 0.5f,
-				0.01f,
-				lightSpanZ + bufferDistance);
+			for (uint32_t i = 0; i < SHADOW_CASCADE_MAX; i++)
+			{
+				if (i >= SHADOW_CASCADE_COUNT)
+				{
+					cascadeSplits[i] = far;
+					cascadeProjView[i] = projView;
+					continue;
+				}
 
-			view = glm::lookAtRH(lightPosition, lightTarget, lightUp);
-			invView = glm::inverse(view);
+				cascadeProjView[i] = cascadeProjections[i] * view;
+			}
 
-			projView = projection * view;
+			/* the CSSM colour format and the shadow map resolution are set by the application, keep them */
+			cascadeInfo = glm::uvec4(SHADOW_CASCADE_COUNT, cascadeInfo.y, cascadeInfo.z, 0);
 		}
 	}
-}
\ No newline at end of file
+}
@@ -1,11 +1,18 @@
 #pragma once
 
+/* c++ */
+#include <vector>
+
+/* renderer */
+#include "Constants.hpp"
+
 /* glm */
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace Renderer
 {
+	class ShadowCache;
 	class ViewerCamera;
 }
 
@@ -20,6 +27,8 @@ namespace Renderer
 			glm::mat4 projView;
 			glm::vec4 position;
 			glm::mat4 invProjView;
+			glm::vec4 viewport; /* x, y: frame size, z, w: texel size */
+			glm::mat4 prevProjView; /* last frame's projView, for reprojection */
 		};
 
 		struct FrameData
@@ -52,6 +61,35 @@ namespace Renderer
 			AmbientLight ambientLight;
 		};
 
+		enum class LocalLightType
+		{
+			SPOT = 0,
+			POINT /* six shadow views, +x -x +y -y +z -z */
+		};
+
+		struct LocalLight
+		{
+			glm::vec4 position = glm::vec4(0.0f); /* w: range */
+			glm::vec4 direction = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f); /* spot only, w: cosine of the outer cone angle */
+			glm::vec4 colour = glm::vec4(1.0f); /* w: cosine of the inner cone angle */
+			glm::uvec4 info = glm::uvec4(0); /* x: LocalLightType, y: first shadow view, z: shadow view count (0: unshadowed) */
+		};
+
+		struct LocalShadowView
+		{
+			glm::mat4 projView = glm::mat4(1);
+			glm::vec4 rect = glm::vec4(0.0f); /* xy: atlas uv offset, zw: atlas uv size */
+			glm::vec4 bias = glm::vec4(0.0f); /* x: world size of a texel one unit from the light */
+		};
+
+		/* std430 storage buffer, the local lights and the atlas views that shadow them */
+		struct LocalLightList
+		{
+			glm::uvec4 counts = glm::uvec4(0); /* x: light count, y: view count */
+			LocalLight lights[LOCAL_LIGHT_MAX]{};
+			LocalShadowView views[LOCAL_VIEW_MAX]{};
+		};
+
 		struct SimpleMaterial
 		{
 			union
@@ -78,25 +116,59 @@ namespace Renderer
 			} data;
 		};
 
+		enum class CascadeSplit
+		{
+			UNIFORM = 0,
+			LOGARITHMIC,
+			PRACTICAL /* blend of uniform and logarithmic, weighted by a lambda */
+		};
+
+		/* world space bounds for fitting the shadow projections to the scene rather than to the camera frustum alone:
+			the casters under a cascade's footprint set its near plane, and the receivers the camera can see clip the rest */
+		struct ShadowFitBounds
+		{
+			std::vector<glm::vec3> casters{}; /* min then max of each caster's bounds */
+			glm::vec3 receiverMin = glm::vec3(0.0f);
+			glm::vec3 receiverMax = glm::vec3(0.0f);
+			bool receiversVisible = false;
+		};
+
+		/* the baked translucent shadows' light view and how the layers are read, see ShadowBake */
+		struct BakedShadowData
+		{
+			glm::mat4 projView = glm::mat4(1);
+			glm::uvec4 info = glm::uvec4(BAKED_SHADOW_LAYERS, BAKED_SHADOW_RESOLUTION, 0, 0); /* x: layer count, y: resolution */
+			glm::vec4 bias = glm::vec4(0.002f, 0.0f, 0.0f, 0.0f); /* x: depth bias, in the bake's [0, 1] depth */
+		};
+
+		/* light view space depth (x: nearest, y: farthest) of the casters whose bounds overlap the footprint,
+			y > x when none of them do */
+		glm::vec2 CasterDepthRange(const ShadowFitBounds& bounds, const glm::mat4& light_view, const glm::vec2& footprint_min, const glm::vec2& footprint_max);
+
+		static_assert(SHADOW_CASCADE_COUNT >= 1 && SHADOW_CASCADE_COUNT <= SHADOW_CASCADE_MAX && SHADOW_CASCADE_MAX == 4,
+			"the shaders declare cascadeProjView[4] and pack the cascade splits in a vec4");
+
 		struct DirectionalShadowData
 		{
+			/* view, projection, and projView cover the whole shadowed range,
+				cascadeProjView[i] covers the camera frustum slice ending at cascadeSplits[i] */
 			glm::mat4 view = glm::mat4(1);
 			glm::mat4 projection = glm::mat4(1);
 			glm::mat4 projView = glm::mat4(1);
 			glm::mat4 invView = glm::mat4(1);
+			glm::mat4 cascadeProjView[SHADOW_CASCADE_MAX]{};
+			glm::vec4 cascadeSplits = glm::vec4(0.0f);
+			glm::uvec4 cascadeInfo = glm::uvec4(SHADOW_CASCADE_COUNT, 0, SHADOW_MAP_RESOLUTION, 0); /* x: cascade count, y: CSSM colour format (CSSMColourFormat), z: rendered shadow map resolution */
+			glm::uvec4 temporalInfo = glm::uvec4(0); /* x: stochastic noise frame */
+			glm::uvec4 samplingInfo = glm::uvec4(0, 4, 0, 0); /* x: stochastic noise pattern (NoisePattern), y: stochastic lookups' PCF radius, z: shadow mask denoise radius */
 
 			private:
-				inline float rightTriangleOpposite(float angleRadians, float adjacentSide)
-				{
-					/* solves for the opposite side length of a right triangle given
-						a non-right angle measurement and its adjacent side's length */
-
-					float h = adjacentSide / cosf(angleRadians);
-					return sqrtf(h * h - adjacentSide * adjacentSide);
-				}
+				glm::mat4 fitOrthographic(const glm::vec3* corners, float bufferDistance, const ShadowFitBounds* fitBounds) const;
 
 			public:
-				void Update(const ViewerCamera* camera, const LightData::DirectionalLight* sunLight, float bufferDistance = 1000.0f, float shadowDistance = 0.0f);
+				void Update(const ViewerCamera* camera, const LightData::DirectionalLight* sunLight, float bufferDistance = 1000.0f, float shadowDistance = 0.0f,
+					CascadeSplit splitScheme = CascadeSplit::PRACTICAL, float splitLambda = 0.75f, ShadowCache* cache = nullptr,
+					const ShadowFitBounds* fitBounds = nullptr);
 		};
 	}
 }
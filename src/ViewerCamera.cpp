@@ -103,12 +103,22 @@ namespace Renderer
 			_nearClip, _farClip);
 		_data.projection[1][1] = -1.0f;
 
+		/* z' = w - z, so the near plane lands on 1 and the far plane on 0 */
+		if (_reversedDepth)
+		{
+			for (glm::length_t i = 0; i < 4; i++)
+				_data.projection[i][2] = _data.projection[i][3] - _data.projection[i][2];
+		}
+
 		_data.view = rotation * glm::translate(_position);
 
+		_data.prevProjView = _data.projView;
 		_data.projView = _data.projection * _data.view;
 		_data.invProjView = glm::inverse(_data.projView);
 
 		_data.position = glm::vec4(_position, 1.0f);
+		_data.viewport = glm::vec4(static_cast<float>(_frameWidth), static_cast<float>(_frameHeight),
+			1.0f / static_cast<float>(_frameWidth), 1.0f / static_cast<float>(_frameHeight));
 
 		_invView = glm::inverse(_data.view);
 
@@ -146,6 +156,12 @@ namespace Renderer
 		SetOrientation(rot_xy.x, rot_xy.y);
 	}
 
+	void ViewerCamera::SetReversedDepth(bool reversed)
+	{
+		/* takes effect from the next FrameUpdate() */
+		_reversedDepth = reversed;
+	}
+
 	/* getters */
 
 	Uniforms::CameraData ViewerCamera::GetUniformData()
@@ -187,6 +203,11 @@ namespace Renderer
 		return _aspect;
 	}
 
+	bool ViewerCamera::ReversedDepth() const
+	{
+		return _reversedDepth;
+	}
+
 	const glm::vec3& ViewerCamera::Forward() const
 	{
 		return _forward;
@@ -212,6 +233,25 @@ namespace Renderer
 		return _data.invProjView;
 	}
 
+	void ViewerCamera::FrustumCorners(float slice_near, float slice_far, glm::vec3* corners) const
+	{
+		/* world space corners of the frustum slice between two view depths, near plane first */
+		const glm::vec2 ndcCorners[4] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+		float range = _farClip - _nearClip;
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			glm::vec4 nearPoint = _data.invProjView * glm::vec4(ndcCorners[i], (_reversedDepth) ? 1.0f : 0.0f, 1.0f);
+			glm::vec4 farPoint = _data.invProjView * glm::vec4(ndcCorners[i], (_reversedDepth) ? 0.0f : 1.0f, 1.0f);
+
+			/* view depth is linear along each corner ray, so a slice's corners are simple lerps */
+			glm::vec3 nearCorner = glm::vec3(nearPoint) / nearPoint.w;
+			glm::vec3 farCorner = glm::vec3(farPoint) / farPoint.w;
+			corners[i] = glm::mix(nearCorner, farCorner, (slice_near - _nearClip) / range);
+			corners[i + 4] = glm::mix(nearCorner, farCorner, (slice_far - _nearClip) / range);
+		}
+	}
+
 	void ViewerCamera::PrintPositionalData()
 	{
 		printf("POS: vec3(%.3f, %.3f, %.3f), ROT: vec2(%.3f, %.3f)\n",
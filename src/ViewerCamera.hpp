@@ -35,6 +35,7 @@ namespace Renderer
 			uint32_t _frameWidth = 0;
 			uint32_t _frameHeight = 0;
 			float _aspect = 0.0f;
+			bool _reversedDepth = false; /* near plane at depth 1, far plane at 0 */
 
 			glm::vec3 _position = glm::vec3(0);
 
@@ -59,6 +60,7 @@ namespace Renderer
 			void SetPosition(glm::vec3 new_position);
 			void SetOrientation(float x, float y);
 			void SetOrientation(glm::vec2 rot_xy);
+			void SetReversedDepth(bool reversed);
 
 			/* getters */
 
@@ -71,6 +73,7 @@ namespace Renderer
 			float NearDist() const;
 			float FarDist() const;
 			float Aspect() const;
+			bool ReversedDepth() const;
 
 			const glm::vec3& Forward() const;
 			const glm::vec3& Right() const;
@@ -79,6 +82,8 @@ namespace Renderer
 			const glm::mat4& InvView() const;
 			const glm::mat4& InvProjView() const;
 
+			void FrustumCorners(float slice_near, float slice_far, glm::vec3* corners) const;
+
 			void PrintPositionalData();
 	};
 }
@@ -0,0 +1,403 @@
+#include "VirtualShadowMap.hpp"
+
+/* c++ */
+#include <algorithm>
+
+/* renderer */
+#include "BufferUtilities.hpp"
+#include "Environment.hpp" // <- class Environment
+#include "RenderPass.hpp" // <- class RenderPass
+#include "ViewerCamera.hpp" // <- class ViewerCamera
+
+/* labutils */
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+
+namespace Renderer
+{
+	static const uint32_t VSM_PAGE_COUNT = VSM_VIRTUAL_PAGES * VSM_VIRTUAL_PAGES;
+	static const uint32_t VSM_SLOT_COUNT = VSM_POOL_PAGES * VSM_POOL_PAGES;
+	static const VkDeviceSize VSM_REQUEST_BYTES = (VSM_PAGE_COUNT / 32) * sizeof(uint32_t);
+	static const VkDeviceSize VSM_PAGE_TABLE_BYTES = VSM_PAGE_COUNT * sizeof(uint32_t);
+
+	static_assert(VSM_PAGE_COUNT % 32 == 0, "the request buffer packs 32 pages per uint");
+	static_assert(VSM_PAGE_TABLE_BYTES <= 65536, "the page table is uploaded with vkCmdUpdateBuffer()");
+
+	/* constructors, etc. */
+
+	VirtualShadowMap::VirtualShadowMap(const Environment* environment, float guard_band, uint32_t page_budget, uint32_t retain_frames)
+		: _region(guard_band, false)
+	{
+		_allocator = environment->Allocator().allocator;
+		_pageBudget = page_budget;
+		_retainFrames = retain_frames;
+
+		/* pages are rendered by offsetting a virtual resolution viewport so only the page lands in the pool */
+		VkPhysicalDeviceProperties props{};
+		vkGetPhysicalDeviceProperties(environment->Window().physicalDevice, &props);
+
+		const float lowestX = -static_cast<float>((VSM_VIRTUAL_PAGES - 1) * VSM_PAGE_SIZE);
+		const float highestX = static_cast<float>((VSM_POOL_PAGES - 1) * VSM_PAGE_SIZE + VSM_VIRTUAL_RESOLUTION);
+		if (props.limits.maxViewportDimensions[0] < VSM_VIRTUAL_RESOLUTION ||
+			props.limits.maxViewportDimensions[1] < VSM_VIRTUAL_RESOLUTION ||
+			props.limits.viewportBoundsRange[0] > lowestX ||
+			props.limits.viewportBoundsRange[1] < highestX)
+		{
+			throw lut::Error("VSM: the device's viewport limits are too small for a %u virtual shadow map (max %u, bounds [%.0f, %.0f])",
+				VSM_VIRTUAL_RESOLUTION, props.limits.maxViewportDimensions[0],
+				props.limits.viewportBoundsRange[0], props.limits.viewportBoundsRange[1]);
+		}
+
+		_requestBuffer = lut::create_buffer(environment->Allocator(), VSM_REQUEST_BYTES,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY);
+
+		_pageTableBuffer = lut::create_buffer(environment->Allocator(), VSM_PAGE_TABLE_BYTES,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY);
+
+		_pageTable.resize(VSM_PAGE_COUNT, 0);
+		_requested.resize(VSM_PAGE_COUNT, 0);
+		_pageSlots.resize(VSM_PAGE_COUNT, NO_SLOT);
+		_slotPages.resize(VSM_SLOT_COUNT, NO_PAGE);
+		_slotLastUsed.resize(VSM_SLOT_COUNT, 0);
+		_slotPending.resize(VSM_SLOT_COUNT, false);
+		_renderList.reserve(_pageBudget);
+
+		FreeUpdateBuffer(environment, &_pageTableBuffer, 0, VSM_PAGE_TABLE_BYTES, _pageTable.data());
+
+		for (size_t i = 0; i < environment->Window().swapImages.size(); i++)
+			createReadbackBuffer();
+
+		reset();
+	}
+
+	VirtualShadowMap::~VirtualShadowMap()
+	{
+		for (size_t i = 0; i < _readbackBuffers.size(); i++)
+			vmaUnmapMemory(_allocator, _readbackBuffers[i].allocation);
+	}
+
+	/* private member functions */
+
+	void VirtualShadowMap::createReadbackBuffer()
+	{
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = VSM_REQUEST_BYTES;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if (const auto& res = vmaCreateBuffer(_allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vmaCreateBuffer() failed to allocate a page request readback buffer. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_readbackBuffers.push_back(lut::Buffer(_allocator, buffer, allocation));
+
+		/* stays mapped for the lifetime of the virtual shadow map */
+		void* dataPtr = nullptr;
+		if (const auto& res = vmaMapMemory(_allocator, allocation, &dataPtr); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vmaMapMemory() failed to map a page request readback buffer. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		_readbackData.push_back(static_cast<uint32_t*>(dataPtr));
+		_readbackGeneration.push_back(0);
+	}
+
+	void VirtualShadowMap::reset()
+	{
+		/* requests made against the old region are now meaningless */
+		_generation++;
+
+		std::fill(_pageTable.begin(), _pageTable.end(), 0);
+		std::fill(_pageSlots.begin(), _pageSlots.end(), NO_SLOT);
+		std::fill(_slotPages.begin(), _slotPages.end(), NO_PAGE);
+		std::fill(_slotPending.begin(), _slotPending.end(), false);
+		_pending.clear();
+		_renderList.clear();
+
+		_freeSlots.clear();
+		for (uint32_t i = VSM_SLOT_COUNT; i > 0; i--)
+			_freeSlots.push_back(i - 1);
+
+		_pageTableDirty = true;
+	}
+
+	uint32_t VirtualShadowMap::allocateSlot()
+	{
+		if (_freeSlots.empty() == false)
+		{
+			uint32_t slot = _freeSlots.back();
+			_freeSlots.pop_back();
+			return slot;
+		}
+
+		/* the pool is full, so reuse the least recently requested page that hasn't been asked for in a while */
+		uint32_t oldest = NO_SLOT;
+		for (uint32_t slot = 0; slot < VSM_SLOT_COUNT; slot++)
+		{
+			if (_slotLastUsed[slot] + _retainFrames >= _frame)
+				continue;
+
+			if (oldest == NO_SLOT || _slotLastUsed[slot] < _slotLastUsed[oldest])
+				oldest = slot;
+		}
+
+		if (oldest != NO_SLOT)
+			evictSlot(oldest);
+
+		return oldest;
+	}
+
+	void VirtualShadowMap::evictSlot(uint32_t slot)
+	{
+		uint32_t page = _slotPages[slot];
+		if (page == NO_PAGE)
+			return;
+
+		_pageSlots[page] = NO_SLOT;
+		if (_pageTable[page] != 0)
+		{
+			_pageTable[page] = 0;
+			_pageTableDirty = true;
+		}
+
+		_slotPages[slot] = NO_PAGE;
+	}
+
+	/* public member functions */
+
+	void VirtualShadowMap::Update(const ViewerCamera* camera, const glm::mat4& light_view, float buffer_distance, float shadow_distance)
+	{
+		float near = camera->NearDist();
+		float far = camera->FarDist();
+		if (shadow_distance > near)
+			far = std::min(far, shadow_distance);
+
+		glm::vec3 corners[8];
+		camera->FrustumCorners(near, far, corners);
+
+		glm::mat4 projection = glm::mat4(1);
+		_region.FitCascades(light_view, corners, 1, buffer_distance, &projection);
+		_projView = projection * light_view;
+
+		/* the region moved, so every page now holds the wrong part of the light's view */
+		if (_region.Dirty())
+		{
+			reset();
+			_region.MarkRendered();
+		}
+	}
+
+	void VirtualShadowMap::ProcessRequests(const Environment* environment)
+	{
+		_frame++;
+		_renderList.clear();
+
+		uint32_t index = environment->CurrentSwapImageIndex();
+		while (index >= _readbackBuffers.size())
+			createReadbackBuffer();
+
+		if (_readbackGeneration[index] == _generation)
+		{
+			if (const auto& res = vmaInvalidateAllocation(_allocator, _readbackBuffers[index].allocation, 0, VK_WHOLE_SIZE); res != VK_SUCCESS)
+			{
+				throw lut::Error("VK: vmaInvalidateAllocation() failed. err: %s",
+					lut::to_string(res).c_str());
+			}
+
+			/* the requests are a few frames old by now, so grow each one by a page
+				to have the neighbouring pages ready before they come into view */
+			std::fill(_requested.begin(), _requested.end(), 0);
+			const uint32_t* requestBits = _readbackData[index];
+
+			for (uint32_t page = 0; page < VSM_PAGE_COUNT; page++)
+			{
+				if ((requestBits[page / 32] & (1u << (page % 32))) == 0)
+					continue;
+
+				int32_t x = static_cast<int32_t>(page % VSM_VIRTUAL_PAGES);
+				int32_t y = static_cast<int32_t>(page / VSM_VIRTUAL_PAGES);
+				for (int32_t v = std::max(y - 1, 0); v <= std::min(y + 1, VSM_VIRTUAL_PAGES - 1); v++)
+				{
+					for (int32_t u = std::max(x - 1, 0); u <= std::min(x + 1, VSM_VIRTUAL_PAGES - 1); u++)
+						_requested[v * VSM_VIRTUAL_PAGES + u] = 1;
+				}
+			}
+
+			for (uint32_t page = 0; page < VSM_PAGE_COUNT; page++)
+			{
+				if (_requested[page] == 0)
+					continue;
+
+				uint32_t slot = _pageSlots[page];
+				if (slot == NO_SLOT)
+				{
+					slot = allocateSlot();
+					if (slot == NO_SLOT)
+					{
+						/* every page in the pool is in use, this one stays unshadowed */
+						_overflows++;
+						continue;
+					}
+
+					_pageSlots[page] = slot;
+					_slotPages[slot] = page;
+
+					if (_slotPending[slot] == false)
+					{
+						_slotPending[slot] = true;
+						_pending.push_back(slot);
+					}
+				}
+
+				_slotLastUsed[slot] = _frame;
+			}
+		}
+
+		/* only a budgeted number of pages are rendered per frame, a page becomes resident once it has been rendered */
+		while (_pending.empty() == false && _renderList.size() < _pageBudget)
+		{
+			uint32_t slot = _pending.front();
+			_pending.pop_front();
+			_slotPending[slot] = false;
+
+			if (_slotPages[slot] == NO_PAGE)
+				continue;
+
+			_renderList.push_back(slot);
+			if (_pageTable[_slotPages[slot]] != slot + 1)
+			{
+				_pageTable[_slotPages[slot]] = slot + 1;
+				_pageTableDirty = true;
+			}
+		}
+	}
+
+	void VirtualShadowMap::Invalidate()
+	{
+		/* casters changed, so re-render every allocated page (they keep their stale contents until then) */
+		for (uint32_t slot = 0; slot < VSM_SLOT_COUNT; slot++)
+		{
+			if (_slotPages[slot] != NO_PAGE && _slotPending[slot] == false)
+			{
+				_slotPending[slot] = true;
+				_pending.push_back(slot);
+			}
+		}
+	}
+
+	void VirtualShadowMap::CmdUploadPageTable(Environment* environment)
+	{
+		if (_pageTableDirty == false)
+			return;
+
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_pageTableBuffer,
+			VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		vkCmdUpdateBuffer(*environment->CurrentCmdBuffer(), *_pageTableBuffer, 0, VSM_PAGE_TABLE_BYTES, _pageTable.data());
+
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_pageTableBuffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+		_pageTableDirty = false;
+	}
+
+	void VirtualShadowMap::CmdClearRequests(Environment* environment)
+	{
+		/* the previous frame's readback copy has to finish before the requests are cleared */
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_requestBuffer,
+			VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		vkCmdFillBuffer(*environment->CurrentCmdBuffer(), *_requestBuffer, 0, VSM_REQUEST_BYTES, 0);
+
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_requestBuffer,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+
+	void VirtualShadowMap::CmdReadbackRequests(Environment* environment)
+	{
+		uint32_t index = environment->CurrentSwapImageIndex();
+		assert(index < _readbackBuffers.size());
+
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_requestBuffer,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		VkBufferCopy copy{};
+		copy.size = VSM_REQUEST_BYTES;
+		vkCmdCopyBuffer(*environment->CurrentCmdBuffer(), *_requestBuffer, *_readbackBuffers[index], 1, &copy);
+
+		CreateBufferBarrier(*environment->CurrentCmdBuffer(), *_readbackBuffers[index],
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+
+		_readbackGeneration[index] = _generation;
+	}
+
+	void VirtualShadowMap::CmdBeginPage(Environment* environment, const RenderPass* render_pass, uint32_t slot, bool clear_colour, bool clear_depth)
+	{
+		assert(slot < VSM_SLOT_COUNT && _slotPages[slot] != NO_PAGE);
+
+		int32_t pageX = static_cast<int32_t>(_slotPages[slot] % VSM_VIRTUAL_PAGES);
+		int32_t pageY = static_cast<int32_t>(_slotPages[slot] / VSM_VIRTUAL_PAGES);
+		int32_t slotX = static_cast<int32_t>(slot % VSM_POOL_PAGES);
+		int32_t slotY = static_cast<int32_t>(slot / VSM_POOL_PAGES);
+
+		/* the whole virtual texture, shifted so this page lands on its slot in the pool */
+		VkViewport viewport{};
+		viewport.x = static_cast<float>((slotX - pageX) * VSM_PAGE_SIZE);
+		viewport.y = static_cast<float>((slotY - pageY) * VSM_PAGE_SIZE);
+		viewport.width = static_cast<float>(VSM_VIRTUAL_RESOLUTION);
+		viewport.height = static_cast<float>(VSM_VIRTUAL_RESOLUTION);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+
+		VkRect2D scissor{};
+		scissor.offset = VkOffset2D{ slotX * VSM_PAGE_SIZE, slotY * VSM_PAGE_SIZE };
+		scissor.extent = VkExtent2D{ VSM_PAGE_SIZE, VSM_PAGE_SIZE };
+
+		environment->CmdSetViewport(viewport, scissor);
+		environment->CmdClearRegion(render_pass, scissor, clear_colour, clear_depth);
+	}
+
+	/* getters */
+
+	const glm::mat4& VirtualShadowMap::ProjView() const
+	{
+		return _projView;
+	}
+	const std::vector<uint32_t>& VirtualShadowMap::PagesToRender() const
+	{
+		return _renderList;
+	}
+	const lut::Buffer& VirtualShadowMap::RequestBuffer() const
+	{
+		return _requestBuffer;
+	}
+	const lut::Buffer& VirtualShadowMap::PageTableBuffer() const
+	{
+		return _pageTableBuffer;
+	}
+	uint32_t VirtualShadowMap::ResidentPageCount() const
+	{
+		return static_cast<uint32_t>(std::count_if(_pageTable.begin(), _pageTable.end(), [](uint32_t entry) { return entry != 0; }));
+	}
+	uint32_t VirtualShadowMap::OverflowCount() const
+	{
+		return _overflows;
+	}
+}
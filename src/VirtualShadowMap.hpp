@@ -0,0 +1,109 @@
+#pragma once
+
+/* c++ */
+#include <deque>
+#include <vector>
+
+/* renderer */
+#include "Constants.hpp"
+#include "ShadowCache.hpp"
+
+/* labutils */
+#include "../labutils/vkbuffer.hpp"
+
+/* glm */
+#include <glm/glm.hpp>
+
+namespace Renderer
+{
+	class Environment;
+	class RenderPass;
+	class ViewerCamera;
+}
+
+namespace Renderer
+{
+	namespace lut = labutils;
+
+	class VirtualShadowMap
+	{
+		public:
+			/* constructors, etc. */
+
+			VirtualShadowMap(const Environment* environment, float guard_band = 0.5f, uint32_t page_budget = 64, uint32_t retain_frames = 30);
+			~VirtualShadowMap();
+
+			VirtualShadowMap(const VirtualShadowMap&) = delete;
+			VirtualShadowMap& operator=(const VirtualShadowMap&) = delete;
+
+		private:
+			/* private member variables */
+
+			static constexpr uint32_t NO_PAGE = 0xFFFFFFFFu;
+			static constexpr uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+			VmaAllocator _allocator = VK_NULL_HANDLE;
+
+			/* the virtual texture covers one stable, texel snapped region of light space,
+				refitting the region invalidates every page */
+			ShadowCache _region;
+			glm::mat4 _projView = glm::mat4(1);
+			uint32_t _generation = 1;
+
+			uint32_t _pageBudget = 64;
+			uint32_t _retainFrames = 30;
+			uint32_t _frame = 0;
+
+			/* the analysis pass ORs request bits into _requestBuffer, which is then copied to this swap image's
+				readback buffer. the copy is read the next time the image comes around, once its fence has signalled */
+			lut::Buffer _requestBuffer{};
+			std::vector<lut::Buffer> _readbackBuffers{};
+			std::vector<uint32_t*> _readbackData{};
+			std::vector<uint32_t> _readbackGeneration{}; /* 0: never written */
+			std::vector<uint8_t> _requested{};
+
+			/* page table: virtual page -> physical slot + 1 (0: not resident) */
+			lut::Buffer _pageTableBuffer{};
+			std::vector<uint32_t> _pageTable{};
+			bool _pageTableDirty = true;
+
+			/* physical pool bookkeeping, pages are only written to the page table once they've been rendered */
+			std::vector<uint32_t> _pageSlots{}; /* virtual page -> slot */
+			std::vector<uint32_t> _slotPages{}; /* slot -> virtual page */
+			std::vector<uint32_t> _slotLastUsed{}; /* frame the slot's page was last requested */
+			std::vector<bool> _slotPending{};
+			std::vector<uint32_t> _freeSlots{};
+			std::deque<uint32_t> _pending{};
+			std::vector<uint32_t> _renderList{};
+
+			uint32_t _overflows = 0;
+
+			/* private member functions */
+
+			void createReadbackBuffer();
+			void reset();
+			uint32_t allocateSlot();
+			void evictSlot(uint32_t slot);
+
+		public:
+			/* public member functions */
+
+			void Update(const ViewerCamera* camera, const glm::mat4& light_view, float buffer_distance, float shadow_distance = 0.0f);
+			void ProcessRequests(const Environment* environment);
+			void Invalidate();
+
+			void CmdUploadPageTable(Environment* environment);
+			void CmdClearRequests(Environment* environment);
+			void CmdReadbackRequests(Environment* environment);
+			void CmdBeginPage(Environment* environment, const RenderPass* render_pass, uint32_t slot, bool clear_colour = true, bool clear_depth = true);
+
+			/* getters */
+
+			const glm::mat4& ProjView() const;
+			const std::vector<uint32_t>& PagesToRender() const;
+			const lut::Buffer& RequestBuffer() const;
+			const lut::Buffer& PageTableBuffer() const;
+			uint32_t ResidentPageCount() const;
+			uint32_t OverflowCount() const;
+	};
+}
@@ -1,8 +1,11 @@
 
 /* c++ */
 #include <algorithm>
+#include <cmath>
+#include <deque>
 #include <iostream>
 #include <fstream>
+#include <memory>
 
 /* glm */
 #if !defined(GLM_FORCE_RADIANS)
@@ -36,10 +39,21 @@ namespace lut = labutils;
 #include "Environment.hpp"
 #include "ViewerCamera.hpp"
 #include "Model.hpp"
+#include "MomentShadowFilter.hpp"
+#include "NoisePatterns.hpp"
 #include "Pipeline.hpp"
 #include "RenderingUtilities.hpp"
+#include "ReferenceRenderer.hpp"
 #include "RenderPass.hpp"
+#include "ShadowAtlas.hpp"
+#include "ShadowBake.hpp"
+#include "ShadowCache.hpp"
+#include "ShadowDepthPyramid.hpp"
+#include "ShadowMask.hpp"
+#include "ShadowRasterizer.hpp"
+#include "ShadowResolutionPolicy.hpp"
 #include "TextureUtilities.hpp"
+#include "VirtualShadowMap.hpp"
 
 #define VANILLA 0
 #define TRANSLUCENT_SHADOWS 0
@@ -47,6 +61,65 @@ namespace lut = labutils;
 #define CSSM 1
 #define CTS 0
 
+/* coloured moment shadow maps: depth moments and transmittance are rendered once in light space and prefiltered
+	(compute blur and mips), so the lookup is a single filtered fetch whatever the filter width */
+#define CMSM 0
+
+/* fourier opacity maps: translucent casters add their absorbance and its depth distribution as a truncated fourier series
+	in one unsorted light-space pass, so the cost stays flat however many casters overlap */
+#define FOM 0
+
+/* translucent shadows (TS/CTS): write nearest translucent depth and colour in one light-space pass (MRT) */
+#define TS_SINGLE_PASS 1
+
+/* only re-render the shadow maps when the (stable, texel snapped) light frustum, the light, or the casters change */
+#define SHADOW_CACHE 1
+
+/* virtual shadow map: a very high resolution shadow map where only the pages the camera can see are rendered,
+	into a small physical page pool (VANILLA, TRANSLUCENT_SHADOWS and CSSM) */
+#define VIRTUAL_SHADOWS 0
+
+/* CSSM only: also renders the coloured shadow map in every colour format each frame and times them,
+	F cycles the format used for lighting, C compares every format's stored depths against RGBA32_SFLOAT */
+#define CSSM_FORMAT_COMPARISON 0
+
+/* CSSM only: the coloured stochastic shadow map is multisampled at a lower resolution, each translucent fragment covers
+	a stochastic share of its texel's samples and the lookup averages every sample, with a smaller kernel */
+#define CSSM_MSAA 0
+
+/* pick the shadow map resolution every frame from the light frustum's size and the shadow pass GPU time,
+	the maps stay allocated at SHADOW_MAP_RESOLUTION and smaller resolutions render into their top left corner */
+#define DYNAMIC_SHADOW_RESOLUTION 0
+
+/* SSM, CSSM and TRANSLUCENT_SHADOWS: an opaque camera depth pre-pass, then the shadow is evaluated once per pixel in
+	compute into a screen-space mask the opaque lighting reads with a single fetch. transparents keep the per-fragment lookup */
+#define SHADOW_MASK 0
+
+/* SHADOW_MASK only: opaque geometry writes a G-buffer (albedo, octahedral normal, emissive, depth) instead of a depth pre-pass,
+	and is lit by one full screen pass that reads the mask. transparents are still shaded forward on top */
+#define DEFERRED 0
+
+/* SHADOW_MASK with SSM or CSSM: the stochastic noise changes every frame and the mask is blended into its reprojected,
+	neighbourhood clamped history, so the mask's PCF kernel shrinks and the noise converges over frames instead */
+#define TEMPORAL_SHADOWS 0
+
+/* SHADOW_MASK with SSM or CSSM: the mask is evaluated with a tiny PCF kernel and a separable, depth and normal aware
+	bilateral filter hides the noise instead, its radius can be changed at runtime with [ and ] */
+#define DENOISED_SHADOWS 0
+
+/* spot and point lights on top of the technique's sun: every shadow view gets a tile of one shared atlas sized by its light's
+	screen coverage, the whole atlas is rendered in one pass (a viewport per view, translucent casters tint it as TS does)
+	and the lights are added by one extra forward pass that loops over the light list */
+#define LOCAL_LIGHTS 0
+
+/* VANILLA, TRANSLUCENT_SHADOWS and CTS: the static opaque casters' shadow map is rasterized on the CPU by every core
+	(SIMD edge functions over binned tiles) and copied in whenever the cache re-renders, instead of the opaque depth draw */
+#define CPU_SHADOW_RASTER 0
+
+/* VANILLA: the static translucent casters' coloured shadows are traced once on the CPU and kept next to the .glb, the lookup
+	reads them on top of the ordinary shadow map, which still has the opaque (and any moving) casters */
+#define BAKED_SHADOWS 0
+
 #define TIMING 0
 
 const float FOV = 90.0f / 180.0f * 3.1415f;
@@ -55,7 +128,104 @@ const float FOV = 90.0f / 180.0f * 3.1415f;
 #else
 	const float FarClipDist = 48.0f;
 #endif
+const char* const SceneModelPath = "../res/models/teapot scene.glb"; /* scene selection, the shadow bake is kept beside it */
 const float ShadowBufferDistance = 10.0f;
+const bool ShadowFitToScene = false; /* opt in: near plane on the nearest caster and the footprint clipped to the visible receivers, instead of ShadowBufferDistance */
+
+/* shadow cascade split scheme (the cascade count is SHADOW_CASCADE_COUNT in Constants.hpp) */
+const Renderer::Uniforms::CascadeSplit ShadowCascadeSplit = Renderer::Uniforms::CascadeSplit::PRACTICAL;
+const float ShadowCascadeLambda = 0.75f; /* PRACTICAL only: 0 = uniform, 1 = logarithmic */
+const float ShadowCacheGuardBand = 0.15f; /* extra cascade coverage (fraction of its radius) before a refit is needed */
+
+/* dynamic shadow resolution settings */
+const float ShadowTexelWorldSize = 0.005f; /* world units per texel wanted in the first cascade, finer is never rendered */
+const float ShadowGpuBudgetMs = 2.0f; /* shadow pass GPU time the resolution is lowered to stay under */
+const uint32_t ShadowResolutionHoldFrames = 30; /* frames between resolution changes, each one re-renders the maps */
+
+/* depth formats, the defaults are the baseline the timing results were taken with. every light-space range is fitted to
+	its cascade plus ShadowBufferDistance, tight enough for D16_UNORM shadow maps, and REVERSED spreads the camera's
+	float depth precision evenly instead of spending it next to the near plane */
+const Renderer::DepthFormat ShadowDepthFormat = Renderer::DepthFormat::D32_SFLOAT;
+const Renderer::DepthRange CameraDepthRange = Renderer::DepthRange::STANDARD;
+
+/* CSSM colour shadow map encoding, RGBA32_SFLOAT is the reference but 16 bytes per texel.
+	the smaller encodings are opt in, CSSM_FORMAT_COMPARISON measures them against it */
+const Renderer::CSSMColourFormat CSSMShadowColourFormat = Renderer::CSSMColourFormat::RGBA32_SFLOAT;
+
+/* CSSM_MSAA: samples per texel, the (lower) resolution the maps are allocated and rendered at, and the lookup's kernel */
+const Renderer::SampleCount CSSMMsaaSamples = Renderer::SampleCount::X8;
+const uint32_t CSSMMsaaResolution = SHADOW_MAP_RESOLUTION / 2;
+const uint32_t CSSMMsaaPCFRadius = 1;
+
+/* stochastic shadow passes: the alpha threshold pattern they start with (N cycles them), and the lookups' PCF radius
+	for each. the stratified patterns average out over far fewer texels, so they get a smaller kernel */
+const Renderer::NoisePattern StochasticNoisePattern = Renderer::NoisePattern::BLUE;
+const uint32_t StochasticPCFRadius[Renderer::NOISE_PATTERN_COUNT] = { 4, 2, 2 }; /* WHITE, BLUE, BAYER */
+const uint32_t TemporalPCFRadius = 1; /* TEMPORAL_SHADOWS: the accumulation does the filtering instead */
+const uint32_t DenoisedPCFRadius = 1; /* DENOISED_SHADOWS: the bilateral filter does the filtering instead */
+
+/* SSM and CSSM lookup quality tiers, K cycles them. each is a variant of the lookup pipelines specialised for its filter
+	and compiled at start up, so its kernel is unrolled. the first is the default, the radius above fixed in the same way
+	(a variant per noise pattern's radius, so N keeps it unrolled) */
+const uint32_t ShadowFilterTierCount = 4;
+const Renderer::ShadowFilter ShadowFilterTiers[ShadowFilterTierCount] = { {}, { 4 }, { 2 }, { 1 } };
+const uint32_t ShadowDenoiseRadius = 6; /* DENOISED_SHADOWS: pixels either side of each separable pass, [ and ] change it */
+const uint32_t ShadowDenoiseMaxRadius = 32;
+
+/* virtual shadow map settings (the page and pool sizes are in Constants.hpp) */
+const float VirtualShadowGuardBand = 0.5f; /* extra coverage before the virtual region moves and every page is dropped */
+const uint32_t VirtualShadowPageBudget = 64; /* most pages rendered in one frame, the rest wait for the next */
+const uint32_t VirtualShadowAnalysisWidth = 960; /* camera depth resolution used to find the pages that are needed */
+const uint32_t VirtualShadowAnalysisHeight = 540;
+
+#if VIRTUAL_SHADOWS and (SSM or CTS)
+	#error "VIRTUAL_SHADOWS supports VANILLA, TRANSLUCENT_SHADOWS and CSSM"
+#endif
+#if VIRTUAL_SHADOWS and TRANSLUCENT_SHADOWS and not TS_SINGLE_PASS
+	#error "VIRTUAL_SHADOWS with TRANSLUCENT_SHADOWS needs TS_SINGLE_PASS"
+#endif
+#if CSSM_FORMAT_COMPARISON and (not CSSM or VIRTUAL_SHADOWS)
+	#error "CSSM_FORMAT_COMPARISON needs CSSM without VIRTUAL_SHADOWS"
+#endif
+#if CSSM_MSAA and (not CSSM or VIRTUAL_SHADOWS or CSSM_FORMAT_COMPARISON)
+	#error "CSSM_MSAA needs CSSM without VIRTUAL_SHADOWS or CSSM_FORMAT_COMPARISON"
+#endif
+#if CSSM_MSAA and (SHADOW_MASK or DYNAMIC_SHADOW_RESOLUTION)
+	#error "CSSM_MSAA's maps are multisampled at a fixed resolution, the SHADOW_MASK and DYNAMIC_SHADOW_RESOLUTION paths can't read them"
+#endif
+#if DYNAMIC_SHADOW_RESOLUTION and VIRTUAL_SHADOWS
+	#error "DYNAMIC_SHADOW_RESOLUTION doesn't apply to VIRTUAL_SHADOWS, its pages are a fixed size"
+#endif
+#if VIRTUAL_SHADOWS and CMSM
+	#error "VIRTUAL_SHADOWS doesn't support CMSM, its pages can't be prefiltered independently"
+#endif
+#if VIRTUAL_SHADOWS and FOM
+	#error "VIRTUAL_SHADOWS doesn't support FOM"
+#endif
+#if SHADOW_MASK and not (SSM or CSSM or TRANSLUCENT_SHADOWS)
+	#error "SHADOW_MASK supports SSM, CSSM and TRANSLUCENT_SHADOWS"
+#endif
+#if SHADOW_MASK and (VIRTUAL_SHADOWS or CSSM_FORMAT_COMPARISON)
+	#error "SHADOW_MASK reads the regular shadow maps, it doesn't support VIRTUAL_SHADOWS or CSSM_FORMAT_COMPARISON"
+#endif
+#if TEMPORAL_SHADOWS and not (SHADOW_MASK and (SSM or CSSM))
+	#error "TEMPORAL_SHADOWS accumulates the stochastic shadow mask, it needs SHADOW_MASK with SSM or CSSM"
+#endif
+#if DENOISED_SHADOWS and not (SHADOW_MASK and (SSM or CSSM))
+	#error "DENOISED_SHADOWS filters the stochastic shadow mask, it needs SHADOW_MASK with SSM or CSSM"
+#endif
+#if DEFERRED and not SHADOW_MASK
+	#error "DEFERRED lights the G-buffer with the technique's shadow through the mask, it needs SHADOW_MASK"
+#endif
+#if LOCAL_LIGHTS and DEFERRED
+	#error "LOCAL_LIGHTS adds a forward pass over the shaded geometry, it doesn't support DEFERRED"
+#endif
+#if CPU_SHADOW_RASTER and (not (VANILLA or TRANSLUCENT_SHADOWS or CTS) or VIRTUAL_SHADOWS)
+	#error "CPU_SHADOW_RASTER replaces the opaque depth pass of VANILLA, TRANSLUCENT_SHADOWS and CTS, without VIRTUAL_SHADOWS"
+#endif
+#if BAKED_SHADOWS and (not VANILLA or VIRTUAL_SHADOWS or SHADOW_MASK)
+	#error "BAKED_SHADOWS adds the baked translucent shadows to VANILLA's forward lookup, without VIRTUAL_SHADOWS or SHADOW_MASK"
+#endif
 
 #define TECHNAME "undefined"
 #if VANILLA
@@ -78,6 +248,14 @@ const float ShadowBufferDistance = 10.0f;
 	#undef TECHNAME
 	#define TECHNAME "cts"
 #endif
+#if CMSM
+	#undef TECHNAME
+	#define TECHNAME "cmsm"
+#endif
+#if FOM
+	#undef TECHNAME
+	#define TECHNAME "fom"
+#endif
 
 #if TIMING 
 	#define TIMESTAMP(X) vkCmdWriteTimestamp(*env.CurrentCmdBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, X);
@@ -100,6 +278,7 @@ int main(int argc, char** argv)
 	simpleOpaqueFeatures.colourPass = Renderer::ColourPass::ENABLED;
 	simpleOpaqueFeatures.depthTest = Renderer::DepthTest::ENABLED;
 	simpleOpaqueFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
+	simpleOpaqueFeatures.depthRange = CameraDepthRange;
 	Renderer::RenderPass simpleOpaquePass(env.WindowPtr(), simpleOpaqueFeatures);
 	
 	Renderer::RenderPassFeatures presentFeatures;
@@ -112,14 +291,22 @@ int main(int argc, char** argv)
 	shadowPassFeatures.colourPass = Renderer::ColourPass::DISABLED;
 	shadowPassFeatures.depthTest = Renderer::DepthTest::ENABLED;
 	shadowPassFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_SHADOWMAP;
+	shadowPassFeatures.depthFormat = ShadowDepthFormat;
+	shadowPassFeatures.multiview = Renderer::Multiview::SHADOW_CASCADES;
 	Renderer::RenderPass shadowPass(env.WindowPtr(), shadowPassFeatures);
 
 	#if TRANSLUCENT_SHADOWS or CTS
+		/* the colour maps are smaller than the opaque map (TS_COLOUR_MAP_RESOLUTION) so they can't share its depth,
+			the pass has its own and starts by filling it with the farthest opaque depth under each texel */
 		Renderer::RenderPassFeatures TS_translucentShadowPassFeatures;
 		TS_translucentShadowPassFeatures.colourPass = Renderer::ColourPass::ENABLED;
 		TS_translucentShadowPassFeatures.depthTest = Renderer::DepthTest::ENABLED;
 		TS_translucentShadowPassFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
-		TS_translucentShadowPassFeatures.clearDepth = Renderer::ClearDepth::DISABLED;
+		TS_translucentShadowPassFeatures.depthFormat = ShadowDepthFormat;
+		TS_translucentShadowPassFeatures.multiview = Renderer::Multiview::SHADOW_CASCADES;
+		#if TS_SINGLE_PASS
+			TS_translucentShadowPassFeatures.specialColour = Renderer::SpecialColour::TS_COLOUR_AND_DEPTH;
+		#endif
 		Renderer::RenderPass TS_translucentShadowPass(env.WindowPtr(), TS_translucentShadowPassFeatures);
 	#endif
 
@@ -128,6 +315,7 @@ int main(int argc, char** argv)
 		CTS_compositingFeatures.colourPass = Renderer::ColourPass::ENABLED;
 		CTS_compositingFeatures.depthTest = Renderer::DepthTest::ENABLED;
 		CTS_compositingFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
+		CTS_compositingFeatures.depthRange = CameraDepthRange;
 		CTS_compositingFeatures.clearColour = Renderer::ClearColour::DISABLED;
 		CTS_compositingFeatures.clearDepth = Renderer::ClearDepth::DISABLED;
 		Renderer::RenderPass CTS_compositingPass(env.WindowPtr(), CTS_compositingFeatures);
@@ -138,10 +326,106 @@ int main(int argc, char** argv)
 		CSSM_shadowFeatures.colourPass = Renderer::ColourPass::ENABLED;
 		CSSM_shadowFeatures.depthTest = Renderer::DepthTest::ENABLED;
 		CSSM_shadowFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
+		CSSM_shadowFeatures.depthFormat = ShadowDepthFormat;
 		CSSM_shadowFeatures.specialColour = Renderer::SpecialColour::CSSM_SHADOWMAP;
+		CSSM_shadowFeatures.multiview = Renderer::Multiview::SHADOW_CASCADES;
+		CSSM_shadowFeatures.cssmColourFormat = CSSMShadowColourFormat;
+		#if CSSM_MSAA
+			CSSM_shadowFeatures.sampleCount = CSSMMsaaSamples;
+		#endif
 		Renderer::RenderPass CSSM_shadowPass(env.WindowPtr(), CSSM_shadowFeatures);
 	#endif
 
+	#if CMSM
+		Renderer::RenderPassFeatures CMSM_shadowFeatures;
+		CMSM_shadowFeatures.colourPass = Renderer::ColourPass::ENABLED;
+		CMSM_shadowFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		CMSM_shadowFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
+		CMSM_shadowFeatures.depthFormat = ShadowDepthFormat;
+		CMSM_shadowFeatures.specialColour = Renderer::SpecialColour::CMSM_MOMENTS;
+		CMSM_shadowFeatures.multiview = Renderer::Multiview::SHADOW_CASCADES;
+		Renderer::RenderPass CMSM_shadowPass(env.WindowPtr(), CMSM_shadowFeatures);
+	#endif
+
+	#if FOM
+		Renderer::RenderPassFeatures FOM_shadowFeatures;
+		FOM_shadowFeatures.colourPass = Renderer::ColourPass::ENABLED;
+		FOM_shadowFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		FOM_shadowFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
+		FOM_shadowFeatures.depthFormat = ShadowDepthFormat;
+		FOM_shadowFeatures.specialColour = Renderer::SpecialColour::FOM_COEFFICIENTS;
+		FOM_shadowFeatures.multiview = Renderer::Multiview::SHADOW_CASCADES;
+		Renderer::RenderPass FOM_shadowPass(env.WindowPtr(), FOM_shadowFeatures);
+	#endif
+
+	#if VIRTUAL_SHADOWS
+		/* VIRTUAL SHADOWS: pages are cleared and drawn one at a time, so the page passes keep the pool contents */
+		#if not CSSM
+			Renderer::RenderPassFeatures VSM_pageFeatures;
+			VSM_pageFeatures.colourPass = Renderer::ColourPass::DISABLED;
+			VSM_pageFeatures.depthTest = Renderer::DepthTest::ENABLED;
+			VSM_pageFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_SHADOWMAP;
+			VSM_pageFeatures.depthFormat = ShadowDepthFormat;
+			VSM_pageFeatures.clearDepth = Renderer::ClearDepth::DISABLED;
+			Renderer::RenderPass VSM_pagePass(env.WindowPtr(), VSM_pageFeatures);
+		#endif
+
+		#if TRANSLUCENT_SHADOWS
+			Renderer::RenderPassFeatures VSM_translucentPageFeatures = TS_translucentShadowPassFeatures;
+			VSM_translucentPageFeatures.clearDepth = Renderer::ClearDepth::DISABLED; /* the pool's pages share the opaque depth */
+			VSM_translucentPageFeatures.clearColour = Renderer::ClearColour::DISABLED;
+			VSM_translucentPageFeatures.multiview = Renderer::Multiview::DISABLED;
+			Renderer::RenderPass VSM_translucentPagePass(env.WindowPtr(), VSM_translucentPageFeatures);
+		#endif
+
+		#if CSSM
+			Renderer::RenderPassFeatures VSM_cssmPageFeatures = CSSM_shadowFeatures;
+			VSM_cssmPageFeatures.clearColour = Renderer::ClearColour::DISABLED;
+			VSM_cssmPageFeatures.clearDepth = Renderer::ClearDepth::DISABLED;
+			VSM_cssmPageFeatures.multiview = Renderer::Multiview::DISABLED;
+			Renderer::RenderPass VSM_cssmPagePass(env.WindowPtr(), VSM_cssmPageFeatures);
+		#endif
+
+		/* VIRTUAL SHADOWS: camera depth pass that marks the pages its fragments fall in */
+		Renderer::RenderPassFeatures VSM_analysisFeatures;
+		VSM_analysisFeatures.colourPass = Renderer::ColourPass::DISABLED;
+		VSM_analysisFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		VSM_analysisFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_SHADOWMAP;
+		VSM_analysisFeatures.depthRange = CameraDepthRange;
+		Renderer::RenderPass VSM_analysisPass(env.WindowPtr(), VSM_analysisFeatures);
+	#endif
+
+	#if SHADOW_MASK and not DEFERRED
+		/* SHADOW MASK: opaque camera depth, the mask is evaluated for these surfaces */
+		Renderer::RenderPassFeatures SM_depthPassFeatures;
+		SM_depthPassFeatures.colourPass = Renderer::ColourPass::DISABLED;
+		SM_depthPassFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		SM_depthPassFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_SHADOWMAP;
+		SM_depthPassFeatures.depthRange = CameraDepthRange;
+		Renderer::RenderPass SM_depthPass(env.WindowPtr(), SM_depthPassFeatures);
+	#endif
+
+	#if DEFERRED
+		/* DEFERRED: opaque G-buffer, its depth also feeds the shadow mask */
+		Renderer::RenderPassFeatures DS_gBufferPassFeatures;
+		DS_gBufferPassFeatures.colourPass = Renderer::ColourPass::ENABLED;
+		DS_gBufferPassFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		DS_gBufferPassFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
+		DS_gBufferPassFeatures.depthRange = CameraDepthRange;
+		DS_gBufferPassFeatures.specialColour = Renderer::SpecialColour::GBUFFER;
+		Renderer::RenderPass DS_gBufferPass(env.WindowPtr(), DS_gBufferPassFeatures);
+	#endif
+
+	#if LOCAL_LIGHTS
+		/* LOCAL LIGHTS: opaque depth, nearest translucent depth and translucent colour of every atlas view, in one pass */
+		Renderer::RenderPassFeatures LL_atlasPassFeatures;
+		LL_atlasPassFeatures.colourPass = Renderer::ColourPass::ENABLED;
+		LL_atlasPassFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		LL_atlasPassFeatures.renderTarget = Renderer::RenderTarget::TEXTURE_GEOMETRY;
+		LL_atlasPassFeatures.specialColour = Renderer::SpecialColour::TS_COLOUR_AND_DEPTH;
+		Renderer::RenderPass LL_atlasPass(env.WindowPtr(), LL_atlasPassFeatures);
+	#endif
+
 	/* initialise swapchain */
 	env.InitialiseSwapChain({ &simpleOpaquePass, &presentPass });
 
@@ -153,6 +437,7 @@ int main(int argc, char** argv)
 	/* set up the camera */
 	Renderer::ViewerCamera camera(&env, FOV, 0.1f, FarClipDist,
 		env.Window().swapchainExtent.width, env.Window().swapchainExtent.height);
+	camera.SetReversedDepth(CameraDepthRange == Renderer::DepthRange::REVERSED);
 	// camera.SetPosition(glm::vec3(0.0f, -1.0f, -15.0f));
 	// camera.FrameUpdate(0.01f);
 
@@ -223,8 +508,30 @@ int main(int argc, char** argv)
 	Renderer::DescriptorSet lightingSet(&env, &lightingUniformLayout, *lightingUBO);
 
 	/* shadow data, uniform, and descriptor sets */
+	Renderer::ShadowCache shadowCache(ShadowCacheGuardBand);
+	#if SHADOW_CACHE
+		Renderer::ShadowCache* shadowCachePtr = &shadowCache;
+	#else
+		Renderer::ShadowCache* shadowCachePtr = nullptr;
+	#endif
+
 	Renderer::Uniforms::DirectionalShadowData shadowData;
-	shadowData.Update(&camera, &lights.sunLight, ShadowBufferDistance);
+	shadowData.Update(&camera, &lights.sunLight, ShadowBufferDistance, 0.0f, ShadowCascadeSplit, ShadowCascadeLambda, shadowCachePtr);
+	shadowData.cascadeInfo.y = static_cast<uint32_t>(CSSMShadowColourFormat); /* the lookup's encoding tolerance */
+
+	/* every pass's viewport is set to the extent it begins with, so the resolution the shadows render at can change between frames */
+	#if CSSM_MSAA
+		uint32_t shadowResolution = CSSMMsaaResolution;
+		shadowCache.SetResolution(shadowResolution);
+	#else
+		uint32_t shadowResolution = SHADOW_MAP_RESOLUTION;
+	#endif
+	shadowData.cascadeInfo.z = shadowResolution;
+
+	#if DYNAMIC_SHADOW_RESOLUTION
+		Renderer::ShadowResolutionPolicy shadowResolutionPolicy(&env, SHADOW_MAP_RESOLUTION,
+			ShadowTexelWorldSize, ShadowGpuBudgetMs, ShadowResolutionHoldFrames);
+	#endif
 
 	/* create image buffers for the shadow maps */
 	uint32_t shadowMapIndex = env.CreateSideBuffers(&shadowPass, 1, Renderer::Environment::SideBufferType::DEPTH);
@@ -234,7 +541,8 @@ int main(int argc, char** argv)
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
 		Renderer::FreeUpdateBuffer(&env, &shadowMapProjUBO, 0, sizeof(Renderer::Uniforms::DirectionalShadowData), &shadowData);
 
-	Renderer::DescriptorSetLayout shadowMapProjSetLayout(&env, { true, false, false }, Renderer::DescriptorSetType::UNIFORM_BUFFER);
+	/* the stochastic shadow passes' fragment shaders read the noise frame */
+	Renderer::DescriptorSetLayout shadowMapProjSetLayout(&env, { true, true, false }, Renderer::DescriptorSetType::UNIFORM_BUFFER);
 
 	Renderer::DescriptorSetLayoutFeatures shadowMapSetFeatures;
 	shadowMapSetFeatures.stages.fragment = true;
@@ -280,11 +588,7 @@ int main(int argc, char** argv)
 	singleTextureLayoutData.pBindingTypes = &singleTextureTypes;
 	Renderer::DescriptorSetLayout singleTextureLayout(&env, singleTextureLayoutData);
 
-	/* load model */
-	Renderer::Model model(&env, "../res/models/teapot scene.glb", &simpleLayout, &defaultSampler); /* scene selection */
-	model.SortTransparentGeometry(-lights.sunLight.direction * 9999.9f, camera.Position());
-
-	/* Pipelines and Dependencies */
+	/* Pipelines and Dependencies: they compile on the pipeline cache's workers while the model loads */
 	std::vector<const VkDescriptorSetLayout*> simpleLayouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*shadowMapLayout };
 	Renderer::Pipeline simplePipeline(&env, Renderer::Pipeline_Default, &simpleOpaquePass, simpleLayouts);
 	
@@ -308,17 +612,88 @@ int main(int argc, char** argv)
 	shadowPipelineFeatures.specialMode = Renderer::SpecialMode::SHADOW_MAP;
 	Renderer::Pipeline shadowPipeline(&env, shadowPipelineFeatures, &shadowPass, shadowLayouts);
 
+	/* load model */
+	Renderer::Model model(&env, SceneModelPath, &simpleLayout, &defaultSampler);
+	model.SortTransparentGeometry(-lights.sunLight.direction * 9999.9f, camera.Position());
+
+	/* scene-aware shadow fitting: the casters never move, the visible receivers are found again whenever the camera does */
+	Renderer::Uniforms::ShadowFitBounds shadowFitBounds;
+	model.CasterBounds(&shadowFitBounds.casters);
+	shadowFitBounds.receiversVisible = model.VisibleBounds(camera.GetUniformDataPtr()->projView,
+		&shadowFitBounds.receiverMin, &shadowFitBounds.receiverMax);
+	const Renderer::Uniforms::ShadowFitBounds* shadowFitBoundsPtr = (ShadowFitToScene) ? &shadowFitBounds : nullptr;
+	shadowData.Update(&camera, &lights.sunLight, ShadowBufferDistance, 0.0f, ShadowCascadeSplit, ShadowCascadeLambda, shadowCachePtr, shadowFitBoundsPtr);
+
+	#if CPU_SHADOW_RASTER
+		Renderer::ShadowRasterizer shadowRasterizer(&env, &model, ShadowDepthFormat);
+		printf("CPU shadow rasterizer: %u triangles, %u threads\n", shadowRasterizer.TriangleCount(), shadowRasterizer.ThreadCount());
+	#endif
+
+	#if BAKED_SHADOWS /* BAKED SHADOWS IMPLEMENTATION: START UP TASKS */
+		/* BAKED SHADOWS: read from beside the model, or traced now and written there */
+		Renderer::ShadowBake BS_bake(&env, &model, SceneModelPath, glm::vec3(lights.sunLight.direction));
+		if (BS_bake.Loaded())
+			printf("Shadow bake loaded from [%s]\n", Renderer::ShadowBake::BakePath(SceneModelPath).c_str());
+		else
+			printf("Shadow bake traced in %.2f s\n", BS_bake.BakeSeconds());
+
+		/* BAKED SHADOWS: the ordinary shadow map set, with the bake and its light view after it */
+		Renderer::DescriptorSetLayoutFeatures BS_shadowMapSetFeatures;
+		BS_shadowMapSetFeatures.stages.fragment = true;
+		BS_shadowMapSetFeatures.bindingCount = 4;
+		Renderer::DescriptorSetType BS_shadowMapSetTypes[4]
+		{
+			Renderer::DescriptorSetType::SAMPLER, /* shadowmap texture */
+			Renderer::DescriptorSetType::UNIFORM_BUFFER, /* shadowmap transform data */
+			Renderer::DescriptorSetType::SAMPLER, /* baked translucent layers */
+			Renderer::DescriptorSetType::UNIFORM_BUFFER /* bake transform data */
+		};
+		BS_shadowMapSetFeatures.pBindingTypes = BS_shadowMapSetTypes;
+		Renderer::DescriptorSetLayout BS_shadowMapLayout(&env, BS_shadowMapSetFeatures);
+
+		std::vector<Renderer::DescriptorSetFeatures> BS_shadowBindingData = bindingData;
+		BS_shadowBindingData.resize(4);
+
+		BS_shadowBindingData[2].binding = 2;
+		BS_shadowBindingData[2].s_View = *BS_bake.View();
+		BS_shadowBindingData[2].s_Sampler = *defaultSampler;
+
+		BS_shadowBindingData[3].binding = 3;
+		BS_shadowBindingData[3].u_Buffer = BS_bake.Buffer();
+		Renderer::DescriptorSet BS_shadowMapSet(&env, &BS_shadowMapLayout, 4, BS_shadowBindingData.data());
+
+		std::vector<const VkDescriptorSetLayout*> BS_layouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*BS_shadowMapLayout };
+		Renderer::PipelineFeatures BS_defaultFeatures = Renderer::Pipeline_Default;
+		BS_defaultFeatures.specialMode = Renderer::SpecialMode::BAKED_DEFAULT;
+		Renderer::Pipeline BS_defaultPipeline(&env, BS_defaultFeatures, &simpleOpaquePass, BS_layouts);
+
+		Renderer::PipelineFeatures BS_transparentFeatures = transparentFeatures;
+		BS_transparentFeatures.specialMode = Renderer::SpecialMode::BAKED_DEFAULT;
+		Renderer::Pipeline BS_transparentPipeline(&env, BS_transparentFeatures, &simpleOpaquePass, BS_layouts);
+	#endif
+
 	#if TRANSLUCENT_SHADOWS or CTS /* TRANSLUCENT SHADOWS IMPLEMENTATION: START UP TASKS */
 		/* TRANSLUCENT SHADOWS: extra buffers for translucent shadows */
-		uint32_t TS_translucentDepthMapIndex = env.CreateSideBuffers(&shadowPass, 1, Renderer::Environment::SideBufferType::DEPTH,
-			false, nullptr, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION);
-		Renderer::SideBufferShareData TS_translucentShareData;
-		TS_translucentShareData.depthIndex = shadowMapIndex;
-		TS_translucentShareData.depthSubindex = 0;
+		const uint32_t TS_colourMipLevels = static_cast<uint32_t>(std::floor(std::log2(static_cast<float>(TS_COLOUR_MAP_RESOLUTION)))) + 1;
 		uint32_t TS_translucentShadowMapIndex = env.CreateSideBuffers(&TS_translucentShadowPass, 1, Renderer::Environment::SideBufferType::COMBINED,
-			true, &TS_translucentShareData, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION);
-		lut::ImageView* TS_translucentDepthMapView = &(*env.GetSideBufferImageView(TS_translucentDepthMapIndex))[0];
-		lut::ImageView* TS_translucentShadowMapView = &(*env.GetSideBufferImageView(TS_translucentShadowMapIndex))[0];
+			false, nullptr, TS_COLOUR_MAP_RESOLUTION, TS_COLOUR_MAP_RESOLUTION, false, TS_colourMipLevels);
+		const lut::ImageView* TS_translucentShadowMapView = env.GetSideBufferMipView(TS_translucentShadowMapIndex);
+
+		#if TS_SINGLE_PASS
+			/* the nearest translucent depth is the second colour attachment of the colour pass */
+			lut::Image* TS_translucentDepthMap = &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[1];
+			lut::ImageView* TS_translucentDepthMapView = &(*env.GetSideBufferImageView(TS_translucentShadowMapIndex))[1];
+			const bool TS_translucentDepthIsDepth = false;
+		#else
+			uint32_t TS_translucentDepthMapIndex = env.CreateSideBuffers(&shadowPass, 1, Renderer::Environment::SideBufferType::DEPTH,
+				false, nullptr, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION);
+			lut::Image* TS_translucentDepthMap = &(*env.GetSideBufferImage(TS_translucentDepthMapIndex))[0];
+			lut::ImageView* TS_translucentDepthMapView = &(*env.GetSideBufferImageView(TS_translucentDepthMapIndex))[0];
+			const bool TS_translucentDepthIsDepth = true;
+		#endif
+
+		/* TRANSLUCENT SHADOWS: the translucent depth is compared manually in the shader, so it needs a plain sampler */
+		lut::Sampler TS_translucentDepthSampler = Renderer::CreateDefaultShadowSampler(env.Window(), false);
 
 		/* TRANSLUCENT SHADOWS: shadowmap set needs two depth textures and a colour texture */
 
@@ -344,11 +719,11 @@ int main(int argc, char** argv)
 
 		TS_shadowBindingData[1].binding = 1;
 		TS_shadowBindingData[1].s_View = **TS_translucentDepthMapView;
-		TS_shadowBindingData[1].s_Sampler = *shadowSampler;
+		TS_shadowBindingData[1].s_Sampler = *TS_translucentDepthSampler;
 
 		TS_shadowBindingData[2].binding = 2;
 		TS_shadowBindingData[2].s_View = **TS_translucentShadowMapView;
-		TS_shadowBindingData[2].s_Sampler = *shadowSampler;
+		TS_shadowBindingData[2].s_Sampler = *TS_translucentDepthSampler; /* filtered between mips, never compared */
 
 		TS_shadowBindingData[3].binding = 3;
 		TS_shadowBindingData[3].u_Buffer = *shadowMapProjUBO;
@@ -374,22 +749,69 @@ int main(int argc, char** argv)
 		TS_transparentFeatures.depthTest = Renderer::DepthTest::ENABLED;
 		TS_transparentFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
 		TS_transparentFeatures.specialMode = Renderer::SpecialMode::TS_COLOURED_SHADOW_MAP;
-		Renderer::Pipeline TS_transparentPipeline(&env, TS_transparentFeatures, &simpleOpaquePass, TS_transparentPipelineLayouts);
+		Renderer::Pipeline TS_transparentPipeline(&env, TS_transparentFeatures, &TS_translucentShadowPass, TS_transparentPipelineLayouts);
+
+		/* the colour pass's depth, the farthest opaque depth under each of its texels, so casters behind the opaque ones are left out */
+		std::vector<const VkDescriptorSetLayout*> TS_opaqueDepthLayouts = { &*singleTextureLayout };
+		Renderer::PipelineFeatures TS_opaqueDepthFeatures = Renderer::Pipeline_Default;
+		TS_opaqueDepthFeatures.depthOp = Renderer::DepthOp::ALWAYS;
+		TS_opaqueDepthFeatures.colorWrite = Renderer::ColorWrite::DISABLED;
+		TS_opaqueDepthFeatures.specialMode = Renderer::SpecialMode::TS_OPAQUE_DEPTH;
+		Renderer::Pipeline TS_opaqueDepthPipeline(&env, TS_opaqueDepthFeatures, &TS_translucentShadowPass, TS_opaqueDepthLayouts);
+		Renderer::DescriptorSet TS_opaqueDepthSet(&env, &singleTextureLayout, **shadowMapView, *pointSampler);
 	#endif
 
 	#if SSM or CSSM
 
-		/* Both stochastic approaches utilise a noise texture */
+		/* Both stochastic approaches utilise a noise texture, every pattern is loaded so N can switch between them */
 
-		lut::Image noiseImage = lut::load_image_texture2d("../res/images/rgb_noise_2048.png",
-			env.Window(), *env.CommandPool(), env.Allocator(), VK_FORMAT_R8G8B8A8_UNORM);
-		lut::ImageView noiseView = Renderer::CreateImageView(&env, *noiseImage, VK_FORMAT_R8G8B8A8_UNORM);
+		Renderer::NoisePatterns noisePatterns(&env, &singleTextureLayout, *pointSampler, "../res/cache", StochasticNoisePattern);
+		Renderer::DescriptorSet* noiseTextureSet = noisePatterns.Set();
+		bool noiseCycleLastFrame = false;
 
-		Renderer::DescriptorSet noiseTextureSet(&env, &singleTextureLayout, *noiseView, *pointSampler);
+		uint32_t shadowFilterTier = 0;
+		bool shadowFilterCycleLastFrame = false;
+
+		shadowData.samplingInfo.x = static_cast<uint32_t>(noisePatterns.Pattern());
+		#if TEMPORAL_SHADOWS
+			shadowData.samplingInfo.y = TemporalPCFRadius;
+		#elif DENOISED_SHADOWS
+			shadowData.samplingInfo.y = DenoisedPCFRadius;
+		#elif CSSM_MSAA
+			shadowData.samplingInfo.y = CSSMMsaaPCFRadius;
+		#else
+			shadowData.samplingInfo.y = StochasticPCFRadius[static_cast<uint32_t>(noisePatterns.Pattern())];
+		#endif
+		Renderer::ShadowFilter shadowFilter{ shadowData.samplingInfo.y }; /* the tier's filter, with the default's radius filled in */
 	#endif
 
 	#if SSM
 
+		/* min/max depth pyramid, so the lookup only runs the big PCF kernel in penumbrae */
+		Renderer::ShadowDepthPyramid SSM_pyramid(&env, SHADOW_MAP_RESOLUTION, SHADOW_CASCADE_COUNT,
+			shadowMapView, nullptr, *pointSampler, *shadowMapProjUBO);
+
+		Renderer::DescriptorSetLayoutFeatures SSM_shadowMapSetFeatures;
+		SSM_shadowMapSetFeatures.stages.fragment = true;
+		SSM_shadowMapSetFeatures.bindingCount = 3;
+		Renderer::DescriptorSetType SSM_shadowMapSetTypes[3]
+		{
+			Renderer::DescriptorSetType::SAMPLER, /* shadowmap texture */
+			Renderer::DescriptorSetType::UNIFORM_BUFFER, /* shadowmap transform data */
+			Renderer::DescriptorSetType::SAMPLER /* shadow depth pyramid */
+		};
+		SSM_shadowMapSetFeatures.pBindingTypes = SSM_shadowMapSetTypes;
+		Renderer::DescriptorSetLayout SSM_shadowMapLayout(&env, SSM_shadowMapSetFeatures);
+
+		std::vector<Renderer::DescriptorSetFeatures> SSM_shadowBindingData = bindingData;
+		SSM_shadowBindingData.resize(3);
+
+		SSM_shadowBindingData[2].binding = 2;
+		SSM_shadowBindingData[2].s_View = *SSM_pyramid.View();
+		SSM_shadowBindingData[2].s_Sampler = *pointSampler;
+
+		Renderer::DescriptorSet SSM_shadowMapSet(&env, &SSM_shadowMapLayout, 3, SSM_shadowBindingData.data());
+
 		std::vector<const VkDescriptorSetLayout*> SSM_shadowLayouts = { &*shadowMapProjSetLayout, &*simpleLayout, &*singleTextureLayout };
 		Renderer::PipelineFeatures SSM_shadowPipelineFeatures;
 		SSM_shadowPipelineFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
@@ -399,43 +821,83 @@ int main(int argc, char** argv)
 
 		Renderer::PipelineFeatures SMM_defaultFeatures = Renderer::Pipeline_Default;
 		SMM_defaultFeatures.specialMode = Renderer::SpecialMode::SSM_DEFAULT_BIG_PCF;
-		Renderer::Pipeline SSM_defaultPipeline(&env, SMM_defaultFeatures, &simpleOpaquePass, simpleLayouts);
+		SMM_defaultFeatures.shadowFilter = shadowFilter;
+		std::vector<const VkDescriptorSetLayout*> SSM_layouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*SSM_shadowMapLayout };
+		Renderer::Pipeline SSM_defaultPipeline(&env, SMM_defaultFeatures, &simpleOpaquePass, SSM_layouts);
 
 		Renderer::PipelineFeatures SSM_transparentFeatures = transparentFeatures;
 		SSM_transparentFeatures.specialMode = Renderer::SpecialMode::SSM_DEFAULT_BIG_PCF;
-		Renderer::Pipeline SSM_transparentPipeline(&env, SSM_transparentFeatures, &simpleOpaquePass, simpleLayouts);
+		SSM_transparentFeatures.shadowFilter = shadowFilter;
+		Renderer::Pipeline SSM_transparentPipeline(&env, SSM_transparentFeatures, &simpleOpaquePass, SSM_layouts);
+
+		for (uint32_t i = 1; i < ShadowFilterTierCount; i++)
+		{
+			SSM_defaultPipeline.PrepareVariant(&env, ShadowFilterTiers[i]);
+			SSM_transparentPipeline.PrepareVariant(&env, ShadowFilterTiers[i]);
+		}
+		#if not (TEMPORAL_SHADOWS or DENOISED_SHADOWS or CSSM_MSAA)
+			for (uint32_t i = 0; i < Renderer::NOISE_PATTERN_COUNT; i++)
+			{
+				SSM_defaultPipeline.PrepareVariant(&env, { StochasticPCFRadius[i] });
+				SSM_transparentPipeline.PrepareVariant(&env, { StochasticPCFRadius[i] });
+			}
+		#endif
 	#endif
 
 	#if CSSM
 
 		/* Buffers */
 
-		uint32_t CSSM_shadowMapIndex = env.CreateSideBuffers(
-			&CSSM_shadowPass, 1, Renderer::Environment::SideBufferType::COMBINED,
-			false, nullptr, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION, true);
+		#if CSSM_MSAA
+			uint32_t CSSM_shadowMapIndex = env.CreateSideBuffers(
+				&CSSM_shadowPass, 1, Renderer::Environment::SideBufferType::COMBINED,
+				false, nullptr, CSSMMsaaResolution, CSSMMsaaResolution, true);
+		#else
+			uint32_t CSSM_shadowMapIndex = env.CreateSideBuffers(
+				&CSSM_shadowPass, 1, Renderer::Environment::SideBufferType::COMBINED,
+				false, nullptr, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION, true);
+		#endif
 		lut::ImageView* CSSM_shadowMapView = &(*env.GetSideBufferImageView(CSSM_shadowMapIndex))[0];
 		lut::ImageView* CSSM_depthMapView = &(*env.GetSideBufferImageView(CSSM_shadowMapIndex))[1];
 
+		/* min/max pyramid over the opaque and coloured depths, so the lookup only runs PCF in penumbrae.
+			the multisampled maps are read per sample instead, with a kernel small enough not to need it */
+		#if not CSSM_MSAA
+			Renderer::ShadowDepthPyramid CSSM_pyramid(&env, SHADOW_MAP_RESOLUTION, SHADOW_CASCADE_COUNT,
+				CSSM_depthMapView, CSSM_shadowMapView, *pointSampler, *shadowMapProjUBO);
+		#endif
+
 		/* Descriptor Sets */
 
+		#if CSSM_MSAA
+			const uint32_t CSSM_shadowBindingCount = 3;
+		#else
+			const uint32_t CSSM_shadowBindingCount = 4;
+		#endif
+
 		Renderer::DescriptorSetLayoutFeatures CSSM_shadowMapSetFeatures;
 		CSSM_shadowMapSetFeatures.stages.fragment = true;
-		CSSM_shadowMapSetFeatures.bindingCount = 3;
-		Renderer::DescriptorSetType CSSM_shadowMapSetTypes[3]
+		CSSM_shadowMapSetFeatures.bindingCount = CSSM_shadowBindingCount;
+		Renderer::DescriptorSetType CSSM_shadowMapSetTypes[4]
 		{
 			Renderer::DescriptorSetType::SAMPLER, /* shadowmap texture */
 			Renderer::DescriptorSetType::SAMPLER, /* shadow colour texture */
-			Renderer::DescriptorSetType::UNIFORM_BUFFER /* shadow transform data */
+			Renderer::DescriptorSetType::UNIFORM_BUFFER, /* shadow transform data */
+			Renderer::DescriptorSetType::SAMPLER /* shadow depth pyramid */
 		};
 		CSSM_shadowMapSetFeatures.pBindingTypes = CSSM_shadowMapSetTypes;
 		Renderer::DescriptorSetLayout CSSM_shadowMapLayout(&env, CSSM_shadowMapSetFeatures);
 
 		std::vector<Renderer::DescriptorSetFeatures> CSSM_shadowBindingData{};
-		CSSM_shadowBindingData.resize(3);
+		CSSM_shadowBindingData.resize(CSSM_shadowBindingCount);
 
 		CSSM_shadowBindingData[0].binding = 0;
 		CSSM_shadowBindingData[0].s_View = **CSSM_depthMapView;
-		CSSM_shadowBindingData[0].s_Sampler = *shadowSampler;
+		#if CSSM_MSAA
+			CSSM_shadowBindingData[0].s_Sampler = *pointSampler; /* fetched per sample, never compared */
+		#else
+			CSSM_shadowBindingData[0].s_Sampler = *shadowSampler;
+		#endif
 
 		CSSM_shadowBindingData[1].binding = 1;
 		CSSM_shadowBindingData[1].s_View = **CSSM_shadowMapView;
@@ -444,7 +906,13 @@ int main(int argc, char** argv)
 		CSSM_shadowBindingData[2].binding = 2;
 		CSSM_shadowBindingData[2].u_Buffer = *shadowMapProjUBO;
 
-		Renderer::DescriptorSet CSSM_shadowMapSet(&env, &CSSM_shadowMapLayout, 3, CSSM_shadowBindingData.data());
+		#if not CSSM_MSAA
+			CSSM_shadowBindingData[3].binding = 3;
+			CSSM_shadowBindingData[3].s_View = *CSSM_pyramid.View();
+			CSSM_shadowBindingData[3].s_Sampler = *pointSampler;
+		#endif
+
+		Renderer::DescriptorSet CSSM_shadowMapSet(&env, &CSSM_shadowMapLayout, CSSM_shadowBindingCount, CSSM_shadowBindingData.data());
 
 		/* Pipelines */
 
@@ -457,281 +925,1476 @@ int main(int argc, char** argv)
 		Renderer::Pipeline CSSM_shadowOpaquePipeline(&env, CSSM_shadowPipelineFeatures, &CSSM_shadowPass, CSSM_shadowLayouts);
 
 		CSSM_shadowPipelineFeatures.alphaBlend = Renderer::AlphaBlend::ENABLED;
-		CSSM_shadowPipelineFeatures.specialMode = Renderer::SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP_2;
+		#if CSSM_MSAA
+			CSSM_shadowPipelineFeatures.specialMode = Renderer::SpecialMode::CSSM_MSAA_SHADOW_MAP;
+		#else
+			CSSM_shadowPipelineFeatures.specialMode = Renderer::SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP_2;
+		#endif
 		CSSM_shadowPipelineFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
 		CSSM_shadowPipelineFeatures.blendMode = Renderer::BlendMode::MIN_ONE_ONE;
 		Renderer::Pipeline CSSM_shadowTransparentPipeline(&env, CSSM_shadowPipelineFeatures, &CSSM_shadowPass, CSSM_shadowLayouts);
 
 		std::vector<const VkDescriptorSetLayout*> CSSM_layouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*CSSM_shadowMapLayout };
 		Renderer::PipelineFeatures CSMM_defaultFeatures = Renderer::Pipeline_Default;
-		CSMM_defaultFeatures.specialMode = Renderer::SpecialMode::CSSM_DEFAULT;
+		#if CSSM_MSAA
+			CSMM_defaultFeatures.specialMode = Renderer::SpecialMode::CSSM_MSAA_DEFAULT;
+		#else
+			CSMM_defaultFeatures.specialMode = Renderer::SpecialMode::CSSM_DEFAULT;
+		#endif
+		CSMM_defaultFeatures.shadowFilter = shadowFilter;
 		Renderer::Pipeline CSSM_defaultPipeline(&env, CSMM_defaultFeatures, &simpleOpaquePass, CSSM_layouts);
 
 		Renderer::PipelineFeatures CSSM_transparentFeatures = transparentFeatures;
-		CSSM_transparentFeatures.specialMode = Renderer::SpecialMode::CSSM_DEFAULT;
+		CSSM_transparentFeatures.specialMode = CSMM_defaultFeatures.specialMode;
+		CSSM_transparentFeatures.shadowFilter = shadowFilter;
 		Renderer::Pipeline CSSM_transparentPipeline(&env, CSSM_transparentFeatures, &simpleOpaquePass, CSSM_layouts);
-	#endif
-
-	#if CTS
-		Renderer::PipelineFeatures CTS_transparentGeometryFeatures = TS_geometryFeatures;
-		CTS_transparentGeometryFeatures.alphaBlend = Renderer::AlphaBlend::ENABLED;
-		CTS_transparentGeometryFeatures.depthTest = Renderer::DepthTest::ENABLED;
-		CTS_transparentGeometryFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
-		Renderer::Pipeline CTS_transparentGeometryPipeline(&env, CTS_transparentGeometryFeatures, &CTS_compositingPass, TS_simpleLayouts);
-	#endif
 
-	#if TIMING
-		/* Create timing resources */
-		uint64_t timestampResults[8]{};
-		/*  [0]: frame start
-			[1]: frame end
-			[2]: shadow mapping start 
-			[3]: shadow mapping end
-			[4]: geometry draw start
-			[5]: geometry draw end 
-			[6]: combination draw begin
-			[7]: combination draw end */
-		uint32_t lastmeshLimit = 0;
-
-		VkQueryPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-		poolInfo.queryCount = 8;
-		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
-
-		VkQueryPool queryPool{};
-		if (auto res = vkCreateQueryPool(env.Window().device, &poolInfo, nullptr, &queryPool); res != VK_SUCCESS)
+		for (uint32_t i = 1; i < ShadowFilterTierCount; i++)
 		{
-			lut::Error("VK: vkCreateQueryPool() failed to create a query pool. err: %s",
-				lut::to_string(res).c_str());
+			CSSM_defaultPipeline.PrepareVariant(&env, ShadowFilterTiers[i]);
+			CSSM_transparentPipeline.PrepareVariant(&env, ShadowFilterTiers[i]);
 		}
-		vkResetQueryPool(env.Window().device, queryPool, 0, 8);
+		#if not (TEMPORAL_SHADOWS or DENOISED_SHADOWS or CSSM_MSAA)
+			for (uint32_t i = 0; i < Renderer::NOISE_PATTERN_COUNT; i++)
+			{
+				CSSM_defaultPipeline.PrepareVariant(&env, { StochasticPCFRadius[i] });
+				CSSM_transparentPipeline.PrepareVariant(&env, { StochasticPCFRadius[i] });
+			}
+		#endif
 
-		/* Create the csv file to write stats to */
-		std::ofstream statsFile("../output/" TECHNAME "_stats.csv");
-		statsFile << "transparent mesh count, total frame render time, shadow mapping time, geometry draw time, combination draw time\n";
+		#if not VIRTUAL_SHADOWS
+			Renderer::DescriptorSet* CSSM_lookupSet = &CSSM_shadowMapSet;
+		#endif
 	#endif
 
-	/* Main loop */
-	double time = glfwGetTime();
-	bool firstFrame = true;
-	bool printOutLastFrame = false;
-	uint32_t frameNumber = 0;
-	bool overrideClose = false;
-	while (glfwWindowShouldClose(env.Window().window) == false && overrideClose == false)
-	{
-		uint32_t meshLimit = model.TransparentMeshCount();
-		#if TIMING
-			/* number of stress test meshes to render */
-			lastmeshLimit = meshLimit;
-			#if not CTS
-				meshLimit = std::min(model.TransparentMeshCount(), frameNumber);
-			#else
-				meshLimit = std::min(model.TransparentMeshCount(), frameNumber * 20);
-				// meshLimit = std::min(30U, frameNumber / 5);
-			#endif
-		#endif
+	#if CMSM /* COLOURED MOMENT SHADOW MAPS: START UP TASKS */
 
-		/* Window polling */
-		glfwPollEvents();
+		/* Buffers */
 
-		/* print camera position and direction */
-		if (glfwGetKey(env.Window().window, GLFW_KEY_P) == GLFW_PRESS)
-		{
-			if (printOutLastFrame == false)
-			{
-				camera.PrintPositionalData();
-			}
+		/* [0]: moments, [1]: transmittance, [2]: depth */
+		uint32_t CMSM_shadowMapIndex = env.CreateSideBuffers(
+			&CMSM_shadowPass, 1, Renderer::Environment::SideBufferType::COMBINED,
+			false, nullptr, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION);
+		lut::Image* CMSM_momentMap = &(*env.GetSideBufferImage(CMSM_shadowMapIndex))[0];
+		lut::Image* CMSM_transmittanceMap = &(*env.GetSideBufferImage(CMSM_shadowMapIndex))[1];
+		lut::Image* CMSM_depthMap = &(*env.GetSideBufferImage(CMSM_shadowMapIndex))[2];
 
-			printOutLastFrame = true;
-		}
-		else
-		{
-			printOutLastFrame = false;
-		}
+		/* the moments are filtered, so they're sampled linearly (with mips) rather than compared */
+		lut::Sampler CMSM_sampler = Renderer::CreateDefaultShadowSampler(env.Window(), false);
 
-		/* Recreate the swap chain if it's been invalidated.
-			This also necessitates adjusting the pipelines,
-			since the window has likely changed size. */
-		if (env.CheckSwapChain({ &simpleOpaquePass, &presentPass }) != ErrorCode::SUCCESS)
+		Renderer::MomentShadowFilter CMSM_filter(&env, SHADOW_MAP_RESOLUTION, SHADOW_CASCADE_COUNT,
+			&(*env.GetSideBufferImageView(CMSM_shadowMapIndex))[0], &(*env.GetSideBufferImageView(CMSM_shadowMapIndex))[1],
+			*CMSM_sampler, *shadowMapProjUBO);
+
+		/* Descriptor Sets */
+
+		Renderer::DescriptorSetLayoutFeatures CMSM_shadowMapSetFeatures;
+		CMSM_shadowMapSetFeatures.stages.fragment = true;
+		CMSM_shadowMapSetFeatures.bindingCount = 3;
+		Renderer::DescriptorSetType CMSM_shadowMapSetTypes[3]
 		{
-			simplePipeline.Repair(&env);
-			transparentPipeline.Repair(&env);
-			postPresentPipeline.Repair(&env);
+			Renderer::DescriptorSetType::SAMPLER, /* filtered moments */
+			Renderer::DescriptorSetType::SAMPLER, /* filtered transmittance */
+			Renderer::DescriptorSetType::UNIFORM_BUFFER /* shadow transform data */
+		};
+		CMSM_shadowMapSetFeatures.pBindingTypes = CMSM_shadowMapSetTypes;
+		Renderer::DescriptorSetLayout CMSM_shadowMapLayout(&env, CMSM_shadowMapSetFeatures);
 
-			#if TRANSLUCENT_SHADOWS or CTS
-				TS_geometryPipeline.Repair(&env);
-				TS_transparentGeometryPipeline.Repair(&env);
-			#endif
+		std::vector<Renderer::DescriptorSetFeatures> CMSM_shadowBindingData{};
+		CMSM_shadowBindingData.resize(3);
 
-			#if CTS
-				CTS_transparentGeometryPipeline.Repair(&env);
-			#endif
+		CMSM_shadowBindingData[0].binding = 0;
+		CMSM_shadowBindingData[0].s_View = *CMSM_filter.MomentView();
+		CMSM_shadowBindingData[0].s_Sampler = *CMSM_sampler;
 
-			camera.UpdateCameraSettings(FOV,
-				env.Window().swapchainExtent.width, env.Window().swapchainExtent.height);
+		CMSM_shadowBindingData[1].binding = 1;
+		CMSM_shadowBindingData[1].s_View = *CMSM_filter.TransmittanceView();
+		CMSM_shadowBindingData[1].s_Sampler = *CMSM_sampler;
 
-			continue;
-		}
+		CMSM_shadowBindingData[2].binding = 2;
+		CMSM_shadowBindingData[2].u_Buffer = *shadowMapProjUBO;
 
-		/* Get the next swap chain image, etc. and wait for fences */
-		if (env.PrepareNextFrame() != ErrorCode::SUCCESS)
-			continue;
+		Renderer::DescriptorSet CMSM_shadowMapSet(&env, &CMSM_shadowMapLayout, 3, CMSM_shadowBindingData.data());
 
-		/* Update time and camera */
-		double now = glfwGetTime();
-		double timeDelta = now - time;
-		time = now;
-		bool moved = false;
-		camera.FrameUpdate(timeDelta, &moved);
+		/* Pipelines */
 
-		if (moved)
-		{
-			/* update shadow data */
+		std::vector<const VkDescriptorSetLayout*> CMSM_shadowLayouts = { &*shadowMapProjSetLayout, &*simpleLayout };
+		Renderer::PipelineFeatures CMSM_shadowPipelineFeatures;
+		CMSM_shadowPipelineFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
+		CMSM_shadowPipelineFeatures.fillMode = Renderer::FillMode::FILL;
+		CMSM_shadowPipelineFeatures.specialMode = Renderer::SpecialMode::CMSM_MOMENT_SHADOW_MAP;
+		CMSM_shadowPipelineFeatures.depthWrite = Renderer::DepthWrite::ENABLED;
+		Renderer::Pipeline CMSM_shadowOpaquePipeline(&env, CMSM_shadowPipelineFeatures, &CMSM_shadowPass, CMSM_shadowLayouts);
+
+		/* translucent casters keep their nearest moments with a min blend and multiply in their transmittance */
+		CMSM_shadowPipelineFeatures.alphaBlend = Renderer::AlphaBlend::ENABLED;
+		CMSM_shadowPipelineFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
+		Renderer::Pipeline CMSM_shadowTransparentPipeline(&env, CMSM_shadowPipelineFeatures, &CMSM_shadowPass, CMSM_shadowLayouts);
+
+		std::vector<const VkDescriptorSetLayout*> CMSM_layouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*CMSM_shadowMapLayout };
+		Renderer::PipelineFeatures CMSM_defaultFeatures = Renderer::Pipeline_Default;
+		CMSM_defaultFeatures.specialMode = Renderer::SpecialMode::CMSM_DEFAULT;
+		Renderer::Pipeline CMSM_defaultPipeline(&env, CMSM_defaultFeatures, &simpleOpaquePass, CMSM_layouts);
+
+		Renderer::PipelineFeatures CMSM_transparentFeatures = transparentFeatures;
+		CMSM_transparentFeatures.specialMode = Renderer::SpecialMode::CMSM_DEFAULT;
+		Renderer::Pipeline CMSM_transparentPipeline(&env, CMSM_transparentFeatures, &simpleOpaquePass, CMSM_layouts);
+	#endif
 
-			shadowData.Update(&camera, &lights.sunLight, ShadowBufferDistance);
-			model.SortTransparentGeometry(-lights.sunLight.direction * 9999.9f, camera.Position(), false, true);
-		}
+	#if FOM /* FOURIER OPACITY MAPS: START UP TASKS */
 
-		/* Prepare to queue commands */
-		env.BeginFrameCommands();
+		/* Buffers */
 
-		#if TIMING
-			vkResetQueryPool(env.Window().device, queryPool, 0, 8);
-		#endif
+		/* [0]: absorbance and a0, [1]: harmonics 1-2, [2]: harmonics 3-4, [3]: opaque depth */
+		uint32_t FOM_shadowMapIndex = env.CreateSideBuffers(
+			&FOM_shadowPass, 1, Renderer::Environment::SideBufferType::COMBINED,
+			false, nullptr, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION);
+		lut::Image* FOM_coefficientMaps[3]
+		{
+			&(*env.GetSideBufferImage(FOM_shadowMapIndex))[0],
+			&(*env.GetSideBufferImage(FOM_shadowMapIndex))[1],
+			&(*env.GetSideBufferImage(FOM_shadowMapIndex))[2]
+		};
+		lut::Image* FOM_depthMap = &(*env.GetSideBufferImage(FOM_shadowMapIndex))[3];
 
-		TIMESTAMP(0) /* frame start */
+		/* the coefficients are sums, so they're filtered linearly rather than compared */
+		lut::Sampler FOM_sampler = Renderer::CreateDefaultShadowSampler(env.Window(), false);
 
-		/* Update the camera and lighting data buffers */
-		Renderer::CmdUpdateBuffer(&env, &cameraUBO, 0, sizeof(Renderer::Uniforms::CameraData), camera.GetUniformDataPtr());
-		Renderer::CmdUpdateBuffer(&env, &lightingUBO, 0, sizeof(Renderer::Uniforms::LightData), &lights);
-		Renderer::CmdUpdateBuffer(&env, &shadowMapProjUBO, 0, sizeof(Renderer::Uniforms::DirectionalShadowData), &shadowData);
+		/* Descriptor Sets */
 
-		/* Set the shadow map texture(s) for writing */
-		if (firstFrame)
+		Renderer::DescriptorSetLayoutFeatures FOM_shadowMapSetFeatures;
+		FOM_shadowMapSetFeatures.stages.fragment = true;
+		FOM_shadowMapSetFeatures.bindingCount = 5;
+		Renderer::DescriptorSetType FOM_shadowMapSetTypes[5]
 		{
-			firstFrame = false;
-			Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
+			Renderer::DescriptorSetType::SAMPLER, /* absorbance */
+			Renderer::DescriptorSetType::SAMPLER, /* harmonics 1-2 */
+			Renderer::DescriptorSetType::SAMPLER, /* harmonics 3-4 */
+			Renderer::DescriptorSetType::SAMPLER, /* opaque depth */
+			Renderer::DescriptorSetType::UNIFORM_BUFFER /* shadow transform data */
+		};
+		FOM_shadowMapSetFeatures.pBindingTypes = FOM_shadowMapSetTypes;
+		Renderer::DescriptorSetLayout FOM_shadowMapLayout(&env, FOM_shadowMapSetFeatures);
 
-			#if TRANSLUCENT_SHADOWS or CTS
-				Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(TS_translucentDepthMapIndex))[0], true);
-				Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0], false);
-			#endif
+		std::vector<Renderer::DescriptorSetFeatures> FOM_shadowBindingData{};
+		FOM_shadowBindingData.resize(5);
 
-			#if CSSM
-				Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[0], false);
-				Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[1], true);
-			#endif
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			FOM_shadowBindingData[i].binding = i;
+			FOM_shadowBindingData[i].s_View = *(*env.GetSideBufferImageView(FOM_shadowMapIndex))[i];
+			FOM_shadowBindingData[i].s_Sampler = *FOM_sampler;
 		}
-		#if not CSSM
-			Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
-		#endif
 
-		#if TRANSLUCENT_SHADOWS or CTS
-			Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(TS_translucentDepthMapIndex))[0], true);
-			Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0], false);
-		#endif
+		FOM_shadowBindingData[3].binding = 3;
+		FOM_shadowBindingData[3].s_View = *(*env.GetSideBufferImageView(FOM_shadowMapIndex))[3];
+		FOM_shadowBindingData[3].s_Sampler = *shadowSampler;
 
-		TIMESTAMP(2) /* shadow mapping start */
+		FOM_shadowBindingData[4].binding = 4;
+		FOM_shadowBindingData[4].u_Buffer = *shadowMapProjUBO;
 
-		#if VANILLA or TRANSLUCENT_SHADOWS or SSM or CTS
-			/* Begin shadow map pass */
-			env.BeginRenderPass(&shadowPass, shadowMapIndex); /* rendering to the opaque shadow map */
+		Renderer::DescriptorSet FOM_shadowMapSet(&env, &FOM_shadowMapLayout, 5, FOM_shadowBindingData.data());
 
+		/* Pipelines */
+
+		std::vector<const VkDescriptorSetLayout*> FOM_shadowLayouts = { &*shadowMapProjSetLayout, &*simpleLayout };
+		Renderer::PipelineFeatures FOM_shadowPipelineFeatures;
+		FOM_shadowPipelineFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
+		FOM_shadowPipelineFeatures.fillMode = Renderer::FillMode::FILL;
+		FOM_shadowPipelineFeatures.specialMode = Renderer::SpecialMode::FOM_SHADOW_MAP;
+		FOM_shadowPipelineFeatures.depthWrite = Renderer::DepthWrite::ENABLED;
+		Renderer::Pipeline FOM_shadowOpaquePipeline(&env, FOM_shadowPipelineFeatures, &FOM_shadowPass, FOM_shadowLayouts);
+
+		/* translucent casters add into the coefficient maps, depth tested against the opaque casters */
+		FOM_shadowPipelineFeatures.alphaBlend = Renderer::AlphaBlend::ENABLED;
+		FOM_shadowPipelineFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
+		Renderer::Pipeline FOM_shadowTransparentPipeline(&env, FOM_shadowPipelineFeatures, &FOM_shadowPass, FOM_shadowLayouts);
+
+		std::vector<const VkDescriptorSetLayout*> FOM_layouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*FOM_shadowMapLayout };
+		Renderer::PipelineFeatures FOM_defaultFeatures = Renderer::Pipeline_Default;
+		FOM_defaultFeatures.specialMode = Renderer::SpecialMode::FOM_DEFAULT;
+		Renderer::Pipeline FOM_defaultPipeline(&env, FOM_defaultFeatures, &simpleOpaquePass, FOM_layouts);
+
+		Renderer::PipelineFeatures FOM_transparentFeatures = transparentFeatures;
+		FOM_transparentFeatures.specialMode = Renderer::SpecialMode::FOM_DEFAULT;
+		Renderer::Pipeline FOM_transparentPipeline(&env, FOM_transparentFeatures, &simpleOpaquePass, FOM_layouts);
+	#endif
+
+	#if CSSM_FORMAT_COMPARISON /* CSSM FORMAT COMPARISON: START UP TASKS */
+		/* CSSM FORMAT COMPARISON: a shadow pass, map, pipelines, and lookup set per colour format */
+		const uint32_t CSSM_compareCount = 4;
+		const Renderer::CSSMColourFormat CSSM_compareFormats[CSSM_compareCount]
+		{
+			Renderer::CSSMColourFormat::RGBA32_SFLOAT, /* reference */
+			Renderer::CSSMColourFormat::RGBA16_UNORM,
+			Renderer::CSSMColourFormat::RGBA16_SFLOAT,
+			Renderer::CSSMColourFormat::RGB10A2_UNORM
+		};
+		const char* CSSM_compareNames[CSSM_compareCount] = { "RGBA32_SFLOAT", "RGBA16_UNORM", "RGBA16_SFLOAT", "RGB10A2_UNORM" };
+		const float CSSM_compareDepthBias = 0.001f; /* depth_bias in CSSM_defaultPCF.frag */
+
+		Renderer::PipelineFeatures CSSM_compareOpaqueFeatures;
+		CSSM_compareOpaqueFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
+		CSSM_compareOpaqueFeatures.fillMode = Renderer::FillMode::FILL;
+		CSSM_compareOpaqueFeatures.specialMode = Renderer::SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP;
+		CSSM_compareOpaqueFeatures.depthWrite = Renderer::DepthWrite::ENABLED;
+
+		std::deque<Renderer::RenderPass> CSSM_comparePasses;
+		std::deque<Renderer::Pipeline> CSSM_compareOpaquePipelines;
+		std::deque<Renderer::Pipeline> CSSM_compareTransparentPipelines;
+		std::deque<Renderer::DescriptorSet> CSSM_compareSets;
+		std::deque<Renderer::ShadowDepthPyramid> CSSM_comparePyramids;
+		std::vector<uint32_t> CSSM_compareIndices;
+
+		for (uint32_t i = 0; i < CSSM_compareCount; i++)
+		{
+			Renderer::RenderPassFeatures compareFeatures = CSSM_shadowFeatures;
+			compareFeatures.cssmColourFormat = CSSM_compareFormats[i];
+			CSSM_comparePasses.emplace_back(env.WindowPtr(), compareFeatures);
+
+			CSSM_compareIndices.push_back(env.CreateSideBuffers(
+				&CSSM_comparePasses.back(), 1, Renderer::Environment::SideBufferType::COMBINED,
+				false, nullptr, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION, true));
+
+			CSSM_compareOpaquePipelines.emplace_back(&env, CSSM_compareOpaqueFeatures, &CSSM_comparePasses.back(), CSSM_shadowLayouts);
+			CSSM_compareTransparentPipelines.emplace_back(&env, CSSM_shadowPipelineFeatures, &CSSM_comparePasses.back(), CSSM_shadowLayouts);
+
+			CSSM_comparePyramids.emplace_back(&env, SHADOW_MAP_RESOLUTION, SHADOW_CASCADE_COUNT,
+				&(*env.GetSideBufferImageView(CSSM_compareIndices.back()))[1], &(*env.GetSideBufferImageView(CSSM_compareIndices.back()))[0],
+				*pointSampler, *shadowMapProjUBO);
+
+			std::vector<Renderer::DescriptorSetFeatures> compareBindingData = CSSM_shadowBindingData;
+			compareBindingData[0].s_View = *(*env.GetSideBufferImageView(CSSM_compareIndices.back()))[1];
+			compareBindingData[1].s_View = *(*env.GetSideBufferImageView(CSSM_compareIndices.back()))[0];
+			compareBindingData[3].s_View = *CSSM_comparePyramids.back().View();
+			CSSM_compareSets.emplace_back(&env, &CSSM_shadowMapLayout, 4, compareBindingData.data());
+		}
+
+		/* CSSM FORMAT COMPARISON: per format pass timing, and readback buffers made on the first comparison */
+		VkQueryPoolCreateInfo comparePoolInfo{};
+		comparePoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		comparePoolInfo.queryCount = CSSM_compareCount * 2;
+		comparePoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+
+		VkQueryPool CSSM_compareQueries{};
+		if (auto res = vkCreateQueryPool(env.Window().device, &comparePoolInfo, nullptr, &CSSM_compareQueries); res != VK_SUCCESS)
+		{
+			throw lut::Error("VK: vkCreateQueryPool() failed to create a query pool. err: %s",
+				lut::to_string(res).c_str());
+		}
+
+		uint64_t CSSM_compareTimestamps[CSSM_compareCount * 2]{};
+		double CSSM_compareTimes[CSSM_compareCount]{};
+		uint32_t CSSM_compareFrames = 0;
+		uint32_t CSSM_compareSelected = 0;
+		bool CSSM_compareCycleLastFrame = false;
+		bool CSSM_compareValidateLastFrame = false;
+		bool CSSM_compareValidate = false;
+		std::vector<lut::Buffer> CSSM_compareReadbacks{};
+
+		CSSM_lookupSet = &CSSM_compareSets[CSSM_compareSelected];
+		shadowData.cascadeInfo.y = static_cast<uint32_t>(CSSM_compareFormats[CSSM_compareSelected]);
+	#endif
+
+	#if CTS
+		Renderer::PipelineFeatures CTS_transparentGeometryFeatures = TS_geometryFeatures;
+		CTS_transparentGeometryFeatures.alphaBlend = Renderer::AlphaBlend::ENABLED;
+		CTS_transparentGeometryFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		CTS_transparentGeometryFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
+		Renderer::Pipeline CTS_transparentGeometryPipeline(&env, CTS_transparentGeometryFeatures, &CTS_compositingPass, TS_simpleLayouts);
+	#endif
+
+	#if VIRTUAL_SHADOWS /* VIRTUAL SHADOWS IMPLEMENTATION: START UP TASKS */
+		Renderer::VirtualShadowMap virtualShadows(&env, VirtualShadowGuardBand, VirtualShadowPageBudget);
+
+		/* VIRTUAL SHADOWS: physical page pools, laid out like the shadow maps they replace */
+		#if not CSSM
+			uint32_t VSM_poolIndex = env.CreateSideBuffers(&VSM_pagePass, 1, Renderer::Environment::SideBufferType::DEPTH,
+				false, nullptr, VSM_POOL_RESOLUTION, VSM_POOL_RESOLUTION);
+			lut::Image* VSM_poolDepth = &(*env.GetSideBufferImage(VSM_poolIndex))[0];
+			lut::ImageView* VSM_poolDepthView = &(*env.GetSideBufferImageView(VSM_poolIndex))[0];
+		#endif
+
+		#if TRANSLUCENT_SHADOWS
+			Renderer::SideBufferShareData VSM_translucentShareData;
+			VSM_translucentShareData.depthIndex = VSM_poolIndex;
+			VSM_translucentShareData.depthSubindex = 0;
+			uint32_t VSM_translucentPoolIndex = env.CreateSideBuffers(&VSM_translucentPagePass, 1, Renderer::Environment::SideBufferType::COMBINED,
+				true, &VSM_translucentShareData, VSM_POOL_RESOLUTION, VSM_POOL_RESOLUTION);
+			lut::Image* VSM_translucentColour = &(*env.GetSideBufferImage(VSM_translucentPoolIndex))[0];
+			lut::Image* VSM_translucentDepth = &(*env.GetSideBufferImage(VSM_translucentPoolIndex))[1];
+			lut::ImageView* VSM_translucentColourView = &(*env.GetSideBufferImageView(VSM_translucentPoolIndex))[0];
+			lut::ImageView* VSM_translucentDepthView = &(*env.GetSideBufferImageView(VSM_translucentPoolIndex))[1];
+		#endif
+
+		#if CSSM
+			uint32_t VSM_cssmPoolIndex = env.CreateSideBuffers(&VSM_cssmPagePass, 1, Renderer::Environment::SideBufferType::COMBINED,
+				false, nullptr, VSM_POOL_RESOLUTION, VSM_POOL_RESOLUTION, true);
+			lut::Image* VSM_cssmColour = &(*env.GetSideBufferImage(VSM_cssmPoolIndex))[0];
+			lut::Image* VSM_cssmDepth = &(*env.GetSideBufferImage(VSM_cssmPoolIndex))[1];
+			lut::ImageView* VSM_cssmColourView = &(*env.GetSideBufferImageView(VSM_cssmPoolIndex))[0];
+			lut::ImageView* VSM_cssmDepthView = &(*env.GetSideBufferImageView(VSM_cssmPoolIndex))[1];
+		#endif
+
+		uint32_t VSM_analysisIndex = env.CreateSideBuffers(&VSM_analysisPass, 1, Renderer::Environment::SideBufferType::DEPTH,
+			false, nullptr, VirtualShadowAnalysisWidth, VirtualShadowAnalysisHeight);
+
+		/* VIRTUAL SHADOWS: the page passes reuse the shadow vertex shaders, so every cascade transform is the virtual one */
+		Renderer::Uniforms::DirectionalShadowData VSM_renderData = shadowData;
+		lut::Buffer VSM_renderUBO = lut::create_buffer(env.Allocator(), sizeof(Renderer::Uniforms::DirectionalShadowData),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		Renderer::FreeUpdateBuffer(&env, &VSM_renderUBO, 0, sizeof(Renderer::Uniforms::DirectionalShadowData), &VSM_renderData);
+		Renderer::DescriptorSet VSM_renderSet(&env, &shadowMapProjSetLayout, *VSM_renderUBO);
+
+		/* VIRTUAL SHADOWS: analysis set, the virtual transform and the page request bits */
+		Renderer::DescriptorSetLayoutFeatures VSM_analysisSetFeatures;
+		VSM_analysisSetFeatures.stages.fragment = true;
+		VSM_analysisSetFeatures.bindingCount = 2;
+		Renderer::DescriptorSetType VSM_analysisSetTypes[2]
+		{
+			Renderer::DescriptorSetType::UNIFORM_BUFFER, /* virtual shadow map transform data */
+			Renderer::DescriptorSetType::STORAGE_BUFFER /* page requests */
+		};
+		VSM_analysisSetFeatures.pBindingTypes = VSM_analysisSetTypes;
+		Renderer::DescriptorSetLayout VSM_analysisLayout(&env, VSM_analysisSetFeatures);
+
+		std::vector<Renderer::DescriptorSetFeatures> VSM_analysisBindingData{};
+		VSM_analysisBindingData.resize(2);
+
+		VSM_analysisBindingData[0].binding = 0;
+		VSM_analysisBindingData[0].u_Buffer = *VSM_renderUBO;
+
+		VSM_analysisBindingData[1].binding = 1;
+		VSM_analysisBindingData[1].sb_Buffer = *virtualShadows.RequestBuffer();
+
+		Renderer::DescriptorSet VSM_analysisSet(&env, &VSM_analysisLayout, 2, VSM_analysisBindingData.data());
+
+		/* VIRTUAL SHADOWS: lookup set, the technique's shadow textures (now page pools) followed by the page table */
+		#if VANILLA
+			const uint32_t VSM_shadowBindingCount = 3;
+			Renderer::DescriptorSetType VSM_shadowMapSetTypes[VSM_shadowBindingCount]
+			{
+				Renderer::DescriptorSetType::SAMPLER, /* shadowmap page pool */
+				Renderer::DescriptorSetType::UNIFORM_BUFFER, /* virtual shadow map transform data */
+				Renderer::DescriptorSetType::STORAGE_BUFFER /* page table */
+			};
+
+			std::vector<Renderer::DescriptorSetFeatures> VSM_shadowBindingData{};
+			VSM_shadowBindingData.resize(VSM_shadowBindingCount);
+
+			VSM_shadowBindingData[0].s_View = **VSM_poolDepthView;
+			VSM_shadowBindingData[0].s_Sampler = *shadowSampler;
+
+			const Renderer::SpecialMode VSM_geometryMode = Renderer::SpecialMode::VSM_DEFAULT;
+		#endif
+
+		#if TRANSLUCENT_SHADOWS
+			const uint32_t VSM_shadowBindingCount = 5;
+			Renderer::DescriptorSetType VSM_shadowMapSetTypes[VSM_shadowBindingCount]
+			{
+				Renderer::DescriptorSetType::SAMPLER, /* opaque shadowmap page pool */
+				Renderer::DescriptorSetType::SAMPLER, /* translucent depth page pool */
+				Renderer::DescriptorSetType::SAMPLER, /* translucent colour page pool */
+				Renderer::DescriptorSetType::UNIFORM_BUFFER, /* virtual shadow map transform data */
+				Renderer::DescriptorSetType::STORAGE_BUFFER /* page table */
+			};
+
+			std::vector<Renderer::DescriptorSetFeatures> VSM_shadowBindingData{};
+			VSM_shadowBindingData.resize(VSM_shadowBindingCount);
+
+			VSM_shadowBindingData[0].s_View = **VSM_poolDepthView;
+			VSM_shadowBindingData[0].s_Sampler = *shadowSampler;
+
+			VSM_shadowBindingData[1].s_View = **VSM_translucentDepthView;
+			VSM_shadowBindingData[1].s_Sampler = *TS_translucentDepthSampler;
+
+			VSM_shadowBindingData[2].s_View = **VSM_translucentColourView;
+			VSM_shadowBindingData[2].s_Sampler = *TS_translucentDepthSampler;
+
+			const Renderer::SpecialMode VSM_geometryMode = Renderer::SpecialMode::VSM_TS_GEOMETRY;
+		#endif
+
+		#if CSSM
+			const uint32_t VSM_shadowBindingCount = 4;
+			Renderer::DescriptorSetType VSM_shadowMapSetTypes[VSM_shadowBindingCount]
+			{
+				Renderer::DescriptorSetType::SAMPLER, /* shadowmap page pool */
+				Renderer::DescriptorSetType::SAMPLER, /* shadow colour page pool */
+				Renderer::DescriptorSetType::UNIFORM_BUFFER, /* virtual shadow map transform data */
+				Renderer::DescriptorSetType::STORAGE_BUFFER /* page table */
+			};
+
+			std::vector<Renderer::DescriptorSetFeatures> VSM_shadowBindingData{};
+			VSM_shadowBindingData.resize(VSM_shadowBindingCount);
+
+			VSM_shadowBindingData[0].s_View = **VSM_cssmDepthView;
+			VSM_shadowBindingData[0].s_Sampler = *shadowSampler;
+
+			VSM_shadowBindingData[1].s_View = **VSM_cssmColourView;
+			VSM_shadowBindingData[1].s_Sampler = *pointSampler;
+
+			const Renderer::SpecialMode VSM_geometryMode = Renderer::SpecialMode::VSM_CSSM_DEFAULT;
+		#endif
+
+		for (uint32_t i = 0; i < VSM_shadowBindingCount; i++)
+			VSM_shadowBindingData[i].binding = i;
+		VSM_shadowBindingData[VSM_shadowBindingCount - 2].u_Buffer = *VSM_renderUBO;
+		VSM_shadowBindingData[VSM_shadowBindingCount - 1].sb_Buffer = *virtualShadows.PageTableBuffer();
+
+		Renderer::DescriptorSetLayoutFeatures VSM_shadowMapSetFeatures;
+		VSM_shadowMapSetFeatures.stages.fragment = true;
+		VSM_shadowMapSetFeatures.bindingCount = VSM_shadowBindingCount;
+		VSM_shadowMapSetFeatures.pBindingTypes = VSM_shadowMapSetTypes;
+		Renderer::DescriptorSetLayout VSM_shadowMapLayout(&env, VSM_shadowMapSetFeatures);
+
+		Renderer::DescriptorSet VSM_shadowMapSet(&env, &VSM_shadowMapLayout, VSM_shadowBindingCount, VSM_shadowBindingData.data());
+
+		/* VIRTUAL SHADOWS: page pipelines, the viewport and scissor move to each page's slot in the pool */
+		#if not CSSM
+			Renderer::PipelineFeatures VSM_pagePipelineFeatures = shadowPipelineFeatures;
+			Renderer::Pipeline VSM_pagePipeline(&env, VSM_pagePipelineFeatures, &VSM_pagePass, shadowLayouts);
+		#endif
+
+		#if TRANSLUCENT_SHADOWS
+			Renderer::Pipeline VSM_translucentPagePipeline(&env, TS_transparentFeatures, &VSM_translucentPagePass, TS_transparentPipelineLayouts);
+		#endif
+
+		#if CSSM
+			Renderer::PipelineFeatures VSM_cssmOpaquePageFeatures;
+			VSM_cssmOpaquePageFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
+			VSM_cssmOpaquePageFeatures.fillMode = Renderer::FillMode::FILL;
+			VSM_cssmOpaquePageFeatures.specialMode = Renderer::SpecialMode::CSSM_COLORED_STOCHASTIC_SHADOW_MAP;
+			VSM_cssmOpaquePageFeatures.depthWrite = Renderer::DepthWrite::ENABLED;
+			Renderer::Pipeline VSM_cssmOpaquePagePipeline(&env, VSM_cssmOpaquePageFeatures, &VSM_cssmPagePass, CSSM_shadowLayouts);
+
+			Renderer::PipelineFeatures VSM_cssmTransparentPageFeatures = CSSM_shadowPipelineFeatures;
+			Renderer::Pipeline VSM_cssmTransparentPagePipeline(&env, VSM_cssmTransparentPageFeatures, &VSM_cssmPagePass, CSSM_shadowLayouts);
+		#endif
+
+		/* VIRTUAL SHADOWS: analysis pipelines, transparent surfaces receive shadows too but don't hide what's behind them */
+		std::vector<const VkDescriptorSetLayout*> VSM_analysisLayouts = { &*cameraUniformLayout, &*VSM_analysisLayout };
+		Renderer::PipelineFeatures VSM_analysisPipelineFeatures;
+		VSM_analysisPipelineFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
+		VSM_analysisPipelineFeatures.fillMode = Renderer::FillMode::FILL;
+		VSM_analysisPipelineFeatures.specialMode = Renderer::SpecialMode::VSM_ANALYSIS;
+		Renderer::Pipeline VSM_analysisOpaquePipeline(&env, VSM_analysisPipelineFeatures, &VSM_analysisPass, VSM_analysisLayouts);
+
+		VSM_analysisPipelineFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
+		Renderer::Pipeline VSM_analysisTransparentPipeline(&env, VSM_analysisPipelineFeatures, &VSM_analysisPass, VSM_analysisLayouts);
+
+		/* VIRTUAL SHADOWS: geometry pipelines */
+		std::vector<const VkDescriptorSetLayout*> VSM_layouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*VSM_shadowMapLayout };
+		Renderer::PipelineFeatures VSM_defaultFeatures = Renderer::Pipeline_Default;
+		VSM_defaultFeatures.specialMode = VSM_geometryMode;
+		Renderer::Pipeline VSM_defaultPipeline(&env, VSM_defaultFeatures, &simpleOpaquePass, VSM_layouts);
+
+		Renderer::PipelineFeatures VSM_transparentFeatures = transparentFeatures;
+		VSM_transparentFeatures.specialMode = VSM_geometryMode;
+		Renderer::Pipeline VSM_transparentPipeline(&env, VSM_transparentFeatures, &simpleOpaquePass, VSM_layouts);
+	#endif
+
+	#if SHADOW_MASK /* SCREEN-SPACE SHADOW MASK: START UP TASKS */
+
+		/* Buffers */
+
+		/* the pre-pass depth and the mask are allocated at the display's size and rendered into their top left corner,
+			so resizing the window never recreates them (a window larger than the display is clamped to it) */
+		const GLFWvidmode* SM_videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		uint32_t SM_width = std::max(env.Window().swapchainExtent.width, (SM_videoMode != nullptr) ? static_cast<uint32_t>(SM_videoMode->width) : 0u);
+		uint32_t SM_height = std::max(env.Window().swapchainExtent.height, (SM_videoMode != nullptr) ? static_cast<uint32_t>(SM_videoMode->height) : 0u);
+
+		#if DEFERRED
+			/* [0]: albedo, [1]: octahedral normal, [2]: emissive, [3]: depth */
+			uint32_t DS_gBufferIndex = env.CreateSideBuffers(&DS_gBufferPass, 1, Renderer::Environment::SideBufferType::COMBINED,
+				false, nullptr, static_cast<int>(SM_width), static_cast<int>(SM_height));
+			std::vector<lut::Image>* DS_gBuffer = env.GetSideBufferImage(DS_gBufferIndex);
+			std::vector<lut::ImageView>* DS_gBufferViews = env.GetSideBufferImageView(DS_gBufferIndex);
+			lut::Image* SM_depthMap = &(*DS_gBuffer)[3];
+			lut::ImageView* SM_depthMapView = &(*DS_gBufferViews)[3];
+		#else
+			uint32_t SM_depthIndex = env.CreateSideBuffers(&SM_depthPass, 1, Renderer::Environment::SideBufferType::DEPTH,
+				false, nullptr, static_cast<int>(SM_width), static_cast<int>(SM_height));
+			lut::Image* SM_depthMap = &(*env.GetSideBufferImage(SM_depthIndex))[0];
+			lut::ImageView* SM_depthMapView = &(*env.GetSideBufferImageView(SM_depthIndex))[0];
+		#endif
+
+		/* the mask reads the same maps as the technique's per-fragment lookup */
+		#if SSM
+			Renderer::ShadowMask shadowMask(&env, SM_width, SM_height, Renderer::ShadowMaskSource::STOCHASTIC,
+				SM_depthMapView, *cameraUBO, *shadowMapProjUBO,
+				shadowMapView, shadowMapView, shadowMapView, *pointSampler, TEMPORAL_SHADOWS, DENOISED_SHADOWS);
+		#elif CSSM
+			Renderer::ShadowMask shadowMask(&env, SM_width, SM_height, Renderer::ShadowMaskSource::COLOURED_STOCHASTIC,
+				SM_depthMapView, *cameraUBO, *shadowMapProjUBO,
+				CSSM_depthMapView, CSSM_shadowMapView, CSSM_shadowMapView, *pointSampler, TEMPORAL_SHADOWS, DENOISED_SHADOWS);
+		#else
+			Renderer::ShadowMask shadowMask(&env, SM_width, SM_height, Renderer::ShadowMaskSource::TRANSLUCENT,
+				SM_depthMapView, *cameraUBO, *shadowMapProjUBO,
+				shadowMapView, TS_translucentDepthMapView, TS_translucentShadowMapView, *pointSampler);
+		#endif
+
+		#if DENOISED_SHADOWS
+			shadowData.samplingInfo.z = ShadowDenoiseRadius;
+			bool SM_denoiseKeyLastFrame = false;
+		#endif
+
+		/* Descriptor Sets */
+
+		#if DEFERRED
+			Renderer::DescriptorSetLayoutFeatures DS_gBufferSetFeatures;
+			DS_gBufferSetFeatures.stages.fragment = true;
+			DS_gBufferSetFeatures.bindingCount = 5;
+			Renderer::DescriptorSetType DS_gBufferSetTypes[5]
+			{
+				Renderer::DescriptorSetType::SAMPLER, /* albedo */
+				Renderer::DescriptorSetType::SAMPLER, /* octahedral normal */
+				Renderer::DescriptorSetType::SAMPLER, /* emissive */
+				Renderer::DescriptorSetType::SAMPLER, /* depth */
+				Renderer::DescriptorSetType::SAMPLER /* shadow mask */
+			};
+			DS_gBufferSetFeatures.pBindingTypes = DS_gBufferSetTypes;
+			Renderer::DescriptorSetLayout DS_gBufferLayout(&env, DS_gBufferSetFeatures);
+
+			std::vector<Renderer::DescriptorSetFeatures> DS_gBufferBindingData(5);
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				DS_gBufferBindingData[i].binding = i;
+				DS_gBufferBindingData[i].s_View = *(*DS_gBufferViews)[i];
+				DS_gBufferBindingData[i].s_Sampler = *pointSampler;
+			}
+
+			DS_gBufferBindingData[4].binding = 4;
+			DS_gBufferBindingData[4].s_View = *shadowMask.View();
+			DS_gBufferBindingData[4].s_Sampler = *pointSampler;
+
+			Renderer::DescriptorSet DS_gBufferSet(&env, &DS_gBufferLayout, 5, DS_gBufferBindingData.data());
+		#else
+			Renderer::DescriptorSet SM_maskSet(&env, &singleTextureLayout, *shadowMask.View(), *pointSampler);
+		#endif
+
+		/* Pipelines */
+
+		#if DEFERRED
+			std::vector<const VkDescriptorSetLayout*> DS_gBufferLayouts = { &*cameraUniformLayout, &*simpleLayout };
+			Renderer::PipelineFeatures DS_gBufferPipelineFeatures = Renderer::Pipeline_Default;
+			DS_gBufferPipelineFeatures.specialMode = Renderer::SpecialMode::DEFERRED_GBUFFER;
+			Renderer::Pipeline DS_gBufferPipeline(&env, DS_gBufferPipelineFeatures, &DS_gBufferPass, DS_gBufferLayouts);
+
+			/* writes the G-buffer depth too, so the forward transparents depth test against the opaque surfaces */
+			std::vector<const VkDescriptorSetLayout*> DS_lightingLayouts = { &*lightingUniformLayout, &*DS_gBufferLayout };
+			Renderer::PipelineFeatures DS_lightingPipelineFeatures = Renderer::Pipeline_Default;
+			DS_lightingPipelineFeatures.specialMode = Renderer::SpecialMode::DEFERRED_LIGHTING;
+			DS_lightingPipelineFeatures.depthOp = Renderer::DepthOp::ALWAYS;
+			Renderer::Pipeline DS_lightingPipeline(&env, DS_lightingPipelineFeatures, &simpleOpaquePass, DS_lightingLayouts);
+		#else
+			std::vector<const VkDescriptorSetLayout*> SM_depthLayouts = { &*cameraUniformLayout };
+			Renderer::PipelineFeatures SM_depthPipelineFeatures;
+			SM_depthPipelineFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
+			SM_depthPipelineFeatures.fillMode = Renderer::FillMode::FILL;
+			SM_depthPipelineFeatures.specialMode = Renderer::SpecialMode::SHADOW_MASK_DEPTH;
+			Renderer::Pipeline SM_depthPipeline(&env, SM_depthPipelineFeatures, &SM_depthPass, SM_depthLayouts);
+
+			std::vector<const VkDescriptorSetLayout*> SM_layouts = { &*cameraUniformLayout, &*simpleLayout, &*lightingUniformLayout, &*singleTextureLayout };
+			Renderer::PipelineFeatures SM_defaultFeatures = Renderer::Pipeline_Default;
+			SM_defaultFeatures.specialMode = Renderer::SpecialMode::SHADOW_MASK_DEFAULT;
+			Renderer::Pipeline SM_defaultPipeline(&env, SM_defaultFeatures, &simpleOpaquePass, SM_layouts);
+		#endif
+	#endif
+
+	#if LOCAL_LIGHTS /* LOCAL LIGHTS IMPLEMENTATION: START UP TASKS */
+		/* LOCAL LIGHTS: a few coloured lights around the teapots, range in position.w */
+		std::vector<Renderer::Uniforms::LocalLight> localLights(3);
+
+		localLights[0].position = glm::vec4(-3.0f, 4.0f, 2.0f, 10.0f);
+		localLights[0].direction = glm::vec4(glm::normalize(glm::vec3(0.5f, -1.0f, -0.3f)), std::cos(glm::radians(35.0f)));
+		localLights[0].colour = glm::vec4(4.0f, 2.4f, 1.2f, std::cos(glm::radians(25.0f)));
+		localLights[0].info.x = static_cast<uint32_t>(Renderer::Uniforms::LocalLightType::SPOT);
+
+		localLights[1].position = glm::vec4(3.0f, 3.0f, -3.0f, 9.0f);
+		localLights[1].direction = glm::vec4(glm::normalize(glm::vec3(-0.6f, -1.0f, 0.6f)), std::cos(glm::radians(45.0f)));
+		localLights[1].colour = glm::vec4(1.0f, 2.0f, 4.0f, std::cos(glm::radians(30.0f)));
+		localLights[1].info.x = static_cast<uint32_t>(Renderer::Uniforms::LocalLightType::SPOT);
+
+		localLights[2].position = glm::vec4(0.0f, 2.0f, 0.0f, 6.0f);
+		localLights[2].colour = glm::vec4(2.0f, 3.0f, 2.0f, 1.0f);
+		localLights[2].info.x = static_cast<uint32_t>(Renderer::Uniforms::LocalLightType::POINT);
+
+		/* LOCAL LIGHTS: [0] translucent colour, [1] nearest translucent depth, [2] opaque depth */
+		uint32_t LL_atlasIndex = env.CreateSideBuffers(&LL_atlasPass, 1, Renderer::Environment::SideBufferType::COMBINED,
+			false, nullptr, LOCAL_ATLAS_RESOLUTION, LOCAL_ATLAS_RESOLUTION);
+		lut::Image* LL_atlasImages[3]{};
+		for (uint32_t i = 0; i < 3; i++)
+			LL_atlasImages[i] = &(*env.GetSideBufferImage(LL_atlasIndex))[i];
+		std::vector<lut::ImageView>* LL_atlasViews = env.GetSideBufferImageView(LL_atlasIndex);
+
+		/* LOCAL LIGHTS: each view's transform is bound at set 0 of the atlas pass */
+		Renderer::DescriptorSetLayout LL_viewLayout(&env, { true, false, false }, Renderer::DescriptorSetType::UNIFORM_BUFFER);
+		Renderer::ShadowAtlas shadowAtlas(&env, &LL_viewLayout);
+
+		/* LOCAL LIGHTS: the light list and the three atlas textures */
+		Renderer::DescriptorSetLayoutFeatures LL_lightSetFeatures;
+		LL_lightSetFeatures.stages.fragment = true;
+		LL_lightSetFeatures.bindingCount = 4;
+		Renderer::DescriptorSetType LL_lightSetTypes[4]
+		{
+			Renderer::DescriptorSetType::STORAGE_BUFFER, /* lights and atlas views */
+			Renderer::DescriptorSetType::SAMPLER, /* opaque depth */
+			Renderer::DescriptorSetType::SAMPLER, /* nearest translucent depth */
+			Renderer::DescriptorSetType::SAMPLER /* translucent colour */
+		};
+		LL_lightSetFeatures.pBindingTypes = LL_lightSetTypes;
+		Renderer::DescriptorSetLayout LL_lightLayout(&env, LL_lightSetFeatures);
+
+		/* LOCAL LIGHTS: the nearest translucent depth is compared manually, and neither plain texture may filter across tiles */
+		lut::Sampler LL_plainSampler = Renderer::CreateDefaultShadowSampler(env.Window(), false);
+
+		std::vector<Renderer::DescriptorSetFeatures> LL_lightBindingData(4);
+		LL_lightBindingData[0].binding = 0;
+		LL_lightBindingData[0].sb_Buffer = *shadowAtlas.LightListBuffer();
+
+		LL_lightBindingData[1].binding = 1;
+		LL_lightBindingData[1].s_View = *(*LL_atlasViews)[2];
+		LL_lightBindingData[1].s_Sampler = *shadowSampler;
+
+		LL_lightBindingData[2].binding = 2;
+		LL_lightBindingData[2].s_View = *(*LL_atlasViews)[1];
+		LL_lightBindingData[2].s_Sampler = *LL_plainSampler;
+
+		LL_lightBindingData[3].binding = 3;
+		LL_lightBindingData[3].s_View = *(*LL_atlasViews)[0];
+		LL_lightBindingData[3].s_Sampler = *LL_plainSampler;
+
+		Renderer::DescriptorSet LL_lightSet(&env, &LL_lightLayout, 4, LL_lightBindingData.data());
+
+		/* LOCAL LIGHTS: atlas pipelines, opaque depth first then the translucent colour and nearest depth over it */
+		std::vector<const VkDescriptorSetLayout*> LL_atlasOpaqueLayouts = { &*LL_viewLayout };
+		Renderer::PipelineFeatures LL_atlasOpaqueFeatures;
+		LL_atlasOpaqueFeatures.alphaBlend = Renderer::AlphaBlend::DISABLED;
+		LL_atlasOpaqueFeatures.fillMode = Renderer::FillMode::FILL;
+		LL_atlasOpaqueFeatures.colorWrite = Renderer::ColorWrite::DISABLED;
+		LL_atlasOpaqueFeatures.specialMode = Renderer::SpecialMode::LOCAL_SHADOW_MAP;
+		Renderer::Pipeline LL_atlasOpaquePipeline(&env, LL_atlasOpaqueFeatures, &LL_atlasPass, LL_atlasOpaqueLayouts);
+
+		std::vector<const VkDescriptorSetLayout*> LL_atlasTransparentLayouts = { &*LL_viewLayout, &*simpleLayout };
+		Renderer::PipelineFeatures LL_atlasTransparentFeatures = Renderer::Pipeline_Default;
+		LL_atlasTransparentFeatures.alphaBlend = Renderer::AlphaBlend::ENABLED;
+		LL_atlasTransparentFeatures.depthTest = Renderer::DepthTest::ENABLED;
+		LL_atlasTransparentFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
+		LL_atlasTransparentFeatures.specialMode = Renderer::SpecialMode::LOCAL_TS_SHADOW_MAP;
+		Renderer::Pipeline LL_atlasTransparentPipeline(&env, LL_atlasTransparentFeatures, &LL_atlasPass, LL_atlasTransparentLayouts);
+
+		/* LOCAL LIGHTS: additive lighting over the shaded geometry, the depth is already laid down */
+		std::vector<const VkDescriptorSetLayout*> LL_lightingLayouts = { &*cameraUniformLayout, &*simpleLayout, &*LL_lightLayout };
+		Renderer::PipelineFeatures LL_lightingFeatures = Renderer::Pipeline_Default;
+		LL_lightingFeatures.alphaBlend = Renderer::AlphaBlend::ENABLED;
+		LL_lightingFeatures.blendMode = Renderer::BlendMode::ADD_SRC_ONE;
+		LL_lightingFeatures.depthWrite = Renderer::DepthWrite::DISABLED;
+		LL_lightingFeatures.specialMode = Renderer::SpecialMode::LOCAL_LIGHTING;
+		Renderer::Pipeline LL_lightingPipeline(&env, LL_lightingFeatures, &simpleOpaquePass, LL_lightingLayouts);
+	#endif
+
+	#if TIMING
+		/* Create timing resources */
+		uint64_t timestampResults[8]{};
+		/*  [0]: frame start
+			[1]: frame end
+			[2]: shadow mapping start 
+			[3]: shadow mapping end
+			[4]: geometry draw start
+			[5]: geometry draw end 
+			[6]: combination draw begin
+			[7]: combination draw end */
+		uint32_t lastmeshLimit = 0;
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryCount = 8;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+
+		VkQueryPool queryPool{};
+		if (auto res = vkCreateQueryPool(env.Window().device, &poolInfo, nullptr, &queryPool); res != VK_SUCCESS)
+		{
+			lut::Error("VK: vkCreateQueryPool() failed to create a query pool. err: %s",
+				lut::to_string(res).c_str());
+		}
+		vkResetQueryPool(env.Window().device, queryPool, 0, 8);
+
+		/* Create the csv file to write stats to */
+		std::ofstream statsFile("../output/" TECHNAME "_stats.csv");
+		statsFile << "transparent mesh count, total frame render time, shadow mapping time, geometry draw time, combination draw time\n";
+	#endif
+
+	/* every start up compile finishes before the first frame, so the time below is the whole start up */
+	env.Pipelines()->WaitIdle();
+	printf("Start up took %.2f s: %u shader modules, %s pipeline cache (%zu bytes)\n", glfwGetTime(), env.Pipelines()->ModuleCount(),
+		(env.Pipelines()->LoadedSize() > 0) ? "warm" : "cold", env.Pipelines()->LoadedSize());
+
+	/* Main loop */
+	double time = glfwGetTime();
+	bool firstFrame = true;
+	bool printOutLastFrame = false;
+	bool referenceLastFrame = false;
+	uint32_t referenceCount = 0;
+	std::unique_ptr<Renderer::ReferenceRenderer> referenceRenderer; /* built the first time it's needed */
+	#if SHADOW_CACHE or VIRTUAL_SHADOWS
+		uint32_t lastShadowMeshLimit = 0;
+	#endif
+	uint32_t frameNumber = 0;
+	bool overrideClose = false;
+	while (glfwWindowShouldClose(env.Window().window) == false && overrideClose == false)
+	{
+		uint32_t meshLimit = model.TransparentMeshCount();
+		#if TIMING
+			/* number of stress test meshes to render */
+			lastmeshLimit = meshLimit;
+			#if not CTS
+				meshLimit = std::min(model.TransparentMeshCount(), frameNumber);
+			#else
+				meshLimit = std::min(model.TransparentMeshCount(), frameNumber * 20);
+				// meshLimit = std::min(30U, frameNumber / 5);
+			#endif
+		#endif
+
+		/* the set of transparent casters changed, so the cached shadow maps are stale */
+		#if SHADOW_CACHE
+			if (meshLimit != lastShadowMeshLimit)
+				shadowCache.Invalidate();
+		#else
+			shadowCache.Invalidate();
+		#endif
+
+		/* TEMPORAL SHADOWS: a new noise pattern, so the stochastic maps are re-rendered every frame */
+		#if TEMPORAL_SHADOWS
+			shadowData.temporalInfo.x = frameNumber % 1024;
+			shadowCache.Invalidate();
+		#endif
+
+		/* CTS: each composited layer overwrites the translucent maps with only the casters up to it,
+			so the full set the opaque geometry is lit by has to be rendered again every frame */
+		#if CTS
+			shadowCache.Invalidate();
+		#endif
+
+		#if VIRTUAL_SHADOWS
+			if (meshLimit != lastShadowMeshLimit)
+				virtualShadows.Invalidate();
+		#endif
+
+		#if SHADOW_CACHE or VIRTUAL_SHADOWS
+			lastShadowMeshLimit = meshLimit;
+		#endif
+
+		/* Window polling */
+		glfwPollEvents();
+
+		/* print camera position and direction */
+		if (glfwGetKey(env.Window().window, GLFW_KEY_P) == GLFW_PRESS)
+		{
+			if (printOutLastFrame == false)
+			{
+				camera.PrintPositionalData();
+			}
+
+			printOutLastFrame = true;
+		}
+		else
+		{
+			printOutLastFrame = false;
+		}
+
+		/* trace the ground truth of this view, at the frame's resolution, for comparing against a capture of the frame */
+		bool referencePressed = (glfwGetKey(env.Window().window, GLFW_KEY_R) == GLFW_PRESS);
+		if (referencePressed && referenceLastFrame == false)
+		{
+			if (referenceRenderer == nullptr)
+			{
+				double buildStart = glfwGetTime();
+				referenceRenderer = std::make_unique<Renderer::ReferenceRenderer>(&model);
+				printf("reference renderer: %u triangles, %u BVH nodes, built in %.1f ms\n", referenceRenderer->TriangleCount(),
+					referenceRenderer->NodeCount(), (glfwGetTime() - buildStart) * 1000.0);
+			}
+
+			double renderStart = glfwGetTime();
+			referenceRenderer->Render(&camera, &lights, env.Window().swapchainExtent.width, env.Window().swapchainExtent.height);
+
+			std::string referencePath = "../output/reference_" + std::to_string(referenceCount++) + ".png";
+			referenceRenderer->WritePNG(referencePath.c_str());
+			printf("reference image %s traced in %.1f ms on %u threads\n", referencePath.c_str(),
+				(glfwGetTime() - renderStart) * 1000.0, referenceRenderer->ThreadCount());
+		}
+		referenceLastFrame = referencePressed;
+
+		#if SSM or CSSM
+			/* cycle the stochastic shadow passes' noise pattern */
+			if (glfwGetKey(env.Window().window, GLFW_KEY_N) == GLFW_PRESS)
+			{
+				if (noiseCycleLastFrame == false)
+				{
+					noisePatterns.Cycle();
+					noiseTextureSet = noisePatterns.Set();
+
+					shadowData.samplingInfo.x = static_cast<uint32_t>(noisePatterns.Pattern());
+					#if not (TEMPORAL_SHADOWS or DENOISED_SHADOWS or CSSM_MSAA)
+						shadowData.samplingInfo.y = StochasticPCFRadius[static_cast<uint32_t>(noisePatterns.Pattern())];
+						if (ShadowFilterTiers[shadowFilterTier].pcfRadius == 0)
+							shadowFilter.pcfRadius = shadowData.samplingInfo.y;
+					#endif
+
+					shadowCache.Invalidate();
+					#if VIRTUAL_SHADOWS
+						virtualShadows.Invalidate();
+					#endif
+					printf("Stochastic noise pattern: %s\n", Renderer::NoisePatternName(noisePatterns.Pattern()));
+				}
+
+				noiseCycleLastFrame = true;
+			}
+			else
+			{
+				noiseCycleLastFrame = false;
+			}
+
+			/* cycle the lookups' filter quality tier */
+			bool filterCyclePressed = (glfwGetKey(env.Window().window, GLFW_KEY_K) == GLFW_PRESS);
+			if (filterCyclePressed && shadowFilterCycleLastFrame == false)
+			{
+				shadowFilterTier = (shadowFilterTier + 1) % ShadowFilterTierCount;
+				shadowFilter = ShadowFilterTiers[shadowFilterTier];
+				if (shadowFilter.pcfRadius == 0)
+					shadowFilter.pcfRadius = shadowData.samplingInfo.y;
+				printf("shadow filter tier %u: PCF radius %u\n", shadowFilterTier, shadowFilter.pcfRadius);
+			}
+			shadowFilterCycleLastFrame = filterCyclePressed;
+		#endif
+
+		#if DENOISED_SHADOWS
+			/* change the shadow mask denoiser's radius, it's read from the shadow data every frame */
+			bool denoiseSmaller = (glfwGetKey(env.Window().window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS);
+			bool denoiseLarger = (glfwGetKey(env.Window().window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS);
+			if ((denoiseSmaller || denoiseLarger) && SM_denoiseKeyLastFrame == false)
+			{
+				uint32_t& radius = shadowData.samplingInfo.z;
+				radius = (denoiseLarger) ? std::min(radius + 1, ShadowDenoiseMaxRadius) : ((radius > 0) ? radius - 1 : 0);
+				printf("shadow denoise radius: %u\n", radius);
+			}
+			SM_denoiseKeyLastFrame = (denoiseSmaller || denoiseLarger);
+		#endif
+
+		#if CSSM_FORMAT_COMPARISON
+			/* cycle the colour format used for lighting */
+			bool cyclePressed = (glfwGetKey(env.Window().window, GLFW_KEY_F) == GLFW_PRESS);
+			if (cyclePressed && CSSM_compareCycleLastFrame == false)
+			{
+				CSSM_compareSelected = (CSSM_compareSelected + 1) % CSSM_compareCount;
+				CSSM_lookupSet = &CSSM_compareSets[CSSM_compareSelected];
+				shadowData.cascadeInfo.y = static_cast<uint32_t>(CSSM_compareFormats[CSSM_compareSelected]);
+				printf("CSSM colour format: %s\n", CSSM_compareNames[CSSM_compareSelected]);
+			}
+			CSSM_compareCycleLastFrame = cyclePressed;
+
+			/* compare the stored depths of every format this frame */
+			bool validatePressed = (glfwGetKey(env.Window().window, GLFW_KEY_C) == GLFW_PRESS);
+			if (validatePressed && CSSM_compareValidateLastFrame == false)
+				CSSM_compareValidate = true;
+			CSSM_compareValidateLastFrame = validatePressed;
+
+			if (CSSM_compareValidate && CSSM_compareReadbacks.empty())
+			{
+				for (uint32_t i = 0; i < CSSM_compareCount; i++)
+				{
+					CSSM_compareReadbacks.push_back(lut::create_buffer(env.Allocator(),
+						static_cast<VkDeviceSize>(SHADOW_MAP_RESOLUTION) * SHADOW_MAP_RESOLUTION * SHADOW_CASCADE_COUNT * Renderer::CSSMColourTexelSize(CSSM_compareFormats[i]),
+						VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU));
+				}
+			}
+		#endif
+
+		/* Recreate the swap chain if it's been invalidated.
+			The viewport is dynamic state, so only a new swap chain format,
+			which recreates the present pass, needs a pipeline rebuilt. */
+		if (const ErrorCode swapChain = env.CheckSwapChain({ &simpleOpaquePass, &presentPass }); swapChain != ErrorCode::SUCCESS)
+		{
+			if (swapChain == ErrorCode::FORMAT_CHANGED)
+				postPresentPipeline.Repair(&env);
+
+			camera.UpdateCameraSettings(FOV,
+				env.Window().swapchainExtent.width, env.Window().swapchainExtent.height);
+
+			continue;
+		}
+
+		/* Get the next swap chain image, etc. and wait for fences */
+		if (env.PrepareNextFrame() != ErrorCode::SUCCESS)
+			continue;
+
+		/* Update time and camera */
+		double now = glfwGetTime();
+		double timeDelta = now - time;
+		time = now;
+		bool moved = false;
+		camera.FrameUpdate(timeDelta, &moved);
+
+		if (moved)
+		{
+			/* update shadow data */
+
+			shadowFitBounds.receiversVisible = model.VisibleBounds(camera.GetUniformDataPtr()->projView,
+				&shadowFitBounds.receiverMin, &shadowFitBounds.receiverMax);
+			shadowData.Update(&camera, &lights.sunLight, ShadowBufferDistance, 0.0f, ShadowCascadeSplit, ShadowCascadeLambda, shadowCachePtr, shadowFitBoundsPtr);
+			model.SortTransparentGeometry(-lights.sunLight.direction * 9999.9f, camera.Position(), false, true);
+		}
+
+		#if DYNAMIC_SHADOW_RESOLUTION
+			/* DYNAMIC SHADOW RESOLUTION: a new resolution changes the texel size, so the cascades are snapped again */
+			shadowResolutionPolicy.Update(&env, shadowData.cascadeProjView[0]);
+			if (shadowResolutionPolicy.Changed())
+			{
+				shadowResolution = shadowResolutionPolicy.Resolution();
+				shadowCache.SetResolution(shadowResolution);
+				shadowData.Update(&camera, &lights.sunLight, ShadowBufferDistance, 0.0f, ShadowCascadeSplit, ShadowCascadeLambda, shadowCachePtr, shadowFitBoundsPtr);
+				shadowData.cascadeInfo.z = shadowResolution;
+				printf("shadow map resolution: %u (%.3f ms)\n", shadowResolution, shadowResolutionPolicy.GpuTime());
+			}
+		#endif
+
+		#if VIRTUAL_SHADOWS
+			/* VIRTUAL SHADOWS: place the virtual region, then give pool slots to the pages the camera asked for */
+			virtualShadows.Update(&camera, shadowData.view, ShadowBufferDistance);
+			virtualShadows.ProcessRequests(&env);
+
+			VSM_renderData = shadowData;
+			for (uint32_t i = 0; i < SHADOW_CASCADE_MAX; i++)
+				VSM_renderData.cascadeProjView[i] = virtualShadows.ProjView();
+			VSM_renderData.cascadeInfo.x = 1;
+		#endif
+
+		/* Prepare to queue commands */
+		env.BeginFrameCommands();
+
+		#if TIMING
+			vkResetQueryPool(env.Window().device, queryPool, 0, 8);
+		#endif
+
+		#if CSSM_FORMAT_COMPARISON
+			vkResetQueryPool(env.Window().device, CSSM_compareQueries, 0, CSSM_compareCount * 2);
+		#endif
+
+		TIMESTAMP(0) /* frame start */
+
+		/* Update the camera and lighting data buffers */
+		Renderer::CmdUpdateBuffer(&env, &cameraUBO, 0, sizeof(Renderer::Uniforms::CameraData), camera.GetUniformDataPtr());
+		Renderer::CmdUpdateBuffer(&env, &lightingUBO, 0, sizeof(Renderer::Uniforms::LightData), &lights);
+		Renderer::CmdUpdateBuffer(&env, &shadowMapProjUBO, 0, sizeof(Renderer::Uniforms::DirectionalShadowData), &shadowData);
+
+		#if VIRTUAL_SHADOWS
+			Renderer::CmdUpdateBuffer(&env, &VSM_renderUBO, 0, sizeof(Renderer::Uniforms::DirectionalShadowData), &VSM_renderData);
+			virtualShadows.CmdUploadPageTable(&env);
+		#endif
+
+		#if LOCAL_LIGHTS
+			/* LOCAL LIGHTS: re-size the tiles for the new view, the list and views are only uploaded when they changed */
+			shadowAtlas.Update(&camera, localLights);
+			shadowAtlas.CmdUpload(&env);
+		#endif
+
+		/* Set the shadow map texture(s) for writing */
+		if (firstFrame)
+		{
+			firstFrame = false;
+			Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
+
+			#if TRANSLUCENT_SHADOWS or CTS
+				Renderer::CmdPrimeImageForRead(&env, TS_translucentDepthMap, TS_translucentDepthIsDepth);
+				Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0], false);
+			#endif
+
+			#if CSSM
+				Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[0], false);
+				Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[1], true);
+			#endif
+
+			#if CMSM
+				Renderer::CmdPrimeImageForRead(&env, CMSM_momentMap, false);
+				Renderer::CmdPrimeImageForRead(&env, CMSM_transmittanceMap, false);
+				Renderer::CmdPrimeImageForRead(&env, CMSM_depthMap, true);
+			#endif
+
+			#if FOM
+				for (lut::Image* map : FOM_coefficientMaps)
+					Renderer::CmdPrimeImageForRead(&env, map, false);
+				Renderer::CmdPrimeImageForRead(&env, FOM_depthMap, true);
+			#endif
+
+			#if VIRTUAL_SHADOWS and not CSSM
+				Renderer::CmdPrimeImageForRead(&env, VSM_poolDepth, true);
+			#endif
+
+			#if VIRTUAL_SHADOWS and TRANSLUCENT_SHADOWS
+				Renderer::CmdPrimeImageForRead(&env, VSM_translucentColour, false);
+				Renderer::CmdPrimeImageForRead(&env, VSM_translucentDepth, false);
+			#endif
+
+			#if VIRTUAL_SHADOWS and CSSM
+				Renderer::CmdPrimeImageForRead(&env, VSM_cssmColour, false);
+				Renderer::CmdPrimeImageForRead(&env, VSM_cssmDepth, true);
+			#endif
+
+			#if DEFERRED
+				for (uint32_t i = 0; i < 3; i++)
+					Renderer::CmdPrimeImageForRead(&env, &(*DS_gBuffer)[i], false);
+			#endif
+
+			#if SHADOW_MASK
+				Renderer::CmdPrimeImageForRead(&env, SM_depthMap, true);
+			#endif
+
+			#if LOCAL_LIGHTS
+				for (uint32_t i = 0; i < 3; i++)
+					Renderer::CmdPrimeImageForRead(&env, LL_atlasImages[i], i == 2);
+			#endif
+
+			#if CSSM_FORMAT_COMPARISON
+				for (uint32_t i = 0; i < CSSM_compareCount; i++)
+				{
+					Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(CSSM_compareIndices[i]))[0], false);
+					Renderer::CmdPrimeImageForRead(&env, &(*env.GetSideBufferImage(CSSM_compareIndices[i]))[1], true);
+				}
+			#endif
+		}
+		TIMESTAMP(2) /* shadow mapping start */
+
+		#if VIRTUAL_SHADOWS /* VIRTUAL SHADOWS IMPLEMENTATION: PAGE RENDERING */
+			if (virtualShadows.PagesToRender().empty() == false)
 			{
-				#if VANILLA or TRANSLUCENT_SHADOWS or CTS
-					/* opaque meshes */
-					shadowPipeline.CmdBind(&env);
-					shadowMapProjSet.CmdBind(&env, &shadowPipeline, 0);
-					model.CmdDrawOpaque_DepthOnly(&env, &shadowPipeline);
+				#if not CSSM
+					Renderer::CmdTransitionForWrite(&env, VSM_poolDepth, true);
+
+					/* VIRTUAL SHADOWS: opaque depth, one page at a time */
+					env.BeginRenderPass(&VSM_pagePass, VSM_poolIndex, VSM_POOL_RESOLUTION, VSM_POOL_RESOLUTION);
+
+					{
+						VSM_pagePipeline.CmdBind(&env);
+						VSM_renderSet.CmdBind(&env, &VSM_pagePipeline, 0);
+
+						for (uint32_t slot : virtualShadows.PagesToRender())
+						{
+							virtualShadows.CmdBeginPage(&env, &VSM_pagePass, slot);
+							model.CmdDrawOpaque_DepthOnly(&env, &VSM_pagePipeline);
+						}
+					}
+
+					env.EndRenderPass();
 				#endif
 
-				#if SSM
-					/* all meshes */
-					SSM_shadowPipeline.CmdBind(&env);
-					shadowMapProjSet.CmdBind(&env, &SSM_shadowPipeline, 0);
-					noiseTextureSet.CmdBind(&env, &SSM_shadowPipeline, 2);
-					model.CmdDrawOpaque(&env, &SSM_shadowPipeline);
-					model.CmdDrawTransparent(&env, &SSM_shadowPipeline, 0, meshLimit);
+				#if TRANSLUCENT_SHADOWS
+					Renderer::CmdTransitionForWrite(&env, VSM_translucentColour, false);
+					Renderer::CmdTransitionForWrite(&env, VSM_translucentDepth, false);
+
+					/* VIRTUAL SHADOWS: translucent colour and nearest translucent depth, tested against the opaque pages */
+					env.BeginRenderPass(&VSM_translucentPagePass, VSM_translucentPoolIndex, VSM_POOL_RESOLUTION, VSM_POOL_RESOLUTION);
+
+					{
+						VSM_translucentPagePipeline.CmdBind(&env);
+						VSM_renderSet.CmdBind(&env, &VSM_translucentPagePipeline, 0);
+
+						for (uint32_t slot : virtualShadows.PagesToRender())
+						{
+							virtualShadows.CmdBeginPage(&env, &VSM_translucentPagePass, slot, true, false);
+							model.CmdDrawTransparentLightFrontToBack(&env, &VSM_translucentPagePipeline, 0, meshLimit);
+						}
+					}
+
+					env.EndRenderPass();
+
+					Renderer::CmdTransitionForRead(&env, VSM_translucentColour, false);
+					Renderer::CmdTransitionForRead(&env, VSM_translucentDepth, false);
 				#endif
-			}
 
-			/* End render pass */
-			env.EndRenderPass();
-		#endif
+				#if not CSSM
+					Renderer::CmdTransitionForRead(&env, VSM_poolDepth, true);
+				#endif
 
-		#if CSSM
-			/* transition the cssm textures for writing */
-			Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[0], false);
-			Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[1], true);
+				#if CSSM
+					Renderer::CmdTransitionForWrite(&env, VSM_cssmColour, false);
+					Renderer::CmdTransitionForWrite(&env, VSM_cssmDepth, true);
+
+					/* VIRTUAL SHADOWS: coloured stochastic shadow map, opaque then transparent meshes per page */
+					env.BeginRenderPass(&VSM_cssmPagePass, VSM_cssmPoolIndex, VSM_POOL_RESOLUTION, VSM_POOL_RESOLUTION);
+
+					{
+						for (uint32_t slot : virtualShadows.PagesToRender())
+						{
+							virtualShadows.CmdBeginPage(&env, &VSM_cssmPagePass, slot);
+
+							VSM_cssmOpaquePagePipeline.CmdBind(&env);
+							VSM_renderSet.CmdBind(&env, &VSM_cssmOpaquePagePipeline, 0);
+							noiseTextureSet->CmdBind(&env, &VSM_cssmOpaquePagePipeline, 2);
+							model.CmdDrawOpaque(&env, &VSM_cssmOpaquePagePipeline);
+
+							VSM_cssmTransparentPagePipeline.CmdBind(&env);
+							VSM_renderSet.CmdBind(&env, &VSM_cssmTransparentPagePipeline, 0);
+							noiseTextureSet->CmdBind(&env, &VSM_cssmTransparentPagePipeline, 2);
+							model.CmdDrawTransparent(&env, &VSM_cssmTransparentPagePipeline, 0, meshLimit);
+						}
+					}
+
+					env.EndRenderPass();
+
+					Renderer::CmdTransitionForRead(&env, VSM_cssmColour, false);
+					Renderer::CmdTransitionForRead(&env, VSM_cssmDepth, true);
+				#endif
+			}
 
-			/* Begin cssm render pass */
-			env.BeginRenderPass(&CSSM_shadowPass, CSSM_shadowMapIndex,
-				SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION); /* rendering to the colored stochastic shadow map */
+			/* VIRTUAL SHADOWS: mark the pages next frame's camera depth needs, read back a few frames later */
+			virtualShadows.CmdClearRequests(&env);
+
+			env.BeginRenderPass(&VSM_analysisPass, VSM_analysisIndex, VirtualShadowAnalysisWidth, VirtualShadowAnalysisHeight);
 
 			{
-				/* all meshes */
-				CSSM_shadowOpaquePipeline.CmdBind(&env);
-				shadowMapProjSet.CmdBind(&env, &CSSM_shadowOpaquePipeline, 0);
-				noiseTextureSet.CmdBind(&env, &CSSM_shadowOpaquePipeline, 2);
-				model.CmdDrawOpaque(&env, &CSSM_shadowOpaquePipeline);
-
-				CSSM_shadowTransparentPipeline.CmdBind(&env);
-				shadowMapProjSet.CmdBind(&env, &CSSM_shadowTransparentPipeline, 0);
-				noiseTextureSet.CmdBind(&env, &CSSM_shadowTransparentPipeline, 2);
-				model.CmdDrawTransparent(&env, &CSSM_shadowTransparentPipeline, 0, meshLimit);
+				VSM_analysisOpaquePipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &VSM_analysisOpaquePipeline, 0);
+				VSM_analysisSet.CmdBind(&env, &VSM_analysisOpaquePipeline, 1);
+				model.CmdDrawOpaque_DepthOnly(&env, &VSM_analysisOpaquePipeline);
+
+				VSM_analysisTransparentPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &VSM_analysisTransparentPipeline, 0);
+				VSM_analysisSet.CmdBind(&env, &VSM_analysisTransparentPipeline, 1);
+				model.CmdDrawTransparent_DepthOnly(&env, &VSM_analysisTransparentPipeline, 0, meshLimit);
 			}
 
-			/* End render pass */
 			env.EndRenderPass();
 
-			/* transition the cssm textures for reading */
-			Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[0], false);
-			Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[1], true);
+			virtualShadows.CmdReadbackRequests(&env);
 		#endif
 
-		/* Set the opaque shadow map texture for reading */
-		#if VANILLA or SSM
-			Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
+		/* the shadow maps are kept between frames, and only re-rendered when the cache is invalidated */
+		#if not VIRTUAL_SHADOWS
+		if (shadowCache.Dirty())
+		{
+			#if DYNAMIC_SHADOW_RESOLUTION
+				shadowResolutionPolicy.CmdBeginTiming(&env);
+			#endif
+
+			#if not CSSM and not CMSM and not FOM
+				Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
+			#endif
+
+			#if TRANSLUCENT_SHADOWS or CTS
+				Renderer::CmdTransitionForWrite(&env, TS_translucentDepthMap, TS_translucentDepthIsDepth);
+				Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0], false);
+			#endif
+
+			#if CPU_SHADOW_RASTER
+				/* the opaque shadow map is rasterized on the CPU and copied in */
+				shadowRasterizer.Rasterize(&env, shadowData.cascadeProjView, shadowPass.ViewCount(), shadowResolution);
+				shadowRasterizer.CmdUpload(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0]);
+			#elif VANILLA or TRANSLUCENT_SHADOWS or SSM or CTS
+				/* Begin shadow map pass */
+				env.BeginRenderPass(&shadowPass, shadowMapIndex, shadowResolution, shadowResolution); /* rendering to the opaque shadow map */
+
+				{
+					#if VANILLA or TRANSLUCENT_SHADOWS or CTS
+						/* opaque meshes */
+						shadowPipeline.CmdBind(&env);
+						shadowMapProjSet.CmdBind(&env, &shadowPipeline, 0);
+						model.CmdDrawOpaque_DepthOnly(&env, &shadowPipeline);
+					#endif
+
+					#if SSM
+						/* all meshes */
+						SSM_shadowPipeline.CmdBind(&env);
+						shadowMapProjSet.CmdBind(&env, &SSM_shadowPipeline, 0);
+						noiseTextureSet->CmdBind(&env, &SSM_shadowPipeline, 2);
+						model.CmdDrawOpaque(&env, &SSM_shadowPipeline);
+						model.CmdDrawTransparent(&env, &SSM_shadowPipeline, 0, meshLimit);
+					#endif
+				}
+
+				/* End render pass */
+				env.EndRenderPass();
+			#endif
+
+			#if CSSM
+				/* transition the cssm textures for writing */
+				Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[0], false);
+				Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[1], true);
+
+				/* Begin cssm render pass */
+				env.BeginRenderPass(&CSSM_shadowPass, CSSM_shadowMapIndex,
+					shadowResolution, shadowResolution); /* rendering to the colored stochastic shadow map */
+
+				{
+					/* all meshes */
+					CSSM_shadowOpaquePipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &CSSM_shadowOpaquePipeline, 0);
+					noiseTextureSet->CmdBind(&env, &CSSM_shadowOpaquePipeline, 2);
+					model.CmdDrawOpaque(&env, &CSSM_shadowOpaquePipeline);
+
+					CSSM_shadowTransparentPipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &CSSM_shadowTransparentPipeline, 0);
+					noiseTextureSet->CmdBind(&env, &CSSM_shadowTransparentPipeline, 2);
+					model.CmdDrawTransparent(&env, &CSSM_shadowTransparentPipeline, 0, meshLimit);
+				}
+
+				/* End render pass */
+				env.EndRenderPass();
+
+				/* transition the cssm textures for reading */
+				Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[0], false);
+				Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(CSSM_shadowMapIndex))[1], true);
+
+				#if not CSSM_MSAA
+					CSSM_pyramid.CmdBuild(&env);
+				#endif
+			#endif
+
+			#if CMSM
+				/* COLOURED MOMENT SHADOW MAPS: transition the moment pass targets for writing */
+				Renderer::CmdTransitionForWrite(&env, CMSM_momentMap, false);
+				Renderer::CmdTransitionForWrite(&env, CMSM_transmittanceMap, false);
+				Renderer::CmdTransitionForWrite(&env, CMSM_depthMap, true);
+
+				/* COLOURED MOMENT SHADOW MAPS: Begin moment render pass */
+				env.BeginRenderPass(&CMSM_shadowPass, CMSM_shadowMapIndex,
+					shadowResolution, shadowResolution); /* rendering to the moment and transmittance maps */
+
+				{
+					/* opaque meshes first, so translucent casters behind them are depth tested away */
+					CMSM_shadowOpaquePipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &CMSM_shadowOpaquePipeline, 0);
+					model.CmdDrawOpaque(&env, &CMSM_shadowOpaquePipeline);
+
+					/* translucent meshes, in any order */
+					CMSM_shadowTransparentPipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &CMSM_shadowTransparentPipeline, 0);
+					model.CmdDrawTransparent(&env, &CMSM_shadowTransparentPipeline, 0, meshLimit);
+				}
+
+				/* COLOURED MOMENT SHADOW MAPS: End render pass */
+				env.EndRenderPass();
+
+				/* COLOURED MOMENT SHADOW MAPS: blur and build the mips, the maps are read back by the filter itself */
+				Renderer::CmdTransitionForRead(&env, CMSM_depthMap, true);
+				CMSM_filter.CmdFilter(&env, CMSM_momentMap, CMSM_transmittanceMap);
+			#endif
+
+			#if FOM
+				/* FOURIER OPACITY MAPS: transition the coefficient maps and the depth for writing */
+				for (lut::Image* map : FOM_coefficientMaps)
+					Renderer::CmdTransitionForWrite(&env, map, false);
+				Renderer::CmdTransitionForWrite(&env, FOM_depthMap, true);
+
+				/* FOURIER OPACITY MAPS: Begin coefficient render pass */
+				env.BeginRenderPass(&FOM_shadowPass, FOM_shadowMapIndex,
+					shadowResolution, shadowResolution); /* rendering to the coefficient maps */
+
+				{
+					/* opaque meshes first, so translucent casters behind them are depth tested away */
+					FOM_shadowOpaquePipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &FOM_shadowOpaquePipeline, 0);
+					model.CmdDrawOpaque(&env, &FOM_shadowOpaquePipeline);
+
+					/* translucent meshes, in any order */
+					FOM_shadowTransparentPipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &FOM_shadowTransparentPipeline, 0);
+					model.CmdDrawTransparent(&env, &FOM_shadowTransparentPipeline, 0, meshLimit);
+				}
+
+				/* FOURIER OPACITY MAPS: End render pass */
+				env.EndRenderPass();
+
+				for (lut::Image* map : FOM_coefficientMaps)
+					Renderer::CmdTransitionForRead(&env, map, false);
+				Renderer::CmdTransitionForRead(&env, FOM_depthMap, true);
+			#endif
+
+			/* Set the opaque shadow map texture for reading */
+			#if VANILLA or SSM
+				Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
+			#endif
+
+			#if SSM
+				SSM_pyramid.CmdBuild(&env);
+			#endif
+
+			#if (TRANSLUCENT_SHADOWS or CTS) and not TS_SINGLE_PASS
+				/* TRANSLUCENT SHADOWS: Begin translucent shadow map pass */
+				env.BeginRenderPass(&shadowPass, TS_translucentDepthMapIndex,
+					shadowResolution, shadowResolution); /* rendering to translucent shadow depth map */
+
+				{
+					/* transparent meshes
+						this pass records the transparent surface closest to the camera */
+					shadowPipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &shadowPipeline, 0);
+					model.CmdDrawTransparentLightFrontToBack_DepthOnly(&env, &shadowPipeline, 0, meshLimit, true);
+				}
+
+				/* TRANSLUCENT SHADOWS: End render pass */
+				env.EndRenderPass();
+
+				/* TRANSLUCENT SHADOWS: Set the translucent depth map texture for reading */
+				Renderer::CmdTransitionForRead(&env, TS_translucentDepthMap, true);
+			#endif
+
+			#if TRANSLUCENT_SHADOWS or CTS
+				/* Set the opaque shadow map texture for reading, the colour pass's depth is made from it */
+				Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
+
+				/* TRANSLUCENT SHADOWS: Begin translucent shadow colour pass */
+				uint32_t TS_colourResolution = std::max(shadowResolution / TS_COLOUR_MAP_DIVISOR, 1u);
+				env.BeginRenderPass(&TS_translucentShadowPass, TS_translucentShadowMapIndex,
+					TS_colourResolution, TS_colourResolution); /* rendering to translucent shadow colour map */
+
+				{
+					TS_opaqueDepthPipeline.CmdBind(&env);
+					TS_opaqueDepthSet.CmdBind(&env, &TS_opaqueDepthPipeline, 0);
+					Renderer::CmdDrawFullscreenQuad(&env);
+
+					/* this pass accumulates the colours of transparent geometry visible to the light,
+						so the final translucent shadow colour can be determined.
+						with TS_SINGLE_PASS it also records the transparent surface closest to the light. */
+					TS_transparentPipeline.CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &TS_transparentPipeline, 0);
+					model.CmdDrawTransparentLightFrontToBack(&env, &TS_transparentPipeline, 0, meshLimit);
+				}
+
+				/* TRANSLUCENT SHADOWS: End render pass */
+				env.EndRenderPass();
+
+				#if TS_SINGLE_PASS
+					/* TRANSLUCENT SHADOWS: Set the translucent depth map texture for reading */
+					Renderer::CmdTransitionForRead(&env, TS_translucentDepthMap, false);
+				#endif
+
+				/* TRANSLUCENT SHADOWS: filter the translucent shadow colour down its mips, leaving it ready for reading */
+				Renderer::CmdBuildColourMips(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0],
+					{ TS_colourResolution, TS_colourResolution }, TS_colourMipLevels, TS_translucentShadowPass.ViewCount());
+			#endif
+
+			#if DYNAMIC_SHADOW_RESOLUTION
+				shadowResolutionPolicy.CmdEndTiming(&env);
+			#endif
+
+			shadowCache.MarkRendered();
+		}
 		#endif
 
-		#if TRANSLUCENT_SHADOWS or CTS
-			/* TRANSLUCENT SHADOWS: Begin translucent shadow map pass */
-			env.BeginRenderPass(&shadowPass, TS_translucentDepthMapIndex); /* rendering to translucent shadow depth map */
+		#if SHADOW_MASK /* SCREEN-SPACE SHADOW MASK: opaque depth pre-pass, then the mask from this frame's shadow maps */
+			VkExtent2D SM_extent = { std::min(env.Window().swapchainExtent.width, SM_width), std::min(env.Window().swapchainExtent.height, SM_height) };
 
-			{
-				/* transparent meshes
-					this pass records the transparent surface closest to the camera */
-				shadowPipeline.CmdBind(&env);
-				shadowMapProjSet.CmdBind(&env, &shadowPipeline, 0);
-				model.CmdDrawTransparentLightFrontToBack_DepthOnly(&env, &shadowPipeline, 0, meshLimit, true);
-			}
+			#if DEFERRED
+				for (uint32_t i = 0; i < 3; i++)
+					Renderer::CmdTransitionForWrite(&env, &(*DS_gBuffer)[i], false);
+			#endif
+			Renderer::CmdTransitionForWrite(&env, SM_depthMap, true);
 
-			/* TRANSLUCENT SHADOWS: End render pass */
-			env.EndRenderPass();
+			#if DEFERRED
+				/* DEFERRED: Begin G-buffer pass */
+				env.BeginRenderPass(&DS_gBufferPass, DS_gBufferIndex, SM_extent.width, SM_extent.height);
+
+				{
+					/* opaque meshes only, transparents are shaded forward */
+					DS_gBufferPipeline.CmdBind(&env);
+					cameraSet.CmdBind(&env, &DS_gBufferPipeline, 0);
+					model.CmdDrawOpaque(&env, &DS_gBufferPipeline);
+				}
+			#else
+				/* SHADOW MASK: Begin depth pre-pass */
+				env.BeginRenderPass(&SM_depthPass, SM_depthIndex, SM_extent.width, SM_extent.height);
+
+				{
+					/* opaque meshes, transparents are lit per fragment and never read the mask */
+					SM_depthPipeline.CmdBind(&env);
+					cameraSet.CmdBind(&env, &SM_depthPipeline, 0);
+					model.CmdDrawOpaque_DepthOnly(&env, &SM_depthPipeline);
+				}
+			#endif
 
-			/* TRANSLUCENT SHADOWS: Set the opaque shadow map texture for reading */
-			Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(TS_translucentDepthMapIndex))[0], true);
+			/* SHADOW MASK: End render pass */
+			env.EndRenderPass();
 
-			/* TRANSLUCENT SHADOWS: Begin translucent shadow colour pass */
-			env.BeginRenderPass(&TS_translucentShadowPass, TS_translucentShadowMapIndex,
-				SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION); /* rendering to translucent shadow colour map */
+			#if DEFERRED
+				for (uint32_t i = 0; i < 3; i++)
+					Renderer::CmdTransitionForRead(&env, &(*DS_gBuffer)[i], false);
+			#endif
+			Renderer::CmdTransitionForRead(&env, SM_depthMap, true);
+			shadowMask.CmdBuild(&env, SM_extent);
+		#endif
 
+		#if CSSM_FORMAT_COMPARISON /* CSSM FORMAT COMPARISON: every format, every frame */
+			for (uint32_t i = 0; i < CSSM_compareCount; i++)
 			{
-				/* this pass accumulates the colours of transparent geometry visible to the light,
-					so the final translucent shadow colour can be determined. */
-				TS_transparentPipeline.CmdBind(&env);
-				shadowMapProjSet.CmdBind(&env, &TS_transparentPipeline, 0);
-				model.CmdDrawTransparentLightFrontToBack(&env, &TS_transparentPipeline, 0, meshLimit);
+				lut::Image* compareColour = &(*env.GetSideBufferImage(CSSM_compareIndices[i]))[0];
+				lut::Image* compareDepth = &(*env.GetSideBufferImage(CSSM_compareIndices[i]))[1];
+
+				Renderer::CmdTransitionForWrite(&env, compareColour, false);
+				Renderer::CmdTransitionForWrite(&env, compareDepth, true);
+
+				vkCmdWriteTimestamp(*env.CurrentCmdBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, CSSM_compareQueries, i * 2);
+
+				env.BeginRenderPass(&CSSM_comparePasses[i], CSSM_compareIndices[i], shadowResolution, shadowResolution);
+
+				{
+					CSSM_compareOpaquePipelines[i].CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &CSSM_compareOpaquePipelines[i], 0);
+					noiseTextureSet->CmdBind(&env, &CSSM_compareOpaquePipelines[i], 2);
+					model.CmdDrawOpaque(&env, &CSSM_compareOpaquePipelines[i]);
+
+					CSSM_compareTransparentPipelines[i].CmdBind(&env);
+					shadowMapProjSet.CmdBind(&env, &CSSM_compareTransparentPipelines[i], 0);
+					noiseTextureSet->CmdBind(&env, &CSSM_compareTransparentPipelines[i], 2);
+					model.CmdDrawTransparent(&env, &CSSM_compareTransparentPipelines[i], 0, meshLimit);
+				}
+
+				env.EndRenderPass();
+
+				vkCmdWriteTimestamp(*env.CurrentCmdBuffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, CSSM_compareQueries, i * 2 + 1);
+
+				Renderer::CmdTransitionForRead(&env, compareColour, false);
+				Renderer::CmdTransitionForRead(&env, compareDepth, true);
+				CSSM_comparePyramids[i].CmdBuild(&env);
+
+				if (CSSM_compareValidate)
+				{
+					Renderer::CmdCopyImageToBuffer(&env, compareColour, *CSSM_compareReadbacks[i],
+						SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION, SHADOW_CASCADE_COUNT);
+				}
 			}
+		#endif
 
-			/* TRANSLUCENT SHADOWS: End render pass */
-			env.EndRenderPass();
+		#if LOCAL_LIGHTS /* LOCAL LIGHTS IMPLEMENTATION: ATLAS RENDERING */
+			if (shadowAtlas.Dirty() && shadowAtlas.ViewCount() > 0)
+			{
+				for (uint32_t i = 0; i < 3; i++)
+					Renderer::CmdTransitionForWrite(&env, LL_atlasImages[i], i == 2);
 
-			/* TRANSLUCENT SHADOWS: Set the translucent shadow colour texture for reading */
-			Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0], false);
+				/* LOCAL LIGHTS: every view in one pass, each into its own tile */
+				env.BeginRenderPass(&LL_atlasPass, LL_atlasIndex, LOCAL_ATLAS_RESOLUTION, LOCAL_ATLAS_RESOLUTION);
 
-			/* Set the opaque shadow map texture for reading */
-			Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
+				{
+					for (uint32_t view = 0; view < shadowAtlas.ViewCount(); view++)
+					{
+						shadowAtlas.CmdBeginView(&env, view);
+
+						LL_atlasOpaquePipeline.CmdBind(&env);
+						shadowAtlas.CmdBindView(&env, &LL_atlasOpaquePipeline, view, 0);
+						model.CmdDrawOpaque_DepthOnly(&env, &LL_atlasOpaquePipeline);
+
+						/* tested against the opaque depth, the nearest translucent depth is min blended */
+						LL_atlasTransparentPipeline.CmdBind(&env);
+						shadowAtlas.CmdBindView(&env, &LL_atlasTransparentPipeline, view, 0);
+						model.CmdDrawTransparent(&env, &LL_atlasTransparentPipeline, 0, meshLimit);
+					}
+				}
+
+				env.EndRenderPass();
+
+				for (uint32_t i = 0; i < 3; i++)
+					Renderer::CmdTransitionForRead(&env, LL_atlasImages[i], i == 2);
+
+				shadowAtlas.MarkRendered();
+			}
 		#endif
 
 		TIMESTAMP(3) /* shadow mapping end */
@@ -743,7 +2406,36 @@ int main(int argc, char** argv)
 		{
 			/* Draw meshes */
 
-			#if VANILLA
+			#if DEFERRED
+				/* opaque geometry: lights the G-buffer, shadowed through the mask */
+				DS_lightingPipeline.CmdBind(&env);
+				lightingSet.CmdBind(&env, &DS_lightingPipeline, 0);
+				DS_gBufferSet.CmdBind(&env, &DS_lightingPipeline, 1);
+				Renderer::CmdDrawFullscreenQuad(&env);
+			#elif SHADOW_MASK
+				/* opaque geometry: one mask fetch per fragment, whichever technique built it */
+				SM_defaultPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &SM_defaultPipeline, 0);
+				lightingSet.CmdBind(&env, &SM_defaultPipeline, 2);
+				SM_maskSet.CmdBind(&env, &SM_defaultPipeline, 3);
+				model.CmdDrawOpaque(&env, &SM_defaultPipeline);
+			#endif
+
+			#if VANILLA and not VIRTUAL_SHADOWS and BAKED_SHADOWS
+				/* opaque geometry */
+				BS_defaultPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &BS_defaultPipeline, 0);
+				lightingSet.CmdBind(&env, &BS_defaultPipeline, 2);
+				BS_shadowMapSet.CmdBind(&env, &BS_defaultPipeline, 3);
+				model.CmdDrawOpaque(&env, &BS_defaultPipeline);
+
+				/* transparent geometry */
+				BS_transparentPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &BS_transparentPipeline, 0);
+				lightingSet.CmdBind(&env, &BS_transparentPipeline, 2);
+				BS_shadowMapSet.CmdBind(&env, &BS_transparentPipeline, 3);
+				model.CmdDrawTransparentCameraBackToFront(&env, &BS_transparentPipeline, 0, meshLimit);
+			#elif VANILLA and not VIRTUAL_SHADOWS
 				/* opaque geometry */
 				simplePipeline.CmdBind(&env);
 				cameraSet.CmdBind(&env, &simplePipeline, 0);
@@ -759,13 +2451,15 @@ int main(int argc, char** argv)
 				model.CmdDrawTransparentCameraBackToFront(&env, &transparentPipeline, 0, meshLimit);
 			#endif
 
-			#if TRANSLUCENT_SHADOWS or CTS
+			#if (TRANSLUCENT_SHADOWS or CTS) and not VIRTUAL_SHADOWS
 				/* opaque geometry */
-				TS_geometryPipeline.CmdBind(&env);
-				cameraSet.CmdBind(&env, &TS_geometryPipeline, 0);
-				lightingSet.CmdBind(&env, &TS_geometryPipeline, 2);
-				TS_shadowMapSet.CmdBind(&env, &TS_geometryPipeline, 3);
-				model.CmdDrawOpaque(&env, &TS_geometryPipeline);
+				#if not SHADOW_MASK /* drawn above */
+					TS_geometryPipeline.CmdBind(&env);
+					cameraSet.CmdBind(&env, &TS_geometryPipeline, 0);
+					lightingSet.CmdBind(&env, &TS_geometryPipeline, 2);
+					TS_shadowMapSet.CmdBind(&env, &TS_geometryPipeline, 3);
+					model.CmdDrawOpaque(&env, &TS_geometryPipeline);
+				#endif
 
 				#if TRANSLUCENT_SHADOWS
 					/* transparent geometry */
@@ -779,35 +2473,96 @@ int main(int argc, char** argv)
 
 			#if SSM
 				/* opaque geometry */
-				SSM_defaultPipeline.CmdBind(&env);
-				cameraSet.CmdBind(&env, &SSM_defaultPipeline, 0);
-				lightingSet.CmdBind(&env, &SSM_defaultPipeline, 2);
-				shadowMapSet.CmdBind(&env, &SSM_defaultPipeline, 3);
-				model.CmdDrawOpaque(&env, &SSM_defaultPipeline);
+				#if not SHADOW_MASK /* drawn above */
+					SSM_defaultPipeline.CmdBind(&env, shadowFilter);
+					cameraSet.CmdBind(&env, &SSM_defaultPipeline, 0);
+					lightingSet.CmdBind(&env, &SSM_defaultPipeline, 2);
+					SSM_shadowMapSet.CmdBind(&env, &SSM_defaultPipeline, 3);
+					model.CmdDrawOpaque(&env, &SSM_defaultPipeline);
+				#endif
 
 				/* transparent geometry */
-				SSM_transparentPipeline.CmdBind(&env);
+				SSM_transparentPipeline.CmdBind(&env, shadowFilter);
 				cameraSet.CmdBind(&env, &SSM_transparentPipeline, 0);
 				lightingSet.CmdBind(&env, &SSM_transparentPipeline, 2);
-				shadowMapSet.CmdBind(&env, &SSM_transparentPipeline, 3);
+				SSM_shadowMapSet.CmdBind(&env, &SSM_transparentPipeline, 3);
 				model.CmdDrawTransparentCameraBackToFront(&env, &SSM_transparentPipeline, 0, meshLimit);
 			#endif
 
-			#if CSSM
+			#if CSSM and not VIRTUAL_SHADOWS
 				/* opaque geometry */
-				CSSM_defaultPipeline.CmdBind(&env);
-				cameraSet.CmdBind(&env, &CSSM_defaultPipeline, 0);
-				lightingSet.CmdBind(&env, &CSSM_defaultPipeline, 2);
-				CSSM_shadowMapSet.CmdBind(&env, &CSSM_defaultPipeline, 3);
-				model.CmdDrawOpaque(&env, &CSSM_defaultPipeline);
+				#if not SHADOW_MASK /* drawn above */
+					CSSM_defaultPipeline.CmdBind(&env, shadowFilter);
+					cameraSet.CmdBind(&env, &CSSM_defaultPipeline, 0);
+					lightingSet.CmdBind(&env, &CSSM_defaultPipeline, 2);
+					CSSM_lookupSet->CmdBind(&env, &CSSM_defaultPipeline, 3);
+					model.CmdDrawOpaque(&env, &CSSM_defaultPipeline);
+				#endif
 
 				/* transparent geometry */
-				CSSM_transparentPipeline.CmdBind(&env);
+				CSSM_transparentPipeline.CmdBind(&env, shadowFilter);
 				cameraSet.CmdBind(&env, &CSSM_transparentPipeline, 0);
 				lightingSet.CmdBind(&env, &CSSM_transparentPipeline, 2);
-				CSSM_shadowMapSet.CmdBind(&env, &CSSM_transparentPipeline, 3);
+				CSSM_lookupSet->CmdBind(&env, &CSSM_transparentPipeline, 3);
 				model.CmdDrawTransparentCameraBackToFront(&env, &CSSM_transparentPipeline, 0, meshLimit);
 			#endif
+
+			#if CMSM
+				/* opaque geometry */
+				CMSM_defaultPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &CMSM_defaultPipeline, 0);
+				lightingSet.CmdBind(&env, &CMSM_defaultPipeline, 2);
+				CMSM_shadowMapSet.CmdBind(&env, &CMSM_defaultPipeline, 3);
+				model.CmdDrawOpaque(&env, &CMSM_defaultPipeline);
+
+				/* transparent geometry */
+				CMSM_transparentPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &CMSM_transparentPipeline, 0);
+				lightingSet.CmdBind(&env, &CMSM_transparentPipeline, 2);
+				CMSM_shadowMapSet.CmdBind(&env, &CMSM_transparentPipeline, 3);
+				model.CmdDrawTransparentCameraBackToFront(&env, &CMSM_transparentPipeline, 0, meshLimit);
+			#endif
+
+			#if FOM
+				/* opaque geometry */
+				FOM_defaultPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &FOM_defaultPipeline, 0);
+				lightingSet.CmdBind(&env, &FOM_defaultPipeline, 2);
+				FOM_shadowMapSet.CmdBind(&env, &FOM_defaultPipeline, 3);
+				model.CmdDrawOpaque(&env, &FOM_defaultPipeline);
+
+				/* transparent geometry */
+				FOM_transparentPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &FOM_transparentPipeline, 0);
+				lightingSet.CmdBind(&env, &FOM_transparentPipeline, 2);
+				FOM_shadowMapSet.CmdBind(&env, &FOM_transparentPipeline, 3);
+				model.CmdDrawTransparentCameraBackToFront(&env, &FOM_transparentPipeline, 0, meshLimit);
+			#endif
+
+			#if VIRTUAL_SHADOWS
+				/* opaque geometry */
+				VSM_defaultPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &VSM_defaultPipeline, 0);
+				lightingSet.CmdBind(&env, &VSM_defaultPipeline, 2);
+				VSM_shadowMapSet.CmdBind(&env, &VSM_defaultPipeline, 3);
+				model.CmdDrawOpaque(&env, &VSM_defaultPipeline);
+
+				/* transparent geometry */
+				VSM_transparentPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &VSM_transparentPipeline, 0);
+				lightingSet.CmdBind(&env, &VSM_transparentPipeline, 2);
+				VSM_shadowMapSet.CmdBind(&env, &VSM_transparentPipeline, 3);
+				model.CmdDrawTransparentCameraBackToFront(&env, &VSM_transparentPipeline, 0, meshLimit);
+			#endif
+
+			#if LOCAL_LIGHTS
+				/* LOCAL LIGHTS: added over everything the technique drew, opaque then transparent back to front */
+				LL_lightingPipeline.CmdBind(&env);
+				cameraSet.CmdBind(&env, &LL_lightingPipeline, 0);
+				LL_lightSet.CmdBind(&env, &LL_lightingPipeline, 2);
+				model.CmdDrawOpaque(&env, &LL_lightingPipeline);
+				model.CmdDrawTransparentCameraBackToFront(&env, &LL_lightingPipeline, 0, meshLimit);
+			#endif
 		}
 
 		TIMESTAMP(5)
@@ -840,14 +2595,18 @@ int main(int argc, char** argv)
 				uint32_t currentMesh = model.TransparentMeshesSortedFarthestFromCamera()[i];
 				uint32_t lightFarIndex = model.ReverseLookupTransparentMeshSortedClosestToLight(currentMesh);
 
-				Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
-				Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(TS_translucentDepthMapIndex))[0], true);
+				Renderer::CmdTransitionForWrite(&env, TS_translucentDepthMap, TS_translucentDepthIsDepth);
 				Renderer::CmdTransitionForWrite(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0], false);
 
+				uint32_t TS_colourResolution = std::max(shadowResolution / TS_COLOUR_MAP_DIVISOR, 1u);
 				env.BeginRenderPass(&TS_translucentShadowPass, TS_translucentShadowMapIndex,
-					SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION); /* rendering to translucent shadow colour map */
+					TS_colourResolution, TS_colourResolution); /* rendering to translucent shadow colour map */
 
 				{
+					TS_opaqueDepthPipeline.CmdBind(&env);
+					TS_opaqueDepthSet.CmdBind(&env, &TS_opaqueDepthPipeline, 0);
+					Renderer::CmdDrawFullscreenQuad(&env);
+
 					/* this pass accumulates the colours of transparent geometry visible to the light,
 						so the final translucent shadow colour can be determined. */
 					TS_transparentPipeline.CmdBind(&env);
@@ -857,9 +2616,9 @@ int main(int argc, char** argv)
 
 				env.EndRenderPass();
 
-				Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(shadowMapIndex))[0], true);
-				Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(TS_translucentDepthMapIndex))[0], true);
-				Renderer::CmdTransitionForRead(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0], false);
+				Renderer::CmdTransitionForRead(&env, TS_translucentDepthMap, TS_translucentDepthIsDepth);
+				Renderer::CmdBuildColourMips(&env, &(*env.GetSideBufferImage(TS_translucentShadowMapIndex))[0],
+					{ TS_colourResolution, TS_colourResolution }, TS_colourMipLevels, TS_translucentShadowPass.ViewCount());
 
 				/* Begin geometry pass */
 				env.BeginRenderPass(&CTS_compositingPass); /* rendering to intermediate 0 */
@@ -947,10 +2706,89 @@ int main(int argc, char** argv)
 			overrideClose = true;
 		#endif
 
+		#if CSSM_FORMAT_COMPARISON
+			vkGetQueryPoolResults(env.Window().device, CSSM_compareQueries, 0, CSSM_compareCount * 2, sizeof(CSSM_compareTimestamps),
+				CSSM_compareTimestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+			for (uint32_t i = 0; i < CSSM_compareCount; i++)
+			{
+				CSSM_compareTimes[i] += static_cast<double>(CSSM_compareTimestamps[i * 2 + 1] - CSSM_compareTimestamps[i * 2]) *
+					env.Window().features.timestampPeriod;
+			}
+
+			if (++CSSM_compareFrames == 120)
+			{
+				for (uint32_t i = 0; i < CSSM_compareCount; i++)
+				{
+					double megabytes = static_cast<double>(SHADOW_MAP_RESOLUTION) * SHADOW_MAP_RESOLUTION * SHADOW_CASCADE_COUNT *
+						Renderer::CSSMColourTexelSize(CSSM_compareFormats[i]) / (1024.0 * 1024.0);
+					printf("%-14s %7.3f ms %7.1f MiB%s\n", CSSM_compareNames[i], CSSM_compareTimes[i] / (CSSM_compareFrames * 1000000.0),
+						megabytes, (i == CSSM_compareSelected) ? " (lighting)" : "");
+					CSSM_compareTimes[i] = 0.0;
+				}
+				CSSM_compareFrames = 0;
+			}
+
+			if (CSSM_compareValidate)
+			{
+				CSSM_compareValidate = false;
+				vkDeviceWaitIdle(env.Window().device);
+
+				/* every format was rendered with the same noise, so any difference is encoding error */
+				std::vector<const uint8_t*> texels(CSSM_compareCount, nullptr);
+				for (uint32_t i = 0; i < CSSM_compareCount; i++)
+				{
+					void* dataPtr = nullptr;
+					if (const auto& res = vmaMapMemory(env.Allocator().allocator, CSSM_compareReadbacks[i].allocation, &dataPtr); res != VK_SUCCESS)
+					{
+						throw lut::Error("VK: vmaMapMemory() failed to map a CSSM comparison buffer. err: %s",
+							lut::to_string(res).c_str());
+					}
+					vmaInvalidateAllocation(env.Allocator().allocator, CSSM_compareReadbacks[i].allocation, 0, VK_WHOLE_SIZE);
+					texels[i] = static_cast<const uint8_t*>(dataPtr);
+				}
+
+				const size_t texelCount = static_cast<size_t>(SHADOW_MAP_RESOLUTION) * SHADOW_MAP_RESOLUTION * SHADOW_CASCADE_COUNT;
+				for (uint32_t i = 1; i < CSSM_compareCount; i++)
+				{
+					uint32_t stride = Renderer::CSSMColourTexelSize(CSSM_compareFormats[i]);
+					float maxError = 0.0f;
+					double totalError = 0.0;
+					size_t overBias = 0;
+
+					for (size_t t = 0; t < texelCount; t++)
+					{
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							float reference = Renderer::DecodeCSSMColourDepth(texels[0] + t * 16, CSSM_compareFormats[0], c);
+							float encoded = Renderer::DecodeCSSMColourDepth(texels[i] + t * stride, CSSM_compareFormats[i], c);
+							float error = std::abs(encoded - reference);
+
+							maxError = std::max(maxError, error);
+							totalError += error;
+							overBias += (error > CSSM_compareDepthBias) ? 1 : 0;
+						}
+					}
+
+					printf("%-14s max depth error %.6f, mean %.8f, %.4f%% of depths off by more than the depth bias\n",
+						CSSM_compareNames[i], maxError, totalError / (texelCount * 3.0),
+						100.0 * static_cast<double>(overBias) / (texelCount * 3.0));
+				}
+
+				for (uint32_t i = 0; i < CSSM_compareCount; i++)
+					vmaUnmapMemory(env.Allocator().allocator, CSSM_compareReadbacks[i].allocation);
+			}
+		#endif
+
 		/* Increment the frame count */
 		frameNumber++;
 	}
 
+	#if CSSM_FORMAT_COMPARISON
+		vkDeviceWaitIdle(env.Window().device);
+		vkDestroyQueryPool(env.Window().device, CSSM_compareQueries, nullptr);
+	#endif
+
 	#if TIMING
 		statsFile.close();
 		/* Destroy the querying resources */